@@ -34,6 +34,7 @@
 //:# - En el calculo de la matriz inversa puedes pasarle el determinante. (08-02-2017)
 //:# - Nuevas funciones IntersecPlaneLine(). (08-09-2016)
 //:# - Nuevas funciones MulMatrix3x3(), TrasMatrix3x3() y RotMatrix3x3(). (29-11-2017)
+//:# - Nuevas funciones Float2Half() y Half2Float(). (18-10-2026)
 //:#############################################################################
 
 /// \file FunctionsMath.h \brief Declares basic/general math functions.
@@ -45,6 +46,7 @@
 #include <cstdlib>
 #include <cmath>
 #include <cfloat>
+#include <cstring>
 
 /// Implements a set of basic/general math functions.
 namespace fmath{
@@ -699,6 +701,54 @@ inline double sec(double z){ return(1.0 / cos(z)); }
 //==============================================================================
 inline double csc(double z){ return(1.0 / sin(z)); }
 
+//==============================================================================
+/// Devuelve valor float convertido a media precision (IEEE 754 binary16) 
+/// redondeando al par mas cercano. Los valores finitos fuera de rango se 
+/// saturan al maximo representable (65504).
+/// Returns float value converted to half precision (IEEE 754 binary16) with
+/// round to nearest even. Finite values out of range saturate to the maximum
+/// representable value (65504).
+//==============================================================================
+inline word Float2Half(float v){
+  unsigned x; memcpy(&x,&v,sizeof(unsigned));
+  const unsigned sign=(x>>16)&0x8000;
+  const unsigned absx=x&0x7FFFFFFF;
+  if(absx>=0x7F800000)return(word(sign|(absx>0x7F800000? 0x7E00: 0x7C00))); //-NaN or Inf.
+  if(absx>=0x477FF000)return(word(sign|0x7BFF));                           //-Saturates to 65504.
+  if(absx<0x38800000){//-Subnormal or zero.
+    if(absx<0x33000000)return(word(sign));
+    const unsigned shift=126-(absx>>23);
+    const unsigned m=(absx&0x7FFFFF)|0x800000;
+    unsigned r=m>>shift;
+    const unsigned rem=m&((1u<<shift)-1),half=1u<<(shift-1);
+    if(rem>half || (rem==half && (r&1)))r++;
+    return(word(sign|r));
+  }
+  unsigned r=(absx-0x38000000)>>13;
+  const unsigned rem=absx&0x1FFF;
+  if(rem>0x1000 || (rem==0x1000 && (r&1)))r++;
+  return(word(sign|r));
+}
+
+//==============================================================================
+/// Devuelve valor float de un valor en media precision (IEEE 754 binary16).
+/// Returns float value of a half precision value (IEEE 754 binary16).
+//==============================================================================
+inline float Half2Float(word h){
+  const unsigned sign=unsigned(h&0x8000)<<16;
+  const unsigned e=(h>>10)&0x1F,m=h&0x3FF;
+  unsigned x;
+  if(e==0x1F)x=sign|0x7F800000|(m<<13);
+  else if(e)x=sign|((e+112)<<23)|(m<<13);
+  else if(m){
+    const float v=float(m)*5.9604644775390625e-8f; //-m*2^-24
+    return(sign? -v: v);
+  }
+  else x=sign;
+  float v; memcpy(&v,&x,sizeof(float));
+  return(v);
+}
+
 }
 
 #endif
@@ -19,9 +19,17 @@
 /// \file JArraysCpu.cpp \brief Implements the class \ref JArraysCpu.
 
 #include "JArraysCpu.h"
+#include "JNumaCpu.h"
+#include "JMemoryTracker.h"
 #include "Functions.h"
 #include <cstdio>
+#include <cstring>
 #include <algorithm>
+#ifdef WIN32
+  #include <malloc.h>
+#else
+  #include <sys/mman.h>
+#endif
 
 using namespace std;
 
@@ -36,6 +44,12 @@ JArraysCpuSize::JArraysCpuSize(unsigned elementsize):ElementSize(elementsize){
   for(unsigned c=0;c<MAXPOINTERS;c++)Pointers[c]=NULL;
   Count=0;
   CountMax=CountUsedMax=0;
+  NumReserve=NumFree=0;
+  HugePages=false;
+  Numa=NULL;
+  CountOld=0;
+  MemTrack=NULL;
+  MemTrackAlloc=MemTrackUsed=0;
   Reset();
 }
 
@@ -59,32 +73,71 @@ void JArraysCpuSize::Reset(){
 /// Frees allocated memory.
 //==============================================================================
 void JArraysCpuSize::FreeMemory(){
-  for(unsigned c=0;c<Count;c++)if(Pointers[c]){ FreePointer(Pointers[c]); Pointers[c]=NULL; }
+  for(unsigned c=0;c<Count;c++)if(Pointers[c]){ FreePointer(Pointers[c],ArraySize); Pointers[c]=NULL; }
   CountUsed=Count=0;
+  CountOld=0;
+  UpdateMemTrack();
 }
 
 //==============================================================================
-/// Reserva memoria y devuelve puntero con memoria asignada.
-/// Allocates memory and returns pointers with allocated memory.
+/// Devuelve el tamano en bytes de la memoria de un array de size elementos. 
+/// Con HugePages los arrays grandes usan multiplos de HUGEPAGESIZE.
+/// Returns the size in bytes of the memory of an array of size elements.
+/// With HugePages the large arrays use multiples of HUGEPAGESIZE.
 //==============================================================================
-void* JArraysCpuSize::AllocPointer(unsigned size)const{
+size_t JArraysCpuSize::GetMapSize(unsigned size)const{
+  const size_t bytes=size_t(size)*ElementSize;
+  return(HugePages && bytes>=HUGEPAGESIZE? (bytes+HUGEPAGESIZE-1)/HUGEPAGESIZE*HUGEPAGESIZE: bytes);
+}
+
+#ifndef WIN32
+//==============================================================================
+/// Mapea mapsize bytes alineados a HUGEPAGESIZE. Mapea una huge page extra y 
+/// recorta las partes no alineadas.
+/// Maps mapsize bytes aligned to HUGEPAGESIZE. It maps an extra huge page and 
+/// trims the unaligned parts.
+//==============================================================================
+void* JArraysCpuSize::MapAligned(size_t mapsize)const{
+  byte *ptr=(byte*)mmap(NULL,mapsize+HUGEPAGESIZE,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+  if(ptr==MAP_FAILED)RunException("MapAligned","Cannot allocate the requested memory.");
+  const size_t head=(HUGEPAGESIZE-size_t(ptr)%HUGEPAGESIZE)%HUGEPAGESIZE;
+  if(head)munmap(ptr,head);
+  munmap(ptr+head+mapsize,HUGEPAGESIZE-head);
+  return(ptr+head);
+}
+#endif
+
+//==============================================================================
+/// Reserva memoria y devuelve puntero con memoria asignada. Con Numa la memoria
+/// se inicializa desde los hilos que procesan cada rango (firsttouch).
+/// En Linux se usa mmap() para poder redimensionar con mremap() y con HugePages
+/// los arrays grandes se alinean a HUGEPAGESIZE y usan huge pages transparentes.
+/// La memoria siempre esta alineada al menos a ALIGNMENT bytes.
+/// Allocates memory and returns pointers with allocated memory. With Numa the
+/// memory is initialised from the threads that process each range (firsttouch).
+/// On Linux mmap() is used so the memory can be resized with mremap() and with
+/// HugePages the large arrays are aligned to HUGEPAGESIZE and use transparent
+/// huge pages. The memory is always aligned to ALIGNMENT bytes at least.
+//==============================================================================
+void* JArraysCpuSize::AllocPointer(unsigned size,bool firsttouch)const{
   void* pointer=NULL;
-  try{
-    switch(ElementSize){
-      case 1:   pointer=new char[size];      break;
-      case 2:   pointer=new word[size];      break;
-      case 4:   pointer=new int[size];       break;
-      case 8:   pointer=new double[size];    break;
-      case 12:  pointer=new int[size*3];     break;
-      case 16:  pointer=new int[size*4];     break;
-      case 24:  pointer=new double[size*3];  break;
-      case 32:  pointer=new double[size*4];  break;
-    }
+  const size_t mapsize=GetMapSize(size);
+#ifndef WIN32
+  if(mapsize>=HUGEPAGESIZE && HugePages){
+    pointer=MapAligned(mapsize);
+    #ifdef MADV_HUGEPAGE
+      madvise(pointer,mapsize,MADV_HUGEPAGE);
+    #endif
   }
-  catch(const std::bad_alloc){
-    RunException("AllocPointer","Cannot allocate the requested memory.");
+  else{
+    pointer=mmap(NULL,mapsize,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+    if(pointer==MAP_FAILED)RunException("AllocPointer","Cannot allocate the requested memory.");
   }
-  if(!pointer)RunException("AllocPointer","The elementsize value is invalid.");
+#else
+  pointer=_aligned_malloc(mapsize,ALIGNMENT);
+  if(!pointer)RunException("AllocPointer","Cannot allocate the requested memory.");
+#endif
+  if(Numa && firsttouch)Numa->FirstTouch(pointer,NULL,ElementSize,size,0);
   return(pointer);
 }
 
@@ -92,18 +145,51 @@ void* JArraysCpuSize::AllocPointer(unsigned size)const{
 /// Libera la memoria asignada del puntero.
 /// Frees memory allocated to pointers.
 //==============================================================================
-void JArraysCpuSize::FreePointer(void* pointer)const{
-  switch(ElementSize){
-    case 1:   delete[] ((char*)pointer);    pointer=NULL;   break;
-    case 2:   delete[] ((word*)pointer);    pointer=NULL;   break;
-    case 4:   delete[] ((int*)pointer);     pointer=NULL;   break;
-    case 8:   delete[] ((double*)pointer);  pointer=NULL;   break;
-    case 12:  delete[] ((int*)pointer);     pointer=NULL;   break;
-    case 16:  delete[] ((int*)pointer);     pointer=NULL;   break;
-    case 24:  delete[] ((double*)pointer);  pointer=NULL;   break;
-    case 32:  delete[] ((double*)pointer);  pointer=NULL;   break;
+void JArraysCpuSize::FreePointer(void* pointer,unsigned size)const{
+#ifndef WIN32
+  if(munmap(pointer,GetMapSize(size)))RunException("FreePointer","Cannot free the allocated memory.");
+#else
+  _aligned_free(pointer);
+#endif
+}
+
+//==============================================================================
+/// Redimensiona la memoria del puntero manteniendo los primeros ncopy elementos
+/// y devuelve el nuevo puntero. En Linux usa mremap() que mueve las paginas sin
+/// copiar datos, en otro caso reserva, copia y libera. Con HugePages los 
+/// arrays grandes se redimensionan en su sitio o se mueven a una reserva 
+/// alineada a HUGEPAGESIZE, de forma que siguen alineados.
+/// Resizes the memory of the pointer keeping the first ncopy elements and 
+/// returns the new pointer. On Linux it uses mremap() that moves the pages 
+/// without copying data, otherwise it allocates, copies and frees. With 
+/// HugePages the large arrays are resized in place or moved to a reservation
+/// aligned to HUGEPAGESIZE, so they remain aligned.
+//==============================================================================
+void* JArraysCpuSize::ResizePointer(void* pointer,unsigned size,unsigned newsize,unsigned ncopy)const{
+#ifndef WIN32
+  const size_t mapsize=GetMapSize(size),newmapsize=GetMapSize(newsize);
+  void *pointer2=MAP_FAILED;
+  if(newmapsize>=HUGEPAGESIZE && HugePages){
+    //-Resizes in place when it is aligned, otherwise the pages are moved to an aligned reservation.
+    //-Redimensiona en su sitio cuando esta alineado, en otro caso las paginas se mueven a una reserva alineada.
+    if(size_t(pointer)%HUGEPAGESIZE==0)pointer2=mremap(pointer,mapsize,newmapsize,0);
+    if(pointer2==MAP_FAILED){
+      void *ptr=MapAligned(newmapsize);
+      pointer2=mremap(pointer,mapsize,newmapsize,MREMAP_MAYMOVE|MREMAP_FIXED,ptr);
+      if(pointer2==MAP_FAILED)munmap(ptr,newmapsize);
+    }
   }
-  if(pointer)RunException("FreePointer","The elementsize value is invalid.");
+  else pointer2=mremap(pointer,mapsize,newmapsize,MREMAP_MAYMOVE);
+  if(pointer2==MAP_FAILED)RunException("ResizePointer","Cannot allocate the requested memory.");
+  #ifdef MADV_HUGEPAGE
+    if(HugePages && newmapsize>=HUGEPAGESIZE)madvise(pointer2,newmapsize,MADV_HUGEPAGE);
+  #endif
+#else
+  void *pointer2=AllocPointer(newsize);
+  if(ncopy)memcpy(pointer2,pointer,size_t(ncopy)*ElementSize);
+  FreePointer(pointer,size);
+#endif
+  return(pointer2);
 }
 
 //==============================================================================
@@ -123,11 +209,12 @@ void JArraysCpuSize::SetArrayCount(unsigned count){
       for(unsigned c=Count;c<count;c++)Pointers[c]=AllocPointer(ArraySize);
     }
     if(Count>count){//-Libera arrays. //-Frees arrays.
-      for(unsigned c=count;c<Count;c++){ FreePointer(Pointers[c]); Pointers[c]=NULL; }
+      for(unsigned c=count;c<Count;c++){ FreePointer(Pointers[c],ArraySize); Pointers[c]=NULL; }
     }
   }
   Count=count;
   CountMax=max(CountMax,Count);
+  UpdateMemTrack();
 }
 
 //==============================================================================
@@ -139,13 +226,36 @@ void JArraysCpuSize::SetArrayCount(unsigned count){
 void JArraysCpuSize::SetArraySize(unsigned size){
   if(CountUsed)RunException("SetArraySize","Unable to change the dimension of the arrays because some are in use.");
   if(ArraySize!=size){
-    ArraySize=size;
     unsigned count=Count;
     FreeMemory();
+    ArraySize=size;
     if(count)SetArrayCount(count);
   }
 }
 
+//==============================================================================
+/// Cambia el numero de elementos de los arrays manteniendo los primeros ncopy
+/// elementos de los arrays en uso. Los punteros anteriores se obtienen con 
+/// GetRenewed().
+/// Changes the number of elements in the arrays keeping the first ncopy 
+/// elements of the arrays in use. The previous pointers are obtained with 
+/// GetRenewed().
+//==============================================================================
+void JArraysCpuSize::ResizeArraySize(unsigned size,unsigned ncopy){
+  CountOld=0;
+  if(!ArraySize || !size)SetArraySize(size);
+  else if(ArraySize!=size){
+    ncopy=min(ncopy,min(ArraySize,size));
+    for(unsigned c=0;c<Count;c++){
+      OldPointers[c]=Pointers[c];
+      Pointers[c]=ResizePointer(Pointers[c],ArraySize,size,(c<CountUsed? ncopy: 0));
+    }
+    CountOld=Count;
+    ArraySize=size;
+    UpdateMemTrack();
+  }
+}
+
 //==============================================================================
 /// Solicita la reserva de un array.
 /// Requests allocating an array.
@@ -154,6 +264,8 @@ void* JArraysCpuSize::Reserve(){
   if(CountUsed==Count||!ArraySize)RunException("Reserve",fun::PrintStr("There are no arrays available with %u bytes.",ElementSize));
   CountUsed++;
   CountUsedMax=max(CountUsedMax,CountUsed);
+  NumReserve++;
+  UpdateMemTrack();
   return(Pointers[CountUsed-1]);
 }
 
@@ -179,9 +291,107 @@ void JArraysCpuSize::Free(void *pointer){
       void *aux=Pointers[CountUsed-1]; Pointers[CountUsed-1]=Pointers[pos]; Pointers[pos]=aux;
     }
     CountUsed--;
+    NumFree++;
+    UpdateMemTrack();
   }
 }  
 
+//==============================================================================
+/// Reserva de nuevo la memoria de todos los arrays desde los hilos que procesan
+/// cada rango segun la ubicacion actual de Numa. Los primeros ncopy elementos 
+/// de los arrays en uso se copian. Los punteros anteriores se obtienen con 
+/// GetRenewed().
+/// Allocates again the memory of all arrays from the threads that process each
+/// range according to the current placement of Numa. The first ncopy elements 
+/// of arrays in use are copied. The previous pointers are obtained with 
+/// GetRenewed().
+//==============================================================================
+void JArraysCpuSize::NumaRenew(unsigned ncopy){
+  if(!Numa)RunException("NumaRenew","NUMA placement is not configured.");
+  ncopy=min(ncopy,ArraySize);
+  CountOld=0;
+  if(ArraySize){
+    //-Both copies of the arrays exist until the previous ones are freed. | Ambas copias de los arrays existen hasta liberar las previas.
+    if(MemTrack)MemTrack->AddAlloc(MemTrackAlloc);
+    for(unsigned c=0;c<Count;c++){
+      void *pointer=AllocPointer(ArraySize,false);
+      Numa->FirstTouch(pointer,(c<CountUsed? Pointers[c]: NULL),ElementSize,ArraySize,ncopy);
+      OldPointers[c]=Pointers[c];
+      Pointers[c]=pointer;
+    }
+    //-Frees previous memory after allocating all new arrays. | Libera la memoria previa tras reservar todos los arrays nuevos.
+    for(unsigned c=0;c<Count;c++)FreePointer(OldPointers[c],ArraySize);
+    if(MemTrack)MemTrack->AddAlloc(-MemTrackAlloc);
+    CountOld=Count;
+  }
+}
+
+//==============================================================================
+/// Devuelve el puntero que sustituye a uno previo a NumaRenew() o a 
+/// ResizeArraySize(). Los punteros previos no se acceden.
+/// Returns the pointer that replaces one previous to NumaRenew() or to 
+/// ResizeArraySize(). The previous pointers are not accessed.
+//==============================================================================
+void* JArraysCpuSize::GetRenewed(void *pointer)const{
+  if(pointer)for(unsigned c=0;c<CountOld;c++)if(OldPointers[c]==pointer)return(Pointers[c]);
+  return(pointer);
+}
+
+
+//==============================================================================
+/// Activa o desactiva el uso de huge pages. Solo se puede cambiar cuando no 
+/// hay memoria asignada.
+/// Enables or disables the use of huge pages. It can only be changed when 
+/// there is no allocated memory.
+//==============================================================================
+void JArraysCpuSize::SetHugePages(bool hugepages){
+  if(HugePages!=hugepages){
+    if(ArraySize && Count)RunException("SetHugePages","Unable to change the use of huge pages with allocated memory.");
+    HugePages=hugepages;
+  }
+}
+
+//==============================================================================
+/// Informa a MemTrack de los cambios de memoria reservada y usada.
+/// Reports to MemTrack the changes of allocated and used memory.
+//==============================================================================
+void JArraysCpuSize::UpdateMemTrack(){
+  if(MemTrack){
+    const llong alloc=GetAllocMemoryCpu();
+    const llong used=(llong)(CountUsed)*ElementSize*ArraySize;
+    if(alloc!=MemTrackAlloc || used!=MemTrackUsed){
+      MemTrack->AddMemory(alloc-MemTrackAlloc,used-MemTrackUsed);
+      MemTrackAlloc=alloc;
+      MemTrackUsed=used;
+    }
+  }
+}
+
+//==============================================================================
+/// Configura el objeto que registra la memoria reservada y usada. La memoria 
+/// actual se transfiere del anterior al nuevo.
+/// Configures the object that records the allocated and used memory. The 
+/// current memory is transferred from the previous one to the new one.
+//==============================================================================
+void JArraysCpuSize::SetMemTrack(JMemoryTracker *memtrack){
+  if(MemTrack)MemTrack->AddMemory(-MemTrackAlloc,-MemTrackUsed);
+  MemTrackAlloc=MemTrackUsed=0;
+  MemTrack=memtrack;
+  UpdateMemTrack();
+}
+
+//==============================================================================
+/// Devuelve texto con estadisticas de memoria y reservas de los arrays.
+/// Returns text with statistics of memory and reserves of the arrays.
+//==============================================================================
+std::string JArraysCpuSize::GetStatsInfo(unsigned nstep)const{
+  const double mbarray=double(ElementSize)*ArraySize/(1024*1024);
+  const double ns=double(max(nstep,1u));
+  return(fun::PrintStr("%2uB: %u arrays of %u (%.1f MB), used:%u (%.1f MB), peak:%u (%.1f MB), reserves:%u (%.1f/step), frees:%u (%.1f/step)"
+    ,ElementSize,Count,ArraySize,mbarray*Count,CountUsed,mbarray*CountUsed,CountUsedMax,mbarray*CountUsedMax
+    ,NumReserve,NumReserve/ns,NumFree,NumFree/ns));
+}
+
 
 //##############################################################################
 //# JArraysCpu
@@ -272,4 +482,95 @@ void JArraysCpu::SetArraySize(unsigned size){
   Arrays32b->SetArraySize(size);
 }
 
+//==============================================================================
+/// Cambia el numero de elementos de los arrays manteniendo los primeros ncopy
+/// elementos de los arrays en uso.
+/// Changes the number of elements in the arrays keeping the first ncopy 
+/// elements of the arrays in use.
+//==============================================================================
+void JArraysCpu::ResizeArraySize(unsigned size,unsigned ncopy){ 
+  Arrays1b->ResizeArraySize(size,ncopy); 
+  Arrays2b->ResizeArraySize(size,ncopy); 
+  Arrays4b->ResizeArraySize(size,ncopy); 
+  Arrays8b->ResizeArraySize(size,ncopy); 
+  Arrays12b->ResizeArraySize(size,ncopy);
+  Arrays16b->ResizeArraySize(size,ncopy);
+  Arrays24b->ResizeArraySize(size,ncopy);
+  Arrays32b->ResizeArraySize(size,ncopy);
+}
+
+//==============================================================================
+/// Configura la ubicacion de memoria de los arrays en nodos NUMA.
+/// Configures the placement of memory of arrays in NUMA nodes.
+//==============================================================================
+void JArraysCpu::SetNuma(const JNumaCpu *numa){ 
+  Arrays1b->SetNuma(numa); 
+  Arrays2b->SetNuma(numa); 
+  Arrays4b->SetNuma(numa); 
+  Arrays8b->SetNuma(numa); 
+  Arrays12b->SetNuma(numa);
+  Arrays16b->SetNuma(numa);
+  Arrays24b->SetNuma(numa);
+  Arrays32b->SetNuma(numa);
+}
+
+//==============================================================================
+/// Reserva de nuevo los arrays segun la ubicacion actual en nodos NUMA.
+/// Allocates again the arrays according to the current placement in NUMA nodes.
+//==============================================================================
+void JArraysCpu::NumaRenew(unsigned ncopy){ 
+  Arrays1b->NumaRenew(ncopy); 
+  Arrays2b->NumaRenew(ncopy); 
+  Arrays4b->NumaRenew(ncopy); 
+  Arrays8b->NumaRenew(ncopy); 
+  Arrays12b->NumaRenew(ncopy);
+  Arrays16b->NumaRenew(ncopy);
+  Arrays24b->NumaRenew(ncopy);
+  Arrays32b->NumaRenew(ncopy);
+}
+
+//==============================================================================
+/// Activa o desactiva el uso de huge pages (solo sin memoria asignada).
+/// Enables or disables the use of huge pages (only without allocated memory).
+//==============================================================================
+void JArraysCpu::SetHugePages(bool hugepages){ 
+  Arrays1b->SetHugePages(hugepages); 
+  Arrays2b->SetHugePages(hugepages); 
+  Arrays4b->SetHugePages(hugepages); 
+  Arrays8b->SetHugePages(hugepages); 
+  Arrays12b->SetHugePages(hugepages);
+  Arrays16b->SetHugePages(hugepages);
+  Arrays24b->SetHugePages(hugepages);
+  Arrays32b->SetHugePages(hugepages);
+}
+
+//==============================================================================
+/// Configura el objeto que registra la memoria reservada y usada.
+/// Configures the object that records the allocated and used memory.
+//==============================================================================
+void JArraysCpu::SetMemTrack(JMemoryTracker *memtrack){ 
+  Arrays1b->SetMemTrack(memtrack); 
+  Arrays2b->SetMemTrack(memtrack); 
+  Arrays4b->SetMemTrack(memtrack); 
+  Arrays8b->SetMemTrack(memtrack); 
+  Arrays12b->SetMemTrack(memtrack);
+  Arrays16b->SetMemTrack(memtrack);
+  Arrays24b->SetMemTrack(memtrack);
+  Arrays32b->SetMemTrack(memtrack);
+}
+
+//==============================================================================
+/// Devuelve texto con estadisticas de los arrays de cada tamano usado.
+/// Returns text with statistics of the arrays of each used size.
+//==============================================================================
+std::string JArraysCpu::GetStatsInfo(unsigned nstep)const{
+  const JArraysCpuSize* arrays[8]={Arrays1b,Arrays2b,Arrays4b,Arrays8b,Arrays12b,Arrays16b,Arrays24b,Arrays32b};
+  std::string tx;
+  for(unsigned c=0;c<8;c++)if(arrays[c]->GetArrayCountMax()){
+    if(!tx.empty())tx=tx+"\n";
+    tx=tx+"  "+arrays[c]->GetStatsInfo(nstep);
+  }
+  return(tx);
+}
+
 
@@ -21,6 +21,12 @@
 //:# =========
 //:# - Codigo creado a partir de JArraysGpu para usar con memoria CPU. (10-03-2014)
 //:# - Remplaza long long por llong. (01-10-2015)
+//:# - Nuevo metodo ResizeArraySize() que cambia el tamano de los arrays 
+//:#   manteniendo sus datos. En Linux la memoria se reserva con mmap() y se
+//:#   redimensiona con mremap() sin copiar datos. (18-10-2026)
+//:# - Arrays alineados a 64 bytes, uso opcional de huge pages transparentes y
+//:#   estadisticas de memoria y reservas de cada tamano. (18-10-2026)
+//:# - Informa de la memoria reservada y usada a un JMemoryTracker. (18-10-2026)
 //:#############################################################################
 
 /// \file JArraysCpu.h \brief Declares the class \ref JArraysCpu.
@@ -31,6 +37,10 @@
 #include "JObject.h"
 #include "TypesDef.h"
 #include "Types.h"
+#include <string>
+
+class JNumaCpu;
+class JMemoryTracker;
 
 //##############################################################################
 //# JArraysCpuSize
@@ -44,17 +54,34 @@ protected:
   unsigned ArraySize;
 
   static const unsigned MAXPOINTERS=30;
+  static const unsigned ALIGNMENT=64;              ///<Minimum alignment in bytes of the arrays.
+  static const unsigned HUGEPAGESIZE=2*1024*1024;  ///<Size of transparent huge pages in bytes.
   void* Pointers[MAXPOINTERS];
   unsigned Count;
   unsigned CountUsed;
 
   unsigned CountMax,CountUsedMax;
+  unsigned NumReserve;            ///<Number of arrays reserved with Reserve().
+  unsigned NumFree;               ///<Number of arrays freed with Free().
+  bool HugePages;                 ///<Arrays of HUGEPAGESIZE or more are aligned to HUGEPAGESIZE and use transparent huge pages (only Linux).
+
+  const JNumaCpu *Numa;           ///<Places memory of arrays in NUMA nodes by first touch (NULL when it is not used).
+  void* OldPointers[MAXPOINTERS]; ///<Previous pointers of arrays renewed by NumaRenew() or ResizeArraySize().
+  unsigned CountOld;              ///<Number of pointers in OldPointers[].
+
+  JMemoryTracker *MemTrack;       ///<Records the allocated and used memory (NULL when it is not used).
+  llong MemTrackAlloc;            ///<Allocated memory reported to MemTrack.
+  llong MemTrackUsed;             ///<Used memory reported to MemTrack.
   
-  void* AllocPointer(unsigned size)const;
-  void FreePointer(void* pointer)const;
+  size_t GetMapSize(unsigned size)const;
+  void* MapAligned(size_t mapsize)const;
+  void* AllocPointer(unsigned size,bool firsttouch=true)const;
+  void FreePointer(void* pointer,unsigned size)const;
+  void* ResizePointer(void* pointer,unsigned size,unsigned newsize,unsigned ncopy)const;
 
   void FreeMemory();
   unsigned FindPointerUsed(void *pointer)const;
+  void UpdateMemTrack();
 
 public:
   JArraysCpuSize(unsigned elementsize);
@@ -70,11 +97,22 @@ public:
 
   void SetArraySize(unsigned size);
   unsigned GetArraySize()const{ return(ArraySize); }
+  void ResizeArraySize(unsigned size,unsigned ncopy);
 
   llong GetAllocMemoryCpu()const{ return((llong)(Count)*ElementSize*ArraySize); };
 
   void* Reserve();
   void Free(void *pointer);
+
+  void SetNuma(const JNumaCpu *numa){ Numa=numa; }
+  void NumaRenew(unsigned ncopy);
+  void* GetRenewed(void *pointer)const;
+
+  void SetHugePages(bool hugepages);
+  void SetMemTrack(JMemoryTracker *memtrack);
+  unsigned GetNumReserve()const{ return(NumReserve); }
+  unsigned GetNumFree()const{ return(NumFree); }
+  std::string GetStatsInfo(unsigned nstep)const;
 };
 
 
@@ -113,6 +151,7 @@ public:
 
   void SetArraySize(unsigned size);
   unsigned GetArraySize()const{ return(Arrays1b->GetArraySize()); }
+  void ResizeArraySize(unsigned size,unsigned ncopy);
 
   byte*        ReserveByte(){       return((byte*)Arrays1b->Reserve());         }
   word*        ReserveWord(){       return((word*)Arrays2b->Reserve());         }
@@ -122,9 +161,11 @@ public:
   tfloat3*     ReserveFloat3(){     return((tfloat3*)Arrays12b->Reserve());     }
   tfloat4*     ReserveFloat4(){     return((tfloat4*)Arrays16b->Reserve());     }
   double*      ReserveDouble(){     return((double*)Arrays8b->Reserve());       }
+  thalf4*      ReserveHalf4(){      return((thalf4*)Arrays8b->Reserve());       }
   tdouble2*    ReserveDouble2(){    return((tdouble2*)Arrays16b->Reserve());    }
   tdouble3*    ReserveDouble3(){    return((tdouble3*)Arrays24b->Reserve());    }
   tsymatrix3f* ReserveSymatrix3f(){ return((tsymatrix3f*)Arrays24b->Reserve()); }
+  void*        ReserveSize(TpArraySize tsize){ return(GetArrays(tsize)->Reserve()); }
 #ifdef CODE_SIZE4
   typecode*    ReserveTypeCode(){   return(ReserveUint());                      }
 #else
@@ -139,9 +180,30 @@ public:
   void Free(tfloat3     *pointer){ Arrays12b->Free(pointer); }
   void Free(tfloat4     *pointer){ Arrays16b->Free(pointer); }
   void Free(double      *pointer){ Arrays8b->Free(pointer);  }
+  void Free(thalf4      *pointer){ Arrays8b->Free(pointer);  }
   void Free(tdouble2    *pointer){ Arrays16b->Free(pointer); }
   void Free(tdouble3    *pointer){ Arrays24b->Free(pointer); }
   void Free(tsymatrix3f *pointer){ Arrays24b->Free(pointer); }
+
+  void SetNuma(const JNumaCpu *numa);
+  void NumaRenew(unsigned ncopy);
+
+  void SetHugePages(bool hugepages);
+  void SetMemTrack(JMemoryTracker *memtrack);
+  std::string GetStatsInfo(unsigned nstep)const;
+
+  byte*        GetRenewed(byte        *pointer)const{ return((byte*)       Arrays1b->GetRenewed(pointer));  }
+  word*        GetRenewed(word        *pointer)const{ return((word*)       Arrays2b->GetRenewed(pointer));  }
+  unsigned*    GetRenewed(unsigned    *pointer)const{ return((unsigned*)   Arrays4b->GetRenewed(pointer));  }
+  int*         GetRenewed(int         *pointer)const{ return((int*)        Arrays4b->GetRenewed(pointer));  }
+  float*       GetRenewed(float       *pointer)const{ return((float*)      Arrays4b->GetRenewed(pointer));  }
+  tfloat3*     GetRenewed(tfloat3     *pointer)const{ return((tfloat3*)    Arrays12b->GetRenewed(pointer)); }
+  tfloat4*     GetRenewed(tfloat4     *pointer)const{ return((tfloat4*)    Arrays16b->GetRenewed(pointer)); }
+  double*      GetRenewed(double      *pointer)const{ return((double*)     Arrays8b->GetRenewed(pointer));  }
+  thalf4*      GetRenewed(thalf4      *pointer)const{ return((thalf4*)     Arrays8b->GetRenewed(pointer));  }
+  tdouble2*    GetRenewed(tdouble2    *pointer)const{ return((tdouble2*)   Arrays16b->GetRenewed(pointer)); }
+  tdouble3*    GetRenewed(tdouble3    *pointer)const{ return((tdouble3*)   Arrays24b->GetRenewed(pointer)); }
+  tsymatrix3f* GetRenewed(tsymatrix3f *pointer)const{ return((tsymatrix3f*)Arrays24b->GetRenewed(pointer)); }
 };
 
 
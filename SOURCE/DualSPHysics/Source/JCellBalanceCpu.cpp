@@ -0,0 +1,278 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+/// \file JCellBalanceCpu.cpp \brief Implements the class \ref JCellBalanceCpu.
+
+#include "JCellBalanceCpu.h"
+#include <climits>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+//==============================================================================
+/// Constructor.
+//==============================================================================
+JCellBalanceCpu::JCellBalanceCpu(int ompthreads,unsigned chunksthread)
+  :OmpThreads(ompthreads),ChunksThread(chunksthread),NumChunks(unsigned(ompthreads)*chunksthread)
+{
+  ClassName="JCellBalanceCpu";
+  SizeCells=0; CellCost=NULL;
+  for(unsigned c=0;c<PASS_COUNT;c++)ChunkPart[c]=new unsigned[NumChunks+1];
+#ifdef OMP_USE
+  for(int th=0;th<OmpThreads;th++)omp_init_lock(QueueLock+th);
+#endif
+  Reset();
+}
+
+//==============================================================================
+/// Destructor.
+//==============================================================================
+JCellBalanceCpu::~JCellBalanceCpu(){
+  Reset();
+  for(unsigned c=0;c<PASS_COUNT;c++){ delete[] ChunkPart[c]; ChunkPart[c]=NULL; }
+#ifdef OMP_USE
+  for(int th=0;th<OmpThreads;th++)omp_destroy_lock(QueueLock+th);
+#endif
+}
+
+//==============================================================================
+/// Initialisation of variables.
+//==============================================================================
+void JCellBalanceCpu::Reset(){
+  delete[] CellCost; CellCost=NULL;
+  SizeCells=0;
+  for(unsigned c=0;c<PASS_COUNT;c++)memset(ChunkPart[c],0,sizeof(unsigned)*(NumChunks+1));
+  RunPart=NULL;
+  memset(Queue,0,sizeof(StQueue)*OMP_MAXTHREADS);
+  RunTime=0;
+  ResetTimes();
+}
+
+//==============================================================================
+/// Initialisation of accumulated times.
+/// Inicializa los tiempos acumulados.
+//==============================================================================
+void JCellBalanceCpu::ResetTimes(){
+  for(int th=0;th<OMP_MAXTHREADS;th++)BusyTime[th]=IdleTime[th]=0;
+  NumSteal=0;
+}
+
+//==============================================================================
+/// Returns the allocated memory.
+/// Devuelve la memoria reservada.
+//==============================================================================
+llong JCellBalanceCpu::GetAllocMemory()const{
+  return(llong(sizeof(unsigned))*(SizeCells+(NumChunks+1)*PASS_COUNT));
+}
+
+//==============================================================================
+/// Returns the current time in seconds.
+/// Devuelve el instante actual en segundos.
+//==============================================================================
+double JCellBalanceCpu::GetTime(){
+#ifdef OMP_USE
+  return(omp_get_wtime());
+#else
+  return(0);
+#endif
+}
+
+//==============================================================================
+/// Allocates memory for the cost of the cells.
+/// Reserva memoria para el coste de las celdas.
+//==============================================================================
+void JCellBalanceCpu::AllocMemoryCells(unsigned ncells){
+  const char met[]="AllocMemoryCells";
+  if(ncells>SizeCells){
+    delete[] CellCost; CellCost=NULL;
+    SizeCells=0;
+    const unsigned size2=ncells+ncells/10+1024;
+    try{
+      CellCost=new unsigned[size2];
+    }
+    catch(const std::bad_alloc){
+      RunException(met,"Could not allocate the requested memory.");
+    }
+    SizeCells=size2;
+  }
+}
+
+//==============================================================================
+/// Computes the number of candidate pairs of the cells starting at cellini with 
+/// the neighbour cells starting at cellinitial2.
+///
+/// Calcula el numero de parejas candidatas de las celdas que empiezan en cellini
+/// con las celdas vecinas que empiezan en cellinitial2.
+//==============================================================================
+void JCellBalanceCpu::ComputeCost(const tint4 &nc,int hdiv,unsigned cellini,unsigned cellinitial2,const unsigned *begincell,const unsigned *cellrow,const unsigned *cellrowinv){
+  const int ncells=int(cellrow[nc.y*nc.z]);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(ncells>OMP_LIMIT_COMPUTEMEDIUM)
+  #endif
+  for(int c=0;c<ncells;c++){
+    const unsigned n1=begincell[cellini+c+1]-begincell[cellini+c];
+    unsigned cost=0;
+    if(n1){
+      const int cx=c%nc.x;
+      const int cy=int(cellrowinv[c/nc.x])%nc.y;
+      const int cz=int(cellrowinv[c/nc.x])/nc.y;
+      const int cxini=cx-min(cx,hdiv);
+      const int cxfin=cx+min(nc.x-cx-1,hdiv)+1;
+      const int yini=cy-min(cy,hdiv);
+      const int yfin=cy+min(nc.y-cy-1,hdiv)+1;
+      const int zini=cz-min(cz,hdiv);
+      const int zfin=cz+min(nc.z-cz-1,hdiv)+1;
+      unsigned n2=0;
+      for(int z=zini;z<zfin;z++)for(int y=yini;y<yfin;y++){
+        const int ymod=int(cellinitial2+cellrow[y+nc.y*z]);
+        n2+=begincell[cxfin+ymod]-begincell[cxini+ymod];
+      }
+      //-One is added for the cost of the particle without neighbours. | Se suma uno por el coste de la particula sin vecinas.
+      const ullong cost2=ullong(n1)*(n2+1);
+      cost=(cost2<UINT_MAX? unsigned(cost2): UINT_MAX);
+    }
+    CellCost[c]=cost;
+  }
+}
+
+//==============================================================================
+/// Splits particles [pini,pfin) of the cells starting at cellini into chunks 
+/// of consecutive cells with similar cost.
+///
+/// Divide las particulas [pini,pfin) de las celdas que empiezan en cellini en
+/// trozos de celdas consecutivas con coste similar.
+//==============================================================================
+void JCellBalanceCpu::MakeChunks(TpPass pass,unsigned ncells,unsigned cellini,const unsigned *begincell,unsigned pini,unsigned pfin){
+  unsigned *chunkpart=ChunkPart[pass];
+  const ullong nchunks=NumChunks;
+  ullong total=0;
+  for(unsigned c=0;c<ncells;c++)total+=CellCost[c];
+  chunkpart[0]=pini;
+  unsigned k=1;
+  ullong sum=0;
+  for(unsigned c=0;c<ncells && k<NumChunks;c++){
+    sum+=CellCost[c];
+    while(k<NumChunks && sum*nchunks>=total*k){
+      chunkpart[k]=max(pini,min(pfin,begincell[cellini+c+1]));
+      k++;
+    }
+  }
+  for(;k<=NumChunks;k++)chunkpart[k]=pfin;
+}
+
+//==============================================================================
+/// Computes chunks of balanced cost for each type of interaction starting from
+/// the current cell division.
+///
+/// Calcula trozos de coste equilibrado para cada tipo de interaccion a partir
+/// de la division en celdas actual.
+//==============================================================================
+void JCellBalanceCpu::Prepare(const tint4 &nc,int hdiv,unsigned cellfluid,const unsigned *begincell,const unsigned *cellrow,const unsigned *cellrowinv,unsigned np,unsigned npb,unsigned npbok){
+  const unsigned ncells=cellrow[nc.y*nc.z];
+  AllocMemoryCells(ncells);
+  for(unsigned pass=0;pass<PASS_COUNT;pass++){
+    const unsigned cellini=(pass==PASS_BoundFluid? 0: cellfluid);
+    const unsigned cellinitial2=(pass==PASS_FluidBound? 0: cellfluid);
+    const unsigned pini=(pass==PASS_BoundFluid? 0: npb);
+    const unsigned pfin=(pass==PASS_BoundFluid? npbok: np);
+    ComputeCost(nc,hdiv,cellini,cellinitial2,begincell,cellrow,cellrowinv);
+    MakeChunks(TpPass(pass),ncells,cellini,begincell,pini,pfin);
+  }
+}
+
+//==============================================================================
+/// Starts the chunk queues of one type of interaction. Each thread starts with
+/// a group of consecutive chunks.
+///
+/// Inicia las colas de trozos de un tipo de interaccion. Cada hilo empieza con
+/// un grupo de trozos consecutivos.
+//==============================================================================
+void JCellBalanceCpu::RunStart(TpPass pass){
+  RunPart=ChunkPart[pass];
+  for(int th=0;th<OmpThreads;th++){
+    StQueue &q=Queue[th];
+    q.ini=ChunksThread*th;
+    q.fin=q.ini+ChunksThread;
+    q.nsteal=0;
+    q.tchunk=-1;
+    q.busyrun=0;
+  }
+  RunTime=GetTime();
+}
+
+//==============================================================================
+/// Takes one chunk from the front (owner) or the back (other threads) of the 
+/// queue of thread thq.
+///
+/// Toma un trozo del principio (propietario) o del final (otros hilos) de la
+/// cola del hilo thq.
+//==============================================================================
+bool JCellBalanceCpu::TakeChunk(int thq,bool front,unsigned &pini,unsigned &pfin){
+  StQueue &q=Queue[thq];
+  unsigned cchunk=UINT_MAX;
+#ifdef OMP_USE
+  omp_set_lock(QueueLock+thq);
+#endif
+  if(q.ini<q.fin)cchunk=(front? q.ini++: --q.fin);
+#ifdef OMP_USE
+  omp_unset_lock(QueueLock+thq);
+#endif
+  if(cchunk!=UINT_MAX){
+    pini=RunPart[cchunk];
+    pfin=RunPart[cchunk+1];
+  }
+  return(cchunk!=UINT_MAX);
+}
+
+//==============================================================================
+/// Returns the next chunk [pini,pfin) for thread th. When its own queue is 
+/// empty, a chunk is taken from other threads. Returns false when there are
+/// no chunks left. The busy time of the previous chunk is accumulated.
+///
+/// Devuelve el siguiente trozo [pini,pfin) para el hilo th. Cuando su propia 
+/// cola esta vacia, se toma un trozo de otros hilos. Devuelve false cuando no
+/// quedan trozos. Se acumula el tiempo ocupado del trozo anterior.
+//==============================================================================
+bool JCellBalanceCpu::NextChunk(int th,unsigned &pini,unsigned &pfin){
+  StQueue &q=Queue[th];
+  const double t=GetTime();
+  if(q.tchunk>=0)q.busyrun+=t-q.tchunk;
+  bool ok=TakeChunk(th,true,pini,pfin);
+  for(int c=1;c<OmpThreads && !ok;c++){
+    ok=TakeChunk((th+c)%OmpThreads,false,pini,pfin);
+    if(ok)q.nsteal++;
+  }
+  q.tchunk=(ok? t: -1);
+  return(ok);
+}
+
+//==============================================================================
+/// Finishes the interaction and accumulates busy and idle time of threads.
+/// Finaliza la interaccion y acumula el tiempo ocupado y ocioso de los hilos.
+//==============================================================================
+void JCellBalanceCpu::RunEnd(){
+  const double trun=GetTime()-RunTime;
+  for(int th=0;th<OmpThreads;th++){
+    const StQueue &q=Queue[th];
+    BusyTime[th]+=q.busyrun;
+    IdleTime[th]+=max(0.,trun-q.busyrun);
+    NumSteal+=q.nsteal;
+  }
+  RunPart=NULL;
+}
+
@@ -0,0 +1,110 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+/// \file JCellBalanceCpu.h \brief Declares the class \ref JCellBalanceCpu.
+
+#ifndef _JCellBalanceCpu_
+#define _JCellBalanceCpu_
+
+#include "Types.h"
+#include "JObject.h"
+#include "OmpDefs.h"
+
+//##############################################################################
+//# JCellBalanceCpu
+//##############################################################################
+/// \brief Distributes the particle interaction among OpenMP threads using chunks 
+/// of cells with balanced cost and work stealing.
+///
+/// The cost of each cell is the number of candidate pairs (particles of the cell
+/// by particles of its neighbour cells) of the current cell division. The cells 
+/// are split into chunks of similar cost and each thread starts with a contiguous
+/// group of chunks. When a thread finishes its chunks it takes the last chunks 
+/// of other threads. The busy and idle time of each thread is accumulated.
+
+class JCellBalanceCpu : protected JObject
+{
+public:
+  /// Types of interaction with balanced chunks.
+  typedef enum{ 
+    PASS_FluidFluid=0,  ///<Interaction Fluid-Fluid.
+    PASS_FluidBound=1,  ///<Interaction Fluid-Bound.
+    PASS_BoundFluid=2   ///<Interaction Bound-Fluid.
+  }TpPass; 
+  static const unsigned PASS_COUNT=3;
+
+protected:
+  const int OmpThreads;       ///<Number of OpenMP threads. | Numero de hilos OpenMP.
+  const unsigned ChunksThread;///<Number of chunks per thread. | Numero de trozos por hilo.
+  const unsigned NumChunks;   ///<Number of chunks of each pass (OmpThreads*ChunksThread). | Numero de trozos de cada pasada (OmpThreads*ChunksThread).
+
+  unsigned SizeCells;         ///<Number of cells with allocated memory. | Numero de celdas con memoria reservada.
+  unsigned *CellCost;         ///<Number of candidate pairs of each cell [SizeCells]. | Numero de parejas candidatas de cada celda [SizeCells].
+  unsigned *ChunkPart[PASS_COUNT]; ///<First particle of each chunk and end of the last one [NumChunks+1]. | Primera particula de cada trozo y fin del ultimo [NumChunks+1].
+
+  /// Queue of chunks and times of one thread (padded to avoid false sharing).
+  typedef struct{
+    unsigned ini;     ///<Next chunk of the queue. | Siguiente trozo de la cola.
+    unsigned fin;     ///<End of chunks of the queue. | Fin de los trozos de la cola.
+    unsigned nsteal;  ///<Number of chunks taken from other threads in the current pass. | Numero de trozos tomados de otros hilos en la pasada actual.
+    double tchunk;    ///<Start time of the current chunk (negative without chunk). | Instante de inicio del trozo actual (negativo sin trozo).
+    double busyrun;   ///<Busy time in the current pass. | Tiempo ocupado en la pasada actual.
+    byte pad[32];
+  }StQueue;
+
+  //-Queues of chunks of the current pass. | Colas de trozos de la pasada actual.
+  const unsigned *RunPart;             ///<ChunkPart[] of the current pass. | ChunkPart[] de la pasada actual.
+  StQueue Queue[OMP_MAXTHREADS];       ///<Queue of chunks of each thread. | Cola de trozos de cada hilo.
+#ifdef OMP_USE
+  omp_lock_t QueueLock[OMP_MAXTHREADS];///<Lock of the queue of each thread. | Bloqueo de la cola de cada hilo.
+#endif
+
+  //-Times of threads. | Tiempos de los hilos.
+  double RunTime;                  ///<Start time of the current pass. | Instante de inicio de la pasada actual.
+  double BusyTime[OMP_MAXTHREADS]; ///<Accumulated busy time of each thread (seconds). | Tiempo ocupado acumulado de cada hilo (segundos).
+  double IdleTime[OMP_MAXTHREADS]; ///<Accumulated idle time of each thread (seconds). | Tiempo ocioso acumulado de cada hilo (segundos).
+  unsigned NumSteal;               ///<Number of chunks taken from other threads. | Numero de trozos tomados de otros hilos.
+
+  void AllocMemoryCells(unsigned ncells);
+  void ComputeCost(const tint4 &nc,int hdiv,unsigned cellini,unsigned cellinitial2,const unsigned *begincell,const unsigned *cellrow,const unsigned *cellrowinv);
+  void MakeChunks(TpPass pass,unsigned ncells,unsigned cellini,const unsigned *begincell,unsigned pini,unsigned pfin);
+  bool TakeChunk(int thq,bool front,unsigned &pini,unsigned &pfin);
+  static double GetTime();
+
+public:
+  JCellBalanceCpu(int ompthreads,unsigned chunksthread);
+  ~JCellBalanceCpu();
+  void Reset();
+  void ResetTimes();
+
+  void Prepare(const tint4 &nc,int hdiv,unsigned cellfluid,const unsigned *begincell,const unsigned *cellrow,const unsigned *cellrowinv,unsigned np,unsigned npb,unsigned npbok);
+  void RunStart(TpPass pass);
+  bool NextChunk(int th,unsigned &pini,unsigned &pfin);
+  void RunEnd();
+
+  int GetOmpThreads()const{ return(OmpThreads); }
+  unsigned GetChunksThread()const{ return(ChunksThread); }
+  double GetBusyTime(int th)const{ return(BusyTime[th]); }
+  double GetIdleTime(int th)const{ return(IdleTime[th]); }
+  unsigned GetNumSteal()const{ return(NumSteal); }
+
+  llong GetAllocMemory()const;
+};
+
+#endif
+
+
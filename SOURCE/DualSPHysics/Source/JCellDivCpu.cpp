@@ -23,6 +23,8 @@
 #include "JFormatFiles2.h"
 #include <cfloat>
 #include <climits>
+#include <algorithm>
+#include <vector>
 
 using namespace std;
 
@@ -43,6 +45,12 @@ JCellDivCpu::JCellDivCpu(bool stable,bool floating,byte periactive,TpCellOrder c
   CellPart=NULL;    SortPart=NULL;
   PartsInCell=NULL; BeginCell=NULL;
   VSort=NULL;
+  SortRuns=NULL;
+  IncDivide=0;
+  CellSfc=CELLSFC_None;
+  CellSparse=false;
+  CellRow=NULL; CellRowInv=NULL; CellRowSfc=NULL;
+  RowUsed=NULL; RowUsedPre=NULL;
   Reset();
 }
 
@@ -62,6 +70,12 @@ void JCellDivCpu::Reset(){
   IncreaseNp=0;
   FreeMemoryAll();
   Ndiv=NdivFull=0;
+  NdivInc=NdivIncFail=0;
+  DivideInc=false;
+  PrevNct=0;
+  PrevCellDomainMin=PrevCellDomainMax=TUint3(0);
+  SizeSortRuns=SortRunsCount=0;
+  SortArraysCount=0;
   Nptot=Npb1=Npf1=Npb2=Npf2=0;
   MemAllocNp=MemAllocNct=0;
   NpbOut=NpfOut=NpbOutIgnore=NpfOutIgnore=0;
@@ -70,6 +84,7 @@ void JCellDivCpu::Reset(){
   CellDomainMin=TUint3(1);
   CellDomainMax=TUint3(0);
   Ncx=Ncy=Ncz=Nsheet=Nct=0;
+  FreeMemoryCellRow();
   Nctt=0;
   BoundLimitOk=BoundDivideOk=false;
   BoundLimitCellMin=BoundLimitCellMax=TUint3(0);
@@ -88,6 +103,22 @@ void JCellDivCpu::FreeMemoryNct(){
   BoundDivideOk=false;
 }
 
+//==============================================================================
+/// Free memory reserved for order of rows of cells.
+/// Libera memoria reservada para el orden de las filas de celdas.
+//==============================================================================
+void JCellDivCpu::FreeMemoryCellRow(){
+  delete[] CellRow;     CellRow=NULL;
+  delete[] CellRowInv;  CellRowInv=NULL;
+  delete[] CellRowSfc;  CellRowSfc=NULL;
+  delete[] RowUsed;     RowUsed=NULL;
+  delete[] RowUsedPre;  RowUsedPre=NULL;
+  SizeCellRow=0;
+  CellRowNc=TUint3(0);
+  RowsStored=0;
+  CellRowChanged=false;
+}
+
 //==============================================================================
 /// Free memory reserved for particles.
 /// Libera memoria reservada para particulas.
@@ -96,6 +127,8 @@ void JCellDivCpu::FreeMemoryNp(){
   delete[] CellPart;    CellPart=NULL;
   delete[] SortPart;    SortPart=NULL;
   delete[] VSort;       SetMemoryVSort(NULL);
+  delete[] SortRuns;    SortRuns=NULL;
+  SizeSortRuns=SortRunsCount=0;
   MemAllocNp=0;
   BoundDivideOk=false;
 }
@@ -118,6 +151,7 @@ void JCellDivCpu::SetMemoryVSort(byte *vsort){
   VSortInt=(int*)VSort;        VSortWord=(word*)VSort;
   VSortFloat=(float*)VSort;    VSortFloat3=(tfloat3*)VSort;
   VSortFloat4=(tfloat4*)VSort; VSortDouble3=(tdouble3*)VSort;
+  VSortHalf4=(thalf4*)VSort;
   VSortSymmatrix3f=(tsymatrix3f*)VSort;
 }
 
@@ -199,7 +233,8 @@ void JCellDivCpu::CheckMemoryNct(unsigned nctmin){
   if(SizeNct<nctmin){
     unsigned overnct=0;
     if(OverMemoryCells>0){
-      ullong nct=ullong(Ncx+OverMemoryCells)*ullong(Ncy+OverMemoryCells)*ullong(Ncz+OverMemoryCells);
+      //-With CellSparse the margin is OverMemoryCells sheets of rows. | Con CellSparse el margen es OverMemoryCells laminas de filas.
+      ullong nct=(CellSparse? ullong(Ncx+OverMemoryCells)*ullong(RowsStored+OverMemoryCells*Ncy): ullong(Ncx+OverMemoryCells)*ullong(Ncy+OverMemoryCells)*ullong(Ncz+OverMemoryCells));
       ullong nctt=SizeBeginCell(nct);
       if(nctt!=unsigned(nctt))RunException("CheckMemoryNct","The number of cells is too big.");
       overnct=unsigned(nct);
@@ -209,6 +244,169 @@ void JCellDivCpu::CheckMemoryNct(unsigned nctmin){
   else if(!BeginCell)AllocMemoryNct(SizeNct);  
 }
 
+//==============================================================================
+/// Check reservation of memory for the runs of incremental divide. 
+/// If there is insufficient memory, the requested memory plus a margin is 
+/// reserved (the previous content is not kept).
+///
+/// Comprueba la reserva de memoria para los tramos del divide incremental. 
+/// Si no es suficiente, reserva la memoria requerida mas un margen (no se 
+/// conserva el contenido previo).
+//==============================================================================
+void JCellDivCpu::CheckMemorySortRuns(unsigned nrunsmin){
+  if(SizeSortRuns<nrunsmin){
+    const unsigned size=nrunsmin+nrunsmin/4+1024;
+    MemAllocNp-=sizeof(tuint3)*SizeSortRuns;
+    delete[] SortRuns; SortRuns=NULL; SizeSortRuns=0;
+    try{
+      SortRuns=new tuint3[size];
+    }
+    catch(const std::bad_alloc){
+      RunException("CheckMemorySortRuns",fun::PrintStr("Failed CPU memory allocation for %u runs of particles.",size));
+    }
+    SizeSortRuns=size;
+    MemAllocNp+=sizeof(tuint3)*SizeSortRuns;
+  }
+}
+
+//==============================================================================
+/// Returns position of cell (x,y) in a Morton curve.
+/// Devuelve posicion de la celda (x,y) en una curva de Morton.
+//==============================================================================
+static ullong MortonCode2(unsigned x,unsigned y){
+  ullong code=0;
+  for(unsigned b=0;b<32;b++)code|=(ullong((x>>b)&1)<<(2*b))|(ullong((y>>b)&1)<<(2*b+1));
+  return(code);
+}
+
+//==============================================================================
+/// Returns position of cell (x,y) in a Hilbert curve of n x n cells (n power of 2).
+/// Devuelve posicion de la celda (x,y) en una curva de Hilbert de n x n celdas (n potencia de 2).
+//==============================================================================
+static ullong HilbertCode2(unsigned n,unsigned x,unsigned y){
+  ullong code=0;
+  for(unsigned s=n/2;s>0;s/=2){
+    const unsigned rx=((x&s)>0? 1: 0);
+    const unsigned ry=((y&s)>0? 1: 0);
+    code+=ullong(s)*ullong(s)*((3*rx)^ry);
+    //-Rotates quadrant. | Rota cuadrante.
+    if(ry==0){
+      if(rx==1){ x=s-1-x; y=s-1-y; }
+      const unsigned t=x; x=y; y=t;
+    }
+  }
+  return(code);
+}
+
+//==============================================================================
+/// Allocates memory for the indicated number of rows of cells.
+/// Reserva memoria para el numero indicado de filas de celdas.
+//==============================================================================
+void JCellDivCpu::AllocMemoryCellRow(unsigned nrows){
+  FreeMemoryCellRow();
+  try{
+    CellRow=new unsigned[nrows+1];
+    CellRowInv=new unsigned[nrows+1];
+    CellRowSfc=new unsigned[nrows];
+    RowUsed=new byte[nrows];
+    RowUsedPre=new byte[nrows];
+  }
+  catch(const std::bad_alloc){
+    RunException("AllocMemoryCellRow",fun::PrintStr("Failed CPU memory allocation for %u rows of cells.",nrows));
+  }
+  SizeCellRow=nrows;
+}
+
+//==============================================================================
+/// Marks in RowUsed[] the rows of cells with some particle inside the domain.
+/// Marca en RowUsed[] las filas de celdas con alguna particula dentro del dominio.
+//==============================================================================
+void JCellDivCpu::MarkRowsUsed(const unsigned *dcellc){
+  memset(RowUsed,0,sizeof(byte)*Ncy*Ncz);
+  const int n=int(Nptot);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int p=0;p<n;p++){
+    const unsigned rcell=dcellc[p];
+    const unsigned cx=PC__Cellx(DomCellCode,rcell)-CellDomainMin.x;
+    const unsigned cy=PC__Celly(DomCellCode,rcell)-CellDomainMin.y;
+    const unsigned cz=PC__Cellz(DomCellCode,rcell)-CellDomainMin.z;
+    if(cx<Ncx && cy<Ncy && cz<Ncz)RowUsed[cy+cz*Ncy]=1;
+  }
+}
+
+//==============================================================================
+/// Calculate order of the rows of cells along X (CellRow[] and CellRowInv[])
+/// and returns the number of cells to store. Rows are kept contiguous, so the 
+/// neighbour cells of a row are a range of BeginCell[], and the rows are 
+/// ordered in the Y-Z plane following CellSfc. With CellSparse only the rows
+/// with particles are stored and all empty rows point to one row without 
+/// particles, so the interaction code does not change.
+///
+/// Calcula el orden de las filas de celdas en X (CellRow[] y CellRowInv[]) y
+/// devuelve el numero de celdas a almacenar. Las filas se mantienen contiguas,
+/// asi las celdas vecinas de una fila son un rango de BeginCell[], y las filas
+/// se ordenan en el plano Y-Z segun CellSfc. Con CellSparse solo se almacenan
+/// las filas con particulas y todas las filas vacias apuntan a una fila sin
+/// particulas, asi el codigo de interaccion no cambia.
+//==============================================================================
+ullong JCellDivCpu::PrepareCellRows(const unsigned *dcellc){
+  const tuint3 nc=TUint3(Ncx,Ncy,Ncz);
+  const unsigned nrows=Ncy*Ncz;
+  CellRowChanged=false;
+  //-Calculate order of all rows when the number of cells changes. | Calcula orden de todas las filas cuando cambia el numero de celdas.
+  if(!CellRow || CellRowNc!=nc){
+    if(SizeCellRow<nrows)AllocMemoryCellRow(nrows);
+    if(CellSfc==CELLSFC_None){
+      for(unsigned r=0;r<nrows;r++)CellRowSfc[r]=r;
+    }
+    else{
+      unsigned n=1;
+      while(n<Ncy || n<Ncz)n*=2;
+      std::vector< std::pair<ullong,unsigned> > key(nrows);
+      for(unsigned cz=0;cz<Ncz;cz++)for(unsigned cy=0;cy<Ncy;cy++){
+        const unsigned r=cy+cz*Ncy;
+        key[r]=std::make_pair(CellSfc==CELLSFC_Morton? MortonCode2(cy,cz): HilbertCode2(n,cy,cz),r);
+      }
+      std::sort(key.begin(),key.end());
+      for(unsigned c=0;c<nrows;c++)CellRowSfc[c]=key[c].second;
+    }
+    CellRowNc=nc;
+    CellRowChanged=true;
+  }
+  //-Check rows with particles. | Comprueba filas con particulas.
+  if(CellSparse){
+    MarkRowsUsed(dcellc);
+    if(CellRowChanged || memcmp(RowUsed,RowUsedPre,sizeof(byte)*nrows))CellRowChanged=true;
+    std::swap(RowUsed,RowUsedPre);
+  }
+  //-Calculate position of stored rows. | Calcula posicion de las filas almacenadas.
+  if(CellRowChanged){
+    const byte *rowused=(CellSparse? RowUsedPre: NULL);
+    unsigned nstored=0,rowempty=nrows;
+    for(unsigned c=0;c<nrows;c++){
+      const unsigned r=CellRowSfc[c];
+      if(!rowused || rowused[r]){
+        CellRowInv[nstored]=r;
+        CellRow[r]=nstored*Ncx;
+        nstored++;
+      }
+      else if(rowempty==nrows)rowempty=r;
+    }
+    //-Empty rows share the last row. | Las filas vacias comparten la ultima fila.
+    if(rowempty<nrows){
+      CellRowInv[nstored]=rowempty;
+      for(unsigned r=0;r<nrows;r++)if(!rowused[r])CellRow[r]=nstored*Ncx;
+      nstored++;
+    }
+    RowsStored=nstored;
+  }
+  const ullong nct=ullong(RowsStored)*Ncx;
+  CellRow[nrows]=unsigned(nct);
+  return(nct);
+}
+
 //==============================================================================
 /// Define simulation domain to use.
 /// Define el dominio de simulacion a usar.
@@ -394,11 +592,55 @@ void JCellDivCpu::CalcCellDomainFluid(unsigned n,unsigned pini,unsigned n2,unsig
   }
 }
 
+//==============================================================================
+/// Reorder values of particles in the runs of incremental divide. The runs 
+/// whose position does not change are not copied.
+///
+/// Reordena datos de particulas en los tramos del divide incremental. No se 
+/// copian los tramos cuya posicion no cambia.
+//==============================================================================
+template<class T> void JCellDivCpu::SortArrayRuns(T *vec,T *vsort)const{
+  const int nr=int(SortRunsCount);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(nr>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int r=0;r<nr;r++){
+    const tuint3 rr=SortRuns[r];
+    if(rr.x!=rr.y)memcpy(vsort+rr.x,vec+rr.y,sizeof(T)*rr.z);
+  }
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(nr>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int r=0;r<nr;r++){
+    const tuint3 rr=SortRuns[r];
+    if(rr.x!=rr.y)memcpy(vec+rr.x,vsort+rr.x,sizeof(T)*rr.z);
+  }
+}
+
+//==============================================================================
+/// Calculate SortPart[] of fluid particles starting from the runs of 
+/// incremental divide.
+///
+/// Calcula SortPart[] de las particulas fluid a partir de los tramos del 
+/// divide incremental.
+//==============================================================================
+void JCellDivCpu::MakeSortPartRuns(){
+  const int nr=int(SortRunsCount);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(nr>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int r=0;r<nr;r++){
+    const tuint3 rr=SortRuns[r];
+    for(unsigned c=0;c<rr.z;c++)SortPart[rr.x+c]=rr.y+c;
+  }
+}
+
 //==============================================================================
 /// Reorder values of all particles (for type word).
 /// Reordena datos de todas las particulas (para tipo word).
 //==============================================================================
 void JCellDivCpu::SortArray(word *vec){
+  if(DivideInc){ SortArrayRuns(vec,VSortWord); return; }
   const int n=int(Nptot);
   const int ini=(DivideFull? 0: int(NpbFinal));
   #ifdef OMP_USE
@@ -413,6 +655,7 @@ void JCellDivCpu::SortArray(word *vec){
 /// Reordena datos de todas las particulas (para tipo unsigned).
 //==============================================================================
 void JCellDivCpu::SortArray(unsigned *vec){
+  if(DivideInc){ SortArrayRuns(vec,(unsigned*)VSortInt); return; }
   const int n=int(Nptot);
   const int ini=(DivideFull? 0: int(NpbFinal));
   #ifdef OMP_USE
@@ -427,6 +670,7 @@ void JCellDivCpu::SortArray(unsigned *vec){
 /// Reordena datos de todas las particulas (para tipo float).
 //==============================================================================
 void JCellDivCpu::SortArray(float *vec){
+  if(DivideInc){ SortArrayRuns(vec,VSortFloat); return; }
   const int n=int(Nptot);
   const int ini=(DivideFull? 0: int(NpbFinal));
   #ifdef OMP_USE
@@ -441,6 +685,7 @@ void JCellDivCpu::SortArray(float *vec){
 /// Reordena datos de todas las particulas (para tipo tdouble3).
 //==============================================================================
 void JCellDivCpu::SortArray(tdouble3 *vec){
+  if(DivideInc){ SortArrayRuns(vec,VSortDouble3); return; }
   const int n=int(Nptot);
   const int ini=(DivideFull? 0: int(NpbFinal));
   #ifdef OMP_USE
@@ -455,6 +700,7 @@ void JCellDivCpu::SortArray(tdouble3 *vec){
 /// Reordena datos de todas las particulas (para tipo tfloat3).
 //==============================================================================
 void JCellDivCpu::SortArray(tfloat3 *vec){
+  if(DivideInc){ SortArrayRuns(vec,VSortFloat3); return; }
   const int n=int(Nptot);
   const int ini=(DivideFull? 0: int(NpbFinal));
   #ifdef OMP_USE
@@ -469,6 +715,7 @@ void JCellDivCpu::SortArray(tfloat3 *vec){
 /// Reordena datos de todas las particulas (para tipo tfloat4).
 //==============================================================================
 void JCellDivCpu::SortArray(tfloat4 *vec){
+  if(DivideInc){ SortArrayRuns(vec,VSortFloat4); return; }
   const int n=int(Nptot);
   const int ini=(DivideFull? 0: int(NpbFinal));
   #ifdef OMP_USE
@@ -478,11 +725,27 @@ void JCellDivCpu::SortArray(tfloat4 *vec){
   memcpy(vec+ini,VSortFloat4+ini,sizeof(tfloat4)*(n-ini));
 }
 
+//==============================================================================
+/// Reorder values of all particles (for type thalf4).
+/// Reordena datos de todas las particulas (para tipo thalf4).
+//==============================================================================
+void JCellDivCpu::SortArray(thalf4 *vec){
+  if(DivideInc){ SortArrayRuns(vec,VSortHalf4); return; }
+  const int n=int(Nptot);
+  const int ini=(DivideFull? 0: int(NpbFinal));
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int p=ini;p<n;p++)VSortHalf4[p]=vec[SortPart[p]];
+  memcpy(vec+ini,VSortHalf4+ini,sizeof(thalf4)*(n-ini));
+}
+
 //==============================================================================
 /// Reorder values of all particles (for type tsymatrix3f).
 /// Reordena datos de todas las particulas (para tipo tsymatrix3f).
 //==============================================================================
 void JCellDivCpu::SortArray(tsymatrix3f *vec){
+  if(DivideInc){ SortArrayRuns(vec,VSortSymmatrix3f); return; }
   const int n=int(Nptot);
   const int ini=(DivideFull? 0: int(NpbFinal));
   #ifdef OMP_USE
@@ -492,6 +755,56 @@ void JCellDivCpu::SortArray(tsymatrix3f *vec){
   memcpy(vec+ini,VSortSymmatrix3f+ini,sizeof(tsymatrix3f)*(n-ini));
 }
 
+//==============================================================================
+/// Register an array to be reordered in SortArrays() writing in dst.
+/// Registra un array para reordenar en SortArrays() escribiendo en dst.
+//==============================================================================
+void JCellDivCpu::AddSortArrayPtr(const void *vec,void *dst,unsigned size,TpSortBlock fun){
+  const char met[]="AddSortArrayPtr";
+  if(SortArraysCount>=SORTARRAYS_MAX)RunException(met,"There are too many arrays to reorder.");
+  if(vec==dst)RunException(met,"The destination of reordering can not be the source array.");
+  SortArraysVec[SortArraysCount]=vec;
+  SortArraysDst[SortArraysCount]=dst;
+  SortArraysSize[SortArraysCount]=size;
+  SortArraysFun[SortArraysCount]=fun;
+  SortArraysCount++;
+}
+
+//==============================================================================
+/// Reorder values of all particles of registered arrays in one pass over 
+/// SortPart[] writing in their destination arrays. Each block of SortPart[]
+/// is reused for all arrays while it is in cache. Values of bound particles
+/// are copied when divide only affected fluid particles.
+///
+/// Reordena datos de todas las particulas de los arrays registrados en una
+/// pasada sobre SortPart[] escribiendo en sus arrays de destino. Cada bloque
+/// de SortPart[] se reutiliza para todos los arrays mientras esta en cache.
+/// Los datos de particulas bound se copian cuando el divide solo afecto a 
+/// las particulas fluid.
+//==============================================================================
+void JCellDivCpu::SortArrays(){
+  if(!SortArraysCount)return;
+  if(DivideInc)RunException("SortArrays","Arrays can not be reordered together after incremental divide.");
+  const unsigned n=Nptot;
+  const unsigned ini=(DivideFull? 0: NpbFinal);
+  const unsigned na=SortArraysCount;
+  const int nblocks=int((n+SORTARRAYS_BLOCK-1)/SORTARRAYS_BLOCK);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int b=0;b<nblocks;b++){
+    const unsigned pini=unsigned(b)*SORTARRAYS_BLOCK;
+    const unsigned pfin=min(n,pini+SORTARRAYS_BLOCK);
+    const unsigned pini2=max(pini,min(pfin,ini));
+    for(unsigned ca=0;ca<na;ca++){
+      const unsigned size=SortArraysSize[ca];
+      if(pini<pini2)memcpy((byte*)SortArraysDst[ca]+size*pini,(const byte*)SortArraysVec[ca]+size*pini,size*(pini2-pini));
+      if(pini2<pfin)SortArraysFun[ca](SortArraysVec[ca],SortArraysDst[ca],SortPart,pini2,pfin);
+    }
+  }
+  SortArraysCount=0;
+}
+
 //==============================================================================
 /// Return current limites of domain.
 /// Devuelve limites actuales del dominio.
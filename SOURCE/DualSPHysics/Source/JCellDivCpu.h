@@ -30,6 +30,7 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <xmmintrin.h>
 
 //#define DBG_JCellDivCpu 1 //:DEL:
 
@@ -86,6 +87,7 @@ protected:
   float       *VSortFloat;       ///<To order vectors float (write to VSort). | Para ordenar vectores float (apunta a VSort).
   tfloat3     *VSortFloat3;      ///<To order vectors tfloat3 (write to VSort). | Para ordenar vectores tfloat3 (apunta a VSort).
   tfloat4     *VSortFloat4;      ///<To order vectors tfloat4 (write to VSort). | Para ordenar vectores tfloat4 (apunta a VSort).
+  thalf4      *VSortHalf4;       ///<To order vectors thalf4 (write to VSort). | Para ordenar vectores thalf4 (apunta a VSort).
   tdouble3    *VSortDouble3;     ///<To order vectors tdouble3 (write to VSort). | Para ordenar vectores tdouble3 (apunta a VSort).
   tsymatrix3f *VSortSymmatrix3f; ///<To order vectors tsymatrix3f (write to VSort). | Para ordenar vectores tsymatrix3f (apunta a VSort).
 
@@ -93,6 +95,27 @@ protected:
   llong MemAllocNct; ///<Memory reserved for cells. | Mermoria reservada para celdas.
 
   unsigned Ndiv,NdivFull;
+  unsigned NdivInc,NdivIncFail; ///<Number of incremental divides and of attempts that used the full sort. | Numero de divides incrementales y de intentos que usaron la ordenacion completa.
+
+  //-Variables for incremental divide. | Variables para divide incremental.
+  float IncDivide;        ///<Maximum fraction of fluid particles that change cell to update the division incrementally (0:disabled). | Fraccion maxima de particulas fluid que cambian de celda para actualizar la division de forma incremental (0:desactivado).
+  bool DivideInc;         ///<Indicate that the divide was incremental and SortRuns[] is used to reorder. | Indica que el divide fue incremental y se usa SortRuns[] para reordenar.
+  unsigned PrevNct;       ///<Number of cells of the previous divide. | Numero de celdas del divide previo.
+  tuint3 PrevCellDomainMin,PrevCellDomainMax; ///<Cell domain of the previous divide. | Dominio de celdas del divide previo.
+  unsigned SizeSortRuns;  ///<Number of runs with allocated memory in SortRuns[]. | Numero de tramos con memoria reservada en SortRuns[].
+  unsigned SortRunsCount; ///<Number of runs in SortRuns[]. | Numero de tramos en SortRuns[].
+  tuint3 *SortRuns;       ///<Runs of consecutive particles to reorder (x:destination, y:source, z:count) [SizeSortRuns]. | Tramos de particulas consecutivas a reordenar (x:destino, y:origen, z:cantidad) [SizeSortRuns].
+
+  //-Arrays reordered together in one pass over SortPart[]. | Arrays reordenados conjuntamente en una pasada sobre SortPart[].
+  static const unsigned SORTARRAYS_MAX=16;       ///<Maximum number of arrays reordered together. | Numero maximo de arrays reordenados conjuntamente.
+  static const unsigned SORTARRAYS_BLOCK=2048;   ///<Number of particles of each block of the pass. | Numero de particulas de cada bloque de la pasada.
+  static const unsigned SORTARRAYS_PREFETCH=16;  ///<Distance (in particles) of prefetch of source values. | Distancia (en particulas) de la precarga de valores de origen.
+  typedef void (*TpSortBlock)(const void *vec,void *dst,const unsigned *sortpart,unsigned pini,unsigned pfin);
+  unsigned SortArraysCount;                   ///<Number of arrays registered to be reordered together. | Numero de arrays registrados para reordenar conjuntamente.
+  const void *SortArraysVec[SORTARRAYS_MAX];  ///<Source arrays. | Arrays de origen.
+  void *SortArraysDst[SORTARRAYS_MAX];        ///<Destination arrays. | Arrays de destino.
+  unsigned SortArraysSize[SORTARRAYS_MAX];    ///<Size of the type of each array. | Tamano del tipo de cada array.
+  TpSortBlock SortArraysFun[SORTARRAYS_MAX];  ///<Reorders a block of each array. | Reordena un bloque de cada array.
 
   //-Number of particles by type to initialise in divide.
   //-Numero de particulas por tipo al iniciar el divide.
@@ -110,6 +133,19 @@ protected:
   tuint3 CellDomainMin; ///<Lower domain limit in cells inside of DomCells. | Limite inferior del dominio en celdas dentro de DomCells.
   tuint3 CellDomainMax; ///<Upper domain limit in cells inside of DomCells. | Limite superior del dominio en celdas dentro de DomCells.
   unsigned Ncx,Ncy,Ncz,Nsheet,Nct;
+
+  //-Variables to order the rows of cells along X. | Variables para ordenar las filas de celdas en X.
+  TpCellSfc CellSfc;     ///<Space-filling curve to order the rows of cells in Y-Z. | Curva de llenado del espacio para ordenar las filas de celdas en Y-Z.
+  bool CellSparse;       ///<Only the rows of cells with particles are stored, the empty rows share one row without particles. | Solo se almacenan las filas de celdas con particulas, las filas vacias comparten una fila sin particulas.
+  tuint3 CellRowNc;      ///<Number of cells used to compute CellRowSfc[]. | Numero de celdas usado para calcular CellRowSfc[].
+  unsigned SizeCellRow;  ///<Number of rows with allocated memory in CellRow[], CellRowInv[], CellRowSfc[] and RowUsed[]. | Numero de filas con memoria reservada en CellRow[], CellRowInv[], CellRowSfc[] y RowUsed[].
+  unsigned *CellRow;     ///<First cell of each row (cy+cz*Ncy) starting from the first cell of bound or fluid, the last value is the number of cells stored (Nct) [Ncy*Ncz+1]. | Primera celda de cada fila (cy+cz*Ncy) a partir de la primera celda de bound o fluid, el ultimo valor es el numero de celdas almacenadas (Nct) [Ncy*Ncz+1].
+  unsigned *CellRowInv;  ///<Row (cy+cz*Ncy) in each position of the order of stored rows [Ncy*Ncz+1]. | Fila (cy+cz*Ncy) en cada posicion del orden de filas almacenadas [Ncy*Ncz+1].
+  unsigned *CellRowSfc;  ///<Rows (cy+cz*Ncy) in the order of CellSfc [Ncy*Ncz]. | Filas (cy+cz*Ncy) en el orden de CellSfc [Ncy*Ncz].
+  byte *RowUsed;         ///<Rows with particles in the current divide (only with CellSparse) [Ncy*Ncz]. | Filas con particulas en el divide actual (solo con CellSparse) [Ncy*Ncz].
+  byte *RowUsedPre;      ///<Rows with particles in the previous divide (only with CellSparse) [Ncy*Ncz]. | Filas con particulas en el divide anterior (solo con CellSparse) [Ncy*Ncz].
+  unsigned RowsStored;   ///<Number of rows of cells stored in BeginCell[]. | Numero de filas de celdas almacenadas en BeginCell[].
+  bool CellRowChanged;   ///<CellRow[] changed in the current divide so all particles must be reordered. | CellRow[] cambio en el divide actual asi que hay que reordenar todas las particulas.
   ullong Nctt;          ///<Total number of special cells included  Nctt=SizeBeginCell(). | Numero total de celdas incluyendo las especiales Nctt=SizeBeginCell().
   unsigned BoxIgnore,BoxFluid,BoxBoundOut,BoxFluidOut,BoxBoundOutIgnore,BoxFluidOutIgnore;
 
@@ -133,12 +169,17 @@ protected:
   void AllocMemoryNct(ullong nct);
   void CheckMemoryNp(unsigned npmin);
   void CheckMemoryNct(unsigned nctmin);
+  void CheckMemorySortRuns(unsigned nrunsmin);
+  void FreeMemoryCellRow();
+  void AllocMemoryCellRow(unsigned nrows);
+  void MarkRowsUsed(const unsigned *dcellc);
+  ullong PrepareCellRows(const unsigned *dcellc);
 
   ullong SizeBeginCell(ullong nct)const{ return((nct*2)+5+1); } //-[BoundOk(nct),BoundIgnore(1),Fluid(nct),BoundOut(1),FluidOut(1),BoundOutIgnore(1),FluidOutIgnore(1),END(1)]
 
   ullong GetAllocMemoryNp()const{ return(MemAllocNp); };
   ullong GetAllocMemoryNct()const{ return(MemAllocNct); };
-  ullong GetAllocMemory()const{ return(GetAllocMemoryNp()+GetAllocMemoryNct()); };
+  ullong GetAllocMemory()const{ return(GetAllocMemoryNp()+GetAllocMemoryNct()+(sizeof(unsigned)*3+2)*ullong(SizeCellRow)); };
 
   void VisuBoundaryOut(unsigned p,unsigned id,tdouble3 pos,typecode code)const;
   //tuint3 GetMapCell(const tfloat3 &pos)const;
@@ -149,6 +190,32 @@ protected:
 
   unsigned CellSize(unsigned box)const{ return(BeginCell[box+1]-BeginCell[box]); }
 
+  void AddSortRun(unsigned dst,unsigned src,unsigned n){
+    if(SortRunsCount){
+      tuint3 &r=SortRuns[SortRunsCount-1];
+      if(r.x+r.z==dst && r.y+r.z==src){ r.z+=n; return; }
+    }
+    SortRuns[SortRunsCount++]=TUint3(dst,src,n);
+  }
+  void MakeSortPartRuns();
+  template<class T> void SortArrayRuns(T *vec,T *vsort)const;
+
+  void AddSortArrayPtr(const void *vec,void *dst,unsigned size,TpSortBlock fun);
+
+  /// Reorders the values of particles pini..pfin-1 prefetching the source values.
+  /// Reordena los valores de particulas pini..pfin-1 precargando los valores de origen.
+  template<class T> static void SortBlock(const void *vec,void *dst,const unsigned *sortpart,unsigned pini,unsigned pfin){
+    const T *v=(const T*)vec;
+    T *d=(T*)dst;
+    const unsigned pfinpre=(pfin-pini>SORTARRAYS_PREFETCH? pfin-SORTARRAYS_PREFETCH: pini);
+    unsigned p=pini;
+    for(;p<pfinpre;p++){
+      _mm_prefetch((const char*)(v+sortpart[p+SORTARRAYS_PREFETCH]),_MM_HINT_T0);
+      d[p]=v[sortpart[p]];
+    }
+    for(;p<pfin;p++)d[p]=v[sortpart[p]];
+  }
+
 public:
   JCellDivCpu(bool stable,bool floating,byte periactive,TpCellOrder cellorder,TpCellMode cellmode,float scell,tdouble3 mapposmin,tdouble3 mapposmax,tuint3 mapcells,unsigned casenbound,unsigned casenfixed,unsigned casenpb,JLog2 *log,std::string dirout,bool allocfullnct=true,float overmemorynp=CELLDIV_OVERMEMORYNP,word overmemorycells=CELLDIV_OVERMEMORYCELLS);
   ~JCellDivCpu();
@@ -161,8 +228,13 @@ public:
   void SortArray(tdouble3 *vec);
   void SortArray(tfloat3 *vec);
   void SortArray(tfloat4 *vec);
+  void SortArray(thalf4 *vec);
   void SortArray(tsymatrix3f *vec);
 
+  void ClearSortArrays(){ SortArraysCount=0; }
+  template<class T> void AddSortArray(const T *vec,T *dst){ AddSortArrayPtr(vec,dst,unsigned(sizeof(T)),&SortBlock<T>); }
+  void SortArrays();
+
   TpCellMode GetCellMode()const{ return(CellMode); }
   unsigned GetHdiv()const{ return(Hdiv); }
   float GetScell()const{ return(Scell); }
@@ -173,6 +245,11 @@ public:
   unsigned GetNcz()const{ return(Ncz); }
   tuint3 GetNcells()const{ return(TUint3(Ncx,Ncy,Ncz)); }
   unsigned GetBoxFluid()const{ return(BoxFluid); }
+  TpCellSfc GetCellSfc()const{ return(CellSfc); }
+  bool GetCellSparse()const{ return(CellSparse); }
+  unsigned GetRowsStored()const{ return(RowsStored); }
+  const unsigned* GetCellRow()const{ return(CellRow); }
+  const unsigned* GetCellRowInv()const{ return(CellRowInv); }
 
   tuint3 GetCellDomainMin()const{ return(CellDomainMin); }
   tuint3 GetCellDomainMax()const{ return(CellDomainMax); }
@@ -191,8 +268,20 @@ public:
 
   //:const unsigned* GetCellPart()const{ return(CellPart); }
   const unsigned* GetBeginCell(){ return(BeginCell); }
+  const unsigned* GetSortPart()const{ return(SortPart); }
+  bool GetDivideFull()const{ return(DivideFull); }
+  bool GetDivideInc()const{ return(DivideInc); }
 
   void SetIncreaseNp(unsigned increasenp){ IncreaseNp=increasenp; }
+  void SetIncDivide(float incdivide){ IncDivide=incdivide; }
+  void SetCellSfc(TpCellSfc cellsfc){ CellSfc=cellsfc; CellRowNc=TUint3(0); }
+  void SetCellSparse(bool cellsparse){ CellSparse=cellsparse; CellRowNc=TUint3(0); }
+
+  float GetIncDivide()const{ return(IncDivide); }
+  unsigned GetNdiv()const{ return(Ndiv); }
+  unsigned GetNdivFull()const{ return(NdivFull); }
+  unsigned GetNdivInc()const{ return(NdivInc); }
+  unsigned GetNdivIncFail()const{ return(NdivIncFail); }
 
   //:bool CellNoEmpty(unsigned box,byte kind)const;
   //:unsigned CellBegin(unsigned box,byte kind)const;
@@ -20,6 +20,10 @@
 
 #include "JCellDivCpuSingle.h"
 #include "Functions.h"
+#include "OmpDefs.h"
+#include <climits>
+#include <cstring>
+#include <algorithm>
 
 using namespace std;
 
@@ -33,6 +37,18 @@ JCellDivCpuSingle::JCellDivCpuSingle(bool stable,bool floating,byte periactive,T
   ,casenbound,casenfixed,casenpb,log,dirout)
 {
   ClassName="JCellDivCpuSingle";
+  SortHist=NULL; SizeSortHist=0;
+  IncMoves=NULL; SizeIncMoves=0;
+}
+
+//==============================================================================
+/// Destructor.
+//==============================================================================
+JCellDivCpuSingle::~JCellDivCpuSingle(){
+  delete[] SortHist; SortHist=NULL;
+  SizeSortHist=0;
+  delete[] IncMoves; IncMoves=NULL;
+  SizeIncMoves=0;
 }
 
 //==============================================================================
@@ -91,14 +107,18 @@ void JCellDivCpuSingle::MergeMapCellBoundFluid(const tuint3 &celbmin,const tuint
 /// Calcula numero de celdas a partir de (CellDomainMin/Max). 
 /// Obtiene localizacion de celdas especiales.
 //==============================================================================
-void JCellDivCpuSingle::PrepareNct(){
+void JCellDivCpuSingle::PrepareNct(const unsigned *dcellc){
   //-Calculate number of cells | Calcula numero de celdas.
   Ncx=CellDomainMax.x-CellDomainMin.x+1;
   Ncy=CellDomainMax.y-CellDomainMin.y+1;
   Ncz=CellDomainMax.z-CellDomainMin.z+1;
   //:printf("======  ncx:%u ncy:%u ncz:%u\n",Ncx,Ncy,Ncz);
-  Nsheet=Ncx*Ncy; Nct=Nsheet*Ncz; Nctt=SizeBeginCell(Nct);
+  Nsheet=Ncx*Ncy;
+  //-Calculate order of rows of cells and number of cells stored. | Calcula orden de las filas de celdas y numero de celdas almacenadas.
+  const ullong nct=PrepareCellRows(dcellc);
+  Nctt=SizeBeginCell(nct);
   if(Nctt!=unsigned(Nctt))RunException("PrepareNct","The number of cells is too big.");
+  Nct=unsigned(nct);
   BoxIgnore=Nct; 
   BoxFluid=BoxIgnore+1; 
   BoxBoundOut=BoxFluid+Nct; 
@@ -107,6 +127,38 @@ void JCellDivCpuSingle::PrepareNct(){
   BoxFluidOutIgnore=BoxBoundOutIgnore+1;
 }
 
+//==============================================================================
+/// Returns box of boundary or fluid particle starting from its cell in the map.
+/// Devuelve caja de particula bound o fluid a partir de su celda en el mapa.
+//==============================================================================
+inline unsigned JCellDivCpuSingle::GetSortBoxFull(unsigned rcell,typecode rcode)const{
+  unsigned cx=PC__Cellx(DomCellCode,rcell)-CellDomainMin.x;
+  unsigned cy=PC__Celly(DomCellCode,rcell)-CellDomainMin.y;
+  unsigned cz=PC__Cellz(DomCellCode,rcell)-CellDomainMin.z;
+  const bool xbound=(CODE_GetType(rcode)<CODE_TYPE_FLOATING);
+  const typecode codeout=CODE_GetSpecialValue(rcode);
+  unsigned box;
+  if(xbound){//-Bound particles (except floating) | Particulas bound (excepto floating).
+    box=(codeout<CODE_OUTIGNORE? ((cx<Ncx && cy<Ncy && cz<Ncz)? cx+CellRow[cy+cz*Ncy]: BoxIgnore): (codeout==CODE_OUTIGNORE? BoxBoundOutIgnore: BoxBoundOut));
+  }
+  else{//-Fluid particles | Particulas fluid.
+    box=(codeout<CODE_OUTIGNORE? BoxFluid+cx+CellRow[cy+cz*Ncy]: (codeout==CODE_OUTIGNORE? BoxFluidOutIgnore: BoxFluidOut));
+  }
+  return(box);
+}
+
+//==============================================================================
+/// Returns box of fluid particle starting from its cell in the map.
+/// Devuelve caja de particula fluid a partir de su celda en el mapa.
+//==============================================================================
+inline unsigned JCellDivCpuSingle::GetSortBoxFluid(unsigned rcell,typecode rcode)const{
+  unsigned cx=PC__Cellx(DomCellCode,rcell)-CellDomainMin.x;
+  unsigned cy=PC__Celly(DomCellCode,rcell)-CellDomainMin.y;
+  unsigned cz=PC__Cellz(DomCellCode,rcell)-CellDomainMin.z;
+  const typecode codeout=CODE_GetSpecialValue(rcode);
+  return(codeout<CODE_OUTIGNORE? BoxFluid+cx+CellRow[cy+cz*Ncy]: (codeout==CODE_OUTIGNORE? BoxFluidOutIgnore: BoxFluidOut));
+}
+
 //==============================================================================
 /// Calculate cell of each boundary and fluid particle (cellpart[]) starting from its cell in 
 /// the map,all the excluded particles are already going to be marked in code[].
@@ -123,21 +175,7 @@ void JCellDivCpuSingle::PrepareNct(){
 void JCellDivCpuSingle::PreSortFull(unsigned np,const unsigned *dcellc,const typecode *codec,unsigned* cellpart,unsigned* partsincell)const{
   memset(partsincell,0,sizeof(unsigned)*(Nctt-1));
   for(unsigned p=0;p<np;p++){
-    unsigned rcell=dcellc[p];
-    unsigned cx=PC__Cellx(DomCellCode,rcell)-CellDomainMin.x;
-    unsigned cy=PC__Celly(DomCellCode,rcell)-CellDomainMin.y;
-    unsigned cz=PC__Cellz(DomCellCode,rcell)-CellDomainMin.z;
-    const unsigned cellsort=cx+cy*Ncx+cz*Nsheet;
-    const typecode rcode=codec[p];
-    const bool xbound=(CODE_GetType(rcode)<CODE_TYPE_FLOATING);
-    const typecode codeout=CODE_GetSpecialValue(rcode);
-    unsigned box;
-    if(xbound){//-Bound particles (except floating) | Particulas bound (excepto floating).
-      box=(codeout<CODE_OUTIGNORE? ((cx<Ncx && cy<Ncy && cz<Ncz)? cellsort: BoxIgnore): (codeout==CODE_OUTIGNORE? BoxBoundOutIgnore: BoxBoundOut));
-    }
-    else{//-Fluid particles | Particulas fluid.
-      box=(codeout<CODE_OUTIGNORE? BoxFluid+cellsort: (codeout==CODE_OUTIGNORE? BoxFluidOutIgnore: BoxFluidOut));
-    }
+    const unsigned box=GetSortBoxFull(dcellc[p],codec[p]);
     cellpart[p]=box;
     partsincell[box]++;
   }
@@ -160,13 +198,7 @@ void JCellDivCpuSingle::PreSortFluid(unsigned np,unsigned pini,const unsigned *d
   memset(partsincell+BoxFluid,0,sizeof(unsigned)*(Nctt-1-BoxFluid));
   const unsigned pfin=pini+np;
   for(unsigned p=pini;p<pfin;p++){
-    unsigned rcell=dcellc[p];
-    unsigned cx=PC__Cellx(DomCellCode,rcell)-CellDomainMin.x;
-    unsigned cy=PC__Celly(DomCellCode,rcell)-CellDomainMin.y;
-    unsigned cz=PC__Cellz(DomCellCode,rcell)-CellDomainMin.z;
-    const unsigned cellsort=BoxFluid+cx+cy*Ncx+cz*Nsheet;
-    const typecode codeout=CODE_GetSpecialValue(codec[p]);
-    unsigned box=(codeout<CODE_OUTIGNORE? cellsort: (codeout==CODE_OUTIGNORE? BoxFluidOutIgnore: BoxFluidOut));
+    const unsigned box=GetSortBoxFluid(dcellc[p],codec[p]);
     cellpart[p]=box;
     partsincell[box]++;
   }
@@ -212,6 +244,268 @@ void JCellDivCpuSingle::MakeSortFluid(unsigned np,unsigned pini,const unsigned*
   }
 }
 
+//==============================================================================
+/// Calculate cellpart[], begincell[] and sortpart[] of particles [pini,pini+np)
+/// with a parallel counting sort (boxes from 0 with full or from BoxFluid). 
+/// Each thread counts the boxes of its range of particles in its own histogram
+/// with the interval of boxes of its particles (the special boxes are counted
+/// apart), so the particles of each box keep the order of the serial version.
+/// Returns false when OpenMP is not used or the histograms are too big (the 
+/// particles are not sorted by cell) and the serial version must be used.
+///
+/// Calcula cellpart[], begincell[] y sortpart[] de las particulas [pini,pini+np)
+/// con una ordenacion por conteo en paralelo (cajas desde 0 con full o desde 
+/// BoxFluid). Cada hilo cuenta las cajas de su rango de particulas en su propio
+/// histograma con el intervalo de cajas de sus particulas (las cajas especiales
+/// se cuentan aparte), asi las particulas de cada caja mantienen el orden de la
+/// version secuencial. Devuelve false cuando no se usa OpenMP o los histogramas
+/// son demasiado grandes (las particulas no estan ordenadas por celda) y debe
+/// usarse la version secuencial.
+//==============================================================================
+bool JCellDivCpuSingle::MakeSortOmp(bool full,unsigned np,unsigned pini,const unsigned *dcellc,const typecode *codec,unsigned* cellpart,unsigned* begincell,unsigned* partsincell,unsigned* sortpart){
+#ifdef OMP_USE
+  const int nth=omp_get_max_threads();
+  if(nth<2 || nth>OMP_MAXTHREADS || np<=OMP_LIMIT_COMPUTEMEDIUM)return(false);
+  const unsigned box0=(full? 0: BoxFluid);
+  const unsigned boxn=unsigned(Nctt-1);
+  unsigned thpini[OMP_MAXTHREADS+1];
+  unsigned thbmin[OMP_MAXTHREADS],thbmax[OMP_MAXTHREADS];
+  ullong thhist[OMP_MAXTHREADS];
+  unsigned thspec[OMP_MAXTHREADS][SORT_SPECIALBOXES];
+  for(int th=0;th<=nth;th++)thpini[th]=pini+unsigned((ullong(np)*th)/nth);
+  //-Computes box of each particle and interval of regular boxes of each thread.
+  //-Calcula caja de cada particula e intervalo de cajas regulares de cada hilo.
+  #pragma omp parallel num_threads(nth)
+  {
+    const int th=omp_get_thread_num();
+    unsigned bmin=UINT_MAX,bmax=0;
+    for(unsigned p=thpini[th];p<thpini[th+1];p++){
+      const unsigned box=(full? GetSortBoxFull(dcellc[p],codec[p]): GetSortBoxFluid(dcellc[p],codec[p]));
+      cellpart[p]=box;
+      if(GetSortSpecial(box)==SORT_SPECIALBOXES){
+        if(bmin>box)bmin=box;
+        if(bmax<box)bmax=box;
+      }
+    }
+    thbmin[th]=bmin; thbmax[th]=bmax;
+  }
+  //-Positions of histograms in SortHist[]. | Posiciones de los histogramas en SortHist[].
+  ullong nhist=0;
+  for(int th=0;th<nth;th++){
+    thhist[th]=nhist;
+    if(thbmin[th]<=thbmax[th])nhist+=thbmax[th]-thbmin[th]+1;
+  }
+  //-Uses serial version when histograms are bigger than the number of boxes and particles.
+  //-Usa la version secuencial cuando los histogramas son mayores que el numero de cajas y particulas.
+  if(nhist>ullong(boxn-box0)*2+np)return(false);
+  if(SizeSortHist<nhist){
+    delete[] SortHist; SortHist=NULL; SizeSortHist=0;
+    const ullong size=nhist+nhist/4+1024;
+    try{
+      SortHist=new unsigned[size];
+    }
+    catch(const std::bad_alloc){
+      RunException("MakeSortOmp",fun::PrintStr("Could not allocate the requested memory (%lld values).",size));
+    }
+    SizeSortHist=size;
+  }
+  //-Counts particles of each box in histogram of each thread.
+  //-Cuenta particulas de cada caja en el histograma de cada hilo.
+  #pragma omp parallel num_threads(nth)
+  {
+    const int th=omp_get_thread_num();
+    unsigned *hist=SortHist+thhist[th];
+    const unsigned bmin=thbmin[th];
+    unsigned *spec=thspec[th];
+    for(unsigned c=0;c<SORT_SPECIALBOXES;c++)spec[c]=0;
+    if(bmin<=thbmax[th])memset(hist,0,sizeof(unsigned)*(thbmax[th]-bmin+1));
+    for(unsigned p=thpini[th];p<thpini[th+1];p++){
+      const unsigned box=cellpart[p];
+      const unsigned cs=GetSortSpecial(box);
+      if(cs<SORT_SPECIALBOXES)spec[cs]++;
+      else hist[box-bmin]++;
+    }
+  }
+  //-Computes begincell[] with a parallel prefix sum over blocks of boxes and 
+  // changes histograms to the first position of each box for each thread.
+  //-Calcula begincell[] con una suma prefija paralela sobre bloques de cajas y 
+  // cambia los histogramas a la primera posicion de cada caja para cada hilo.
+  unsigned blocksum[OMP_MAXTHREADS];
+  const unsigned nbox=boxn-box0;
+  if(full)begincell[0]=0;
+  const unsigned begin0=begincell[box0]; //-It is read before the loop where begincell[box0] is written. | Se lee antes del bucle donde se escribe begincell[box0].
+  #pragma omp parallel num_threads(nth)
+  {
+    const int th=omp_get_thread_num();
+    const unsigned bini=box0+unsigned((ullong(nbox)*th)/nth),bfin=box0+unsigned((ullong(nbox)*(th+1))/nth);
+    //-Threads with regular boxes in this block. | Hilos con cajas regulares en este bloque.
+    int ths[OMP_MAXTHREADS],nths=0;
+    for(int t=0;t<nth;t++)if(thbmin[t]<=thbmax[t] && thbmin[t]<bfin && thbmax[t]>=bini)ths[nths++]=t;
+    unsigned sum=0;
+    for(unsigned box=bini;box<bfin;box++){
+      unsigned n=0;
+      const unsigned cs=GetSortSpecial(box);
+      if(cs<SORT_SPECIALBOXES)for(int t=0;t<nth;t++)n+=thspec[t][cs];
+      else for(int ct=0;ct<nths;ct++){
+        const int t=ths[ct];
+        if(box>=thbmin[t] && box<=thbmax[t])n+=SortHist[thhist[t]+box-thbmin[t]];
+      }
+      partsincell[box]=n;
+      sum+=n;
+    }
+    blocksum[th]=sum;
+    #pragma omp barrier
+    unsigned pos=begin0;
+    for(int t=0;t<th;t++)pos+=blocksum[t];
+    for(unsigned box=bini;box<bfin;box++){
+      begincell[box]=pos;
+      const unsigned cs=GetSortSpecial(box);
+      if(cs<SORT_SPECIALBOXES){
+        unsigned pos2=pos;
+        for(int t=0;t<nth;t++){ const unsigned n=thspec[t][cs]; thspec[t][cs]=pos2; pos2+=n; }
+      }
+      else{
+        unsigned pos2=pos;
+        for(int ct=0;ct<nths;ct++){
+          const int t=ths[ct];
+          if(box>=thbmin[t] && box<=thbmax[t]){
+            unsigned *h=SortHist+thhist[t]+box-thbmin[t];
+            const unsigned n=*h; *h=pos2; pos2+=n;
+          }
+        }
+      }
+      pos+=partsincell[box];
+    }
+    if(th+1==nth)begincell[boxn]=pos;
+  }
+  //-Puts particles in their boxes keeping the order of each box.
+  //-Coloca las particulas en sus cajas manteniendo el orden de cada caja.
+  #pragma omp parallel num_threads(nth)
+  {
+    const int th=omp_get_thread_num();
+    unsigned *hist=SortHist+thhist[th];
+    const unsigned bmin=thbmin[th];
+    unsigned *spec=thspec[th];
+    for(unsigned p=thpini[th];p<thpini[th+1];p++){
+      const unsigned box=cellpart[p];
+      const unsigned cs=GetSortSpecial(box);
+      if(cs<SORT_SPECIALBOXES)sortpart[spec[cs]++]=p;
+      else sortpart[hist[box-bmin]++]=p;
+    }
+  }
+  return(true);
+#else
+  return(false);
+#endif
+}
+
+//==============================================================================
+/// Updates CellPart[], BeginCell[] and the runs to reorder fluid particles 
+/// starting from the previous divide when few particles changed cell. The 
+/// particles of each box keep the order of the full counting sort: first the
+/// particles coming from previous boxes, then those that stay in the box and 
+/// finally those coming from next boxes.
+/// Returns false when the fraction of particles that changed cell is higher 
+/// than IncDivide or the cells changed and the full sort must be used.
+///
+/// Actualiza CellPart[], BeginCell[] y los tramos para reordenar las particulas
+/// fluid a partir del divide previo cuando pocas particulas cambiaron de celda. 
+/// Las particulas de cada caja mantienen el orden de la ordenacion por conteo 
+/// completa: primero las particulas que vienen de cajas previas, despues las 
+/// que siguen en la caja y finalmente las que vienen de cajas siguientes.
+/// Devuelve false cuando la fraccion de particulas que cambiaron de celda es 
+/// mayor que IncDivide o las celdas cambiaron y debe usarse la ordenacion completa.
+//==============================================================================
+bool JCellDivCpuSingle::MakeSortInc(const unsigned *dcellc,const typecode *codec){
+  const unsigned pini=Npb1,pfin=Npb1+Npf1;
+  //-Fluid particles of previous divide must be sorted in the same positions.
+  //-Las particulas fluid del divide previo deben estar ordenadas en las mismas posiciones.
+  //-BeginCell[] of previous divide is only valid with the same cells.
+  //-BeginCell[] del divide previo solo es valido con las mismas celdas.
+  if(Nct!=PrevNct || CellDomainMin!=PrevCellDomainMin || CellDomainMax!=PrevCellDomainMax){ NdivIncFail++; return(false); }
+  if(BeginCell[BoxFluid]!=pini || BeginCell[BoxBoundOut]!=pfin){ NdivIncFail++; return(false); }
+  const unsigned maxmoves=unsigned(IncDivide*Npf1);
+  int nth=1;
+  #ifdef OMP_USE
+    if(Npf1>OMP_LIMIT_COMPUTEMEDIUM)nth=min(omp_get_max_threads(),OMP_MAXTHREADS);
+  #endif
+  //-Each thread stores its particles that changed cell in its own part of IncMoves[].
+  //-Cada hilo guarda sus particulas que cambiaron de celda en su propia parte de IncMoves[].
+  const ullong sizemoves=ullong(maxmoves+1)*max(nth,2);
+  if(SizeIncMoves<sizemoves){
+    delete[] IncMoves; IncMoves=NULL; SizeIncMoves=0;
+    try{
+      IncMoves=new ullong[sizemoves];
+    }
+    catch(const std::bad_alloc){
+      RunException("MakeSortInc",fun::PrintStr("Could not allocate the requested memory (%lld values).",sizemoves));
+    }
+    SizeIncMoves=sizemoves;
+  }
+  unsigned thmoves[OMP_MAXTHREADS];
+  #ifdef OMP_USE
+    #pragma omp parallel num_threads(nth) if(nth>1)
+  #endif
+  {
+    #ifdef OMP_USE
+      const int th=omp_get_thread_num();
+    #else
+      const int th=0;
+    #endif
+    const unsigned thini=pini+unsigned((ullong(Npf1)*th)/nth),thfin=pini+unsigned((ullong(Npf1)*(th+1))/nth);
+    ullong *moves=IncMoves+ullong(maxmoves+1)*th;
+    unsigned nmoves=0;
+    for(unsigned p=thini;p<thfin && nmoves<=maxmoves;p++){
+      const unsigned box=GetSortBoxFluid(dcellc[p],codec[p]);
+      if(box!=CellPart[p]){
+        moves[nmoves++]=(ullong(box)<<32)|p;
+        CellPart[p]=box;
+      }
+    }
+    thmoves[th]=nmoves;
+  }
+  unsigned nmoves=0;
+  for(int th=0;th<nth;th++)nmoves+=thmoves[th];
+  if(nmoves>maxmoves){ NdivIncFail++; return(false); }
+  //-Joins moved particles by position and copies them sorted by new box.
+  //-Junta particulas movidas por posicion y las copia ordenadas por nueva caja.
+  for(int th=1,n=thmoves[0];th<nth;n+=thmoves[th],th++){
+    if(thmoves[th])memmove(IncMoves+n,IncMoves+ullong(maxmoves+1)*th,sizeof(ullong)*thmoves[th]);
+  }
+  ullong *movespos=IncMoves;
+  ullong *movesbox=IncMoves+nmoves;
+  memcpy(movesbox,movespos,sizeof(ullong)*nmoves);
+  sort(movesbox,movesbox+nmoves);
+  //-Computes new BeginCell[] and runs of particles. | Calcula nuevo BeginCell[] y tramos de particulas.
+  const unsigned boxn=unsigned(Nctt-1);
+  CheckMemorySortRuns(nmoves*2+(boxn-BoxFluid)+1);
+  SortRunsCount=0;
+  unsigned dst=pini,cpos=0,cbox=0;
+  unsigned oini=BeginCell[BoxFluid];
+  for(unsigned box=BoxFluid;box<boxn;box++){
+    const unsigned ofin=(box<BoxBoundOut? BeginCell[box+1]: oini);
+    BeginCell[box]=dst;
+    //-Particles coming from previous boxes. | Particulas que vienen de cajas previas.
+    for(;cbox<nmoves && unsigned(movesbox[cbox]>>32)==box && unsigned(movesbox[cbox])<oini;cbox++)AddSortRun(dst++,unsigned(movesbox[cbox]),1);
+    //-Particles that stay in the box. | Particulas que siguen en la caja.
+    unsigned p=oini;
+    for(;cpos<nmoves && unsigned(movespos[cpos])<ofin;cpos++){
+      const unsigned pm=unsigned(movespos[cpos]);
+      if(pm>p){ AddSortRun(dst,p,pm-p); dst+=pm-p; }
+      p=pm+1;
+    }
+    if(ofin>p){ AddSortRun(dst,p,ofin-p); dst+=ofin-p; }
+    //-Particles coming from next boxes. | Particulas que vienen de cajas siguientes.
+    for(;cbox<nmoves && unsigned(movesbox[cbox]>>32)==box;cbox++)AddSortRun(dst++,unsigned(movesbox[cbox]),1);
+    oini=ofin;
+  }
+  BeginCell[boxn]=dst;
+  if(dst!=pfin)RunException("MakeSortInc","The number of sorted particles is invalid.");
+  DivideInc=true;
+  NdivInc++;
+  return(true);
+}
+
 //==============================================================================
 /// Calculate cell of each particle (CellPart[]) starting from cell[], all the
 /// excluded particles will already be marked in code[].
@@ -227,12 +521,19 @@ void JCellDivCpuSingle::PreSort(const unsigned* dcellc,const typecode *codec){
   //-Carga SortPart[] con la p actual en los vectores de datos donde esta la particula que deberia ir en dicha posicion.
   //-Carga BeginCell[] con primera particula de cada celda.
   if(DivideFull){
-    PreSortFull(Nptot,dcellc,codec,CellPart,PartsInCell);
-    MakeSortFull(CellPart,BeginCell,PartsInCell,SortPart);
+    if(!MakeSortOmp(true,Nptot,0,dcellc,codec,CellPart,BeginCell,PartsInCell,SortPart)){
+      PreSortFull(Nptot,dcellc,codec,CellPart,PartsInCell);
+      MakeSortFull(CellPart,BeginCell,PartsInCell,SortPart);
+    }
+  }
+  else if(IncDivide && !Npb2 && !Npf2 && MakeSortInc(dcellc,codec)){
+    MakeSortPartRuns();
   }
   else{
-    PreSortFluid(Npf1,Npb1,dcellc,codec,CellPart,PartsInCell);
-    MakeSortFluid(Npf1,Npb1,CellPart,BeginCell,PartsInCell,SortPart);
+    if(!MakeSortOmp(false,Npf1,Npb1,dcellc,codec,CellPart,BeginCell,PartsInCell,SortPart)){
+      PreSortFluid(Npf1,Npb1,dcellc,codec,CellPart,PartsInCell);
+      MakeSortFluid(Npf1,Npb1,CellPart,BeginCell,PartsInCell,SortPart);
+    }
   }
   SortArray(CellPart); //-Order values of CellPart[] | Ordena valores de CellPart[].
 }
@@ -257,6 +558,7 @@ void JCellDivCpuSingle::Divide(unsigned npb1,unsigned npf1,unsigned npb2,unsigne
 {
   const char met[]="Divide";
   DivideFull=false;
+  DivideInc=false;
   TmcStart(timers,TMC_NlLimits);
 
   //-Establish number of particles. | Establece numero de particulas.
@@ -282,7 +584,7 @@ void JCellDivCpuSingle::Divide(unsigned npb1,unsigned npf1,unsigned npb2,unsigne
   CalcCellDomain(dcellc,codec,idpc,posc);
   //-Calculate number of cells for divide and check reservation of memory for cells.
   //-Calcula numero de celdas para el divide y comprueba reserva de memoria para celdas.
-  PrepareNct();
+  PrepareNct(dcellc);
   //-Check is there is memory reserved and if it is sufficient for Nptot.
   //-Comprueba si hay memoria reservada y si es suficiente para Nptot.
   CheckMemoryNct(Nct);
@@ -292,7 +594,7 @@ void JCellDivCpuSingle::Divide(unsigned npb1,unsigned npf1,unsigned npb2,unsigne
   //-BoundDivideOk returns false in order to reserve or free memory for particles or cells.
   //-Determina si el divide afecta a todas las particulas.
   //-BoundDivideOk se vuelve false al reservar o liberar memoria para particulas o celdas.
-  if(!BoundDivideOk || BoundDivideCellMin!=CellDomainMin || BoundDivideCellMax!=CellDomainMax){
+  if(!BoundDivideOk || BoundDivideCellMin!=CellDomainMin || BoundDivideCellMax!=CellDomainMax || CellRowChanged){
     DivideFull=true;
     BoundDivideOk=true; BoundDivideCellMin=CellDomainMin; BoundDivideCellMax=CellDomainMax;
   }
@@ -315,6 +617,7 @@ void JCellDivCpuSingle::Divide(unsigned npb1,unsigned npf1,unsigned npb2,unsigne
   NpFinal=Nptot-NpbOut-NpfOut-NpbOutIgnore-NpfOutIgnore;
   NpbFinal=Npb1+Npb2-NpbOut-NpbOutIgnore;
 
+  PrevNct=Nct; PrevCellDomainMin=CellDomainMin; PrevCellDomainMax=CellDomainMax;
   Ndiv++;
   if(DivideFull)NdivFull++;
   TmcStop(timers,TMC_NlMakeSort);
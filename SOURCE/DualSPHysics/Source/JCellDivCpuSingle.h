@@ -31,23 +31,38 @@
 class JCellDivCpuSingle : public JCellDivCpu
 {
 protected:
+  static const unsigned SORT_SPECIALBOXES=5; ///<Number of special boxes (BoxIgnore and boxes of excluded particles).
+
+  unsigned *SortHist;   ///<Histograms of boxes of each thread for parallel counting sort [SizeSortHist]. | Histogramas de cajas de cada hilo para ordenacion por conteo en paralelo [SizeSortHist].
+  ullong SizeSortHist;  ///<Number of values with allocated memory in SortHist[]. | Numero de valores con memoria reservada en SortHist[].
+
+  ullong *IncMoves;     ///<Fluid particles that changed cell in incremental divide (new box<<32|position) [SizeIncMoves]. | Particulas fluid que cambiaron de celda en el divide incremental (nueva caja<<32|posicion) [SizeIncMoves].
+  ullong SizeIncMoves;  ///<Number of values with allocated memory in IncMoves[]. | Numero de valores con memoria reservada en IncMoves[].
+
+  unsigned GetSortBoxFull(unsigned rcell,typecode rcode)const;
+  unsigned GetSortBoxFluid(unsigned rcell,typecode rcode)const;
+  unsigned GetSortSpecial(unsigned box)const{ return(box==BoxIgnore? 0: (box>=BoxBoundOut? 1+box-BoxBoundOut: SORT_SPECIALBOXES)); }
+
   void CalcCellDomain(const unsigned *dcellc,const typecode *codec,const unsigned* idpc,const tdouble3* posc);
   void MergeMapCellBoundFluid(const tuint3 &celbmin,const tuint3 &celbmax,const tuint3 &celfmin,const tuint3 &celfmax,tuint3 &celmin,tuint3 &celmax)const;
-  void PrepareNct();
+  void PrepareNct(const unsigned *dcellc);
 
   void PreSortFull(unsigned np,const unsigned *dcellc,const typecode *codec,unsigned* cellpart,unsigned* partsincell)const;
   void PreSortFluid(unsigned np,unsigned pini,const unsigned *dcellc,const typecode *codec,unsigned* cellpart,unsigned* partsincell)const;
   void MakeSortFull(const unsigned* cellpart,unsigned* begincell,unsigned* partsincell,unsigned* sortpart)const;
   void MakeSortFluid(unsigned np,unsigned pini,const unsigned* cellpart,unsigned* begincell,unsigned* partsincell,unsigned* sortpart)const;
+  bool MakeSortOmp(bool full,unsigned np,unsigned pini,const unsigned *dcellc,const typecode *codec,unsigned* cellpart,unsigned* begincell,unsigned* partsincell,unsigned* sortpart);
+  bool MakeSortInc(const unsigned *dcellc,const typecode *codec);
   void PreSort(const unsigned* dcellc,const typecode *codec);
 
 public:
   JCellDivCpuSingle(bool stable,bool floating,byte periactive,TpCellOrder cellorder,TpCellMode cellmode,float scell,tdouble3 mapposmin,tdouble3 mapposmax,tuint3 mapcells,unsigned casenbound,unsigned casenfixed,unsigned casenpb,JLog2 *log,std::string dirout);
+  ~JCellDivCpuSingle();
 
   void Divide(unsigned npb1,unsigned npf1,unsigned npb2,unsigned npf2,bool boundchanged
     ,const unsigned *dcellc,const typecode* codec,const unsigned* idpc,const tdouble3* posc,TimersCpu timers);
 
-  ullong GetAllocMemory()const{ return(JCellDivCpu::GetAllocMemory()); }
+  ullong GetAllocMemory()const{ return(JCellDivCpu::GetAllocMemory()+sizeof(unsigned)*SizeSortHist+sizeof(ullong)*SizeIncMoves); }
   ullong GetAllocMemoryNp()const{ return(JCellDivCpu::GetAllocMemoryNp()); };
   ullong GetAllocMemoryNct()const{ return(JCellDivCpu::GetAllocMemoryNct()); };
 };
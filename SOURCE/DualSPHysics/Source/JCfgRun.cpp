@@ -39,21 +39,41 @@ JCfgRun::JCfgRun(){
 void JCfgRun::Reset(){
   RunCommand=""; RunPath=""; ProgramPath="";
   PrintInfo=false; SvDef=false; DirsDef=0;
+  BenchRadix=0;
   Cpu=false;
   Gpu=false; GpuId=-1; GpuFree=false;
   Stable=false;
   PosDouble=-1;
   OmpThreads=0;
+  OmpPin=false;
+  Numa=false;
+  HugePages=false;
+  ArraysStats=false;
+  CompactState=false;
+  MemProfile=false;
+  FusedStep=false;
+  PeriImage=false;
+  Symmetry=false;
+  CellTile=false;
+  FusedInter=false;
+  SimdMode=SIMDMODE_None;
+  NeighListSkin=0;
+  CellBalance=0;
+  IncDivide=0;
+  CellSfc=CELLSFC_None;
+  CellSparse=false;
   BlockSizeMode=BSIZEMODE_Empirical;
   SvTimers=true;
   CellOrder=ORDER_None;
   CellMode=CELLMODE_2H;
+  CellModeAuto=0;
   DomainMode=0;
   DomainParticlesMin=DomainParticlesMax=TDouble3(0);
   DomainParticlesPrcMin=DomainParticlesPrcMax=TDouble3(0);
   DomainFixedMin=DomainFixedMax=TDouble3(0);
   TStep=STEP_None; VerletSteps=-1;
   TKernel=KERNEL_None;
+  KerTableSize=0;
   TVisco=VISCO_None; Visco=0; ViscoBoundFactor=-1;
   DeltaSph=-1;
   Shifting=-1;
@@ -86,6 +106,8 @@ void JCfgRun::VisuInfo()const{
   printf("  Options:\n");
   printf("    -h          Shows information about parameters\n");
   printf("    -ver        Shows version information\n");
+  printf("    -benchradix[:n]  Compares parallel radix sort against serial version and\n");
+  printf("        std::sort using n random keys (10000000 by default) and finishes\n");
   printf("    -opt <file> Loads a file configuration\n\n");
   printf("    -cpu        Execution on CPU (option by default)\n");
   printf("    -gpu[:id]   Execution on GPU and id of the device\n");
@@ -100,7 +122,74 @@ void JCfgRun::VisuInfo()const{
   printf("    -ompthreads:<int>  Only for CPU execution, indicates the number of threads\n");
   printf("                   by host for parallel execution, this takes the number of \n");
   printf("                   cores of the device by default (or using zero value)\n\n");
+  printf("    -omppin[:0/1]  Only for CPU execution, pins each thread to one cpu and\n");
+  printf("                   threads are distributed among NUMA nodes in contiguous\n");
+  printf("                   groups. The detected topology is shown at startup\n\n");
+  printf("    -numa[:0/1]    Only for CPU execution, particle arrays are split in one\n");
+  printf("                   range per thread and each range is initialised by its\n");
+  printf("                   thread so memory is placed in its NUMA node. Placement\n");
+  printf("                   is renewed after the division in cells when the ranges\n");
+  printf("                   change. Use with -omppin\n\n");
 #endif
+  printf("    -hugepages[:0/1]   Only for CPU execution on Linux, large particle arrays\n");
+  printf("                       are aligned to 2 MB and use transparent huge pages\n");
+  printf("    -arraysstats[:0/1] Only for CPU execution, shows memory and number of\n");
+  printf("                       reserves and frees of particle arrays of each size\n\n");
+  printf("    -compactstate[:0/1] Only for CPU execution, the previous velocity and\n");
+  printf("                     density of Verlet and the predictor state of Symplectic\n");
+  printf("                     are stored as differences with the current values in\n");
+  printf("                     half precision (and float for positions). It reduces\n");
+  printf("                     memory per particle with a small loss of accuracy\n\n");
+  printf("    -memprofile[:0/1] Only for CPU execution, records the current and peak\n");
+  printf("                     memory of each execution phase. The peak of each PART\n");
+  printf("                     is shown in Run.out and stored in the bi4 info\n\n");
+  printf("    -symmetry[:0/1]  Only for CPU execution, computes each pair of fluid\n");
+  printf("                     particles only once and applies the result to both\n");
+  printf("                     particles (not available with floating bodies)\n\n");
+  printf("    -celltile[:0/1]  Only for CPU execution, interaction of fluid particles\n");
+  printf("                     is computed cell by cell using a local copy of the data\n");
+  printf("                     of neighbour cells (not available with floating bodies)\n\n");
+  printf("    -fusedinter[:0/1]  Only for CPU execution, initialisation of arrays,\n");
+  printf("                     pressure and maximum velocity are computed in one sweep\n");
+  printf("                     before interaction and corrections of ace and ar with\n");
+  printf("                     maximum ace in one sweep after interaction. Results\n");
+  printf("                     may differ from the default code in the last bit of\n");
+  printf("                     pressure (vectorised pow)\n\n");
+  printf("    -simd:<mode>  Only for CPU execution, SIMD instructions used in particle\n");
+  printf("                  interaction with Pos-Single, Wendland kernel and artificial\n");
+  printf("                  viscosity (without floating bodies or shifting)\n");
+  printf("        none      Scalar code (by default)\n");
+  printf("        auto      Best instruction set supported by the CPU\n");
+  printf("        avx2      AVX2 instructions\n");
+  printf("        avx512    AVX-512 instructions\n\n");
+  printf("    -nlist[:skin]  Only for CPU execution, stores a list of neighbours with\n");
+  printf("                   cutoff 2h+skin*h which is reused while the displacement\n");
+  printf("                   of particles is lower than skin/2 (skin=0.2 by default).\n");
+  printf("                   The list is kept after each divide and periodic\n");
+  printf("                   boundaries use -periimage (so they are not supported\n");
+  printf("                   with DEM). Not available with Symmetry, CellTile or SIMD\n\n");
+  printf("    -periimage[:0/1]  Only for CPU execution, periodic boundaries are applied\n");
+  printf("                   in the neighbour search around the periodic images of\n");
+  printf("                   each particle instead of duplicating particles (not\n");
+  printf("                   available with DEM, Symmetry, CellTile or SIMD)\n\n");
+  printf("    -cellbalance[:n]  Only for CPU execution, interaction is distributed among\n");
+  printf("                   threads in n chunks per thread with similar number of\n");
+  printf("                   candidate pairs and idle threads take chunks from other\n");
+  printf("                   threads (n=8 by default). Busy and idle time of each\n");
+  printf("                   thread is shown with the timers\n\n");
+  printf("    -incdivide[:f]  Only for CPU execution, cell division of fluid is\n");
+  printf("                   updated moving only the particles that changed cell\n");
+  printf("                   when they are less than a fraction f of fluid particles\n");
+  printf("                   (0<=f<1, f=0.1 by default). Number of incremental\n");
+  printf("                   divides is shown with the timers\n\n");
+  printf("    -cellsfc:<mode>  Only for CPU execution, order of the rows of cells in\n");
+  printf("                   memory. Cells of each row along X are always contiguous\n");
+  printf("        none       Rows in order of Y and Z (by default)\n");
+  printf("        morton     Rows following a Morton curve in the Y-Z plane\n");
+  printf("        hilbert    Rows following a Hilbert curve in the Y-Z plane\n\n");
+  printf("    -cellsparse[:0/1]  Only for CPU execution, only the rows of cells along X\n");
+  printf("                   with particles are stored in the cell division. Reduces\n");
+  printf("                   memory of cells when most of the domain is empty\n\n");
   printf("    -blocksize:<mode>  Defines BlockSize to use in particle interactions on GPU\n");
   printf("        0: Fixed value (128) is used\n");
   printf("        1: Optimum BlockSize indicated by Occupancy Calculator of CUDA\n");
@@ -108,13 +197,20 @@ void JCfgRun::VisuInfo()const{
   //printf("    -cellorder:<axis> Indicates the order of the axes. (xyz/xzy/yxz/yzx/zxy/zyx)\n");
   printf("    -cellmode:<mode>  Specifies the cell division mode\n");
   printf("        2h        Lowest and the least expensive in memory (by default)\n");
-  printf("        h         Fastest and the most expensive in memory\n\n");
+  printf("        h         Fastest and the most expensive in memory\n");
+  printf("        auto[:n]  Measures n steps (10 by default) with 2h and with h and\n");
+  printf("                  continues with the fastest one (only for CPU execution)\n\n");
   printf("    -symplectic      Symplectic algorithm as time step algorithm\n");
   printf("    -verlet[:steps]  Verlet algorithm as time step algorithm and number of\n");
-  printf("                     time steps to switch equations\n\n");
+  printf("                     time steps to switch equations\n");
+  printf("    -fusedstep[:0/1] Only for CPU execution with Symplectic, shifting and\n");
+  printf("                     damping zones are applied in the same sweep over\n");
+  printf("                     particles that updates position, velocity and cell\n\n");
   printf("    -cubic           Cubic spline kernel\n");
   printf("    -wendland        Wendland kernel\n");
-  printf("    -gaussian        Gaussian kernel\n\n");
+  printf("    -gaussian        Gaussian kernel\n");
+  printf("    -kertable[:n]    Kernel gradient is interpolated from a table with n\n");
+  printf("                     intervals computed at the start (4096 by default)\n\n");
   printf("    -viscoart:<float>          Artificial viscosity [0-1]\n");
   printf("    -viscolamsps:<float>       Laminar+SPS viscosity [order of 1E-6]\n");  
   printf("    -viscoboundfactor:<float>  Multiplies the viscosity value of boundary\n");
@@ -172,18 +268,38 @@ void JCfgRun::VisuConfig()const{
   PrintVar("  PartBegin",PartBegin,ln);
   PrintVar("  PartBeginFirst",PartBeginFirst,ln);
   PrintVar("  PartBeginDir",PartBeginDir,ln);
+  PrintVar("  BenchRadix",BenchRadix,ln);
   PrintVar("  Cpu",Cpu,ln);
   printf("  %s  %s\n",VarStr("Gpu",Gpu).c_str(),VarStr("GpuId",GpuId).c_str());
   PrintVar("  GpuFree",GpuFree,ln);
   PrintVar("  Stable",Stable,ln);
   PrintVar("  PosDouble",PosDouble,ln);
   PrintVar("  OmpThreads",OmpThreads,ln);
+  PrintVar("  OmpPin",OmpPin,ln);
+  PrintVar("  Numa",Numa,ln);
+  PrintVar("  HugePages",HugePages,ln);
+  PrintVar("  ArraysStats",ArraysStats,ln);
+  PrintVar("  CompactState",CompactState,ln);
+  PrintVar("  MemProfile",MemProfile,ln);
+  PrintVar("  FusedStep",FusedStep,ln);
+  PrintVar("  PeriImage",PeriImage,ln);
+  PrintVar("  Symmetry",Symmetry,ln);
+  PrintVar("  CellTile",CellTile,ln);
+  PrintVar("  FusedInter",FusedInter,ln);
+  PrintVar("  SimdMode",GetNameSimdMode(SimdMode),ln);
+  PrintVar("  NeighListSkin",NeighListSkin,ln);
+  PrintVar("  CellBalance",CellBalance,ln);
+  PrintVar("  IncDivide",IncDivide,ln);
+  PrintVar("  CellSfc",GetNameCellSfc(CellSfc),ln);
+  PrintVar("  CellSparse",CellSparse,ln);
   PrintVar("  BlockSize",BlockSizeMode,ln);
   PrintVar("  CellOrder",GetNameCellOrder(CellOrder),ln);
   PrintVar("  CellMode",GetNameCellMode(CellMode),ln);
+  PrintVar("  CellModeAuto",CellModeAuto,ln);
   PrintVar("  TStep",TStep,ln);
   PrintVar("  VerletSteps",VerletSteps,ln);
   PrintVar("  TKernel",TKernel,ln);
+  PrintVar("  KerTableSize",KerTableSize,ln);
   PrintVar("  TVisco",TVisco,ln);
   PrintVar("  Visco",Visco,ln);
   PrintVar("  ViscoBoundFactor",ViscoBoundFactor,ln);
@@ -314,6 +430,11 @@ void JCfgRun::LoadOpts(string *optlis,int optn,int lv,string file){
       else if(txword=="GPU"){ Gpu=true; Cpu=false;
         if(txoptfull!="")GpuId=atoi(txoptfull.c_str()); 
       }
+      else if(txword=="BENCHRADIX"){
+        const int n=(txoptfull!=""? atoi(txoptfull.c_str()): 10000000);
+        if(n<=0)ErrorParm(opt,c,lv,file);
+        BenchRadix=unsigned(n);
+      }
       else if(txword=="STABLE")Stable=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
       else if(txword=="POSDOUBLE"){
         if(txoptfull=="0")PosDouble=0;
@@ -325,7 +446,47 @@ void JCfgRun::LoadOpts(string *optlis,int optn,int lv,string file){
       else if(txword=="OMPTHREADS"){ 
         OmpThreads=atoi(txoptfull.c_str()); if(OmpThreads<0)OmpThreads=0;
       } 
+      else if(txword=="OMPPIN")OmpPin=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="NUMA")Numa=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="HUGEPAGES")HugePages=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="ARRAYSSTATS")ArraysStats=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
 #endif
+      else if(txword=="COMPACTSTATE")CompactState=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="MEMPROFILE")MemProfile=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="FUSEDSTEP")FusedStep=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="PERIIMAGE")PeriImage=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="SYMMETRY")Symmetry=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="CELLTILE")CellTile=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="FUSEDINTER")FusedInter=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="SIMD"){
+        txoptfull=StrUpper(txoptfull);
+        if(txoptfull=="NONE")SimdMode=SIMDMODE_None;
+        else if(txoptfull=="AUTO")SimdMode=SIMDMODE_Auto;
+        else if(txoptfull=="AVX2")SimdMode=SIMDMODE_Avx2;
+        else if(txoptfull=="AVX512")SimdMode=SIMDMODE_Avx512;
+        else ErrorParm(opt,c,lv,file);
+      }
+      else if(txword=="NLIST"){
+        NeighListSkin=(txoptfull!=""? float(atof(txoptfull.c_str())): 0.2f);
+        if(NeighListSkin<0)ErrorParm(opt,c,lv,file);
+      }
+      else if(txword=="CELLBALANCE"){
+        const int n=(txoptfull!=""? atoi(txoptfull.c_str()): 8);
+        if(n<0 || n>1024)ErrorParm(opt,c,lv,file);
+        CellBalance=unsigned(n);
+      }
+      else if(txword=="INCDIVIDE"){
+        IncDivide=(txoptfull!=""? float(atof(txoptfull.c_str())): 0.1f);
+        if(IncDivide<0 || IncDivide>=1)ErrorParm(opt,c,lv,file);
+      }
+      else if(txword=="CELLSFC"){
+        txoptfull=StrUpper(txoptfull);
+        if(txoptfull=="NONE")CellSfc=CELLSFC_None;
+        else if(txoptfull=="MORTON")CellSfc=CELLSFC_Morton;
+        else if(txoptfull=="HILBERT")CellSfc=CELLSFC_Hilbert;
+        else ErrorParm(opt,c,lv,file);
+      }
+      else if(txword=="CELLSPARSE")CellSparse=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
       else if(txword=="BLOCKSIZE"){
         if(txoptfull=="0")BlockSizeMode=BSIZEMODE_Fixed;
         else if(txoptfull=="1")BlockSizeMode=BSIZEMODE_Occupancy;
@@ -351,8 +512,15 @@ void JCfgRun::LoadOpts(string *optlis,int optn,int lv,string file){
         bool ok=true;
         if(!txoptfull.empty()){
           txoptfull=StrUpper(txoptfull);
+          CellModeAuto=0;
           if(txoptfull=="H")CellMode=CELLMODE_H;
           else if(txoptfull=="2H")CellMode=CELLMODE_2H;
+          else if(StrUpper(txopt1)=="AUTO"){
+            const int n=(txopt2!=""? atoi(txopt2.c_str()): 10);
+            CellMode=CELLMODE_2H;
+            CellModeAuto=unsigned(n);
+            if(n<2)ok=false;
+          }
           else ok=false;
         }
         else ok=false;
@@ -365,6 +533,11 @@ void JCfgRun::LoadOpts(string *optlis,int optn,int lv,string file){
       else if(txword=="CUBIC")TKernel=KERNEL_Cubic;
       else if(txword=="WENDLAND")TKernel=KERNEL_Wendland;
       else if(txword=="GAUSSIAN")TKernel=KERNEL_Gaussian;
+      else if(txword=="KERTABLE"){
+        const int n=(txoptfull!=""? atoi(txoptfull.c_str()): 4096);
+        if(n<16 || n>(1<<24))ErrorParm(opt,c,lv,file);
+        KerTableSize=unsigned(n);
+      }
       else if(txword=="VISCOART"){ 
         Visco=float(atof(txoptfull.c_str())); 
         if(Visco>10)ErrorParm(opt,c,lv,file);
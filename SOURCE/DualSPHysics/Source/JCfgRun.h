@@ -64,6 +64,7 @@ public:
   std::string RunPath;
   std::string ProgramPath;
   bool PrintInfo;
+  unsigned BenchRadix;  ///<Number of values for the benchmark of JRadixSort (0:disabled).
 
   bool Cpu;
   bool Gpu;
@@ -73,13 +74,32 @@ public:
   int PosDouble;  ///<Precision in particle interaction. 0:Simple, 1:Double, 2:Uses and save double (default=0).
 
   int OmpThreads;
+  bool OmpPin;     ///<OpenMP threads are pinned to cpus of their NUMA nodes (only CPU).
+  bool Numa;       ///<Particle arrays are placed in the NUMA nodes of the threads that process them (only CPU).
+  bool HugePages;  ///<Particle arrays use transparent huge pages (only CPU on Linux).
+  bool ArraysStats;///<Shows statistics of particle arrays at the end of execution (only CPU).
+  bool CompactState;///<Previous-step state of Verlet and Symplectic is stored in reduced precision (only CPU).
+  bool MemProfile;  ///<Records the peak of memory of each execution phase and PART (only CPU).
+  bool PeriImage;   ///<Periodic boundaries search neighbours around periodic images of particles instead of duplicating particles (only CPU).
+  bool FusedStep;   ///<Symplectic applies shifting, update of particles and damping in one sweep (only CPU).
+  bool Symmetry;   ///<Fluid-Fluid interaction computes each pair only once (only CPU).
+  bool CellTile;   ///<Fluid interaction is computed cell by cell with a local copy of neighbour cells (only CPU).
+  bool FusedInter; ///<Preparation and reductions of interaction are computed in one sweep before and one after interaction (only CPU).
+  TpSimdMode SimdMode; ///<SIMD instructions used in particle interaction (only CPU).
+  float NeighListSkin; ///<Skin distance (factor of h) of the neighbour list reused between steps, 0:disabled (only CPU).
+  unsigned CellBalance; ///<Number of chunks per thread of balanced cost for interaction with work stealing, 0:disabled (only CPU).
+  float IncDivide;      ///<Maximum fraction of fluid particles that changed cell to update the cell division incrementally, 0:disabled (only CPU).
+  TpCellSfc CellSfc;    ///<Space-filling curve used to order the rows of cells (only CPU).
+  bool CellSparse;      ///<Only the rows of cells with particles are stored (only CPU).
   TpBlockSizeMode BlockSizeMode;
 
   TpCellOrder CellOrder;
   TpCellMode  CellMode;
+  unsigned CellModeAuto;  ///<Number of steps measured with each cell mode to select the fastest one (0:disabled, only CPU).
   TpStep TStep;
   int VerletSteps;
   TpKernel TKernel;
+  unsigned KerTableSize;  ///<Number of intervals of the tabulated kernel, 0:disabled (only CPU).
   TpVisco TVisco;
   float Visco;
   float ViscoBoundFactor;
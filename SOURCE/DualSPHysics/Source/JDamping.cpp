@@ -280,6 +280,37 @@ void JDamping::ComputeDampingPla(const JDamping::StDamping &da,double dt,unsigne
   }
 }
 
+//==============================================================================
+/// Applies Damping of all zones to one particle. It gives the same result as
+/// ComputeDamping() and it is used by the fused update of particles.
+///
+/// Aplica Damping de todas las zonas a una particula. Da el mismo resultado 
+/// que ComputeDamping() y se usa en la actualizacion fusionada de particulas.
+//==============================================================================
+void JDamping::ComputeDampingParticle(double dt,const tdouble3 &ps,tfloat4 &velrhop)const{
+  const unsigned nzone=GetCount();
+  for(unsigned c=0;c<nzone;c++){
+    const StDamping &da=List[c];
+    const float dist=da.dist;
+    const double vdis=fmath::PointPlane(da.plane,ps);
+    if(0<vdis && vdis<=dist+da.overlimit && (!da.usedomain || (ps.z>=da.domzmin && ps.z<=da.domzmax 
+      && fmath::PointPlane(da.dompla0,ps)<=0 && fmath::PointPlane(da.dompla1,ps)<=0 && fmath::PointPlane(da.dompla2,ps)<=0 && fmath::PointPlane(da.dompla3,ps)<=0)))
+    {
+      const double fdis=(vdis>=dist? 1.: vdis/dist);
+      const double redudt=dt*(fdis*fdis)*da.redumax;
+      double redudtx=(1.-redudt*da.factorxyz.x);
+      double redudty=(1.-redudt*da.factorxyz.y);
+      double redudtz=(1.-redudt*da.factorxyz.z);
+      redudtx=(redudtx<0? 0.: redudtx);
+      redudty=(redudty<0? 0.: redudty);
+      redudtz=(redudtz<0? 0.: redudtz);
+      velrhop.x=float(redudtx*velrhop.x);
+      velrhop.y=float(redudty*velrhop.y);
+      velrhop.z=float(redudtz*velrhop.z);
+    }
+  }
+}
+
 //==============================================================================
 /// Applies Damping to the indicated particles.
 /// Aplica Damping a las particulas indicadas.
@@ -24,6 +24,7 @@
 //:# - Muestra vector normal del plano para facilitar su comprension. (26-11-2014)
 //:# - Se puede aplicar un factor de amortiguacion para cada componente. (26-11-2014)
 //:# - Documentacion del codigo en ingles. (08-08-2017)
+//:# - Nuevo metodo ComputeDampingParticle() para aplicar todas las zonas a una particula. (18-10-2026)
 //:#############################################################################
 
 /// \file JDamping.h \brief Declares the class \ref JDamping.
@@ -93,6 +94,7 @@ public:
 
   void ComputeDamping(double timestep,double dt,unsigned n,unsigned pini,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop)const;
   void ComputeDamping(double timestep,double dt,unsigned n,unsigned pini,const tdouble3 *pos,tfloat4 *velrhop)const{ ComputeDamping(timestep,dt,n,pini,pos,NULL,velrhop); }
+  void ComputeDampingParticle(double dt,const tdouble3 &ps,tfloat4 &velrhop)const;
 };
 
 
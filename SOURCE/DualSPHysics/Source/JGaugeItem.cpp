@@ -52,6 +52,7 @@ JGaugeItem::JGaugeItem(TpGauge type,unsigned idx,std::string name,JLog2* log)
 //==============================================================================
 void JGaugeItem::Reset(){
   Config(false,TDouble3(0),TDouble3(0),0,0,0,0);
+  ConfigPeriImages(0,NULL);
   SaveVtkPart=false;
   ConfigComputeTiming(0,0,0);
   ConfigOutputTiming(false,0,0,0);
@@ -77,6 +78,16 @@ void JGaugeItem::Config(bool simulate2d,tdouble3 domposmin,tdouble3 domposmax
   MassFluid=massfluid;
 }
 
+//==============================================================================
+/// Configures the periodic images of the points used in the neighbour search
+/// when there are no periodic particles (PeriImage).
+//==============================================================================
+void JGaugeItem::ConfigPeriImages(unsigned count,const tdouble3 *inc){
+  if(count>26)RunException("ConfigPeriImages","Number of periodic images is invalid.");
+  PeriImgCount=count;
+  for(unsigned c=0;c<count;c++)PeriImgInc[c]=inc[c];
+}
+
 //==============================================================================
 /// Configures compute timing.
 //==============================================================================
@@ -193,6 +204,19 @@ void JGaugeItem::GetInteractionCells(const tdouble3 &pos,const tint4 &nc,const t
   zfin=cz+min(nc.z-cz-1,Hdiv)+1;
 }
 
+//==============================================================================
+/// Returns the periodic image cimg of a point when it is within the domain 
+/// increased by margin. Neighbours of the image are the periodic neighbours 
+/// of the point.
+/// Devuelve la imagen periodica cimg de un punto cuando esta dentro del 
+/// dominio aumentado en margin. Los vecinos de la imagen son los vecinos 
+/// periodicos del punto.
+//==============================================================================
+bool JGaugeItem::GetPeriImage(unsigned cimg,const tdouble3 &pos,double margin,tdouble3 &posimg)const{
+  posimg=pos+PeriImgInc[cimg];
+  return(DomPosMin-TDouble3(margin)<=posimg && posimg<DomPosMax+TDouble3(margin));
+}
+
 #ifdef _WITHGPU
 //==============================================================================
 /// Throws exception for Cuda error.
@@ -309,7 +333,7 @@ unsigned JGaugeVelocity::GetPointDef(std::vector<tfloat3> &points)const{
 //==============================================================================
 /// Calculates velocity at indicated points (on CPU).
 //==============================================================================
-void JGaugeVelocity::CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell
+void JGaugeVelocity::CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell,const unsigned *cellrow
   ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop)
 {
   SetTimeStep(timestep);
@@ -319,47 +343,53 @@ void JGaugeVelocity::CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,con
   if(!ptout){
     const tint4 nc=TInt4(int(ncells.x),int(ncells.y),int(ncells.z),int(ncells.x*ncells.y));
     const tint3 cellzero=TInt3(cellmin.x,cellmin.y,cellmin.z);
-    const unsigned cellfluid=nc.w*nc.z+1;
-    //-Obtain limits of interaction. | Obtiene limites de interaccion.
-    int cxini,cxfin,yini,yfin,zini,zfin;
-    GetInteractionCells(Point,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
+    const unsigned cellfluid=cellrow[nc.y*nc.z]+1;
 
     //-Auxiliary variables.
     double sumwab=0;
     tdouble3 sumvel=TDouble3(0);
 
-    //-Search for neighbors in adjacent cells.
-    //-Busqueda de vecinos en celdas adyacentes.
-    if(cxini<cxfin)for(int z=zini;z<zfin;z++){
-      const int zmod=(nc.w)*z+cellfluid; //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
-      for(int y=yini;y<yfin;y++){
-        int ymod=zmod+nc.x*y;
-        const unsigned pini=begincell[cxini+ymod];
-        const unsigned pfin=begincell[cxfin+ymod];
-
-        //-Interaction with Fluid/Floating | Interaccion con varias Fluid/Floating.
-        //--------------------------------------------------------------------------
-        for(unsigned p2=pini;p2<pfin;p2++){
-          const float drx=float(Point.x-pos[p2].x);
-          const float dry=float(Point.y-pos[p2].y);
-          const float drz=float(Point.z-pos[p2].z);
-          const float rr2=(drx*drx+dry*dry+drz*drz);
-          //-Interaction with real neighboring particles.
-          //-Interaccion con particulas vecinas reales.
-          if(rr2<=Fourh2 && rr2>=ALMOSTZERO && CODE_IsFluid(code[p2])){
-            float wab;
-            {//-Wendland kernel.
-              const float qq=sqrt(rr2)/H;
-              const float wqq=2.f*qq+1.f;
-              const float wqq1=1.f-0.5f*qq;
-              const float wqq2=wqq1*wqq1;
-              wab=Awen*wqq*wqq2*wqq2;
+    //-Search for neighbours of the point and of its periodic images (PeriImage). | Busqueda de vecinos del punto y de sus imagenes periodicas (PeriImage).
+    for(unsigned cimg=0;cimg<=PeriImgCount;cimg++){
+      tdouble3 ptpos=Point;
+      if(cimg && !GetPeriImage(cimg-1,Point,H*2,ptpos))continue;
+      //-Obtain limits of interaction. | Obtiene limites de interaccion.
+      int cxini,cxfin,yini,yfin,zini,zfin;
+      GetInteractionCells(ptpos,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
+
+      //-Search for neighbors in adjacent cells.
+      //-Busqueda de vecinos en celdas adyacentes.
+      if(cxini<cxfin)for(int z=zini;z<zfin;z++){
+        const unsigned *rowz=cellrow+nc.y*z; //-First cell of the rows of cells in z. | Primera celda de las filas de celdas en z.
+        for(int y=yini;y<yfin;y++){
+          int ymod=int(cellfluid+rowz[y]); //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
+          const unsigned pini=begincell[cxini+ymod];
+          const unsigned pfin=begincell[cxfin+ymod];
+
+          //-Interaction with Fluid/Floating | Interaccion con varias Fluid/Floating.
+          //--------------------------------------------------------------------------
+          for(unsigned p2=pini;p2<pfin;p2++){
+            const float drx=float(ptpos.x-pos[p2].x);
+            const float dry=float(ptpos.y-pos[p2].y);
+            const float drz=float(ptpos.z-pos[p2].z);
+            const float rr2=(drx*drx+dry*dry+drz*drz);
+            //-Interaction with real neighboring particles.
+            //-Interaccion con particulas vecinas reales.
+            if(rr2<=Fourh2 && rr2>=ALMOSTZERO && CODE_IsFluid(code[p2])){
+              float wab;
+              {//-Wendland kernel.
+                const float qq=sqrt(rr2)/H;
+                const float wqq=2.f*qq+1.f;
+                const float wqq1=1.f-0.5f*qq;
+                const float wqq2=wqq1*wqq1;
+                wab=Awen*wqq*wqq2*wqq2;
+              }
+              wab*=MassFluid/velrhop[p2].w;
+              sumwab+=wab;
+              sumvel.x+=wab*velrhop[p2].x;
+              sumvel.y+=wab*velrhop[p2].y;
+              sumvel.z+=wab*velrhop[p2].z;
             }
-            wab*=MassFluid/velrhop[p2].w;
-            sumwab+=wab;
-            sumvel.x+=wab*velrhop[p2].x;
-            sumvel.y+=wab*velrhop[p2].y;
-            sumvel.z+=wab*velrhop[p2].z;
           }
         }
       }
@@ -533,48 +563,53 @@ unsigned JGaugeSwl::GetPointDef(std::vector<tfloat3> &points)const{
 /// pertenecer al dominio de celdas.
 //==============================================================================
 float JGaugeSwl::CalculeMassCpu(const tdouble3 &ptpos,const tint4 &nc
-  ,const tint3 &cellzero,unsigned cellfluid,const unsigned *begincell
+  ,const tint3 &cellzero,unsigned cellfluid,const unsigned *begincell,const unsigned *cellrow
   ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop)const
 {
-  //-Obtain limits of interaction. | Obtiene limites de interaccion.
-  int cxini,cxfin,yini,yfin,zini,zfin;
-  GetInteractionCells(ptpos,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
-
   //-Auxiliary variables.
   double sumwab=0;
   double summass=0;
 
-  //-Search for neighbors in adjacent cells.
-  //-Busqueda de vecinos en celdas adyacentes.
-  if(cxini<cxfin)for(int z=zini;z<zfin;z++){
-    const int zmod=(nc.w)*z+cellfluid; //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
-    for(int y=yini;y<yfin;y++){
-      int ymod=zmod+nc.x*y;
-      const unsigned pini=begincell[cxini+ymod];
-      const unsigned pfin=begincell[cxfin+ymod];
-
-      //-Interaction with Fluid/Floating | Interaccion con varias Fluid/Floating.
-      //--------------------------------------------------------------------------
-      for(unsigned p2=pini;p2<pfin;p2++){
-        const float drx=float(ptpos.x-pos[p2].x);
-        const float dry=float(ptpos.y-pos[p2].y);
-        const float drz=float(ptpos.z-pos[p2].z);
-        const float rr2=(drx*drx+dry*dry+drz*drz);
-        //-Interaction with real neighboring particles.
-        //-Interaccion con particulas vecinas reales.
-        if(rr2<=Fourh2 && rr2>=ALMOSTZERO && CODE_IsFluid(code[p2])){
-          float wab;
-          {//-Wendland kernel.
-            const float qq=sqrt(rr2)/H;
-            const float wqq=2.f*qq+1.f;
-            const float wqq1=1.f-0.5f*qq;
-            const float wqq2=wqq1*wqq1;
-            wab=Awen*wqq*wqq2*wqq2;
+  //-Search for neighbours of the point and of its periodic images (PeriImage). | Busqueda de vecinos del punto y de sus imagenes periodicas (PeriImage).
+  for(unsigned cimg=0;cimg<=PeriImgCount;cimg++){
+    tdouble3 ptimg=ptpos;
+    if(cimg && !GetPeriImage(cimg-1,ptpos,H*2,ptimg))continue;
+    //-Obtain limits of interaction. | Obtiene limites de interaccion.
+    int cxini,cxfin,yini,yfin,zini,zfin;
+    GetInteractionCells(ptimg,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
+
+    //-Search for neighbors in adjacent cells.
+    //-Busqueda de vecinos en celdas adyacentes.
+    if(cxini<cxfin)for(int z=zini;z<zfin;z++){
+      const unsigned *rowz=cellrow+nc.y*z; //-First cell of the rows of cells in z. | Primera celda de las filas de celdas en z.
+      for(int y=yini;y<yfin;y++){
+        int ymod=int(cellfluid+rowz[y]); //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
+        const unsigned pini=begincell[cxini+ymod];
+        const unsigned pfin=begincell[cxfin+ymod];
+
+        //-Interaction with Fluid/Floating | Interaccion con varias Fluid/Floating.
+        //--------------------------------------------------------------------------
+        for(unsigned p2=pini;p2<pfin;p2++){
+          const float drx=float(ptimg.x-pos[p2].x);
+          const float dry=float(ptimg.y-pos[p2].y);
+          const float drz=float(ptimg.z-pos[p2].z);
+          const float rr2=(drx*drx+dry*dry+drz*drz);
+          //-Interaction with real neighboring particles.
+          //-Interaccion con particulas vecinas reales.
+          if(rr2<=Fourh2 && rr2>=ALMOSTZERO && CODE_IsFluid(code[p2])){
+            float wab;
+            {//-Wendland kernel.
+              const float qq=sqrt(rr2)/H;
+              const float wqq=2.f*qq+1.f;
+              const float wqq1=1.f-0.5f*qq;
+              const float wqq2=wqq1*wqq1;
+              wab=Awen*wqq*wqq2*wqq2;
+            }
+            //:Log->Printf("----> p2:%u  wab:%f  vol:%f",p2,wab,MassFluid/velrhop[p2].w);
+            wab*=MassFluid/velrhop[p2].w;
+            sumwab+=wab;
+            summass+=wab*MassFluid;
           }
-          //:Log->Printf("----> p2:%u  wab:%f  vol:%f",p2,wab,MassFluid/velrhop[p2].w);
-          wab*=MassFluid/velrhop[p2].w;
-          sumwab+=wab;
-          summass+=wab*MassFluid;
         }
       }
     }
@@ -587,20 +622,20 @@ float JGaugeSwl::CalculeMassCpu(const tdouble3 &ptpos,const tint4 &nc
 //==============================================================================
 /// Calculates surface water level at indicated points (on CPU).
 //==============================================================================
-void JGaugeSwl::CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell
+void JGaugeSwl::CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell,const unsigned *cellrow
   ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop)
 {
   SetTimeStep(timestep);
   const tint4 nc=TInt4(int(ncells.x),int(ncells.y),int(ncells.z),int(ncells.x*ncells.y));
   const tint3 cellzero=TInt3(cellmin.x,cellmin.y,cellmin.z);
-  const unsigned cellfluid=nc.w*nc.z+1;
+  const unsigned cellfluid=cellrow[nc.y*nc.z]+1;
 
   //-Look for change of fluid to empty. | Busca paso de fluido a vacio.
   tdouble3 ptsurf=TDouble3(DBL_MAX);
   float mpre=0;
   tdouble3 ptpos=Point0;
   for(unsigned cp=0;cp<=PointNp;cp++){
-    const float mass=CalculeMassCpu(ptpos,nc,cellzero,cellfluid,begincell,pos,code,velrhop);
+    const float mass=CalculeMassCpu(ptpos,nc,cellzero,cellfluid,begincell,cellrow,pos,code,velrhop);
     if(mass>MassLimit)mpre=mass;
     if(mass<MassLimit && mpre){
       const float fxm1=(MassLimit-mpre)/(mass-mpre)-1;
@@ -772,7 +807,7 @@ void JGaugeMaxZ::GetInteractionCellsMaxZ(const tdouble3 &pos,const tint4 &nc,con
 //==============================================================================
 /// Calculates maximum z of fluid at distance of a vertical line (on CPU).
 //==============================================================================
-void JGaugeMaxZ::CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell
+void JGaugeMaxZ::CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell,const unsigned *cellrow
   ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop)
 {
   //Log->Printf("JGaugeMaxZ----> timestep:%g  (%d)",timestep,(DG?1:0));
@@ -782,30 +817,36 @@ void JGaugeMaxZ::CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const u
   //-Obtain limits of interaction.
   const tint4 nc=TInt4(int(ncells.x),int(ncells.y),int(ncells.z),int(ncells.x*ncells.y));
   const tint3 cellzero=TInt3(cellmin.x,cellmin.y,cellmin.z);
-  const unsigned cellfluid=nc.w*nc.z+1;
-  int cxini,cxfin,yini,yfin,zini,zfin;
-  GetInteractionCellsMaxZ(Point0,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
+  const unsigned cellfluid=cellrow[nc.y*nc.z]+1;
   //-Start measure.
-  unsigned pmax=UINT_MAX;
   float zmax=-FLT_MAX;
-  //-Search for neighbours in adjacent cells. | Busqueda de vecinos en celdas adyacentes.
-  if(cxini<cxfin)for(int z=zfin-1;z>=zini && pmax==UINT_MAX;z--){
-    const int zmod=(nc.w)*z+cellfluid; //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
-    for(int y=yini;y<yfin;y++){
-      int ymod=zmod+nc.x*y;
-      const unsigned pini=begincell[cxini+ymod];
-      const unsigned pfin=begincell[cxfin+ymod];
-
-      //-Interaction of boundary with type Fluid/Float | Interaccion de Bound con varias Fluid/Float.
-      //---------------------------------------------------------------------------------------------
-      for(unsigned p2=pini;p2<pfin;p2++){
-        if(pos[p2].z>zmax){
-          const float drx=float(Point0.x-pos[p2].x);
-          const float dry=float(Point0.y-pos[p2].y);
-          const float rr2=drx*drx+dry*dry;
-          if(rr2<=maxdist2 && CODE_IsFluid(code[p2])){//-Only with fluid particles.
-            zmax=float(pos[p2].z);
-            pmax=p2;
+  //-Search in the column of the point and in the columns of its periodic images (PeriImage). | Busqueda en la columna del punto y en las columnas de sus imagenes periodicas (PeriImage).
+  for(unsigned cimg=0;cimg<=PeriImgCount;cimg++){
+    tdouble3 ptimg=Point0;
+    if(cimg && !GetPeriImage(cimg-1,Point0,DistLimit+Height,ptimg))continue;
+    const double incz=ptimg.z-Point0.z;
+    int cxini,cxfin,yini,yfin,zini,zfin;
+    GetInteractionCellsMaxZ(ptimg,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
+    unsigned pmax=UINT_MAX;
+    //-Search for neighbours in adjacent cells. | Busqueda de vecinos en celdas adyacentes.
+    if(cxini<cxfin)for(int z=zfin-1;z>=zini && pmax==UINT_MAX;z--){
+      const unsigned *rowz=cellrow+nc.y*z; //-First cell of the rows of cells in z. | Primera celda de las filas de celdas en z.
+      for(int y=yini;y<yfin;y++){
+        int ymod=int(cellfluid+rowz[y]); //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
+        const unsigned pini=begincell[cxini+ymod];
+        const unsigned pfin=begincell[cxfin+ymod];
+
+        //-Interaction of boundary with type Fluid/Float | Interaccion de Bound con varias Fluid/Float.
+        //---------------------------------------------------------------------------------------------
+        for(unsigned p2=pini;p2<pfin;p2++){
+          if(pos[p2].z-incz>zmax){
+            const float drx=float(ptimg.x-pos[p2].x);
+            const float dry=float(ptimg.y-pos[p2].y);
+            const float rr2=drx*drx+dry*dry;
+            if(rr2<=maxdist2 && CODE_IsFluid(code[p2])){//-Only with fluid particles.
+              zmax=float(pos[p2].z-incz);
+              pmax=p2;
+            }
           }
         }
       }
@@ -20,6 +20,10 @@
 //:# Cambios:
 //:# =========
 //:# - Clase para medir magnitudes fisicas durante la simulacion. (12-02-2018)
+//:# - Nuevo metodo GetAllocMemory() con la memoria del buffer de resultados.
+//:#   (18-10-2026)
+//:# - Busqueda de vecinos en imagenes periodicas de los puntos de medida cuando
+//:#   no se crean particulas periodicas (PeriImage). (18-10-2026)
 //:#############################################################################
 
 /// \file JGaugeItem.h \brief Declares the class \ref JGaugeItem.
@@ -80,6 +84,8 @@ protected:
   float Fourh2;
   float Awen;
   float MassFluid;
+  unsigned PeriImgCount;  ///<Number of periodic images of the points (0:periodic particles are used). | Numero de imagenes periodicas de los puntos (0:se usan particulas periodicas).
+  tdouble3 PeriImgInc[26];///<Displacement of each periodic image. | Desplazamiento de cada imagen periodica.
 
   //-Configuration variables.
   bool SaveVtkPart; //-Creates VTK files for each PART.
@@ -109,6 +115,7 @@ protected:
   bool PointIsOut(double px,double py)const{ return(px!=px || py!=py || px<DomPosMin.x || py<DomPosMin.y || px>=DomPosMax.x || py>=DomPosMax.y); }
   inline void GetInteractionCells(const tdouble3 &pos,const tint4 &nc,const tint3 &cellzero
     ,int &cxini,int &cxfin,int &yini,int &yfin,int &zini,int &zfin)const;
+  bool GetPeriImage(unsigned cimg,const tdouble3 &pos,double margin,tdouble3 &posimg)const;
 
   static std::string GetNameType(TpGauge type);
 
@@ -126,6 +133,7 @@ public:
   const std::string Name;
 
   void Config(bool simulate2d,tdouble3 domposmin,tdouble3 domposmax,float scell,int hdiv,float h,float massfluid);
+  void ConfigPeriImages(unsigned count,const tdouble3 *inc);
   void SetSaveVtkPart(bool save){ SaveVtkPart=save; }
   void ConfigComputeTiming(double start,double end,double dt);
   void ConfigOutputTiming(bool save,double start,double end,double dt);
@@ -137,6 +145,7 @@ public:
   virtual void SaveResults()=0;
   virtual void SaveVtkResult(unsigned cpart)=0;
   virtual unsigned GetPointDef(std::vector<tfloat3> &points)const=0;
+  virtual llong GetAllocMemory()const=0;
 
   void SaveResults(unsigned cpart);
 
@@ -152,7 +161,7 @@ public:
   bool Output(double timestep)const{ return(OutputSave && timestep>=OutputNext && OutputStart<=timestep && timestep<=OutputEnd); }
 
   virtual void CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin
-    ,const unsigned *begincell,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop)=0;
+    ,const unsigned *begincell,const unsigned *cellrow,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop)=0;
 
  #ifdef _WITHGPU
   virtual void CalculeGpu(double timestep,tuint3 ncells,tuint3 cellmin,const int2 *beginendcell
@@ -203,13 +212,14 @@ public:
   void SaveResults();
   void SaveVtkResult(unsigned cpart);
   unsigned GetPointDef(std::vector<tfloat3> &points)const;
+  llong GetAllocMemory()const{ return(llong(sizeof(StGaugeVelRes))*OutBuff.capacity()); }
 
   tdouble3 GetPoint()const{ return(Point); }
   const StGaugeVelRes& GetResult()const{ return(Result); }
 
   void SetPoint(const tdouble3 &point){ ClearResult(); Point=point; }
 
-  void CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell
+  void CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell,const unsigned *cellrow
     ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop);
 
  #ifdef _WITHGPU
@@ -261,7 +271,7 @@ protected:
   void ClearResult(){ Result.Reset(); }
   void StoreResult();
   float CalculeMassCpu(const tdouble3 &ptpos,const tint4 &nc
-    ,const tint3 &cellzero,unsigned cellfluid,const unsigned *begincell
+    ,const tint3 &cellzero,unsigned cellfluid,const unsigned *begincell,const unsigned *cellrow
     ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop)const;
 
 public:
@@ -271,6 +281,7 @@ public:
   void SaveResults();
   void SaveVtkResult(unsigned cpart);
   unsigned GetPointDef(std::vector<tfloat3> &points)const;
+  llong GetAllocMemory()const{ return(llong(sizeof(StGaugeSwlRes))*OutBuff.capacity()); }
 
   tdouble3 GetPoint0()const{ return(Point0); }
   tdouble3 GetPoint2()const{ return(Point2); }
@@ -280,7 +291,7 @@ public:
 
   void SetPoints(const tdouble3 &point0,const tdouble3 &point2,double pointdp);
 
-  void CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell
+  void CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell,const unsigned *cellrow
     ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop);
 
  #ifdef _WITHGPU
@@ -336,6 +347,7 @@ public:
   void SaveResults();
   void SaveVtkResult(unsigned cpart);
   unsigned GetPointDef(std::vector<tfloat3> &points)const;
+  llong GetAllocMemory()const{ return(llong(sizeof(StGaugeMaxzRes))*OutBuff.capacity()); }
 
   tdouble3 GetPoint0()const{ return(Point0); }
   double GetHeight()const{ return(Height); }
@@ -346,7 +358,7 @@ public:
   void SetHeight   (double height){          ClearResult(); Height=height; }
   void SetDistLimit(float distlimit){        ClearResult(); DistLimit=distlimit; }
 
-  void CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell
+  void CalculeCpu(double timestep,tuint3 ncells,tuint3 cellmin,const unsigned *begincell,const unsigned *cellrow
     ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop);
 
  #ifdef _WITHGPU
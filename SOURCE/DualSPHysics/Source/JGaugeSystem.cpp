@@ -65,6 +65,7 @@ void JGaugeSystem::Reset(){
   DomPosMin=DomPosMax=TDouble3(0);
   Scell=0;
   Hdiv=0;
+  PeriImgCount=0;
   ResetCfgDefault();
   for(unsigned c=0;c<Gauges.size();c++)delete Gauges[c];
   Gauges.clear();
@@ -107,6 +108,28 @@ void JGaugeSystem::Config(bool simulate2d,double simulate2dposy,double timemax,d
   Configured=true;
 }
 
+//==============================================================================
+/// Updates configuration of cells of the object and its gauges.
+//==============================================================================
+void JGaugeSystem::ConfigCells(tdouble3 posmin,tdouble3 posmax,float scell,unsigned hdiv){
+  DomPosMin=posmin;
+  DomPosMax=posmax;
+  Scell=scell;
+  Hdiv=int(hdiv);
+  for(unsigned cg=0;cg<GetCount();cg++)Gauges[cg]->Config(Simulate2D,DomPosMin,DomPosMax,Scell,Hdiv,H,MassFluid);
+}
+
+//==============================================================================
+/// Configures the periodic images of the points of the gauges when there are
+/// no periodic particles (PeriImage).
+//==============================================================================
+void JGaugeSystem::ConfigPeriImages(unsigned count,const tdouble3 *inc){
+  if(count>26)RunException("ConfigPeriImages","Number of periodic images is invalid.");
+  PeriImgCount=count;
+  for(unsigned c=0;c<count;c++)PeriImgInc[c]=inc[c];
+  for(unsigned cg=0;cg<GetCount();cg++)Gauges[cg]->ConfigPeriImages(PeriImgCount,PeriImgInc);
+}
+
 //==============================================================================
 /// Loads initial conditions of XML object.
 //==============================================================================
@@ -273,6 +296,7 @@ JGaugeVelocity* JGaugeSystem::AddGaugeVel(std::string name,double computestart,d
   //-Creates object.
   JGaugeVelocity* gau=new JGaugeVelocity(GetCount(),name,point,Log);
   gau->Config(Simulate2D,DomPosMin,DomPosMax,Scell,Hdiv,H,MassFluid);
+  gau->ConfigPeriImages(PeriImgCount,PeriImgInc);
   gau->ConfigComputeTiming(computestart,computeend,computedt);
   //-Uses common configuration.
   gau->SetSaveVtkPart(CfgDefault.savevtkpart);
@@ -291,6 +315,7 @@ JGaugeSwl* JGaugeSystem::AddGaugeSwl(std::string name,double computestart,double
   //-Creates object.
   JGaugeSwl* gau=new JGaugeSwl(GetCount(),name,point0,point2,pointdp,masslimit,Log);
   gau->Config(Simulate2D,DomPosMin,DomPosMax,Scell,Hdiv,H,MassFluid);
+  gau->ConfigPeriImages(PeriImgCount,PeriImgInc);
   gau->ConfigComputeTiming(computestart,computeend,computedt);
   //-Uses common configuration.
   gau->SetSaveVtkPart(CfgDefault.savevtkpart);
@@ -308,6 +333,7 @@ JGaugeMaxZ* JGaugeSystem::AddGaugeMaxZ(std::string name,double computestart,doub
   //-Creates object.
   JGaugeMaxZ* gau=new JGaugeMaxZ(GetCount(),name,point0,height,distlimit,Log);
   gau->Config(Simulate2D,DomPosMin,DomPosMax,Scell,Hdiv,H,MassFluid);
+  gau->ConfigPeriImages(PeriImgCount,PeriImgInc);
   gau->ConfigComputeTiming(computestart,computeend,computedt);
   //-Uses common configuration.
   gau->SetSaveVtkPart(CfgDefault.savevtkpart);
@@ -395,7 +421,7 @@ JGaugeItem* JGaugeSystem::GetGauge(unsigned c)const{
 //==============================================================================
 /// Updates results on gauges (on CPU).
 //==============================================================================
-void JGaugeSystem::CalculeCpu(double timestep,bool svpart,tuint3 ncells,tuint3 cellmin,const unsigned *begincell
+void JGaugeSystem::CalculeCpu(double timestep,bool svpart,tuint3 ncells,tuint3 cellmin,const unsigned *begincell,const unsigned *cellrow
   ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop)
 {
   //Log->Printf("AAA_000 t:%f",timestep);
@@ -403,7 +429,7 @@ void JGaugeSystem::CalculeCpu(double timestep,bool svpart,tuint3 ncells,tuint3 c
   for(unsigned cg=0;cg<ng;cg++){
     JGaugeItem* gau=Gauges[cg];
     if(gau->Update(timestep)){
-      gau->CalculeCpu(timestep,ncells,cellmin,begincell,pos,code,velrhop);
+      gau->CalculeCpu(timestep,ncells,cellmin,begincell,cellrow,pos,code,velrhop);
     }
   }
   //Log->Print("AAA_fin");
@@ -438,5 +464,15 @@ void JGaugeSystem::SaveResults(unsigned cpart){
   for(unsigned cg=0;cg<ng;cg++)Gauges[cg]->SaveResults(cpart);
 }
 
+//==============================================================================
+/// Returns the CPU memory allocated for results of gauges.
+//==============================================================================
+llong JGaugeSystem::GetAllocMemory()const{
+  llong s=0;
+  const unsigned ng=GetCount();
+  for(unsigned cg=0;cg<ng;cg++)s+=Gauges[cg]->GetAllocMemory();
+  return(s);
+}
+
 
 
@@ -22,6 +22,9 @@
 //:# - Clase para gestionar la medicion de distintas magnitudes de forma 
 //:#   automatica y simple. (12-02-2017)
 //:# - Error corregido cargando <default><output>. (03-03-2017)
+//:# - Nuevo metodo GetAllocMemory(). (18-10-2026)
+//:# - Nuevo metodo ConfigPeriImages() para usar imagenes periodicas de los 
+//:#   puntos de medida (PeriImage). (18-10-2026)
 //:#############################################################################
 
 /// \file JGaugeSystem.h \brief Declares the class \ref JGaugeSystem.
@@ -66,6 +69,8 @@ private:
   int Hdiv;               ///<Value to divide 2H. | Valor por el que se divide a DosH
   float H;
   float MassFluid;
+  unsigned PeriImgCount;  ///<Number of periodic images of the points (0:periodic particles are used). | Numero de imagenes periodicas de los puntos (0:se usan particulas periodicas).
+  tdouble3 PeriImgInc[26];///<Displacement of each periodic image. | Desplazamiento de cada imagen periodica.
 
   JGaugeItem::StDefault CfgDefault; ///<Default configuration.
 
@@ -92,6 +97,8 @@ public:
 
   void Config(bool simulate2d,double simulate2dposy,double timemax,double timepart
     ,double dp,tdouble3 posmin,tdouble3 posmax,float scell,unsigned hdiv,float h,float massfluid);
+  void ConfigCells(tdouble3 posmin,tdouble3 posmax,float scell,unsigned hdiv);
+  void ConfigPeriImages(unsigned count,const tdouble3 *inc);
 
   void LoadXml(JXml *sxml,const std::string &place);
   void VisuConfig(std::string txhead,std::string txfoot);
@@ -115,7 +122,7 @@ public:
   unsigned GetGaugeIdx(const std::string &name)const;
   JGaugeItem* GetGauge(unsigned c)const;
 
-  void CalculeCpu(double timestep,bool svpart,tuint3 ncells,tuint3 cellmin,const unsigned *begincell
+  void CalculeCpu(double timestep,bool svpart,tuint3 ncells,tuint3 cellmin,const unsigned *begincell,const unsigned *cellrow
     ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop);
 
  #ifdef _WITHGPU
@@ -124,6 +131,7 @@ public:
  #endif
 
   void SaveResults(unsigned cpart);
+  llong GetAllocMemory()const;
 };
 
 
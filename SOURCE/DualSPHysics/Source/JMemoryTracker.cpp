@@ -0,0 +1,190 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+/// \file JMemoryTracker.cpp \brief Implements the class \ref JMemoryTracker.
+
+#include "JMemoryTracker.h"
+#include "Functions.h"
+#include <algorithm>
+
+using namespace std;
+
+//==============================================================================
+/// Constructor.
+//==============================================================================
+JMemoryTracker::JMemoryTracker(){
+  ClassName="JMemoryTracker";
+  Reset();
+}
+
+//==============================================================================
+/// Destructor.
+//==============================================================================
+JMemoryTracker::~JMemoryTracker(){
+  Reset();
+}
+
+//==============================================================================
+/// Initialisation of variables.
+//==============================================================================
+void JMemoryTracker::Reset(){
+  ConfigPhases(0);
+  Alloc=Used=AllocPeak=UsedPeak=0;
+  BlockName.clear();
+  BlockSize.clear();
+  ResetPart();
+}
+
+//==============================================================================
+/// Configura el numero de fases y anade la fase Other para la memoria fuera
+/// de cualquier fase.
+/// Configures the number of phases and adds the phase Other for memory out
+/// of any phase.
+//==============================================================================
+void JMemoryTracker::ConfigPhases(unsigned count){
+  if(count+1>MAXPHASES)RunException("ConfigPhases","Number of phases exceeds the maximum.");
+  PhaseCount=count+1;
+  for(unsigned c=0;c<MAXPHASES;c++){
+    PhaseName[c]=(c<count? fun::PrintStr("Phase%u",c): (c==count? "Other": ""));
+    PhaseAllocPeak[c]=PhaseUsedPeak[c]=0;
+  }
+  StackSize=0;
+  PartPhase=count;
+}
+
+//==============================================================================
+/// Cambia el nombre de una fase.
+/// Changes the name of a phase.
+//==============================================================================
+void JMemoryTracker::SetPhaseName(unsigned phase,const std::string &name){
+  if(phase+1>=PhaseCount)RunException("SetPhaseName","Phase is invalid.");
+  PhaseName[phase]=name;
+}
+
+//==============================================================================
+/// Actualiza los picos de memoria global, del PART y de las fases activas.
+/// Updates the peaks of memory of the simulation, the PART and the active phases.
+//==============================================================================
+void JMemoryTracker::UpdatePeaks(){
+  AllocPeak=max(AllocPeak,Alloc);
+  UsedPeak=max(UsedPeak,Used);
+  PartAllocPeak=max(PartAllocPeak,Alloc);
+  if(PartUsedPeak<Used){
+    PartUsedPeak=Used;
+    PartPhase=GetPhase();
+  }
+  if(StackSize)for(unsigned c=0;c<StackSize;c++){
+    const unsigned ph=Stack[c];
+    PhaseAllocPeak[ph]=max(PhaseAllocPeak[ph],Alloc);
+    PhaseUsedPeak[ph]=max(PhaseUsedPeak[ph],Used);
+  }
+  else{
+    const unsigned ph=PhaseCount-1;
+    PhaseAllocPeak[ph]=max(PhaseAllocPeak[ph],Alloc);
+    PhaseUsedPeak[ph]=max(PhaseUsedPeak[ph],Used);
+  }
+}
+
+//==============================================================================
+/// Inicia una fase. La memoria actual cuenta para su pico.
+/// Starts a phase. The current memory counts for its peak.
+//==============================================================================
+void JMemoryTracker::StartPhase(unsigned phase){
+  if(phase+1<PhaseCount && StackSize<MAXSTACK){
+    Stack[StackSize++]=phase;
+    UpdatePeaks();
+  }
+}
+
+//==============================================================================
+/// Finaliza una fase aunque no sea la ultima iniciada.
+/// Finishes a phase even when it is not the last one started.
+//==============================================================================
+void JMemoryTracker::StopPhase(unsigned phase){
+  unsigned c=StackSize;
+  while(c && Stack[c-1]!=phase)c--;
+  if(c){
+    for(;c<StackSize;c++)Stack[c-1]=Stack[c];
+    StackSize--;
+  }
+}
+
+//==============================================================================
+/// Suma (o resta con valores negativos) memoria reservada y usada.
+/// Adds (or subtracts with negative values) allocated and used memory.
+//==============================================================================
+void JMemoryTracker::AddMemory(llong alloc,llong used){
+  Alloc+=alloc;
+  Used+=used;
+  UpdatePeaks();
+}
+
+//==============================================================================
+/// Cambia el tamano de un bloque de memoria reservada y usada. El bloque se
+/// crea la primera vez.
+/// Changes the size of a block of allocated and used memory. The block is
+/// created the first time.
+//==============================================================================
+void JMemoryTracker::SetBlock(const std::string &name,llong size){
+  unsigned cb=0;
+  for(;cb<unsigned(BlockName.size()) && BlockName[cb]!=name;cb++);
+  if(cb==unsigned(BlockName.size())){
+    BlockName.push_back(name);
+    BlockSize.push_back(0);
+  }
+  const llong inc=size-BlockSize[cb];
+  BlockSize[cb]=size;
+  if(inc)AddMemory(inc,inc);
+}
+
+//==============================================================================
+/// Inicia los picos de un nuevo PART con la memoria actual.
+/// Starts the peaks of a new PART with the current memory.
+//==============================================================================
+void JMemoryTracker::ResetPart(){
+  PartAllocPeak=Alloc;
+  PartUsedPeak=Used;
+  PartPhase=GetPhase();
+}
+
+//==============================================================================
+/// Devuelve texto con la memoria del PART actual.
+/// Returns text with the memory of the current PART.
+//==============================================================================
+std::string JMemoryTracker::GetPartInfo()const{
+  const double mb=1024*1024;
+  return(fun::PrintStr("Memory peak: %.2f MB used (%s), %.2f MB allocated - Current: %.2f MB used, %.2f MB allocated"
+    ,PartUsedPeak/mb,PhaseName[PartPhase].c_str(),PartAllocPeak/mb,Used/mb,Alloc/mb));
+}
+
+//==============================================================================
+/// Devuelve lineas de texto con los picos de memoria de cada fase.
+/// Returns lines of text with the peaks of memory of each phase.
+//==============================================================================
+void JMemoryTracker::GetPhasesInfo(std::vector<std::string> &lines)const{
+  const double mb=1024*1024;
+  unsigned size=5;
+  for(unsigned c=0;c<PhaseCount;c++)size=max(size,unsigned(PhaseName[c].length()));
+  lines.push_back(fun::PrintStr("  %-*s  %12s  %12s",size,"Phase","Used (MB)","Alloc (MB)"));
+  for(unsigned c=0;c<PhaseCount;c++)if(PhaseAllocPeak[c]){
+    lines.push_back(fun::PrintStr("  %-*s  %12.2f  %12.2f",size,PhaseName[c].c_str(),PhaseUsedPeak[c]/mb,PhaseAllocPeak[c]/mb));
+  }
+  lines.push_back(fun::PrintStr("  %-*s  %12.2f  %12.2f",size,"Total",UsedPeak/mb,AllocPeak/mb));
+  for(unsigned cb=0;cb<unsigned(BlockName.size());cb++){
+    lines.push_back(fun::PrintStr("  Block %s: %.2f MB",BlockName[cb].c_str(),BlockSize[cb]/mb));
+  }
+}
@@ -0,0 +1,105 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+/// \file JMemoryTracker.h \brief Declares the class \ref JMemoryTracker.
+
+#ifndef _JMemoryTracker_
+#define _JMemoryTracker_
+
+#include "TypesDef.h"
+#include "JObject.h"
+#include <string>
+#include <vector>
+
+//##############################################################################
+//# JMemoryTracker
+//##############################################################################
+/// \brief Records the current and peak CPU memory of the simulation for each
+/// execution phase and for each PART.
+///
+/// The memory is reported as allocated (reserved) and used (in use) bytes.
+/// The phases are the timers of the execution and they can be nested, the
+/// peaks are assigned to all the active phases. The memory allocated out of
+/// any phase is assigned to the last phase (Other). Named blocks are used for
+/// memory whose size is only known as a total (cell division, gauges...).
+
+class JMemoryTracker : protected JObject
+{
+public:
+  static const unsigned MAXPHASES=32;  ///<Maximum number of phases (including Other).
+  static const unsigned MAXSTACK=8;    ///<Maximum number of nested phases.
+
+protected:
+  unsigned PhaseCount;                 ///<Number of phases including Other. | Numero de fases incluyendo Other.
+  std::string PhaseName[MAXPHASES];    ///<Name of each phase. | Nombre de cada fase.
+  llong PhaseAllocPeak[MAXPHASES];     ///<Peak of allocated memory during each phase. | Pico de memoria reservada durante cada fase.
+  llong PhaseUsedPeak[MAXPHASES];      ///<Peak of used memory during each phase. | Pico de memoria usada durante cada fase.
+
+  unsigned Stack[MAXSTACK];            ///<Active phases (the last one is the current phase). | Fases activas (la ultima es la fase actual).
+  unsigned StackSize;                  ///<Number of active phases. | Numero de fases activas.
+
+  llong Alloc;                         ///<Current allocated memory. | Memoria reservada actual.
+  llong Used;                          ///<Current used memory. | Memoria usada actual.
+  llong AllocPeak;                     ///<Peak of allocated memory. | Pico de memoria reservada.
+  llong UsedPeak;                      ///<Peak of used memory. | Pico de memoria usada.
+
+  llong PartAllocPeak;                 ///<Peak of allocated memory in the current PART. | Pico de memoria reservada en el PART actual.
+  llong PartUsedPeak;                  ///<Peak of used memory in the current PART. | Pico de memoria usada en el PART actual.
+  unsigned PartPhase;                  ///<Phase of the peak of used memory in the current PART. | Fase del pico de memoria usada en el PART actual.
+
+  std::vector<std::string> BlockName;  ///<Name of memory blocks. | Nombre de bloques de memoria.
+  std::vector<llong> BlockSize;        ///<Current size of memory blocks. | Tamano actual de bloques de memoria.
+
+  unsigned GetPhase()const{ return(StackSize? Stack[StackSize-1]: PhaseCount-1); }
+  void UpdatePeaks();
+
+public:
+  JMemoryTracker();
+  ~JMemoryTracker();
+  void Reset();
+
+  void ConfigPhases(unsigned count);
+  void SetPhaseName(unsigned phase,const std::string &name);
+  unsigned GetPhaseCount()const{ return(PhaseCount); }
+  std::string GetPhaseName(unsigned phase)const{ return(phase<PhaseCount? PhaseName[phase]: ""); }
+
+  void StartPhase(unsigned phase);
+  void StopPhase(unsigned phase);
+
+  void AddMemory(llong alloc,llong used);
+  void AddAlloc(llong size){ AddMemory(size,0); }
+  void AddUsed(llong size){ AddMemory(0,size); }
+  void AddTemp(llong size){ AddMemory(size,size); }
+  void SetBlock(const std::string &name,llong size);
+
+  llong GetAlloc()const{ return(Alloc); }
+  llong GetUsed()const{ return(Used); }
+  llong GetAllocPeak()const{ return(AllocPeak); }
+  llong GetUsedPeak()const{ return(UsedPeak); }
+
+  llong GetPartAllocPeak()const{ return(PartAllocPeak); }
+  llong GetPartUsedPeak()const{ return(PartUsedPeak); }
+  const char* GetPartPhaseName()const{ return(PhaseName[PartPhase].c_str()); }
+  void ResetPart();
+
+  std::string GetPartInfo()const;
+  void GetPhasesInfo(std::vector<std::string> &lines)const;
+};
+
+#endif
+
+
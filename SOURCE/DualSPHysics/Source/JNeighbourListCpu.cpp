@@ -0,0 +1,510 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+/// \file JNeighbourListCpu.cpp \brief Implements the class \ref JNeighbourListCpu.
+
+#include "JNeighbourListCpu.h"
+#include "Functions.h"
+#include "OmpDefs.h"
+#include <cmath>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+
+using namespace std;
+
+//==============================================================================
+/// Constructor.
+//==============================================================================
+JNeighbourListCpu::JNeighbourListCpu(float skin,float dosh,float scell)
+  :Skin(skin),Cutoff(dosh+skin)
+{
+  ClassName="JNeighbourListCpu";
+  PosBuild=NULL; BuildPart=NULL; CurPart=NULL;
+  for(unsigned c=0;c<PASS_COUNT;c++){ Begin[c]=NULL; List[c]=NULL; SizeList[c]=0; }
+  PosAux=NULL; PartAux=NULL; BeginAux=NULL;
+  NumChunks=1;
+  for(unsigned c=0;c<OMP_MAXTHREADS;c++){ ChunkList[c]=NULL; SizeChunkList[c]=NumChunkList[c]=0; }
+  ImgCount=0;
+  Reset();
+  ConfigCells(scell);
+}
+
+//==============================================================================
+/// Updates the number of cells to look for neighbours after a change of cell 
+/// size and invalidates the list.
+/// Actualiza el numero de celdas para buscar vecinos tras un cambio del tamano
+/// de celda e invalida la lista.
+//==============================================================================
+void JNeighbourListCpu::ConfigCells(float scell){
+  Scell=scell;
+  Hdiv=int(ceil(Cutoff/scell));
+  Valid=false;
+}
+
+//==============================================================================
+/// Configures the periodic images of each particle where neighbours are also
+/// searched (PeriImage). The order must be the same as in the interaction.
+/// Configura las imagenes periodicas de cada particula donde tambien se buscan
+/// vecinos (PeriImage). El orden debe ser el mismo que en la interaccion.
+//==============================================================================
+void JNeighbourListCpu::ConfigPeriImages(unsigned count,const tdouble3 *inc,const tint3 *dir){
+  if(count>26)RunException("ConfigPeriImages","Number of periodic images is invalid.");
+  ImgCount=count;
+  for(unsigned c=0;c<count;c++){ ImgInc[c]=inc[c]; ImgDir[c]=dir[c]; }
+  Valid=false;
+}
+
+//==============================================================================
+/// Destructor.
+//==============================================================================
+JNeighbourListCpu::~JNeighbourListCpu(){
+  Reset();
+}
+
+//==============================================================================
+/// Initialisation of variables.
+//==============================================================================
+void JNeighbourListCpu::Reset(){
+  FreeMemory();
+  Valid=false;
+  Np=Npb=NpbOk=NpBuild=0;
+  NumBuild=NumReuse=NumPeriodic=0;
+}
+
+//==============================================================================
+/// Frees allocated memory.
+/// Libera memoria reservada.
+//==============================================================================
+void JNeighbourListCpu::FreeMemory(){
+  delete[] PosBuild;  PosBuild=NULL;
+  delete[] BuildPart; BuildPart=NULL;
+  delete[] CurPart;   CurPart=NULL;
+  for(unsigned c=0;c<PASS_COUNT;c++){
+    delete[] Begin[c]; Begin[c]=NULL;
+    delete[] List[c];  List[c]=NULL;
+    SizeList[c]=0;
+  }
+  delete[] PosAux;   PosAux=NULL;
+  delete[] PartAux;  PartAux=NULL;
+  delete[] BeginAux; BeginAux=NULL;
+  for(unsigned c=0;c<OMP_MAXTHREADS;c++){
+    delete[] ChunkList[c]; ChunkList[c]=NULL;
+    SizeChunkList[c]=NumChunkList[c]=0;
+  }
+  SizeNp=0;
+  Valid=false;
+}
+
+//==============================================================================
+/// Allocates memory for np particles.
+/// Reserva memoria para np particulas.
+//==============================================================================
+void JNeighbourListCpu::AllocMemoryNp(unsigned np){
+  if(np>SizeNp){
+    //-Lists of neighbours are kept. | Se mantienen las listas de vecinos.
+    const unsigned sizelist[PASS_COUNT]={SizeList[0],SizeList[1],SizeList[2]};
+    unsigned *list[PASS_COUNT]={List[0],List[1],List[2]};
+    for(unsigned c=0;c<PASS_COUNT;c++){ List[c]=NULL; SizeList[c]=0; }
+    unsigned sizechunk[OMP_MAXTHREADS];
+    unsigned *chunk[OMP_MAXTHREADS];
+    for(unsigned c=0;c<OMP_MAXTHREADS;c++){ chunk[c]=ChunkList[c]; sizechunk[c]=SizeChunkList[c]; ChunkList[c]=NULL; SizeChunkList[c]=0; }
+    FreeMemory();
+    for(unsigned c=0;c<PASS_COUNT;c++){ List[c]=list[c]; SizeList[c]=sizelist[c]; }
+    for(unsigned c=0;c<OMP_MAXTHREADS;c++){ ChunkList[c]=chunk[c]; SizeChunkList[c]=sizechunk[c]; }
+    try{
+      PosBuild=new tdouble3[np];
+      BuildPart=new unsigned[np];
+      CurPart=new unsigned[np];
+      for(unsigned c=0;c<PASS_COUNT;c++)Begin[c]=new unsigned[np*2];
+      PosAux=new tdouble3[np];
+      PartAux=new unsigned[np];
+      BeginAux=new unsigned[np*2];
+    }
+    catch(const std::bad_alloc){
+      RunException("AllocMemoryNp","Could not allocate the requested memory.");
+    }
+    SizeNp=np;
+  }
+}
+
+//==============================================================================
+/// Returns list with memory for the requested number of neighbours (the first
+/// size values are kept when keep=true).
+/// Devuelve lista con memoria para el numero de vecinos solicitado (se 
+/// mantienen los primeros size valores cuando keep=true).
+//==============================================================================
+unsigned* JNeighbourListCpu::ResizeList(unsigned *list,unsigned &size,unsigned newsize,bool keep){
+  if(newsize>size){
+    const unsigned size2=newsize+newsize/10+1024;
+    unsigned *list2=(keep? new unsigned[size2]: NULL);
+    if(list2 && size)memcpy(list2,list,sizeof(unsigned)*size);
+    delete[] list; list=NULL; size=0;
+    list=(list2? list2: new unsigned[size2]);
+    size=size2;
+  }
+  return(list);
+}
+
+//==============================================================================
+/// Returns memory reserved on CPU.
+/// Devuelve la memoria reservada en CPU.
+//==============================================================================
+llong JNeighbourListCpu::GetAllocMemory()const{
+  llong s=0;
+  s+=llong(sizeof(tdouble3))*SizeNp*2;                          //-PosBuild,PosAux
+  s+=llong(sizeof(unsigned))*SizeNp*3;                          //-BuildPart,CurPart,PartAux
+  s+=llong(sizeof(unsigned))*SizeNp*2*(PASS_COUNT+1);           //-Begin,BeginAux
+  for(unsigned c=0;c<PASS_COUNT;c++)s+=llong(sizeof(unsigned))*SizeList[c];
+  for(unsigned c=0;c<OMP_MAXTHREADS;c++)s+=llong(sizeof(unsigned))*SizeChunkList[c];
+  return(s);
+}
+
+//==============================================================================
+/// Returns the code of the periodic image with the number of periodic 
+/// displacements dir (0 without displacement and UINT_MAX when it does not exist).
+/// Devuelve el codigo de la imagen periodica con el numero de desplazamientos
+/// periodicos dir (0 sin desplazamiento y UINT_MAX cuando no existe).
+//==============================================================================
+unsigned JNeighbourListCpu::GetImage(const tint3 &dir)const{
+  unsigned cimg=(dir==TInt3(0)? 0: UINT_MAX);
+  for(unsigned c=0;c<ImgCount && cimg==UINT_MAX;c++)if(ImgDir[c]==dir)cimg=c+1;
+  return(cimg);
+}
+
+//==============================================================================
+/// Updates the periodic images of the neighbours of particle p after crossing 
+/// a periodic boundary with the displacement of image cimg, and the image of p
+/// in the lists of its neighbours. Returns false when some image does not exist.
+///
+/// Actualiza las imagenes periodicas de los vecinos de la particula p tras 
+/// cruzar un limite periodico con el desplazamiento de la imagen cimg, y la 
+/// imagen de p en las listas de sus vecinos. Devuelve false cuando alguna 
+/// imagen no existe.
+//==============================================================================
+bool JNeighbourListCpu::UpdateImages(unsigned p,unsigned cimg){
+  const tint3 dirp=ImgDir[cimg];
+  const unsigned bp=BuildPart[p];
+  //-Pass of the lists of neighbours where p is a neighbour. | Paso de las listas de vecinos donde p es vecino.
+  const unsigned passnb[PASS_COUNT]={PASS_FluidFluid,PASS_BoundFluid,PASS_FluidBound};
+  bool ok=true;
+  for(unsigned c=0;c<PASS_COUNT && ok;c++){
+    unsigned *list=List[c];
+    const unsigned rini=Begin[c][p*2];
+    const unsigned rfin=Begin[c][p*2+1];
+    for(unsigned r=rini;r<rfin && ok;r++){
+      const unsigned b2=(list[r]&PART_MASK);
+      const unsigned img=(list[r]>>IMG_SHIFT);
+      const unsigned img2=GetImage((img? ImgDir[img-1]: TInt3(0))-dirp);
+      ok=(img2!=UINT_MAX);
+      if(ok)list[r]=b2|(img2<<IMG_SHIFT);
+      //-Updates p in the list of the neighbour (only once for each neighbour). | Actualiza p en la lista del vecino (solo una vez por vecino).
+      const unsigned p2=CurPart[b2];
+      bool first=(ok && p2!=UINT_MAX && b2!=bp);
+      for(unsigned r2=rini;r2<r && first;r2++)first=((list[r2]&PART_MASK)!=b2);
+      if(first){
+        unsigned *list2=List[passnb[c]];
+        const unsigned r2fin=Begin[passnb[c]][p2*2+1];
+        for(unsigned r2=Begin[passnb[c]][p2*2];r2<r2fin && ok;r2++)if((list2[r2]&PART_MASK)==bp){
+          const unsigned img=(list2[r2]>>IMG_SHIFT);
+          const unsigned img2=GetImage((img? ImgDir[img-1]: TInt3(0))+dirp);
+          ok=(img2!=UINT_MAX);
+          if(ok)list2[r2]=bp|(img2<<IMG_SHIFT);
+        }
+      }
+    }
+  }
+  return(ok);
+}
+
+//==============================================================================
+/// Checks that the maximum displacement of particles since the list was built 
+/// does not exceed skin/2. Particles that crossed a periodic boundary keep the
+/// list updating the periodic images of their neighbours. Returns false when 
+/// the list is invalid.
+///
+/// Comprueba que el desplazamiento maximo de las particulas desde que se creo
+/// la lista no supera skin/2. Las particulas que cruzaron un limite periodico
+/// mantienen la lista actualizando las imagenes periodicas de sus vecinos. 
+/// Devuelve false cuando la lista no es valida.
+//==============================================================================
+bool JNeighbourListCpu::CheckDisplacement(unsigned np,const tdouble3 *pos){
+  if(Valid && np!=Np)Valid=false;
+  if(Valid){
+    //-Two particles can approach each other up to twice the maximum displacement.
+    //-Dos particulas pueden acercarse hasta el doble del desplazamiento maximo.
+    const double dmax2=double(Skin)*double(Skin)/4.;
+    const int n=int(np);
+    double dmax=0;
+    #ifdef OMP_USE
+      #pragma omp parallel if(n>OMP_LIMIT_COMPUTELIGHT)
+      {
+        double dmaxth=0;
+        #pragma omp for schedule (static)
+        for(int p=0;p<n;p++){
+          const tdouble3 d=pos[p]-PosBuild[p];
+          const double d2=d.x*d.x+d.y*d.y+d.z*d.z;
+          if(dmaxth<d2)dmaxth=d2;
+        }
+        #pragma omp critical 
+        {
+          if(dmax<dmaxth)dmax=dmaxth;
+        }
+      }
+    #else
+      for(int p=0;p<n;p++){
+        const tdouble3 d=pos[p]-PosBuild[p];
+        const double d2=d.x*d.x+d.y*d.y+d.z*d.z;
+        if(dmax<d2)dmax=d2;
+      }
+    #endif
+    //-Looks for particles that crossed a periodic boundary. | Busca particulas que cruzaron un limite periodico.
+    if(dmax>dmax2 && ImgCount){
+      dmax=0;
+      for(unsigned p=0;p<np && Valid;p++){
+        const tdouble3 d=pos[p]-PosBuild[p];
+        double d2=d.x*d.x+d.y*d.y+d.z*d.z;
+        for(unsigned cimg=0;cimg<ImgCount && d2>dmax2;cimg++){
+          const tdouble3 dimg=d-ImgInc[cimg];
+          const double d2img=dimg.x*dimg.x+dimg.y*dimg.y+dimg.z*dimg.z;
+          if(d2img<=dmax2){
+            Valid=UpdateImages(p,cimg);
+            PosBuild[p]=PosBuild[p]+ImgInc[cimg];
+            d2=d2img;
+            NumPeriodic++;
+          }
+        }
+        if(dmax<d2)dmax=d2;
+      }
+    }
+    Valid=(Valid && dmax<=dmax2);
+    if(Valid)NumReuse++;
+  }
+  return(Valid);
+}
+
+//==============================================================================
+/// Stores the neighbours of particles [pini,pfin) and of their periodic images
+/// within the cutoff distance using the cells. The particles are split in one
+/// chunk per thread and the neighbours of each chunk are stored in ChunkList[]
+/// with positions relative to the chunk in Begin[pass].
+///
+/// Almacena los vecinos de las particulas [pini,pfin) y de sus imagenes 
+/// periodicas dentro de la distancia de corte usando las celdas. Las particulas
+/// se dividen en un trozo por hilo y los vecinos de cada trozo se guardan en 
+/// ChunkList[] con posiciones relativas al trozo en Begin[pass].
+//==============================================================================
+void JNeighbourListCpu::SearchPass(unsigned pass,unsigned pini,unsigned pfin,unsigned cellinitial
+  ,const tint4 &nc,const tint3 &cellzero,const tdouble3 &domposmin,const unsigned *begincell
+  ,const unsigned *cellrow,unsigned cellcode,const unsigned *dcell,const tdouble3 *pos)
+{
+  unsigned *begin=Begin[pass];
+  const double cutoff2=double(Cutoff)*double(Cutoff);
+  const int hdiv=Hdiv;
+  //-Limits of cells increased by the cutoff to search around periodic images. | Limites de las celdas aumentados con la distancia de corte para buscar alrededor de imagenes periodicas.
+  const tdouble3 imgmin=TDouble3(domposmin.x+Scell*cellzero.x-Cutoff,domposmin.y+Scell*cellzero.y-Cutoff,domposmin.z+Scell*cellzero.z-Cutoff);
+  const tdouble3 imgmax=TDouble3(domposmin.x+Scell*(cellzero.x+nc.x)+Cutoff,domposmin.y+Scell*(cellzero.y+nc.y)+Cutoff,domposmin.z+Scell*(cellzero.z+nc.z)+Cutoff);
+  bool errmem=false;
+  const int nchunks=int(NumChunks);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static,1)
+  #endif
+  for(int ck=0;ck<nchunks;ck++){
+    const unsigned ini=pini+unsigned(ullong(pfin-pini)*ck/nchunks);
+    const unsigned fin=pini+unsigned(ullong(pfin-pini)*(ck+1)/nchunks);
+    unsigned *list=ChunkList[ck];
+    unsigned size=SizeChunkList[ck];
+    unsigned cnt=0;  //-Number of neighbours in the chunk. | Numero de vecinos en el trozo.
+    try{
+      for(unsigned p1=ini;p1<fin;p1++){
+        begin[p1*2]=cnt;
+        for(unsigned cimg=0;cimg<=ImgCount;cimg++){
+          tdouble3 posp1=pos[p1];
+          int cx,cy,cz;
+          if(!cimg){
+            cx=PC__Cellx(cellcode,dcell[p1])-cellzero.x;
+            cy=PC__Celly(cellcode,dcell[p1])-cellzero.y;
+            cz=PC__Cellz(cellcode,dcell[p1])-cellzero.z;
+          }
+          else{
+            //-Periodic image of p1 and its cell limited to the cells of the domain. | Imagen periodica de p1 y su celda limitada a las celdas del dominio.
+            posp1=posp1+ImgInc[cimg-1];
+            if(!(imgmin<=posp1 && posp1<imgmax))continue;
+            cx=min(max(int(floor((posp1.x-domposmin.x)/Scell))-cellzero.x,0),nc.x-1);
+            cy=min(max(int(floor((posp1.y-domposmin.y)/Scell))-cellzero.y,0),nc.y-1);
+            cz=min(max(int(floor((posp1.z-domposmin.z)/Scell))-cellzero.z,0),nc.z-1);
+          }
+          //-Obtain limits of interaction. | Obtiene limites de interaccion.
+          const int cxini=cx-min(cx,hdiv);
+          const int cxfin=cx+min(nc.x-cx-1,hdiv)+1;
+          const int yini=cy-min(cy,hdiv);
+          const int yfin=cy+min(nc.y-cy-1,hdiv)+1;
+          const int zini=cz-min(cz,hdiv);
+          const int zfin=cz+min(nc.z-cz-1,hdiv)+1;
+          //-Search for neighbours in adjacent cells. | Busqueda de vecinos en celdas adyacentes.
+          for(int z=zini;z<zfin;z++){
+            const unsigned *rowz=cellrow+nc.y*z; //-First cell of the rows of cells in z. | Primera celda de las filas de celdas en z.
+            for(int y=yini;y<yfin;y++){
+              const int ymod=int(cellinitial+rowz[y]);
+              const unsigned p2ini=begincell[cxini+ymod];
+              const unsigned p2fin=begincell[cxfin+ymod];
+              //-Space for all particles of the cells. | Espacio para todas las particulas de las celdas.
+              if(cnt+(p2fin-p2ini)>size)list=ResizeList(list,size,cnt+(p2fin-p2ini),true);
+              for(unsigned p2=p2ini;p2<p2fin;p2++){
+                const double drx=posp1.x-pos[p2].x;
+                const double dry=posp1.y-pos[p2].y;
+                const double drz=posp1.z-pos[p2].z;
+                const double rr2=drx*drx+dry*dry+drz*drz;
+                if(rr2<=cutoff2 && (cimg || p2!=p1))list[cnt++]=p2|(cimg<<IMG_SHIFT);
+              }
+            }
+          }
+        }
+        begin[p1*2+1]=cnt;
+      }
+    }
+    catch(const std::bad_alloc){
+      #ifdef OMP_USE
+        #pragma omp critical
+      #endif
+      errmem=true;
+      cnt=0;
+    }
+    ChunkList[ck]=list;
+    SizeChunkList[ck]=size;
+    NumChunkList[ck]=cnt;
+  }
+  if(errmem)RunException("SearchPass","Could not allocate the requested memory.");
+}
+
+//==============================================================================
+/// Builds the lists of neighbours for interactions Fluid-Fluid, Fluid-Bound
+/// and Bound-Fluid starting from the current cell division.
+///
+/// Crea las listas de vecinos para las interacciones Fluid-Fluid, Fluid-Bound
+/// y Bound-Fluid a partir de la division en celdas actual.
+//==============================================================================
+void JNeighbourListCpu::Build(unsigned np,unsigned npb,unsigned npbok,tuint3 ncells,tuint3 cellmin,tdouble3 domposmin
+  ,const unsigned *begincell,const unsigned *cellrow,unsigned cellcode,const unsigned *dcell,const tdouble3 *pos)
+{
+  const char met[]="Build";
+  if(np>PART_MASK)RunException(met,fun::PrintStr("The number of particles exceeds the maximum of the neighbour list (%u).",PART_MASK));
+  AllocMemoryNp(np);
+  const tint4 nc=TInt4(int(ncells.x),int(ncells.y),int(ncells.z),int(ncells.x*ncells.y));
+  const tint3 cellzero=TInt3(cellmin.x,cellmin.y,cellmin.z);
+  const unsigned cellfluid=cellrow[nc.y*nc.z]+1;
+  //-One chunk of particles for each thread. | Un trozo de particulas para cada hilo.
+  NumChunks=unsigned(min(omp_get_max_threads(),OMP_MAXTHREADS));
+  const int nchunks=int(NumChunks);
+  for(unsigned pass=0;pass<PASS_COUNT;pass++){
+    const unsigned pini=(pass==PASS_BoundFluid? 0: npb);
+    const unsigned pfin=(pass==PASS_BoundFluid? npbok: np);
+    const unsigned cellinitial=(pass==PASS_FluidBound? 0: cellfluid);
+    unsigned *begin=Begin[pass];
+    //-Stores neighbours of each chunk of particles. | Almacena vecinos de cada trozo de particulas.
+    memset(begin,0,sizeof(unsigned)*np*2);
+    SearchPass(pass,pini,pfin,cellinitial,nc,cellzero,domposmin,begincell,cellrow,cellcode,dcell,pos);
+    //-Joins the neighbours of all chunks in List[]. | Une los vecinos de todos los trozos en List[].
+    unsigned chunkini[OMP_MAXTHREADS];
+    ullong nr=0;
+    for(int ck=0;ck<nchunks;ck++){ chunkini[ck]=unsigned(nr); nr+=NumChunkList[ck]; }
+    if(nr>UINT_MAX)RunException(met,"The number of neighbours exceeds the maximum of the neighbour list.");
+    try{
+      List[pass]=ResizeList(List[pass],SizeList[pass],unsigned(nr));
+    }
+    catch(const std::bad_alloc){
+      RunException(met,"Could not allocate the requested memory.");
+    }
+    unsigned *list=List[pass];
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static,1)
+    #endif
+    for(int ck=0;ck<nchunks;ck++){
+      const unsigned ini=pini+unsigned(ullong(pfin-pini)*ck/nchunks);
+      const unsigned fin=pini+unsigned(ullong(pfin-pini)*(ck+1)/nchunks);
+      const unsigned cini=chunkini[ck];
+      memcpy(list+cini,ChunkList[ck],sizeof(unsigned)*NumChunkList[ck]);
+      for(unsigned p=ini;p<fin;p++){ begin[p*2]+=cini; begin[p*2+1]+=cini; }
+    }
+  }
+  //-Build index of each particle is its current position. | El indice de creacion de cada particula es su posicion actual.
+  memcpy(PosBuild,pos,sizeof(tdouble3)*np);
+  const int n=int(np);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int p=0;p<n;p++){ BuildPart[p]=unsigned(p); CurPart[p]=unsigned(p); }
+  Np=NpBuild=np; Npb=npb; NpbOk=npbok;
+  Valid=true;
+  NumBuild++;
+}
+
+//==============================================================================
+/// Reorders the data of particles according to the new order after divide
+/// (sortpart[p] is the previous position of particle p for p>=pini). The list
+/// of neighbours does not change, only the current position of each build 
+/// index, which is UINT_MAX for excluded particles. New particles are not 
+/// allowed so periodic boundaries use periodic images (PeriImage).
+///
+/// Reordena los datos de particulas segun el nuevo orden tras el divide
+/// (sortpart[p] es la posicion anterior de la particula p para p>=pini). La 
+/// lista de vecinos no cambia, solo la posicion actual de cada indice de 
+/// creacion, que es UINT_MAX para las particulas excluidas. No se permiten 
+/// particulas nuevas asi que los limites periodicos usan imagenes periodicas
+/// (PeriImage).
+//==============================================================================
+void JNeighbourListCpu::SortData(unsigned np,unsigned npb,unsigned npbok,unsigned pini,const unsigned *sortpart){
+  if(Valid && (np>Np || npb!=Npb || npbok!=NpbOk))Valid=false;
+  if(Valid){
+    const int n=int(np);
+    //-Reorders position when the list was built and build index of each particle. | Reordena posicion cuando se creo la lista e indice de creacion de cada particula.
+    memcpy(PosAux,PosBuild,sizeof(tdouble3)*pini);
+    memcpy(PartAux,BuildPart,sizeof(unsigned)*pini);
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int p=int(pini);p<n;p++){
+      const unsigned pold=sortpart[p];
+      PosAux[p]=PosBuild[pold];
+      PartAux[p]=BuildPart[pold];
+    }
+    swap(PosBuild,PosAux);
+    swap(BuildPart,PartAux);
+    //-Reorders first and last neighbour of each particle. | Reordena primer y ultimo vecino de cada particula.
+    for(unsigned pass=0;pass<PASS_COUNT;pass++){
+      const unsigned *begin=Begin[pass];
+      memcpy(BeginAux,begin,sizeof(unsigned)*pini*2);
+      #ifdef OMP_USE
+        #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+      #endif
+      for(int p=int(pini);p<n;p++){
+        const unsigned pold=sortpart[p];
+        BeginAux[p*2]=begin[pold*2];
+        BeginAux[p*2+1]=begin[pold*2+1];
+      }
+      swap(Begin[pass],BeginAux);
+    }
+    //-Current position of each build index. | Posicion actual de cada indice de creacion.
+    memset(CurPart,255,sizeof(unsigned)*NpBuild);
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int p=0;p<n;p++)CurPart[BuildPart[p]]=unsigned(p);
+    Np=np;
+  }
+}
@@ -0,0 +1,130 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+/// \file JNeighbourListCpu.h \brief Declares the class \ref JNeighbourListCpu.
+
+#ifndef _JNeighbourListCpu_
+#define _JNeighbourListCpu_
+
+#include "Types.h"
+#include "JObject.h"
+#include "OmpDefs.h"
+
+//##############################################################################
+//# JNeighbourListCpu
+//##############################################################################
+/// \brief Manages a list of neighbours for each particle (Verlet list in CSR format) 
+/// that is reused in several interactions.
+///
+/// The list is built using the cells of \ref JCellDivCpu with a cutoff of 2h+skin, 
+/// so it remains valid while the maximum displacement of the particles since the 
+/// list was built does not exceed skin/2. Neighbours are stored with the index of 
+/// the particle when the list was built (build index) and the periodic image of 
+/// the particle where they were found (PeriImage), so the list does not change 
+/// after each divide and only the current position of each build index and the 
+/// first and last neighbour of each particle are reordered. Excluded particles 
+/// are removed with an invalid position and particles that cross a periodic 
+/// boundary only change the periodic image of their neighbours.
+
+class JNeighbourListCpu : protected JObject
+{
+public:
+  /// Types of interaction with a list of neighbours.
+  typedef enum{ 
+    PASS_FluidFluid=0,  ///<Interaction Fluid-Fluid.
+    PASS_FluidBound=1,  ///<Interaction Fluid-Bound.
+    PASS_BoundFluid=2   ///<Interaction Bound-Fluid.
+  }TpPass; 
+  static const unsigned PASS_COUNT=3;
+
+  static const unsigned IMG_SHIFT=27;                     ///<Bits of the build index in each neighbour, the rest is the periodic image (0 or 1+image). | Bits del indice de creacion en cada vecino, el resto es la imagen periodica (0 o 1+imagen).
+  static const unsigned PART_MASK=(1u<<IMG_SHIFT)-1;      ///<Mask to obtain the build index of each neighbour. | Mascara para obtener el indice de creacion de cada vecino.
+
+protected:
+  const float Skin;       ///<Distance added to the kernel size (2h) to build the list. | Distancia que se suma al tamano del kernel (2h) para crear la lista.
+  const float Cutoff;     ///<Cutoff distance to build the list (2h+skin). | Distancia de corte para crear la lista (2h+skin).
+  float Scell;            ///<Cell size. | Tamano de celda.
+  int Hdiv;               ///<Number of cells around each cell to look for neighbours. | Numero de celdas alrededor de cada celda para buscar vecinos.
+
+  unsigned ImgCount;      ///<Number of periodic images of each particle (PeriImage). | Numero de imagenes periodicas de cada particula (PeriImage).
+  tdouble3 ImgInc[26];    ///<Displacement of each periodic image. | Desplazamiento de cada imagen periodica.
+  tint3 ImgDir[26];       ///<Number of periodic displacements in X, Y and Z of each periodic image. | Numero de desplazamientos periodicos en X, Y y Z de cada imagen periodica.
+
+  bool Valid;             ///<Indicates that the list can be used. | Indica que la lista se puede usar.
+  unsigned Np;            ///<Current number of particles. | Numero actual de particulas.
+  unsigned Npb;           ///<Number of boundary particles when the list was built. | Numero de particulas contorno cuando se creo la lista.
+  unsigned NpbOk;         ///<Number of boundary particles near fluid when the list was built. | Numero de particulas contorno cerca del fluido cuando se creo la lista.
+  unsigned NpBuild;       ///<Number of particles when the list was built. | Numero de particulas cuando se creo la lista.
+
+  unsigned SizeNp;        ///<Number of particles with allocated memory. | Numero de particulas con memoria reservada.
+  tdouble3 *PosBuild;     ///<Position of particles when the list was built (in current order) [SizeNp]. | Posicion de las particulas cuando se creo la lista (en el orden actual) [SizeNp].
+  unsigned *BuildPart;    ///<Build index of each particle [SizeNp]. | Indice de creacion de cada particula [SizeNp].
+  unsigned *CurPart;      ///<Current position of each build index (UINT_MAX when it was excluded) [SizeNp]. | Posicion actual de cada indice de creacion (UINT_MAX cuando se excluyo) [SizeNp].
+  unsigned *Begin[PASS_COUNT];     ///<First and last+1 neighbour in List[] of each particle (in current order) [SizeNp*2]. | Primer y ultimo+1 vecino en List[] de cada particula (en el orden actual) [SizeNp*2].
+  unsigned *List[PASS_COUNT];      ///<Build index and periodic image of neighbours of each particle [SizeList]. | Indice de creacion e imagen periodica de los vecinos de cada particula [SizeList].
+  unsigned SizeList[PASS_COUNT];   ///<Number of neighbours with allocated memory in List[]. | Numero de vecinos con memoria reservada en List[].
+  tdouble3 *PosAux;       ///<Auxiliary memory to reorder PosBuild [SizeNp].
+  unsigned *PartAux;      ///<Auxiliary memory to reorder BuildPart [SizeNp].
+  unsigned *BeginAux;     ///<Auxiliary memory to reorder Begin[] [SizeNp*2].
+
+  unsigned NumChunks;                    ///<Number of chunks of particles to build the list. | Numero de trozos de particulas para crear la lista.
+  unsigned *ChunkList[OMP_MAXTHREADS];   ///<Neighbours found in each chunk [SizeChunkList]. | Vecinos encontrados en cada trozo [SizeChunkList].
+  unsigned SizeChunkList[OMP_MAXTHREADS];///<Number of neighbours with allocated memory in ChunkList[]. | Numero de vecinos con memoria reservada en ChunkList[].
+  unsigned NumChunkList[OMP_MAXTHREADS]; ///<Number of neighbours found in each chunk. | Numero de vecinos encontrados en cada trozo.
+
+  unsigned NumBuild;      ///<Number of times the list was built. | Numero de veces que se creo la lista.
+  unsigned NumReuse;      ///<Number of interactions using a list built before. | Numero de interacciones usando una lista creada antes.
+  unsigned NumPeriodic;   ///<Number of particles that crossed a periodic boundary keeping the list. | Numero de particulas que cruzaron un limite periodico manteniendo la lista.
+
+  void FreeMemory();
+  void AllocMemoryNp(unsigned np);
+  static unsigned* ResizeList(unsigned *list,unsigned &size,unsigned newsize,bool keep=false);
+  void SearchPass(unsigned pass,unsigned pini,unsigned pfin,unsigned cellinitial
+    ,const tint4 &nc,const tint3 &cellzero,const tdouble3 &domposmin,const unsigned *begincell
+    ,const unsigned *cellrow,unsigned cellcode,const unsigned *dcell,const tdouble3 *pos);
+  unsigned GetImage(const tint3 &dir)const;
+  bool UpdateImages(unsigned p,unsigned cimg);
+
+public:
+  JNeighbourListCpu(float skin,float dosh,float scell);
+  ~JNeighbourListCpu();
+  void Reset();
+
+  void Invalidate(){ Valid=false; }
+  void ConfigCells(float scell);
+  void ConfigPeriImages(unsigned count,const tdouble3 *inc,const tint3 *dir);
+  bool CheckDisplacement(unsigned np,const tdouble3 *pos);
+  void Build(unsigned np,unsigned npb,unsigned npbok,tuint3 ncells,tuint3 cellmin,tdouble3 domposmin
+    ,const unsigned *begincell,const unsigned *cellrow,unsigned cellcode,const unsigned *dcell,const tdouble3 *pos);
+  void SortData(unsigned np,unsigned npb,unsigned npbok,unsigned pini,const unsigned *sortpart);
+
+  bool IsValid()const{ return(Valid); }
+  float GetSkin()const{ return(Skin); }
+  const unsigned* GetBegin(TpPass pass)const{ return(Valid? Begin[pass]: NULL); }
+  const unsigned* GetList(TpPass pass)const{ return(Valid? List[pass]: NULL); }
+  const unsigned* GetCurPart()const{ return(Valid? CurPart: NULL); }
+  unsigned GetNumBuild()const{ return(NumBuild); }
+  unsigned GetNumReuse()const{ return(NumReuse); }
+  unsigned GetNumPeriodic()const{ return(NumPeriodic); }
+
+  llong GetAllocMemory()const;
+};
+
+#endif
+
+
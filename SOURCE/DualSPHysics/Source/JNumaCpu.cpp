@@ -0,0 +1,260 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+/// \file JNumaCpu.cpp \brief Implements the class \ref JNumaCpu.
+
+#include "JNumaCpu.h"
+#include "JLog2.h"
+#include "Functions.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#ifdef WIN32
+  #include <windows.h>
+#else
+  #include <sched.h>
+  #include <malloc.h>
+#endif
+
+using namespace std;
+
+//==============================================================================
+/// Constructor.
+//==============================================================================
+JNumaCpu::JNumaCpu(int ompthreads):OmpThreads(ompthreads){
+  ClassName="JNumaCpu";
+  Reset();
+  LoadTopology();
+  ConfigThreads();
+#ifndef WIN32
+  //-Fixes the threshold of mmap so large arrays always use new pages that are 
+  // placed by first touch (the default threshold grows when arrays are freed).
+  //-Fija el umbral de mmap para que los arrays grandes usen siempre paginas 
+  // nuevas que se ubican con el primer acceso (el umbral por defecto crece al 
+  // liberar arrays).
+  mallopt(M_MMAP_THRESHOLD,128*1024);
+#endif
+}
+
+//==============================================================================
+/// Destructor.
+//==============================================================================
+JNumaCpu::~JNumaCpu(){
+  Reset();
+}
+
+//==============================================================================
+/// Initialisation of variables.
+//==============================================================================
+void JNumaCpu::Reset(){
+  TopologySys=false;
+  NumNodes=0;
+  NodeCpus.clear();
+  memset(NodeCpuIni,0,sizeof(unsigned)*(MAXNODES+1));
+  memset(ThreadNode,0,sizeof(int)*OMP_MAXTHREADS);
+  memset(ThreadCpu,0,sizeof(int)*OMP_MAXTHREADS);
+  Pinned=false;
+  PlaceNpb=PlaceNp=0;
+  NumPlace=0;
+}
+
+//==============================================================================
+/// Loads list of cpus from file with format "0-3,8,10-11".
+/// Carga lista de cpus de fichero con formato "0-3,8,10-11".
+//==============================================================================
+bool JNumaCpu::LoadCpuList(const std::string &file,std::vector<int> &cpus){
+  cpus.clear();
+  FILE *pf=fopen(file.c_str(),"r");
+  if(!pf)return(false);
+  char tx[4096];
+  const bool ok=(fgets(tx,sizeof(tx),pf)!=NULL);
+  fclose(pf);
+  if(ok){
+    const char *c=tx;
+    while(*c>='0' && *c<='9'){
+      char *e=NULL;
+      const int v1=int(strtol(c,&e,10));
+      int v2=v1;
+      if(*e=='-')v2=int(strtol(e+1,&e,10));
+      for(int v=v1;v<=v2;v++)cpus.push_back(v);
+      c=(*e==','? e+1: e);
+    }
+  }
+  return(!cpus.empty());
+}
+
+//==============================================================================
+/// Loads NUMA topology of the host. Without system information all cpus are
+/// in one node.
+/// Carga la topologia NUMA del host. Sin informacion del sistema todas las cpus
+/// estan en un nodo.
+//==============================================================================
+void JNumaCpu::LoadTopology(){
+  NumNodes=0; NodeCpus.clear();
+#ifndef WIN32
+  for(unsigned node=0;node<MAXNODES;node++){
+    vector<int> cpus;
+    if(!LoadCpuList(fun::PrintStr("/sys/devices/system/node/node%u/cpulist",node),cpus)){
+      //-Nodes without cpus or without information are ignored.
+      if(node>0 && !fun::DirExists(fun::PrintStr("/sys/devices/system/node/node%u",node)))break;
+      continue;
+    }
+    NodeCpuIni[NumNodes]=unsigned(NodeCpus.size());
+    NodeCpus.insert(NodeCpus.end(),cpus.begin(),cpus.end());
+    NumNodes++;
+  }
+#endif
+  TopologySys=(NumNodes>0);
+  if(!TopologySys){
+    #ifdef OMP_USE
+      const int ncpus=max(omp_get_num_procs(),1);
+    #else
+      const int ncpus=1;
+    #endif
+    for(int c=0;c<ncpus;c++)NodeCpus.push_back(c);
+    NumNodes=1;
+  }
+  NodeCpuIni[NumNodes]=unsigned(NodeCpus.size());
+}
+
+//==============================================================================
+/// Assigns threads to nodes in contiguous groups proportional to the number of
+/// cpus of each node and assigns one cpu of the node to each thread.
+/// Asigna los hilos a los nodos en grupos contiguos proporcionales al numero de
+/// cpus de cada nodo y asigna una cpu del nodo a cada hilo.
+//==============================================================================
+void JNumaCpu::ConfigThreads(){
+  const unsigned ncpus=unsigned(NodeCpus.size());
+  for(int th=0;th<OmpThreads;th++){
+    const unsigned pos=unsigned((ullong(th)*ncpus)/unsigned(OmpThreads));
+    unsigned node=0;
+    while(node+1<NumNodes && pos>=NodeCpuIni[node+1])node++;
+    ThreadNode[th]=int(node);
+    ThreadCpu[th]=NodeCpus[pos];
+  }
+}
+
+//==============================================================================
+/// Pins each OpenMP thread to its cpu. Returns false when it is not possible.
+/// Fija cada hilo OpenMP a su cpu. Devuelve false cuando no es posible.
+//==============================================================================
+bool JNumaCpu::PinThreads(){
+  int nok=0;
+  #ifdef OMP_USE
+    #pragma omp parallel num_threads(OmpThreads) reduction(+:nok)
+  #endif
+  {
+    const int th=omp_get_thread_num();
+    const int cpu=ThreadCpu[th];
+  #ifdef WIN32
+    if(cpu<int(sizeof(DWORD_PTR)*8) && SetThreadAffinityMask(GetCurrentThread(),DWORD_PTR(1)<<cpu))nok++;
+  #else
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu,&mask);
+    if(!sched_setaffinity(0,sizeof(mask),&mask))nok++;
+  #endif
+  }
+  Pinned=(nok==OmpThreads);
+  return(Pinned);
+}
+
+//==============================================================================
+/// Shows the topology and the placement of threads.
+/// Muestra la topologia y la ubicacion de los hilos.
+//==============================================================================
+void JNumaCpu::VisuTopology(JLog2 *log)const{
+  log->Printf("NUMA topology: %u node%s with %u cpus%s.",NumNodes,(NumNodes>1? "s": ""),unsigned(NodeCpus.size()),(TopologySys? "": " (no system information)"));
+  for(unsigned node=0;node<NumNodes;node++){
+    string tx;
+    for(unsigned c=NodeCpuIni[node];c<NodeCpuIni[node+1];c++){
+      unsigned c2=c;
+      while(c2+1<NodeCpuIni[node+1] && NodeCpus[c2+1]==NodeCpus[c2]+1)c2++;
+      tx=tx+(tx.empty()? "": ",")+fun::IntStr(NodeCpus[c])+(c2>c? string("-")+fun::IntStr(NodeCpus[c2]): string(""));
+      c=c2;
+    }
+    string txth;
+    for(int th=0;th<OmpThreads;th++)if(ThreadNode[th]==int(node))txth=txth+(txth.empty()? "": ",")+fun::IntStr(th);
+    log->Printf("  Node %u: cpus [%s]  threads [%s]",node,tx.c_str(),txth.c_str());
+  }
+  if(Pinned){
+    string tx;
+    for(int th=0;th<OmpThreads;th++)tx=tx+(th? ",": "")+fun::PrintStr("%d:%d",th,ThreadCpu[th]);
+    log->Printf("  Pinned threads (thread:cpu): %s",tx.c_str());
+  }
+}
+
+//==============================================================================
+/// Initialises array ptr[size] from the threads that process each range of 
+/// particles so its memory pages are placed in their NUMA nodes. The first 
+/// ncopy elements are copied from src and the rest are set to zero.
+///
+/// Inicializa el array ptr[size] desde los hilos que procesan cada rango de 
+/// particulas para que sus paginas de memoria se ubiquen en sus nodos NUMA. Los
+/// primeros ncopy elementos se copian de src y el resto se ponen a cero.
+//==============================================================================
+void JNumaCpu::FirstTouch(void *ptr,const void *src,unsigned elementsize,unsigned size,unsigned ncopy)const{
+  byte *dst=(byte*)ptr;
+  const byte *src8=(const byte*)src;
+  const unsigned np=min(PlaceNp,size),npb=min(PlaceNpb,np);
+  if(!src8)ncopy=0;
+  #ifdef OMP_USE
+    #pragma omp parallel num_threads(OmpThreads)
+  #endif
+  {
+    const int th=omp_get_thread_num();
+    const int nth=omp_get_num_threads();
+    //-Ranges of boundary, fluid and free space. | Rangos de contorno, fluido y espacio libre.
+    unsigned rini[3],rfin[3];
+    GetThreadRange(0,npb,th,nth,rini[0],rfin[0]);
+    GetThreadRange(npb,np,th,nth,rini[1],rfin[1]);
+    GetThreadRange(np,size,th,nth,rini[2],rfin[2]);
+    for(unsigned r=0;r<3;r++){
+      const unsigned ini=rini[r],fin=rfin[r],fcp=max(ini,min(fin,ncopy));
+      if(fcp>ini)memcpy(dst+size_t(ini)*elementsize,src8+size_t(ini)*elementsize,size_t(fcp-ini)*elementsize);
+      if(fin>fcp)memset(dst+size_t(fcp)*elementsize,0,size_t(fin-fcp)*elementsize);
+    }
+  }
+}
+
+//==============================================================================
+/// Returns true when the ranges of particles of threads moved too much from 
+/// the current placement of the arrays.
+/// Devuelve true cuando los rangos de particulas de los hilos se movieron 
+/// demasiado respecto a la ubicacion actual de los arrays.
+//==============================================================================
+bool JNumaCpu::CheckPlacement(unsigned npb,unsigned np)const{
+  if(NumNodes<2)return(false);
+  const unsigned dnpb=(npb>PlaceNpb? npb-PlaceNpb: PlaceNpb-npb);
+  const unsigned nf=np-npb,placenf=PlaceNp-PlaceNpb;
+  const unsigned dnf=(nf>placenf? nf-placenf: placenf-nf);
+  //-Tolerance is 1/32 of the fluid range of one thread. | La tolerancia es 1/32 del rango de fluido de un hilo.
+  const unsigned tol=nf/(unsigned(OmpThreads)*32);
+  return(dnpb+dnf>tol);
+}
+
+//==============================================================================
+/// Stores the ranges of particles used for the placement of arrays.
+/// Guarda los rangos de particulas usados para la ubicacion de los arrays.
+//==============================================================================
+void JNumaCpu::SetPlacement(unsigned npb,unsigned np){
+  if(PlaceNp)NumPlace++;
+  PlaceNpb=npb; PlaceNp=np;
+}
+
@@ -0,0 +1,96 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+/// \file JNumaCpu.h \brief Declares the class \ref JNumaCpu.
+
+#ifndef _JNumaCpu_
+#define _JNumaCpu_
+
+#include "Types.h"
+#include "JObject.h"
+#include "OmpDefs.h"
+#include <string>
+#include <vector>
+
+class JLog2;
+
+//##############################################################################
+//# JNumaCpu
+//##############################################################################
+/// \brief Manages the NUMA topology of the host, the placement of OpenMP threads
+/// and the first-touch placement of particle arrays.
+///
+/// Threads are assigned to NUMA nodes in contiguous groups proportional to the 
+/// number of cpus of each node. Particle data is split in one static range per
+/// thread for boundary [0,npb) and fluid [npb,np) particles, so the pages of each
+/// range are first touched by the thread that processes that range.
+
+class JNumaCpu : protected JObject
+{
+protected:
+  static const unsigned MAXNODES=64;
+  const int OmpThreads;          ///<Number of OpenMP threads. | Numero de hilos OpenMP.
+
+  //-Topology. | Topologia.
+  bool TopologySys;              ///<Topology was loaded from system information. | La topologia se cargo de la informacion del sistema.
+  unsigned NumNodes;             ///<Number of NUMA nodes. | Numero de nodos NUMA.
+  std::vector<int> NodeCpus;     ///<Cpus of each node consecutively. | Cpus de cada nodo consecutivamente.
+  unsigned NodeCpuIni[MAXNODES+1];///<First position in NodeCpus[] of each node. | Primera posicion en NodeCpus[] de cada nodo.
+
+  //-Placement of threads. | Ubicacion de hilos.
+  int ThreadNode[OMP_MAXTHREADS];///<NUMA node of each thread. | Nodo NUMA de cada hilo.
+  int ThreadCpu[OMP_MAXTHREADS]; ///<Cpu assigned to each thread. | Cpu asignada a cada hilo.
+  bool Pinned;                   ///<Threads are pinned to their cpus. | Los hilos estan fijados a sus cpus.
+
+  //-Placement of particle arrays. | Ubicacion de arrays de particulas.
+  unsigned PlaceNpb;             ///<Number of boundary particles of the current placement. | Numero de particulas contorno de la ubicacion actual.
+  unsigned PlaceNp;              ///<Number of particles of the current placement. | Numero de particulas de la ubicacion actual.
+  unsigned NumPlace;             ///<Number of placements after the initial one. | Numero de reubicaciones despues de la inicial.
+
+  void LoadTopology();
+  static bool LoadCpuList(const std::string &file,std::vector<int> &cpus);
+  void ConfigThreads();
+
+public:
+  JNumaCpu(int ompthreads);
+  ~JNumaCpu();
+  void Reset();
+
+  bool PinThreads();
+  void VisuTopology(JLog2 *log)const;
+
+  static void GetThreadRange(unsigned pini,unsigned pfin,int th,int nth,unsigned &ini,unsigned &fin){
+    const unsigned n=pfin-pini,q=n/unsigned(nth),r=n%unsigned(nth);
+    ini=pini+q*unsigned(th)+std::min(unsigned(th),r);
+    fin=ini+q+(unsigned(th)<r? 1: 0);
+  }
+  void FirstTouch(void *ptr,const void *src,unsigned elementsize,unsigned size,unsigned ncopy)const;
+
+  bool CheckPlacement(unsigned npb,unsigned np)const;
+  void SetPlacement(unsigned npb,unsigned np);
+
+  int GetOmpThreads()const{ return(OmpThreads); }
+  unsigned GetNumNodes()const{ return(NumNodes); }
+  int GetThreadNode(int th)const{ return(ThreadNode[th]); }
+  bool GetPinned()const{ return(Pinned); }
+  unsigned GetNumPlace()const{ return(NumPlace); }
+};
+
+#endif
+
+
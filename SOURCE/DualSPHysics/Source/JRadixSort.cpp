@@ -19,6 +19,8 @@
 /// \file JRadixSort.cpp \brief Implements the class \ref JRadixSort.
 
 #include "JRadixSort.h"
+#include "Functions.h"
+#include "JTimer.h"
 #include <string>
 #include <cstring>
 #include <climits>
@@ -258,6 +260,32 @@ template<class T> void JRadixSort::LoadBeginKeys(const T* data){
   }
 }
 
+//==============================================================================
+/// Devuelve el numero de hilos para los pasos de ordenacion.
+/// Returns the number of threads for the sorting steps.
+//==============================================================================
+int JRadixSort::GetStepThreads()const{
+  const int threads=omp_get_max_threads();
+  if(!UseOmp || threads<2)return(1);
+  const int nb=int(Size/(OMPSIZE*4));
+  return(min(threads,max(nb,1)));
+}
+
+//==============================================================================
+/// Indica si todos los valores tienen la misma clave en el paso ck, en cuyo caso
+/// el paso no cambia el orden y se puede omitir.
+/// Returns if all values have the same key in step ck, in which case the step
+/// does not change the order and can be skipped.
+//==============================================================================
+bool JRadixSort::TrivialStep(unsigned ck)const{
+  const unsigned *bk=BeginKeys+(ck*KEYSRANGE);
+  for(unsigned c=0;c<KEYSRANGE;c++){
+    const unsigned n=(c+1<KEYSRANGE? bk[c+1]: Size)-bk[c];
+    if(n)return(n==Size);
+  }
+  return(true);
+}
+
 //==============================================================================
 /// Realiza un paso de ordenacion en funcion de 1 bit.
 /// Performs a sorting step in an 1 bit function.
@@ -292,6 +320,79 @@ template<class T> void JRadixSort::SortStepIndex(unsigned ck,const T* data,T* da
   }
 }
 
+//==============================================================================
+/// Realiza un paso de ordenacion estable con varios hilos. Cada hilo cuenta las 
+/// claves de su rango contiguo de datos y luego lo distribuye a partir de la 
+/// posicion de sus claves tras los hilos anteriores. Index es opcional.
+/// Performs a stable sorting step with several threads. Each thread counts the
+/// keys of its contiguous range of data and then scatters it starting from the 
+/// position of its keys after the previous threads. Index is optional.
+//==============================================================================
+template<class T> void JRadixSort::SortStepOmp(unsigned ck,int threads,unsigned *thkeys
+  ,const T* data,T* data2,const unsigned *index,unsigned *index2)
+{
+  const unsigned ckmov=ck*KEYSBITS;
+  const unsigned sthkeys=KEYSRANGE+OMPSTRIDE;
+  const unsigned nth=(Size+unsigned(threads)-1)/unsigned(threads);
+  //-Cuenta claves del rango de cada hilo.
+  //-Counts keys of the range of each thread.
+  #ifdef OMP_USE_RADIXSORT
+    #pragma omp parallel for schedule (static,1)
+  #endif
+  for(int th=0;th<threads;th++){
+    unsigned *n=thkeys+(sthkeys*th);
+    memset(n,0,sizeof(unsigned)*KEYSRANGE);
+    const unsigned pini=min(Size,nth*th),pfin=min(Size,pini+nth);
+    for(unsigned p=pini;p<pfin;p++)n[(data[p]>>ckmov)&KEYSMASK]++;
+  }
+  //-Calcula posicion inicial de cada clave para cada hilo.
+  //-Computes initial position of each key for each thread.
+  const unsigned *bk=BeginKeys+(ck*KEYSRANGE);
+  for(unsigned k=0;k<KEYSRANGE;k++){
+    unsigned pos=bk[k];
+    for(int th=0;th<threads;th++){
+      unsigned *n=thkeys+(sthkeys*th+k);
+      const unsigned v=*n; *n=pos; pos+=v;
+    }
+  }
+  //-Distribuye los datos del rango de cada hilo.
+  //-Scatters data of the range of each thread.
+  #ifdef OMP_USE_RADIXSORT
+    #pragma omp parallel for schedule (static,1)
+  #endif
+  for(int th=0;th<threads;th++){
+    unsigned *p2=thkeys+(sthkeys*th);
+    const unsigned pini=min(Size,nth*th),pfin=min(Size,pini+nth);
+    if(index)for(unsigned p=pini;p<pfin;p++){
+      const unsigned pk=p2[(data[p]>>ckmov)&KEYSMASK]++;
+      data2[pk]=data[p];
+      index2[pk]=index[p];
+    }
+    else for(unsigned p=pini;p<pfin;p++){
+      data2[p2[(data[p]>>ckmov)&KEYSMASK]++]=data[p];
+    }
+  }
+}
+
+//==============================================================================
+/// Aplica los pasos de ordenacion omitiendo los que no cambian el orden. 
+/// Al terminar prevdata (y PrevIndex) apuntan a los datos ordenados.
+/// Applies the sorting steps skipping those that do not change the order.
+/// At the end prevdata (and PrevIndex) point to the sorted data.
+//==============================================================================
+template<class T> void JRadixSort::SortSteps(bool makeindex,T *&prevdata,T *&data){
+  const int threads=GetStepThreads();
+  unsigned *thkeys=(threads>1? new unsigned[(KEYSRANGE+OMPSTRIDE)*threads]: NULL);
+  for(unsigned ck=0;ck<Nkeys;ck++)if(!TrivialStep(ck)){
+    if(threads>1)SortStepOmp(ck,threads,thkeys,prevdata,data,(makeindex? PrevIndex: NULL),Index);
+    else if(makeindex)SortStepIndex(ck,prevdata,data,PrevIndex,Index);
+    else SortStep(ck,prevdata,data);
+    if(makeindex)swap(PrevIndex,Index);
+    swap(prevdata,data);
+  }
+  delete[] thkeys;
+}
+
 //==============================================================================
 /// Crea e inicializa el vector Index[].
 /// Creates and initializes the Index[] array.
@@ -342,14 +443,7 @@ void JRadixSort::Sort(bool makeindex,unsigned size,unsigned *data,unsigned nbits
   AllocMemory(Size);
   if(makeindex)IndexCreate();
   LoadBeginKeys<unsigned>(PrevData32);
-  for(unsigned ck=0;ck<Nkeys;ck++){
-    if(makeindex){
-      SortStepIndex(ck,PrevData32,Data32,PrevIndex,Index);
-      swap(PrevIndex,Index);
-    }
-    else SortStep(ck,PrevData32,Data32);
-    swap(PrevData32,Data32);
-  }
+  SortSteps<unsigned>(makeindex,PrevData32,Data32);
   if(makeindex){ 
     swap(PrevIndex,Index);
     delete[] PrevIndex; PrevIndex=NULL;
@@ -370,14 +464,7 @@ void JRadixSort::Sort(bool makeindex,unsigned size,ullong *data,unsigned nbits){
   AllocMemory(Size);
   if(makeindex)IndexCreate();
   LoadBeginKeys<ullong>(PrevData64);
-  for(unsigned ck=0;ck<Nkeys;ck++){
-    if(makeindex){
-      SortStepIndex(ck,PrevData64,Data64,PrevIndex,Index);
-      swap(PrevIndex,Index);
-    }
-    else SortStep(ck,PrevData64,Data64);
-    swap(PrevData64,Data64);
-  }
+  SortSteps<ullong>(makeindex,PrevData64,Data64);
   if(makeindex){ 
     swap(PrevIndex,Index);
     delete[] PrevIndex; PrevIndex=NULL;
@@ -520,6 +607,78 @@ void JRadixSort::SortData(unsigned size,const tdouble3 *data,tdouble3 *result){
 //==============================================================================
 void JRadixSort::SortData(unsigned size,const tdouble2 *data,tdouble2 *result){ TSortData<tdouble2>(size,data,result); }
 
+//==============================================================================
+/// Ejecuta benchmark de un tipo de clave y devuelve linea de resultados.
+/// Runs benchmark of one type of key and returns line of results.
+//==============================================================================
+template<class T> std::string JRadixSort::TRunBenchmark(unsigned size,unsigned nbits){
+  const char met[]="RunBenchmark";
+  //-Genera claves aleatorias (xorshift64) de nbits.
+  //-Generates random keys (xorshift64) of nbits.
+  const ullong mask=(nbits>=64? ~ullong(0): (ullong(1)<<nbits)-1);
+  T *keys=new T[size];
+  T *ref=new T[size];
+  T *data=new T[size];
+  unsigned *ids=new unsigned[size];
+  unsigned *ids2=new unsigned[size];
+  ullong x=88172645463325252ULL;
+  for(unsigned p=0;p<size;p++){
+    x^=x<<13; x^=x>>7; x^=x<<17;
+    keys[p]=T(x&mask);
+    ids[p]=p;
+  }
+  JTimer timer;
+  //-Referencia con std::sort.
+  //-Reference with std::sort.
+  memcpy(ref,keys,sizeof(T)*size);
+  timer.Start();
+  sort(ref,ref+size);
+  timer.Stop();
+  const double tstd=timer.GetElapsedTimeD();
+  //-Ordenacion secuencial y con OpenMP (con indice).
+  //-Sequential sort and with OpenMP (with index).
+  double tsort[2];
+  int nthreads=1;
+  for(int omp=0;omp<2;omp++){
+    JRadixSort rs(omp!=0);
+    if(omp)nthreads=(rs.UseOmp? omp_get_max_threads(): 1);
+    memcpy(data,keys,sizeof(T)*size);
+    timer.Start();
+    rs.Sort(true,size,data);
+    timer.Stop();
+    tsort[omp]=timer.GetElapsedTimeD();
+    rs.SortData(size,ids,ids2);
+    //-Comprueba claves ordenadas, indice y estabilidad.
+    //-Checks sorted keys, index and stability.
+    if(memcmp(data,ref,sizeof(T)*size))rs.RunException(met,"The sorted keys are not correct.");
+    for(unsigned p=0;p<size;p++){
+      if(keys[ids2[p]]!=data[p] || (p && data[p-1]==data[p] && ids2[p-1]>=ids2[p]))rs.RunException(met,"The sorting index is not correct.");
+    }
+  }
+  delete[] keys; delete[] ref; delete[] data;
+  delete[] ids; delete[] ids2;
+  return(fun::PrintStr("  %2u-bit keys (%2u bits) std::sort:%9.2f ms  serial:%9.2f ms  omp(%d):%9.2f ms  [OK]\n"
+    ,unsigned(sizeof(T)*8),nbits,tstd,tsort[0],nthreads,tsort[1]));
+}
+
+//==============================================================================
+/// Compara RadixSort con OpenMP frente a la version secuencial y std::sort
+/// usando claves aleatorias de 32 y 64 bits. Devuelve texto con resultados y 
+/// genera excepcion si alguna ordenacion no es correcta.
+/// Compares RadixSort with OpenMP against the sequential version and std::sort
+/// using random keys of 32 and 64 bits. Returns text with results and throws
+/// an exception when some sort is not correct.
+//==============================================================================
+std::string JRadixSort::RunBenchmark(unsigned size){
+  string tx=fun::PrintStr("Benchmark of JRadixSort with %u values (OpenMP:%s threads:%d)\n"
+    ,size,(CompiledOMP()? "True": "False"),omp_get_max_threads());
+  tx=tx+TRunBenchmark<unsigned>(size,24);
+  tx=tx+TRunBenchmark<unsigned>(size,32);
+  tx=tx+TRunBenchmark<ullong>(size,48);
+  tx=tx+TRunBenchmark<ullong>(size,64);
+  return(tx);
+}
+
 //==============================================================================
 /// Comprueba ordenacion de datos.
 /// Checks sorting data.
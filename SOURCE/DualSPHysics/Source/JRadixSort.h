@@ -32,6 +32,9 @@
 //:# - Limpieza de codigo usado para debug. (30-01-2016)
 //:# - Se usa _WITHOMP_RADIXSORT para compilacion con OMP. (07-07-2016)
 //:# - Se usa OMP_USE_RADIXSORT definido en OmpDefs.h para compilacion con OMP. (04-01-2017)
+//:# - Pasos de ordenacion con OpenMP mediante histogramas por hilo y omite los 
+//:#   pasos en que todos los valores tienen la misma clave. (18-10-2026)
+//:# - Nuevo metodo RunBenchmark() para comparar con std::sort. (18-10-2026)
 //:#############################################################################
 
 /// \file JRadixSort.h \brief Declares the class  \ref JRadixSort.
@@ -42,6 +45,7 @@
 #include "JObject.h"
 #include "TypesDef.h"
 #include "OmpDefs.h"
+#include <string>
 
 //#define OMP_USE_RADIXSORT ///<Enables/disables OpenMP use, it should be defined in OmpDefs.h.
 
@@ -87,11 +91,17 @@ private:
   template<class T> unsigned TCalcNbits(unsigned size,const T *data)const;
   template<class T> void SortStep(unsigned ck,const T* data,T* data2);
   template<class T> void SortStepIndex(unsigned ck,const T* data,T* data2,const unsigned *index,unsigned *index2);
+  template<class T> void SortStepOmp(unsigned ck,int threads,unsigned *thkeys,const T* data,T* data2,const unsigned *index,unsigned *index2);
+  template<class T> void SortSteps(bool makeindex,T *&prevdata,T *&data);
+  int GetStepThreads()const;
+  bool TrivialStep(unsigned ck)const;
 
   template<class T> void TSortData(unsigned size,const T *data,T *result);
 
   void IndexCreate();
 
+  template<class T> static std::string TRunBenchmark(unsigned size,unsigned nbits);
+
 public:
   JRadixSort(bool useomp);
   ~JRadixSort();
@@ -130,6 +140,8 @@ public:
   void SortData(unsigned size,const tdouble2 *data,tdouble2 *result);
   void SortData(unsigned size,const tdouble3 *data,tdouble3 *result);
 
+  static std::string RunBenchmark(unsigned size);
+
   void DgCheckResult32()const;
   void DgCheckResult64()const;
 };
@@ -34,6 +34,7 @@
 #include "JTimeOut.h"
 #include "JSphVisco.h"
 #include "JGaugeSystem.h"
+#include "JMemoryTracker.h"
 #include "JWaveGen.h"
 #include "JSphAccInput.h"
 #include "JPartDataBi4.h"
@@ -69,9 +70,12 @@ JSph::JSph(bool cpu,bool withmpi):Cpu(cpu),WithMpi(withmpi){
   FtObjs=NULL;
   DemData=NULL;
   GaugeSystem=NULL;
+  MemTrack=NULL;
   WaveGen=NULL;
   Damping=NULL;
   AccInput=NULL;
+  KerTableFac=NULL;
+  KerTableTensil=NULL;
   InitVars();
 }
 
@@ -90,9 +94,12 @@ JSph::~JSph(){
   delete MkInfo;
   delete Motion;
   delete[] MotionObjBegin; MotionObjBegin=NULL;
+  delete[] KerTableFac;    KerTableFac=NULL;
+  delete[] KerTableTensil; KerTableTensil=NULL;
   AllocMemoryFloating(0);
   delete[] DemData; DemData=NULL;
   delete GaugeSystem;
+  delete MemTrack;
   delete WaveGen;
   delete Damping;
   delete AccInput;
@@ -121,6 +128,9 @@ void JSph::InitVars(){
   TKernel=KERNEL_Wendland;
   Awen=Bwen=Agau=Bgau=0;
   memset(&CubicCte,0,sizeof(StCubicCte));
+  KerTableSize=0; KerTableIdr2=0;
+  delete[] KerTableFac;    KerTableFac=NULL;
+  delete[] KerTableTensil; KerTableTensil=NULL;
   TVisco=VISCO_None;
   TDeltaSph=DELTA_None; DeltaSph=0;
   TShifting=SHIFT_None; ShiftCoef=ShiftTFS=0;
@@ -375,6 +385,7 @@ void JSph::LoadConfig(const JCfgRun *cfg){
   if(cfg->TStep)TStep=cfg->TStep;
   if(cfg->VerletSteps>=0)VerletSteps=cfg->VerletSteps;
   if(cfg->TKernel)TKernel=cfg->TKernel;
+  KerTableSize=(Cpu? cfg->KerTableSize: 0);
   if(cfg->TVisco){ TVisco=cfg->TVisco; Visco=cfg->Visco; }
   if(cfg->ViscoBoundFactor>=0)ViscoBoundFactor=cfg->ViscoBoundFactor;
   if(cfg->DeltaSph>=0){
@@ -845,6 +856,117 @@ void JSph::ConfigConstants(bool simulate2d){
     SpsBlin=float((2./3.)*0.0066*dp_sps*dp_sps); 
   }
   VisuConfig();
+  if(KerTableSize)ConfigKernelTable();
+}
+
+//==============================================================================
+/// Returns fac (kernel derivative divided by distance) computed in double 
+/// precision starting from the constants of the kernel.
+/// Devuelve fac (derivada del kernel dividida por la distancia) calculado en 
+/// doble precision a partir de las constantes del kernel.
+//==============================================================================
+double JSph::GetKernelFacAnalytic(double rr2)const{
+  const double h=H;
+  const double qq=sqrt(rr2)/h;
+  double fac=0;
+  if(qq<2){
+    if(TKernel==KERNEL_Wendland){
+      const double wqq1=1.-0.5*qq;
+      fac=double(Bwen)*wqq1*wqq1*wqq1/h;         //-fac=Bwen*qq*wqq1^3/rad
+    }
+    else if(TKernel==KERNEL_Gaussian){
+      fac=double(Bgau)*exp(-4.*qq*qq)/h;         //-fac=Bgau*qq*exp(-4*qq^2)/rad
+    }
+    else if(TKernel==KERNEL_Cubic){
+      if(qq>1){
+        const double wqq1=2.-qq;
+        fac=double(CubicCte.c2)*wqq1*wqq1/(qq*h);
+      }
+      else fac=(double(CubicCte.c1)+double(CubicCte.d1)*qq)/h;
+    }
+  }
+  return(fac);
+}
+
+//==============================================================================
+/// Returns tensile correction fab=(wab/wdeltap)^4 of Cubic kernel computed in 
+/// double precision.
+/// Devuelve correccion tensil fab=(wab/wdeltap)^4 del kernel Cubic calculado 
+/// en doble precision.
+//==============================================================================
+double JSph::GetKernelTensilAnalytic(double rr2)const{
+  const double qq=sqrt(rr2)/H;
+  double wab=0;
+  if(qq<2){
+    if(qq>1){
+      const double wqq1=2.-qq;
+      wab=double(CubicCte.a24)*(wqq1*wqq1*wqq1);
+    }
+    else wab=double(CubicCte.a2)*(1.-1.5*qq*qq+0.75*qq*qq*qq);
+  }
+  const double fab=wab*double(CubicCte.od_wdeltap);
+  return(fab*fab*fab*fab);
+}
+
+//==============================================================================
+/// Computes tables of the kernel derivative (and tensile correction for Cubic)
+/// on a uniform grid of rr2 in [0,Fourh2] for linear interpolation during the
+/// interaction. The maximum relative error of the interpolation against the
+/// analytic kernel is shown.
+///
+/// Calcula tablas de la derivada del kernel (y correccion tensil para Cubic)
+/// en una malla uniforme de rr2 en [0,Fourh2] para interpolacion lineal 
+/// durante la interaccion. Se muestra el error relativo maximo de la 
+/// interpolacion respecto al kernel analitico.
+//==============================================================================
+void JSph::ConfigKernelTable(){
+  const char* met="ConfigKernelTable";
+  const unsigned n=KerTableSize;
+  const bool tensil=(TKernel==KERNEL_Cubic);
+  delete[] KerTableFac;    KerTableFac=NULL;
+  delete[] KerTableTensil; KerTableTensil=NULL;
+  try{
+    KerTableFac=new float[(n+2)*2];
+    if(tensil)KerTableTensil=new float[(n+2)*2];
+  }
+  catch(const std::bad_alloc){
+    RunException(met,"Could not allocate the requested memory.");
+  }
+  const double dr2=double(Fourh2)/n;
+  KerTableIdr2=float(n/double(Fourh2));
+  for(unsigned ct=0;ct<2;ct++)if(!ct || tensil){
+    float *tab=(!ct? KerTableFac: KerTableTensil);
+    for(unsigned c=0;c<=n;c++){
+      const double v0=(!ct? GetKernelFacAnalytic(dr2*c): GetKernelTensilAnalytic(dr2*c));
+      const double v1=(c<n? (!ct? GetKernelFacAnalytic(dr2*(c+1)): GetKernelTensilAnalytic(dr2*(c+1))): v0);
+      tab[c*2]=float(v0);
+      tab[c*2+1]=float(v1-v0);
+    }
+    //-Additional interval in case rr2*KerTableIdr2 is rounded over n. | Intervalo adicional por si rr2*KerTableIdr2 se redondea por encima de n.
+    tab[n*2+2]=tab[n*2]; tab[n*2+3]=0;
+  }
+  //-Validation against analytic kernel for rr2>=Eta2. Relative error is only 
+  // evaluated where the value is over 1% of the maximum to skip the zero at 2h.
+  const unsigned nsub=8;
+  for(unsigned ct=0;ct<2;ct++)if(!ct || tensil){
+    const float *tab=(!ct? KerTableFac: KerTableTensil);
+    double vmax=0;
+    for(unsigned c=0;c<=n;c++)vmax=std::max(vmax,fabs(double(tab[c*2])));
+    double errrel=0,errabs=0;
+    for(unsigned c=0;c<n;c++)for(unsigned cs=0;cs<nsub;cs++){
+      const float rr2=float(dr2*(c+(cs+0.5)/nsub));
+      if(rr2>=Eta2 && rr2<=Fourh2){
+        const float x=rr2*KerTableIdr2;
+        const unsigned cx=unsigned(x);
+        const double v=double(tab[cx*2]+tab[cx*2+1]*(x-float(cx)));
+        const double va=(!ct? GetKernelFacAnalytic(rr2): GetKernelTensilAnalytic(rr2));
+        const double err=fabs(v-va);
+        errabs=std::max(errabs,err);
+        if(fabs(va)>=vmax*0.01)errrel=std::max(errrel,err/fabs(va));
+      }
+    }
+    Log->Printf("KernelTable %s: %u intervals, max relative error: %g (max error/max value: %g)",(!ct? "fac": "tensil"),n,errrel,(vmax? errabs/vmax: 0));
+  }
 }
 
 //==============================================================================
@@ -1115,14 +1237,23 @@ void JSph::OrderCodeData(TpCellOrder order,unsigned n,tfloat4 *v){
 }
 
 //==============================================================================
-/// Configures cell division.
+/// Sets cell mode and computes the variables that depend on the cell size.
+/// Establece modo de celdas y calcula las variables que dependen del tamano de celda.
 //==============================================================================
-void JSph::ConfigCellDivision(){
-  if(CellMode!=CELLMODE_2H && CellMode!=CELLMODE_H)RunException("ConfigCellDivision","The CellMode is invalid.");
+void JSph::SetCellMode(TpCellMode cellmode){
+  if(cellmode!=CELLMODE_2H && cellmode!=CELLMODE_H)RunException("SetCellMode","The CellMode is invalid.");
+  CellMode=cellmode;
   Hdiv=(CellMode==CELLMODE_2H? 1: 2);
   Scell=Dosh/Hdiv;
   MovLimit=Scell*0.9f;
   Map_Cells=TUint3(unsigned(ceil(Map_Size.x/Scell)),unsigned(ceil(Map_Size.y/Scell)),unsigned(ceil(Map_Size.z/Scell)));
+}
+
+//==============================================================================
+/// Configures cell division.
+//==============================================================================
+void JSph::ConfigCellDivision(){
+  SetCellMode(CellMode);
   //-Prints configuration.
   Log->Print(fun::VarStr("CellMode",string(GetNameCellMode(CellMode))));
   Log->Print(fun::VarStr("Hdiv",Hdiv));
@@ -1353,6 +1484,7 @@ void JSph::ConfigSaveData(unsigned piece,unsigned pieces,std::string div){
 //==============================================================================
 void JSph::AddParticlesOut(unsigned nout,const unsigned *idp,const tdouble3* pos,const tfloat3 *vel,const float *rhop,unsigned noutrhop,unsigned noutmove){
   PartsOut->AddParticles(nout,idp,pos,vel,rhop,noutrhop,noutmove);
+  if(MemTrack)MemTrack->SetBlock("PartsOut",PartsOut->GetAllocMemory());
 }
 
 //==============================================================================
@@ -1364,6 +1496,7 @@ void JSph::AddParticlesOut(unsigned nout,const unsigned *idp,const tdouble3* pos
 //==============================================================================
 tfloat3* JSph::GetPointerDataFloat3(unsigned n,const tdouble3* v)const{
   tfloat3* v2=new tfloat3[n];
+  if(MemTrack)MemTrack->AddTemp(sizeof(tfloat3)*n);
   for(unsigned c=0;c<n;c++)v2[c]=ToTFloat3(v[c]);
   return(v2);
 }
@@ -1393,6 +1526,11 @@ void JSph::SavePartData(unsigned npok,unsigned nout,const unsigned *idp,const td
       bdpart->SetvUint("npfper",infoplus->npfper);
       bdpart->SetvUint("newnp",infoplus->newnp);
       bdpart->SetvLlong("cpualloc",infoplus->memorycpualloc);
+      if(infoplus->memorycpupeak){
+        bdpart->SetvLlong("cpupeak",infoplus->memorycpupeak);
+        bdpart->SetvLlong("cpupeakused",infoplus->memorycpupeakused);
+        bdpart->SetvText("cpupeakphase",infoplus->memorycpupeakphase);
+      }
       if(infoplus->gpudata){
         bdpart->SetvLlong("nctalloc",infoplus->memorynctalloc);
         bdpart->SetvLlong("nctused",infoplus->memorynctused);
@@ -1416,6 +1554,7 @@ void JSph::SavePartData(unsigned npok,unsigned nout,const unsigned *idp,const td
       delete[] press; press=NULL;//-Memory must to be deallocated after saving file because DataBi4 uses this memory space.
     }
     if(SvData&SDAT_Info)DataBi4->SaveFileInfo();
+    if(posf3 && MemTrack)MemTrack->AddTemp(-llong(sizeof(tfloat3))*npok);
     delete[] posf3;
   }
 
@@ -1424,6 +1563,7 @@ void JSph::SavePartData(unsigned npok,unsigned nout,const unsigned *idp,const td
     //-Generates array with posf3 and type of particle.
     tfloat3* posf3=GetPointerDataFloat3(npok,pos);
     byte *type=new byte[npok];
+    if(MemTrack)MemTrack->AddTemp(sizeof(byte)*npok);
     for(unsigned p=0;p<npok;p++){
       const unsigned id=idp[p];
       type[p]=(id>=CaseNbound? 3: (id<CaseNfixed? 0: (id<CaseNpb? 1: 2)));
@@ -1438,6 +1578,7 @@ void JSph::SavePartData(unsigned npok,unsigned nout,const unsigned *idp,const td
     if(SvData&SDAT_Vtk)JFormatFiles2::SaveVtk(DirDataOut+fun::FileNameSec("PartVtk.vtk",Part),npok,posf3,nfields,fields);
     if(SvData&SDAT_Csv)JFormatFiles2::SaveCsv(DirDataOut+fun::FileNameSec("PartCsv.csv",Part),CsvSepComa,npok,posf3,nfields,fields);
     //-Deallocate of memory.
+    if(MemTrack)MemTrack->AddTemp(-llong(sizeof(tfloat3)+sizeof(byte))*npok);
     delete[] posf3;
     delete[] type; 
   }
@@ -1448,6 +1589,7 @@ void JSph::SavePartData(unsigned npok,unsigned nout,const unsigned *idp,const td
     else{
       const tfloat3* posf3=GetPointerDataFloat3(PartsOut->GetCount(),PartsOut->GetPosOut());
       DataOutBi4->SavePartOut(Part,TimeStep,PartsOut->GetCount(),PartsOut->GetIdpOut(),posf3,PartsOut->GetVelOut(),PartsOut->GetRhopOut());
+      if(MemTrack)MemTrack->AddTemp(-llong(sizeof(tfloat3))*PartsOut->GetCount());
       delete[] posf3;
     }
   }
@@ -1504,6 +1646,12 @@ void JSph::SaveData(unsigned npok,const unsigned *idp,const tdouble3 *pos,const
     Log->Printf("  Particles out: %u  (total: %u)",nout,PartOut);
   }
 
+  //-Shows memory of the PART and starts the next one. | Muestra la memoria del PART e inicia el siguiente.
+  if(MemTrack){
+    Log->Printf("  %s",MemTrack->GetPartInfo().c_str());
+    MemTrack->ResetPart();
+  }
+
   if(SvDomainVtk)SaveDomainVtk(ndom,vdom);
   if(SaveDt)SaveDt->SaveData();
   if(GaugeSystem)GaugeSystem->SaveResults(Part);
@@ -21,6 +21,8 @@
 //:# =========
 //:# - El calculo de constantes en ConfigConstants() se hace usando double aunque
 //:#   despues se convierte a float (22-04-2013)
+//:# - Registro opcional de la memoria de cada fase y PART con JMemoryTracker.
+//:#   (18-10-2026)
 //:#############################################################################
 
 /// \file JSph.h \brief Declares the class \ref JSph.
@@ -59,6 +61,7 @@ class JDamping;
 class JXml;
 class JTimeOut;
 class JGaugeSystem;
+class JMemoryTracker;
 
 //##############################################################################
 //# XML format of execution parameters in _FmtXML__Parameters.xml.
@@ -94,6 +97,9 @@ public:
     llong memorynpused;
     llong memorynctalloc;
     llong memorynctused;
+    llong memorycpupeak;      ///<Peak of allocated CPU memory in the PART (0 without memory profile).        | Pico de memoria CPU reservada en el PART (0 sin perfil de memoria).
+    llong memorycpupeakused;  ///<Peak of used CPU memory in the PART (0 without memory profile).             | Pico de memoria CPU usada en el PART (0 sin perfil de memoria).
+    const char* memorycpupeakphase; ///<Phase of the peak of used CPU memory in the PART (NULL without memory profile). | Fase del pico de memoria CPU usada en el PART (NULL sin perfil de memoria).
   }StInfoPartPlus;
 
 /// Structure with Periodic information.
@@ -170,6 +176,10 @@ protected:
   float Agau;                 ///<Gaussian kernel constant to compute wab.                               | Constante para calcular wab con kernel Gaussian.
   float Bgau;                 ///<Gaussian kernel constant to compute fac (kernel derivative).           | Constante para calcular fac (derivada del kernel) con kernel Gaussian.
   StCubicCte CubicCte;        ///<Constants for Cubic Spline Kernel.                                     | Constante para kernel cubic spline.
+  unsigned KerTableSize;      ///<Number of intervals of the tabulated kernel (0:disabled, only CPU).    | Numero de intervalos del kernel tabulado (0:desactivado, solo CPU).
+  float KerTableIdr2;         ///<Inverse of the rr2 step of kernel tables (KerTableSize/Fourh2).        | Inversa del paso de rr2 de las tablas del kernel (KerTableSize/Fourh2).
+  float *KerTableFac;         ///<Table of fac (kernel derivative / distance) as pairs (value,increment) [(KerTableSize+2)*2]. | Tabla de fac (derivada del kernel / distancia) como pares (valor,incremento) [(KerTableSize+2)*2].
+  float *KerTableTensil;      ///<Table of tensile correction fab of Cubic kernel as pairs (value,increment) [(KerTableSize+2)*2]. | Tabla de correccion tensil fab del kernel Cubic como pares (valor,incremento) [(KerTableSize+2)*2].
   TpVisco TVisco;             ///<Viscosity type: Artificial,...                                         | Tipo de viscosidad: Artificial,...
   TpDeltaSph TDeltaSph;       ///<Delta-SPH type: None, Basic or Dynamic.                                | Tipo de Delta-SPH: None, Basic o Dynamic. 
   float DeltaSph;             ///<DeltaSPH constant. The default value is 0.1f, with 0 having no effect. | Constante para DeltaSPH. El valor por defecto es 0.1f, con 0 no tiene efecto.  
@@ -272,6 +282,8 @@ protected:
 
   JGaugeSystem *GaugeSystem;    ///<Object for automatic gauge system.
 
+  JMemoryTracker *MemTrack;     ///<Records the memory of each phase and PART (NULL when it is not used).
+
   JWaveGen *WaveGen;            ///<Object for wave generation.
 
   JDamping* Damping;            ///<Object for damping zones.
@@ -357,6 +369,9 @@ protected:
   void ResizeMapLimits();
 
   void ConfigConstants(bool simulate2d);
+  double GetKernelFacAnalytic(double rr2)const;
+  double GetKernelTensilAnalytic(double rr2)const;
+  void ConfigKernelTable();
   void VisuConfig()const;
   void VisuParticleSummary()const;
   void LoadDcellParticles(unsigned n,const typecode *code,const tdouble3 *pos,unsigned *dcell)const;
@@ -377,6 +392,7 @@ protected:
   static void OrderDecodeData(TpCellOrder order,unsigned n,tdouble3 *v){ OrderCodeData(GetDecodeOrder(order),n,v); }
   static void OrderCodeData(TpCellOrder order,unsigned n,tfloat4 *v);
   static void OrderDecodeData(TpCellOrder order,unsigned n,tfloat4 *v){ OrderCodeData(GetDecodeOrder(order),n,v); }
+  void SetCellMode(TpCellMode cellmode);
   void ConfigCellDivision();
   void SelecDomain(tuint3 celini,tuint3 celfin);
   static unsigned CalcCellCode(tuint3 ncells);
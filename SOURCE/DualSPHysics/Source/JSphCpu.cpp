@@ -32,6 +32,9 @@
 #include "JTimeOut.h"
 #include "JSphAccInput.h"
 #include "JGaugeSystem.h"
+#include "JNeighbourListCpu.h"
+#include "JCellBalanceCpu.h"
+#include "JNumaCpu.h"
 
 #include <climits>
 
@@ -43,6 +46,9 @@ using namespace std;
 JSphCpu::JSphCpu(bool withmpi):JSph(true,withmpi){
   ClassName="JSphCpu";
   CellDiv=NULL;
+  NeighList=NULL;
+  CellBalance=NULL;
+  Numa=NULL;
   ArraysCpu=new JArraysCpu;
   InitVars();
   TmcCreation(Timers,false);
@@ -55,6 +61,9 @@ JSphCpu::~JSphCpu(){
   FreeCpuMemoryParticles();
   FreeCpuMemoryFixed();
   delete ArraysCpu;
+  delete NeighList; NeighList=NULL;
+  delete CellBalance; CellBalance=NULL;
+  delete Numa; Numa=NULL;
   TmcDestruction(Timers);
 }
 
@@ -64,23 +73,49 @@ JSphCpu::~JSphCpu(){
 void JSphCpu::InitVars(){
   RunMode="";
   OmpThreads=1;
+  Symmetry=false;
+  CellTile=false;
+  FusedInter=false;
+  IncDivide=0;
+  CellSfc=CELLSFC_None;
+  CellSparse=false;
+  CellModeAuto=CellModeAutoNum=0;
+  CellModeAutoTime[0]=CellModeAutoTime[1]=0;
+  CellRow=CellRowInv=NULL;
+  SimdMode=SIMDMODE_None;
+  delete NeighList; NeighList=NULL;
+  delete CellBalance; CellBalance=NULL;
+  ArraysCpu->SetNuma(NULL);
+  delete Numa; Numa=NULL;
+  NumaArrays=false;
+  HugePages=false;
+  ArraysStats=false;
+  CompactState=false;
+  FusedStep=false;
 
   Np=Npb=NpbOk=0;
   NpbPer=NpfPer=0;
+  PeriImage=false;
+  PeriImgCount=0;
   WithFloating=false;
 
   Idpc=NULL; Codec=NULL; Dcellc=NULL; Posc=NULL; Velrhopc=NULL;
-  VelrhopM1c=NULL;                //-Verlet
-  PosPrec=NULL; VelrhopPrec=NULL; //-Symplectic
+  VelrhopM1c=NULL; VelrhopM1h=NULL;   //-Verlet
+  PosPrec=NULL; VelrhopPrec=NULL;      //-Symplectic
+  PosPrecOff=NULL; VelrhopPrech=NULL;  //-Symplectic (CompactState)
   PsPosc=NULL;                    //-Interaccion Pos-Single.
   SpsTauc=NULL; SpsGradvelc=NULL; //-Laminar+SPS. 
   Arc=NULL; Acec=NULL; Deltac=NULL;
   ShiftPosc=NULL; ShiftDetectc=NULL; //-Shifting.
   Pressc=NULL;
+  memset(&SimdCte,0,sizeof(StSimdCte));
+  memset(&SimdData,0,sizeof(StSimdParticles));
+  SimdSize=0; SimdMem=NULL;           //-SIMD.
   RidpMove=NULL; 
   FtRidp=NULL;
   FtoForces=NULL;
   FtoForcesRes=NULL;
+  FtBlockCount=0; FtBlockIni=NULL; FtBlockFt=NULL; FtoBlockForces=NULL;
   FreeCpuMemoryParticles();
   FreeCpuMemoryFixed();
 }
@@ -95,6 +130,10 @@ void JSphCpu::FreeCpuMemoryFixed(){
   delete[] FtRidp;       FtRidp=NULL;
   delete[] FtoForces;    FtoForces=NULL;
   delete[] FtoForcesRes; FtoForcesRes=NULL;
+  delete[] FtBlockIni;     FtBlockIni=NULL;
+  delete[] FtBlockFt;      FtBlockFt=NULL;
+  delete[] FtoBlockForces; FtoBlockForces=NULL;
+  FtBlockCount=0;
 }
 
 //==============================================================================
@@ -112,6 +151,17 @@ void JSphCpu::AllocCpuMemoryFixed(){
       FtRidp      =new unsigned[CaseNfloat];     MemCpuFixed+=(sizeof(unsigned)*CaseNfloat);
       FtoForces   =new StFtoForces[FtCount];     MemCpuFixed+=(sizeof(StFtoForces)*FtCount);
       FtoForcesRes=new StFtoForcesRes[FtCount];  MemCpuFixed+=(sizeof(StFtoForcesRes)*FtCount);
+      //-Blocks of particles of floating bodies (large bodies are split in several blocks).
+      FtBlockIni=new unsigned[FtCount+1];  MemCpuFixed+=(sizeof(unsigned)*(FtCount+1));
+      FtBlockCount=0;
+      for(unsigned cf=0;cf<FtCount;cf++){
+        FtBlockIni[cf]=FtBlockCount;
+        FtBlockCount+=max(1u,(FtObjs[cf].count+FT_BLOCKSIZE-1)/FT_BLOCKSIZE);
+      }
+      FtBlockIni[FtCount]=FtBlockCount;
+      FtBlockFt     =new unsigned[FtBlockCount];     MemCpuFixed+=(sizeof(unsigned)*FtBlockCount);
+      FtoBlockForces=new StFtoForces[FtBlockCount];  MemCpuFixed+=(sizeof(StFtoForces)*FtBlockCount);
+      for(unsigned cf=0;cf<FtCount;cf++)for(unsigned b=FtBlockIni[cf];b<FtBlockIni[cf+1];b++)FtBlockFt[b]=cf;
     }
   }
   catch(const std::bad_alloc){
@@ -127,6 +177,7 @@ void JSphCpu::FreeCpuMemoryParticles(){
   CpuParticlesSize=0;
   MemCpuParticles=0;
   ArraysCpu->Reset();
+  FreeSimdMemory();
 }
 
 //==============================================================================
@@ -153,11 +204,18 @@ void JSphCpu::AllocCpuMemoryParticles(unsigned np,float over){
   ArraysCpu->AddArrayCount(JArraysCpu::SIZE_24B,2); //-pos
   if(Psingle)ArraysCpu->AddArrayCount(JArraysCpu::SIZE_12B,1); //-pspos
   if(TStep==STEP_Verlet){
-    ArraysCpu->AddArrayCount(JArraysCpu::SIZE_16B,1); //-velrhopm1
+    if(CompactState)ArraysCpu->AddArrayCount(JArraysCpu::SIZE_8B,1); //-velrhopm1h
+    else ArraysCpu->AddArrayCount(JArraysCpu::SIZE_16B,1); //-velrhopm1
   }
   else if(TStep==STEP_Symplectic){
-    ArraysCpu->AddArrayCount(JArraysCpu::SIZE_24B,1); //-pospre
-    ArraysCpu->AddArrayCount(JArraysCpu::SIZE_16B,1); //-velrhoppre
+    if(CompactState){
+      ArraysCpu->AddArrayCount(JArraysCpu::SIZE_12B,1); //-posprecoff
+      ArraysCpu->AddArrayCount(JArraysCpu::SIZE_8B,1);  //-velrhopprech
+    }
+    else{
+      ArraysCpu->AddArrayCount(JArraysCpu::SIZE_24B,1); //-pospre
+      ArraysCpu->AddArrayCount(JArraysCpu::SIZE_16B,1); //-velrhoppre
+    }
   }
   if(TVisco==VISCO_LaminarSPS){     
     ArraysCpu->AddArrayCount(JArraysCpu::SIZE_24B,1); //-SpsTau,SpsGradvel
@@ -175,78 +233,84 @@ void JSphCpu::AllocCpuMemoryParticles(unsigned np,float over){
 //==============================================================================
 void JSphCpu::ResizeCpuMemoryParticles(unsigned npnew){
   npnew=npnew+PARTICLES_OVERMEMORY_MIN;
-  //-Saves current data from CPU.
-  unsigned    *idp       =SaveArrayCpu(Np,Idpc);
-  typecode    *code      =SaveArrayCpu(Np,Codec);
-  unsigned    *dcell     =SaveArrayCpu(Np,Dcellc);
-  tdouble3    *pos       =SaveArrayCpu(Np,Posc);
-  tfloat4     *velrhop   =SaveArrayCpu(Np,Velrhopc);
-  tfloat4     *velrhopm1 =SaveArrayCpu(Np,VelrhopM1c);
-  tdouble3    *pospre    =SaveArrayCpu(Np,PosPrec);
-  tfloat4     *velrhoppre=SaveArrayCpu(Np,VelrhopPrec);
-  tsymatrix3f *spstau    =SaveArrayCpu(Np,SpsTauc);
-  //-Frees pointers.
-  ArraysCpu->Free(Idpc);
-  ArraysCpu->Free(Codec);
-  ArraysCpu->Free(Dcellc);
-  ArraysCpu->Free(Posc);
-  ArraysCpu->Free(Velrhopc);
-  ArraysCpu->Free(VelrhopM1c);
-  ArraysCpu->Free(PosPrec);
-  ArraysCpu->Free(VelrhopPrec);
-  ArraysCpu->Free(SpsTauc);
-  //-Resizes CPU memory allocation.
+  //-Resizes CPU memory allocation keeping current data. | Redimensiona la memoria de CPU manteniendo los datos actuales.
   const double mbparticle=(double(MemCpuParticles)/(1024*1024))/CpuParticlesSize; //-MB por particula.
   Log->Printf("**JSphCpu: Requesting cpu memory for %u particles: %.1f MB.",npnew,mbparticle*npnew);
-  ArraysCpu->SetArraySize(npnew);
-  //-Reserve pointers.
-  Idpc    =ArraysCpu->ReserveUint();
-  Codec   =ArraysCpu->ReserveTypeCode();
-  Dcellc  =ArraysCpu->ReserveUint();
-  Posc    =ArraysCpu->ReserveDouble3();
-  Velrhopc=ArraysCpu->ReserveFloat4();
-  if(velrhopm1) VelrhopM1c =ArraysCpu->ReserveFloat4();
-  if(pospre)    PosPrec    =ArraysCpu->ReserveDouble3();
-  if(velrhoppre)VelrhopPrec=ArraysCpu->ReserveFloat4();
-  if(spstau)    SpsTauc    =ArraysCpu->ReserveSymatrix3f();
-  //-Restore data in CPU memory.
-  RestoreArrayCpu(Np,idp,Idpc);
-  RestoreArrayCpu(Np,code,Codec);
-  RestoreArrayCpu(Np,dcell,Dcellc);
-  RestoreArrayCpu(Np,pos,Posc);
-  RestoreArrayCpu(Np,velrhop,Velrhopc);
-  RestoreArrayCpu(Np,velrhopm1,VelrhopM1c);
-  RestoreArrayCpu(Np,pospre,PosPrec);
-  RestoreArrayCpu(Np,velrhoppre,VelrhopPrec);
-  RestoreArrayCpu(Np,spstau,SpsTauc);
+  ArraysCpu->ResizeArraySize(npnew,Np);
+  //-Updates pointers. | Actualiza punteros.
+  Idpc        =ArraysCpu->GetRenewed(Idpc);
+  Codec       =ArraysCpu->GetRenewed(Codec);
+  Dcellc      =ArraysCpu->GetRenewed(Dcellc);
+  Posc        =ArraysCpu->GetRenewed(Posc);
+  Velrhopc    =ArraysCpu->GetRenewed(Velrhopc);
+  VelrhopM1c  =ArraysCpu->GetRenewed(VelrhopM1c);
+  VelrhopM1h  =ArraysCpu->GetRenewed(VelrhopM1h);
+  PosPrec     =ArraysCpu->GetRenewed(PosPrec);
+  VelrhopPrec =ArraysCpu->GetRenewed(VelrhopPrec);
+  PosPrecOff  =ArraysCpu->GetRenewed(PosPrecOff);
+  VelrhopPrech=ArraysCpu->GetRenewed(VelrhopPrech);
+  SpsTauc     =ArraysCpu->GetRenewed(SpsTauc);
   //-Updates values.
   CpuParticlesSize=npnew;
   MemCpuParticles=ArraysCpu->GetAllocMemoryCpu();
 }
 
 //==============================================================================
-/// Saves a CPU array in CPU memory. 
+/// Deallocate memory of particle data in SoA format for SIMD interaction.
+/// Libera memoria de datos de particulas en formato SoA para interaccion SIMD.
 //==============================================================================
-template<class T> T* JSphCpu::TSaveArrayCpu(unsigned np,const T *datasrc)const{
-  T *data=NULL;
-  if(datasrc){
+void JSphCpu::FreeSimdMemory(){
+  delete[] SimdMem; SimdMem=NULL;
+  SimdSize=0;
+  memset(&SimdData,0,sizeof(StSimdParticles));
+}
+
+//==============================================================================
+/// Copies particle data to SoA format for SIMD interaction (after computing 
+/// PsPosc and Pressc). Each stream is aligned to 64 bytes and includes 
+/// CPUSIMD_PAD extra values so the last SIMD load of a cell is always valid.
+///
+/// Copia datos de particulas a formato SoA para interaccion SIMD (despues de 
+/// calcular PsPosc y Pressc). Cada stream esta alineado a 64 bytes e incluye
+/// CPUSIMD_PAD valores extra para que la ultima carga SIMD de una celda sea valida.
+//==============================================================================
+void JSphCpu::PrepareSimdData(unsigned np){
+  const char met[]="PrepareSimdData";
+  if(SimdSize<np){
+    FreeSimdMemory();
+    const unsigned size=((CpuParticlesSize>np? CpuParticlesSize: np)+CPUSIMD_PAD+15)/16*16;
     try{
-      data=new T[np];
+      SimdMem=new float[size*8+16];
     }
     catch(const std::bad_alloc){
-      RunException("TSaveArrayCpu","Could not allocate the requested memory.");
+      RunException(met,"Could not allocate the requested memory.");
     }
-    memcpy(data,datasrc,sizeof(T)*np);
+    memset(SimdMem,0,sizeof(float)*(size*8+16));
+    float *ptr=(float*)((size_t(SimdMem)+63)/64*64);
+    SimdData.posx=ptr; ptr+=size;
+    SimdData.posy=ptr; ptr+=size;
+    SimdData.posz=ptr; ptr+=size;
+    SimdData.velx=ptr; ptr+=size;
+    SimdData.vely=ptr; ptr+=size;
+    SimdData.velz=ptr; ptr+=size;
+    SimdData.rhop=ptr; ptr+=size;
+    SimdData.press=ptr;
+    SimdSize=size-CPUSIMD_PAD;
+  }
+  float *posx=(float*)SimdData.posx,*posy=(float*)SimdData.posy,*posz=(float*)SimdData.posz;
+  float *velx=(float*)SimdData.velx,*vely=(float*)SimdData.vely,*velz=(float*)SimdData.velz;
+  float *rhop=(float*)SimdData.rhop,*press=(float*)SimdData.press;
+  const int n=int(np);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int p=0;p<n;p++){
+    const tfloat3 ps=PsPosc[p];
+    const tfloat4 v=Velrhopc[p];
+    posx[p]=ps.x; posy[p]=ps.y; posz[p]=ps.z;
+    velx[p]=v.x;  vely[p]=v.y;  velz[p]=v.z;
+    rhop[p]=v.w;  press[p]=Pressc[p];
   }
-  return(data);
-}
-
-//==============================================================================
-/// Restores an array (generic) from CPU memory. 
-//==============================================================================
-template<class T> void JSphCpu::TRestoreArrayCpu(unsigned np,T *data,T *datanew)const{
-  if(data&&datanew)memcpy(datanew,data,sizeof(T)*np);
-  delete[] data;
 }
 
 //==============================================================================
@@ -259,10 +323,36 @@ void JSphCpu::ReserveBasicArraysCpu(){
   Dcellc=ArraysCpu->ReserveUint();
   Posc=ArraysCpu->ReserveDouble3();
   Velrhopc=ArraysCpu->ReserveFloat4();
-  if(TStep==STEP_Verlet)VelrhopM1c=ArraysCpu->ReserveFloat4();
+  if(TStep==STEP_Verlet){
+    if(CompactState)VelrhopM1h=ArraysCpu->ReserveHalf4();
+    else VelrhopM1c=ArraysCpu->ReserveFloat4();
+  }
   if(TVisco==VISCO_LaminarSPS)SpsTauc=ArraysCpu->ReserveSymatrix3f();
 }
 
+//==============================================================================
+/// Allocates again the particle arrays from the threads that process each 
+/// range of particles so memory is placed in their NUMA nodes.
+/// Reserva de nuevo los arrays de particulas desde los hilos que procesan cada
+/// rango de particulas para que la memoria se ubique en sus nodos NUMA.
+//==============================================================================
+void JSphCpu::NumaPlaceArrays(){
+  Numa->SetPlacement(Npb,Np);
+  ArraysCpu->NumaRenew(Np);
+  Idpc        =ArraysCpu->GetRenewed(Idpc);
+  Codec       =ArraysCpu->GetRenewed(Codec);
+  Dcellc      =ArraysCpu->GetRenewed(Dcellc);
+  Posc        =ArraysCpu->GetRenewed(Posc);
+  Velrhopc    =ArraysCpu->GetRenewed(Velrhopc);
+  VelrhopM1c  =ArraysCpu->GetRenewed(VelrhopM1c);
+  VelrhopM1h  =ArraysCpu->GetRenewed(VelrhopM1h);
+  PosPrec     =ArraysCpu->GetRenewed(PosPrec);
+  VelrhopPrec =ArraysCpu->GetRenewed(VelrhopPrec);
+  PosPrecOff  =ArraysCpu->GetRenewed(PosPrecOff);
+  VelrhopPrech=ArraysCpu->GetRenewed(VelrhopPrech);
+  SpsTauc     =ArraysCpu->GetRenewed(SpsTauc);
+}
+
 //==============================================================================
 /// Return memory reserved on CPU.
 /// Devuelve la memoria reservada en cpu.
@@ -273,6 +363,12 @@ llong JSphCpu::GetAllocMemoryCpu()const{
   s+=MemCpuParticles;
   //-Reserved in AllocCpuMemoryFixed().
   s+=MemCpuFixed;
+  //-Reserved in PrepareSimdData().
+  if(SimdMem)s+=llong(sizeof(float))*((SimdSize+CPUSIMD_PAD)*8+16);
+  //-Reserved in NeighList.
+  if(NeighList)s+=NeighList->GetAllocMemory();
+  //-Reserved in CellBalance.
+  if(CellBalance)s+=CellBalance->GetAllocMemory();
   //-Reserved in other objects.
   return(s);
 }
@@ -363,6 +459,17 @@ void JSphCpu::ConfigOmp(const JCfgRun *cfg){
     OmpThreads=1;
     omp_set_num_threads(OmpThreads);
   }
+  //-Configures NUMA placement of threads and particle arrays. | Configura ubicacion NUMA de hilos y arrays de particulas.
+  if(Cpu && (cfg->OmpPin || cfg->Numa)){
+    Numa=new JNumaCpu(OmpThreads);
+    if(cfg->OmpPin && !Numa->PinThreads())Log->Print("\n*** Attention: OpenMP threads could not be pinned to cpus.\n");
+    Numa->VisuTopology(Log);
+    NumaArrays=cfg->Numa;
+    if(NumaArrays){
+      ArraysCpu->SetNuma(Numa);
+      omp_set_nested(0); //-Interaction of each range is executed by only one thread. | La interaccion de cada rango la ejecuta un solo hilo.
+    }
+  }
 #else
   OmpThreads=1;
 #endif
@@ -380,8 +487,100 @@ void JSphCpu::ConfigRunMode(const JCfgRun *cfg,std::string preinfo){
   //  preinfo=preinfo+"HostName:"+hname;
   //#endif
   Hardware="Cpu";
+  Symmetry=cfg->Symmetry;
+  if(Symmetry && CaseNfloat){
+    Log->Print("\n*** Attention: Symmetry is disabled because it is not supported with floating bodies.\n");
+    Symmetry=false;
+  }
+  FusedInter=cfg->FusedInter;
+  IncDivide=cfg->IncDivide;
+  CellModeAuto=cfg->CellModeAuto;
+  CellTile=cfg->CellTile;
+  if(CellTile && CaseNfloat){
+    Log->Print("\n*** Attention: CellTile is disabled because it is not supported with floating bodies.\n");
+    CellTile=false;
+  }
+  //-Selects SIMD instructions for particle interaction.
+  SimdMode=cfg->SimdMode;
+  if(SimdMode!=SIMDMODE_None){
+    const TpSimdMode simdcpu=cpusimd::GetSimdModeCpu();
+    if(SimdMode==SIMDMODE_Auto)SimdMode=simdcpu;
+    else if(SimdMode>simdcpu){
+      Log->Printf("\n*** Attention: SIMD mode %s is not supported by the CPU, %s is used instead.\n",GetNameSimdMode(SimdMode),GetNameSimdMode(simdcpu));
+      SimdMode=simdcpu;
+    }
+    if(SimdMode!=SIMDMODE_None && (!Psingle || TKernel!=KERNEL_Wendland || TVisco!=VISCO_Artificial || TShifting!=SHIFT_None || CaseNfloat || KerTableFac)){
+      Log->Print("\n*** Attention: SIMD is disabled because it is only supported with Pos-Single, Wendland kernel, artificial viscosity and without floating bodies, shifting or kernel table.\n");
+      SimdMode=SIMDMODE_None;
+    }
+  }
+  if(SimdMode!=SIMDMODE_None){
+    SimdCte.h=H;
+    SimdCte.fourh2=Fourh2;
+    SimdCte.eta2=Eta2;
+    SimdCte.bwen=Bwen;
+    SimdCte.cs0=float(Cs0);
+    SimdCte.delta2h=Delta2H;
+    SimdCte.massb=MassBound;
+    SimdCte.massf=MassFluid;
+    SimdCte.cellcode=DomCellCode;
+    SimdCte.ompthreads=OmpThreads;
+  }
+  //-Configures neighbour list reused in several interactions.
+  if(cfg->NeighListSkin>0){
+    if(Symmetry || CellTile || SimdMode!=SIMDMODE_None)Log->Print("\n*** Attention: Neighbour list is disabled because it is not supported with Symmetry, CellTile or SIMD.\n");
+    else if(PeriActive && !PeriImage)Log->Print("\n*** Attention: Neighbour list is disabled because periodic boundaries are only supported with PeriImage (not available with DEM).\n");
+    else NeighList=new JNeighbourListCpu(cfg->NeighListSkin*H,Dosh,Scell);
+  }
+  Timers[TMC_NlNeighList].active=(Timers[TMC_NlNeighList].active && NeighList!=NULL);
+  //-Configures displacements of periodic images for the neighbour search.
+  PeriImgCount=0;
+  if(PeriImage){
+    tint3 imgdir[26];
+    const int nx=(PeriX? 1: 0),ny=(PeriY? 1: 0),nz=(PeriZ? 1: 0);
+    for(int cz=-nz;cz<=nz;cz++)for(int cy=-ny;cy<=ny;cy++)for(int cx=-nx;cx<=nx;cx++)if(cx||cy||cz){
+      imgdir[PeriImgCount]=TInt3(cx,cy,cz);
+      PeriImgInc[PeriImgCount++]=PeriXinc*double(cx)+PeriYinc*double(cy)+PeriZinc*double(cz);
+    }
+    //-The neighbour list stores the periodic image where each neighbour was found. | La lista de vecinos guarda la imagen periodica donde se encontro cada vecino.
+    if(NeighList)NeighList->ConfigPeriImages(PeriImgCount,PeriImgInc,imgdir);
+  }
+  //-Gauges also search the neighbours of the periodic images of their points. | Las medidas tambien buscan los vecinos de las imagenes periodicas de sus puntos.
+  GaugeSystem->ConfigPeriImages(PeriImgCount,PeriImgInc);
+  Timers[TMC_SuPeriodic].active=(Timers[TMC_SuPeriodic].active && !PeriImage);
+  //-Configures fused update of particles with Symplectic.
+  FusedStep=cfg->FusedStep;
+  if(FusedStep && TStep!=STEP_Symplectic){
+    Log->Print("\n*** Attention: FusedStep is disabled because it is only supported with Symplectic.\n");
+    FusedStep=false;
+  }
+  //-Configures interaction in chunks of balanced cost with work stealing.
+  if(cfg->CellBalance){
+    CellBalance=new JCellBalanceCpu(OmpThreads,cfg->CellBalance);
+    #ifdef OMP_USE
+      omp_set_nested(0); //-Interaction of each chunk is executed by only one thread. | La interaccion de cada trozo la ejecuta un solo hilo.
+    #endif
+  }
   if(OmpThreads==1)RunMode="Single core";
   else RunMode=string("OpenMP(Threads:")+fun::IntStr(OmpThreads)+")";
+  if(KerTableFac)RunMode=string("KerTable(")+fun::UintStr(KerTableSize)+") - "+RunMode;
+  if(NumaArrays)RunMode=string("Numa(Nodes:")+fun::UintStr(Numa->GetNumNodes())+") - "+RunMode;
+  if(Numa && Numa->GetPinned())RunMode=string("OmpPin - ")+RunMode;
+  if(CellSparse)RunMode=string("CellSparse - ")+RunMode;
+  if(HugePages)RunMode=string("HugePages - ")+RunMode;
+  if(CompactState)RunMode=string("CompactState - ")+RunMode;
+  if(FusedStep)RunMode=string("FusedStep - ")+RunMode;
+  if(PeriImage)RunMode=string("PeriImage - ")+RunMode;
+  if(MemTrack)RunMode=string("MemProfile - ")+RunMode;
+  if(CellModeAuto)RunMode=string("CellModeAuto - ")+RunMode;
+  if(CellSfc!=CELLSFC_None)RunMode=string("CellSfc-")+GetNameCellSfc(CellSfc)+" - "+RunMode;
+  if(IncDivide)RunMode=string("IncDivide(")+fun::FloatStr(IncDivide,"%g")+") - "+RunMode;
+  if(CellBalance)RunMode=string("CellBalance(Chunks:")+fun::UintStr(CellBalance->GetChunksThread())+") - "+RunMode;
+  if(NeighList)RunMode=string("NeighList(Skin:")+fun::FloatStr(cfg->NeighListSkin,"%g")+"h) - "+RunMode;
+  if(SimdMode!=SIMDMODE_None)RunMode=string("Simd-")+GetNameSimdMode(SimdMode)+" - "+RunMode;
+  if(CellTile)RunMode=string("CellTile - ")+RunMode;
+  if(FusedInter)RunMode=string("FusedInter - ")+RunMode;
+  if(Symmetry)RunMode=string("Symmetry - ")+RunMode;
   if(!preinfo.empty())RunMode=preinfo+" - "+RunMode;
   if(Stable)RunMode=string("Stable - ")+RunMode;
   if(Psingle)RunMode=string("Pos-Single - ")+RunMode;
@@ -399,7 +598,8 @@ void JSphCpu::InitRun(){
   const char met[]="InitRun";
   WithFloating=(CaseNfloat>0);
   if(TStep==STEP_Verlet){
-    memcpy(VelrhopM1c,Velrhopc,sizeof(tfloat4)*Np);
+    if(CompactState)memset(VelrhopM1h,0,sizeof(thalf4)*Np);
+    else memcpy(VelrhopM1c,Velrhopc,sizeof(tfloat4)*Np);
     VerletStep=0;
   }
   else if(TStep==STEP_Symplectic)DtPre=DtIni;
@@ -557,11 +757,93 @@ void JSphCpu::PreInteractionVars_Forces(TpInter tinter,unsigned np,unsigned npb)
   }
 }
 
+//==============================================================================
+/// Prepare variables for interaction in one sweep over particles: initialises
+/// arrays, computes pressure and position in single precision and returns the
+/// maximum velocity of particles from pvini. Each thread processes its static 
+/// range in blocks of FUSED_BLOCKSIZE particles that stay in cache between the
+/// loops of the block. Pressure may differ from the default code in the last
+/// bit since the compiler can compute different particles with the vectorised
+/// and the scalar pow() (-ffast-math).
+///
+/// Prepara variables para interaccion en un solo barrido de las particulas:
+/// inicializa arrays, calcula presion y posicion en simple precision y devuelve
+/// la velocidad maxima de las particulas desde pvini. Cada hilo procesa su 
+/// rango estatico en bloques de FUSED_BLOCKSIZE particulas que permanecen en 
+/// cache entre los bucles del bloque. La presion puede diferir del codigo por
+/// defecto en el ultimo bit ya que el compilador puede calcular particulas 
+/// distintas con pow() vectorizado y escalar (-ffast-math).
+//==============================================================================
+float JSphCpu::PreInteractionFused_Forces(unsigned np,unsigned npb,unsigned pvini){
+  float *ar=Arc,*delta=Deltac,*shiftdetect=ShiftDetectc,*press=Pressc;
+  tfloat3 *ace=Acec,*shiftpos=ShiftPosc,*pspos=PsPosc;
+  tsymatrix3f *gradvel=SpsGradvelc;
+  const tdouble3 *pos=Posc;
+  const tfloat4 *velrhop=Velrhopc;
+  const tfloat3 gravity=Gravity;
+  float vmaxth[OMP_MAXTHREADS*OMP_STRIDE];
+  for(int th=0;th<OmpThreads;th++)vmaxth[th*OMP_STRIDE]=0;
+  const int n=int(np);
+  #ifdef OMP_USE
+    #pragma omp parallel if(n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  {
+    const int th=omp_get_thread_num();
+    //-Same range of schedule(static). | Mismo rango que schedule(static).
+    unsigned ini,fin;
+    JNumaCpu::GetThreadRange(0,np,th,omp_get_num_threads(),ini,fin);
+    float vmax2=0;
+    for(unsigned bini=ini;bini<fin;bini+=FUSED_BLOCKSIZE){
+      const int pini=int(bini),pfin=int(min(fin,bini+FUSED_BLOCKSIZE));
+      //-Initialize arrays. | Inicializa arrays.
+      for(int p=pini;p<pfin;p++){
+        ar[p]=0;
+        if(delta)delta[p]=0;
+        if(shiftpos)shiftpos[p]=TFloat3(0);
+        if(shiftdetect)shiftdetect[p]=0;
+        ace[p]=(unsigned(p)<npb? TFloat3(0): gravity);
+        if(gradvel && unsigned(p)>=npb)memset(gradvel+p,0,sizeof(tsymatrix3f));
+        if(pspos)pspos[p]=ToTFloat3(pos[p]);
+      }
+      //-Prepare values of rhop for interaction. | Prepara datos derivados de rhop para interaccion.
+      for(int p=pini;p<pfin;p++){
+        const float rhop=velrhop[p].w,rhop_r0=rhop/RhopZero;
+        press[p]=CteB*(pow(rhop_r0,Gamma)-1.0f);
+      }
+      //-Maximum velocity. | Velocidad maxima.
+      for(int p=max(pini,int(pvini));p<pfin;p++){
+        const tfloat4 v=velrhop[p];
+        const float v2=v.x*v.x+v.y*v.y+v.z*v.z;
+        if(vmax2<v2)vmax2=v2;
+      }
+    }
+    vmaxth[th*OMP_STRIDE]=vmax2;
+  }
+  float vmax=0;
+  for(int th=0;th<OmpThreads;th++)if(vmax<vmaxth[th*OMP_STRIDE])vmax=vmaxth[th*OMP_STRIDE];
+  return(sqrt(vmax));
+}
+
+//==============================================================================
+/// Builds the neighbour list again when the particles moved more than skin/2
+/// since the list was built.
+/// Crea de nuevo la lista de vecinos cuando las particulas se movieron mas de 
+/// skin/2 desde que se creo la lista.
+//==============================================================================
+void JSphCpu::UpdateNeighbourList(){
+  TmcStart(Timers,TMC_NlNeighList);
+  if(!NeighList->CheckDisplacement(Np,Posc)){
+    NeighList->Build(Np,Npb,NpbOk,CellDiv->GetNcells(),CellDiv->GetCellDomainMin(),DomPosMin,CellDiv->GetBeginCell(),CellRow,DomCellCode,Dcellc,Posc);
+  }
+  TmcStop(Timers,TMC_NlNeighList);
+}
+
 //==============================================================================
 /// Prepare variables for interaction functions "INTER_Forces" or "INTER_ForcesCorr".
 /// Prepara variables para interaccion "INTER_Forces" o "INTER_ForcesCorr".
 //==============================================================================
 void JSphCpu::PreInteraction_Forces(TpInter tinter){
+  if(NeighList)UpdateNeighbourList();
   TmcStart(Timers,TMC_CfPreForces);
   //-Assign memory.
   Arc=ArraysCpu->ReserveFloat();
@@ -574,6 +856,18 @@ void JSphCpu::PreInteraction_Forces(TpInter tinter){
   Pressc=ArraysCpu->ReserveFloat();
   if(TVisco==VISCO_LaminarSPS)SpsGradvelc=ArraysCpu->ReserveSymatrix3f();
 
+  if(FusedInter){
+    if(Psingle)PsPosc=ArraysCpu->ReserveFloat3();
+    //-Initialize arrays, computes pressure, PsPosc and VelMax in one sweep. | Inicializa arrays, calcula presion, PsPosc y VelMax en un barrido.
+    VelMax=PreInteractionFused_Forces(Np,Npb,(DtAllParticles? 0: Npb));
+    //-Apply the extra forces to the correct particle sets.
+    if(AccInput)AddAccInput();
+    //-Prepare data in SoA format for SIMD interaction.
+    if(SimdMode!=SIMDMODE_None)PrepareSimdData(Np);
+    ViscDtMax=0;
+    TmcStop(Timers,TMC_CfPreForces);
+    return;
+  }
   //-Prepare values for interaction Pos-Simpe.
   if(Psingle){
     PsPosc=ArraysCpu->ReserveFloat3();
@@ -585,6 +879,8 @@ void JSphCpu::PreInteraction_Forces(TpInter tinter){
   }
   //-Initialize Arrays.
   PreInteractionVars_Forces(tinter,Np,Npb);
+  //-Prepare data in SoA format for SIMD interaction.
+  if(SimdMode!=SIMDMODE_None)PrepareSimdData(Np);
 
   //-Calculate VelMax: Floating object particles are included and do not affect use of periodic condition.
   //-Calcula VelMax: Se incluyen las particulas floatings y no afecta el uso de condiciones periodicas.
@@ -742,6 +1038,36 @@ float JSphCpu::GetKernelCubicTensil(float rr2,float rhopp1,float pressp1,float r
   return(fab*(tensilp1+tensilp2));
 }
 
+//==============================================================================
+/// Returns gradients (frx, fry and frz) with linear interpolation of fac from 
+/// the kernel table computed in ConfigConstants().
+/// Devuelve gradients (frx, fry y frz) con interpolacion lineal de fac desde 
+/// la tabla del kernel calculada en ConfigConstants().
+//==============================================================================
+void JSphCpu::GetKernelTable(float rr2,float drx,float dry,float drz
+  ,float &frx,float &fry,float &frz)const
+{
+  const float x=rr2*KerTableIdr2;
+  const unsigned c=unsigned(x);
+  const float fac=KerTableFac[c*2]+KerTableFac[c*2+1]*(x-float(c));
+  frx=fac*drx; fry=fac*dry; frz=fac*drz;
+}
+
+//==============================================================================
+/// Returns tensile correction for kernel Cubic with linear interpolation of
+/// fab from the kernel table computed in ConfigConstants().
+/// Devuelve correccion tensil para kernel Cubic con interpolacion lineal de 
+/// fab desde la tabla del kernel calculada en ConfigConstants().
+//==============================================================================
+float JSphCpu::GetKernelTableTensil(float rr2,float rhopp1,float pressp1,float rhopp2,float pressp2)const{
+  const float x=rr2*KerTableIdr2;
+  const unsigned c=unsigned(x);
+  const float fab=KerTableTensil[c*2]+KerTableTensil[c*2+1]*(x-float(c));
+  const float tensilp1=(pressp1/(rhopp1*rhopp1))*(pressp1>0? 0.01f: -0.2f);
+  const float tensilp2=(pressp2/(rhopp2*rhopp2))*(pressp2>0? 0.01f: -0.2f);
+  return(fab*(tensilp1+tensilp2));
+}
+
 //==============================================================================
 /// Return cell limits for interaction starting from cell coordinates.
 /// Devuelve limites de celdas para interaccion a partir de coordenadas de celda.
@@ -763,6 +1089,33 @@ void JSphCpu::GetInteractionCells(unsigned rcell
   zfin=cz+min(nc.z-cz-1,hdiv)+1;
 }
 
+//==============================================================================
+/// Returns the position and cell of the periodic image cimg of a particle when
+/// it is within the domain (PeriImage). Neighbours of the image are the 
+/// periodic neighbours of the particle. The cell is limited as in 
+/// PeriodicDuplicatePos().
+///
+/// Devuelve la posicion y celda de la imagen periodica cimg de una particula 
+/// cuando esta dentro del dominio (PeriImage). Los vecinos de la imagen son 
+/// los vecinos periodicos de la particula. La celda se limita como en 
+/// PeriodicDuplicatePos().
+//==============================================================================
+bool JSphCpu::GetPeriImage(unsigned cimg,const tdouble3 &pos,tdouble3 &posimg,unsigned &dcellimg)const{
+  const tdouble3 ps=pos+PeriImgInc[cimg];
+  const bool ok=(Map_PosMin<=ps && ps<Map_PosMax);
+  if(ok){
+    unsigned cx=unsigned((ps.x-DomPosMin.x)/Scell);
+    unsigned cy=unsigned((ps.y-DomPosMin.y)/Scell);
+    unsigned cz=unsigned((ps.z-DomPosMin.z)/Scell);
+    cx=(cx<=DomCells.x? cx: DomCells.x);
+    cy=(cy<=DomCells.y? cy: DomCells.y);
+    cz=(cz<=DomCells.z? cz: DomCells.z);
+    posimg=ps;
+    dcellimg=PC__Cell(DomCellCode,cx,cy,cz);
+  }
+  return(ok);
+}
+
 //==============================================================================
 /// Perform interaction between particles. Bound-Fluid/Float
 /// Realiza interaccion entre particulas. Bound-Fluid/Float
@@ -770,6 +1123,7 @@ void JSphCpu::GetInteractionCells(unsigned rcell
 template<bool psingle,TpKernel tker,TpFtMode ftmode> void JSphCpu::InteractionForcesBound
   (unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial
   ,const unsigned *beginendcell,tint3 cellzero,const unsigned *dcell
+  ,const unsigned *nlbegin,const unsigned *nlist,const unsigned *nlcur
   ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
   ,float &viscdt,float *ar)const
 {
@@ -786,53 +1140,82 @@ template<bool psingle,TpKernel tker,TpFtMode ftmode> void JSphCpu::InteractionFo
 
     //-Load data of particle p1. | Carga datos de particula p1.
     const tfloat3 velp1=TFloat3(velrhop[p1].x,velrhop[p1].y,velrhop[p1].z);
-    const tfloat3 psposp1=(psingle? pspos[p1]: TFloat3(0));
-    const tdouble3 posp1=(psingle? TDouble3(0): pos[p1]);
-
-    //-Obtain limits of interaction. | Obtiene limites de interaccion.
-    int cxini,cxfin,yini,yfin,zini,zfin;
-    GetInteractionCells(dcell[p1],hdiv,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
-
-    //-Search for neighbours in adjacent cells. | Busqueda de vecinos en celdas adyacentes.
-    for(int z=zini;z<zfin;z++){
-      const int zmod=(nc.w)*z+cellinitial; //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
-      for(int y=yini;y<yfin;y++){
-        int ymod=zmod+nc.x*y;
-        const unsigned pini=beginendcell[cxini+ymod];
-        const unsigned pfin=beginendcell[cxfin+ymod];
-
-        //-Interaction of boundary with type Fluid/Float | Interaccion de Bound con varias Fluid/Float.
-        //---------------------------------------------------------------------------------------------
-        for(unsigned p2=pini;p2<pfin;p2++){
-          const float drx=(psingle? psposp1.x-pspos[p2].x: float(posp1.x-pos[p2].x));
-          const float dry=(psingle? psposp1.y-pspos[p2].y: float(posp1.y-pos[p2].y));
-          const float drz=(psingle? psposp1.z-pspos[p2].z: float(posp1.z-pos[p2].z));
-          const float rr2=drx*drx+dry*dry+drz*drz;
-          if(rr2<=Fourh2 && rr2>=ALMOSTZERO){
-            //-Cubic Spline, Wendland or Gaussian kernel.
-            float frx,fry,frz;
-            if(tker==KERNEL_Wendland)GetKernelWendland(rr2,drx,dry,drz,frx,fry,frz);
-            else if(tker==KERNEL_Gaussian)GetKernelGaussian(rr2,drx,dry,drz,frx,fry,frz);
-            else if(tker==KERNEL_Cubic)GetKernelCubic(rr2,drx,dry,drz,frx,fry,frz);
-
-            //===== Get mass of particle p2 ===== 
-            float massp2=MassFluid; //-Contains particle mass of incorrect fluid. | Contiene masa de particula por defecto fluid.
-            bool compute=true;      //-Deactivate when using DEM and/or bound-float. | Se desactiva cuando se usa DEM y es bound-float.
-            if(USE_FLOATING){
-              bool ftp2=CODE_IsFloating(code[p2]);
-              if(ftp2)massp2=FtObjs[CODE_GetTypeValue(code[p2])].massp;
-              compute=!(USE_DEM && ftp2); //-Deactivate when using DEM and/or bound-float. | Se desactiva cuando se usa DEM y es bound-float.
+    tfloat3 psposp1=(psingle? pspos[p1]: TFloat3(0));
+    tdouble3 posp1=(psingle? TDouble3(0): pos[p1]);
+    unsigned dcellp1=dcell[p1];
+
+    //-Search for neighbours of p1 and, with PeriImage, of its periodic images within the domain. | Busqueda de vecinos de p1 y, con PeriImage, de sus imagenes periodicas dentro del dominio.
+    const unsigned nimg=(PeriImage && !nlist? PeriImgCount: 0); //-The neighbour list includes the neighbours of the periodic images. | La lista de vecinos incluye los vecinos de las imagenes periodicas.
+    for(unsigned cimg=0;cimg<=nimg;cimg++){
+      if(cimg){
+        tdouble3 psimg;
+        if(!GetPeriImage(cimg-1,Posc[p1],psimg,dcellp1))continue;
+        if(psingle)psposp1=ToTFloat3(psimg);
+        else posp1=psimg;
+      }
+      //-Obtain limits of interaction (or ranges of neighbour list). | Obtiene limites de interaccion (o rangos de lista de vecinos).
+      int cxini=0,cxfin=0,yini=0,yfin=0,zini=0,zfin=1;
+      if(nlist){ yini=int(nlbegin[p1*2]); yfin=int(nlbegin[p1*2+1]); }
+      else GetInteractionCells(dcellp1,hdiv,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
+
+      //-Search for neighbours in adjacent cells. | Busqueda de vecinos en celdas adyacentes.
+      for(int z=zini;z<zfin;z++){
+        const unsigned *rowz=CellRow+nc.y*z; //-First cell of the rows of cells in z. | Primera celda de las filas de celdas en z.
+        for(int y=yini;y<yfin;y++){
+          int ymod=(nlist? 0: int(cellinitial+rowz[y])); //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
+          unsigned pini,pfin;
+          tfloat3 psposp1c=psposp1;
+          tdouble3 posp1c=posp1;
+          if(nlist){
+            //-Neighbour y of the list found around p1 or around one of its periodic images. | Vecino y de la lista encontrado alrededor de p1 o de una de sus imagenes periodicas.
+            const unsigned cimgy=(nlist[y]>>JNeighbourListCpu::IMG_SHIFT);
+            pini=nlcur[nlist[y]&JNeighbourListCpu::PART_MASK];
+            pfin=pini+1; //-Excluded neighbours have pini=UINT_MAX and pfin=0. | Los vecinos excluidos tienen pini=UINT_MAX y pfin=0.
+            if(cimgy){
+              const tdouble3 psimg=Posc[p1]+PeriImgInc[cimgy-1];
+              if(psingle)psposp1c=ToTFloat3(psimg);
+              else posp1c=psimg;
             }
+          }
+          else{
+            pini=beginendcell[cxini+ymod];
+            pfin=beginendcell[cxfin+ymod];
+          }
 
-            if(compute){
-              //-Density derivative.
-              const float dvx=velp1.x-velrhop[p2].x, dvy=velp1.y-velrhop[p2].y, dvz=velp1.z-velrhop[p2].z;
-              if(compute)arp1+=massp2*(dvx*frx+dvy*fry+dvz*frz);
+          //-Interaction of boundary with type Fluid/Float | Interaccion de Bound con varias Fluid/Float.
+          //---------------------------------------------------------------------------------------------
+          for(unsigned p2=pini;p2<pfin;p2++){
+            const float drx=(psingle? psposp1c.x-pspos[p2].x: float(posp1c.x-pos[p2].x));
+            const float dry=(psingle? psposp1c.y-pspos[p2].y: float(posp1c.y-pos[p2].y));
+            const float drz=(psingle? psposp1c.z-pspos[p2].z: float(posp1c.z-pos[p2].z));
+            const float rr2=drx*drx+dry*dry+drz*drz;
+            if(rr2<=Fourh2 && rr2>=ALMOSTZERO){
+              //-Cubic Spline, Wendland or Gaussian kernel.
+              float frx,fry,frz;
+              if(tker==KERNEL_Table)GetKernelTable(rr2,drx,dry,drz,frx,fry,frz);
+              else if(tker==KERNEL_Wendland)GetKernelWendland(rr2,drx,dry,drz,frx,fry,frz);
+              else if(tker==KERNEL_Gaussian)GetKernelGaussian(rr2,drx,dry,drz,frx,fry,frz);
+              else if(tker==KERNEL_Cubic)GetKernelCubic(rr2,drx,dry,drz,frx,fry,frz);
+
+              //===== Get mass of particle p2 ===== 
+              float massp2=MassFluid; //-Contains particle mass of incorrect fluid. | Contiene masa de particula por defecto fluid.
+              bool compute=true;      //-Deactivate when using DEM and/or bound-float. | Se desactiva cuando se usa DEM y es bound-float.
+              if(USE_FLOATING){
+                bool ftp2=CODE_IsFloating(code[p2]);
+                if(ftp2)massp2=FtObjs[CODE_GetTypeValue(code[p2])].massp;
+                compute=!(USE_DEM && ftp2); //-Deactivate when using DEM and/or bound-float. | Se desactiva cuando se usa DEM y es bound-float.
+              }
 
-              {//-Viscosity.
-                const float dot=drx*dvx + dry*dvy + drz*dvz;
-                const float dot_rr2=dot/(rr2+Eta2);
-                visc=max(dot_rr2,visc);
+              if(compute){
+                //-Density derivative.
+                const float dvx=velp1.x-velrhop[p2].x, dvy=velp1.y-velrhop[p2].y, dvz=velp1.z-velrhop[p2].z;
+                if(compute)arp1+=massp2*(dvx*frx+dvy*fry+dvz*frz);
+
+                {//-Viscosity.
+                  const float dot=drx*dvx + dry*dvy + drz*dvz;
+                  const float dot_rr2=dot/(rr2+Eta2);
+                  visc=max(dot_rr2,visc);
+                }
               }
             }
           }
@@ -857,6 +1240,7 @@ template<bool psingle,TpKernel tker,TpFtMode ftmode> void JSphCpu::InteractionFo
 template<bool psingle,TpKernel tker,TpFtMode ftmode,bool lamsps,TpDeltaSph tdelta,bool shift> void JSphCpu::InteractionForcesFluid
   (unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial,float visco
   ,const unsigned *beginendcell,tint3 cellzero,const unsigned *dcell
+  ,const unsigned *nlbegin,const unsigned *nlist,const unsigned *nlcur
   ,const tsymatrix3f* tau,tsymatrix3f* gradvel
   ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
   ,const float *press 
@@ -892,149 +1276,722 @@ template<bool psingle,TpKernel tker,TpFtMode ftmode,bool lamsps,TpDeltaSph tdelt
     //-Obtain data of particle p1.
     const tfloat3 velp1=TFloat3(velrhop[p1].x,velrhop[p1].y,velrhop[p1].z);
     const float rhopp1=velrhop[p1].w;
-    const tfloat3 psposp1=(psingle? pspos[p1]: TFloat3(0));
-    const tdouble3 posp1=(psingle? TDouble3(0): pos[p1]);
+    tfloat3 psposp1=(psingle? pspos[p1]: TFloat3(0));
+    tdouble3 posp1=(psingle? TDouble3(0): pos[p1]);
+    unsigned dcellp1=dcell[p1];
     const float pressp1=press[p1];
     const tsymatrix3f taup1=(lamsps? tau[p1]: gradvelp1);
 
-    //-Obtain interaction limits.
-    int cxini,cxfin,yini,yfin,zini,zfin;
-    GetInteractionCells(dcell[p1],hdiv,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
-
-    //-Search for neighbours in adjacent cells.
-    for(int z=zini;z<zfin;z++){
-      const int zmod=(nc.w)*z+cellinitial; //-Sum from start of fluid or boundary cells. | Le suma donde empiezan las celdas de fluido o bound.
-      for(int y=yini;y<yfin;y++){
-        int ymod=zmod+nc.x*y;
-        const unsigned pini=beginendcell[cxini+ymod];
-        const unsigned pfin=beginendcell[cxfin+ymod];
-
-        //-Interaction of Fluid with type Fluid or Bound. | Interaccion de Fluid con varias Fluid o Bound.
-        //------------------------------------------------------------------------------------------------
-        for(unsigned p2=pini;p2<pfin;p2++){
-          const float drx=(psingle? psposp1.x-pspos[p2].x: float(posp1.x-pos[p2].x));
-          const float dry=(psingle? psposp1.y-pspos[p2].y: float(posp1.y-pos[p2].y));
-          const float drz=(psingle? psposp1.z-pspos[p2].z: float(posp1.z-pos[p2].z));
-          const float rr2=drx*drx+dry*dry+drz*drz;
-          if(rr2<=Fourh2 && rr2>=ALMOSTZERO){
-            //-Cubic Spline, Wendland or Gaussian kernel.
-            float frx,fry,frz;
-            if(tker==KERNEL_Wendland)GetKernelWendland(rr2,drx,dry,drz,frx,fry,frz);
-            else if(tker==KERNEL_Gaussian)GetKernelGaussian(rr2,drx,dry,drz,frx,fry,frz);
-            else if(tker==KERNEL_Cubic)GetKernelCubic(rr2,drx,dry,drz,frx,fry,frz);
-
-            //===== Get mass of particle p2 ===== 
-            float massp2=(boundp2? MassBound: MassFluid); //-Contiene masa de particula segun sea bound o fluid.
-            bool ftp2=false;    //-Indicate if it is floating | Indica si es floating.
-            bool compute=true;  //-Deactivate when using DEM and if it is of type float-float or float-bound | Se desactiva cuando se usa DEM y es float-float o float-bound.
-            if(USE_FLOATING){
-              ftp2=CODE_IsFloating(code[p2]);
-              if(ftp2)massp2=FtObjs[CODE_GetTypeValue(code[p2])].massp;
-              #ifdef DELTA_HEAVYFLOATING
-                if(ftp2 && massp2<=(MassFluid*1.2f) && (tdelta==DELTA_Dynamic || tdelta==DELTA_DynamicExt))deltap1=FLT_MAX;
-              #else
-                if(ftp2 && (tdelta==DELTA_Dynamic || tdelta==DELTA_DynamicExt))deltap1=FLT_MAX;
-              #endif
-              if(ftp2 && shift && tshifting==SHIFT_NoBound)shiftposp1.x=FLT_MAX; //-With floating objects do not use shifting. | Con floatings anula shifting.
-              compute=!(USE_DEM && ftp1 && (boundp2 || ftp2)); //-Deactivate when using DEM and if it is of type float-float or float-bound. | Se desactiva cuando se usa DEM y es float-float o float-bound.
+    //-Search for neighbours of p1 and, with PeriImage, of its periodic images within the domain. | Busqueda de vecinos de p1 y, con PeriImage, de sus imagenes periodicas dentro del dominio.
+    const unsigned nimg=(PeriImage && !nlist? PeriImgCount: 0); //-The neighbour list includes the neighbours of the periodic images. | La lista de vecinos incluye los vecinos de las imagenes periodicas.
+    for(unsigned cimg=0;cimg<=nimg;cimg++){
+      if(cimg){
+        tdouble3 psimg;
+        if(!GetPeriImage(cimg-1,Posc[p1],psimg,dcellp1))continue;
+        if(psingle)psposp1=ToTFloat3(psimg);
+        else posp1=psimg;
+      }
+      //-Obtain interaction limits (or ranges of neighbour list).
+      int cxini=0,cxfin=0,yini=0,yfin=0,zini=0,zfin=1;
+      if(nlist){ yini=int(nlbegin[p1*2]); yfin=int(nlbegin[p1*2+1]); }
+      else GetInteractionCells(dcellp1,hdiv,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
+
+      //-Search for neighbours in adjacent cells.
+      for(int z=zini;z<zfin;z++){
+        const unsigned *rowz=CellRow+nc.y*z; //-First cell of the rows of cells in z. | Primera celda de las filas de celdas en z.
+        for(int y=yini;y<yfin;y++){
+          int ymod=(nlist? 0: int(cellinitial+rowz[y])); //-Sum from start of fluid or boundary cells. | Le suma donde empiezan las celdas de fluido o bound.
+          unsigned pini,pfin;
+          tfloat3 psposp1c=psposp1;
+          tdouble3 posp1c=posp1;
+          if(nlist){
+            //-Neighbour y of the list found around p1 or around one of its periodic images. | Vecino y de la lista encontrado alrededor de p1 o de una de sus imagenes periodicas.
+            const unsigned cimgy=(nlist[y]>>JNeighbourListCpu::IMG_SHIFT);
+            pini=nlcur[nlist[y]&JNeighbourListCpu::PART_MASK];
+            pfin=pini+1; //-Excluded neighbours have pini=UINT_MAX and pfin=0. | Los vecinos excluidos tienen pini=UINT_MAX y pfin=0.
+            if(cimgy){
+              const tdouble3 psimg=Posc[p1]+PeriImgInc[cimgy-1];
+              if(psingle)psposp1c=ToTFloat3(psimg);
+              else posp1c=psimg;
             }
+          }
+          else{
+            pini=beginendcell[cxini+ymod];
+            pfin=beginendcell[cxfin+ymod];
+          }
 
-            //===== Acceleration ===== 
-            if(compute){
-              const float prs=(pressp1+press[p2])/(rhopp1*velrhop[p2].w) + (tker==KERNEL_Cubic? GetKernelCubicTensil(rr2,rhopp1,pressp1,velrhop[p2].w,press[p2]): 0);
-              const float p_vpm=-prs*massp2*ftmassp1;
-              acep1.x+=p_vpm*frx; acep1.y+=p_vpm*fry; acep1.z+=p_vpm*frz;
-            }
+          //-Interaction of Fluid with type Fluid or Bound. | Interaccion de Fluid con varias Fluid o Bound.
+          //------------------------------------------------------------------------------------------------
+          for(unsigned p2=pini;p2<pfin;p2++){
+            const float drx=(psingle? psposp1c.x-pspos[p2].x: float(posp1c.x-pos[p2].x));
+            const float dry=(psingle? psposp1c.y-pspos[p2].y: float(posp1c.y-pos[p2].y));
+            const float drz=(psingle? psposp1c.z-pspos[p2].z: float(posp1c.z-pos[p2].z));
+            const float rr2=drx*drx+dry*dry+drz*drz;
+            if(rr2<=Fourh2 && rr2>=ALMOSTZERO){
+              //-Cubic Spline, Wendland or Gaussian kernel.
+              float frx,fry,frz;
+              if(tker==KERNEL_Table)GetKernelTable(rr2,drx,dry,drz,frx,fry,frz);
+              else if(tker==KERNEL_Wendland)GetKernelWendland(rr2,drx,dry,drz,frx,fry,frz);
+              else if(tker==KERNEL_Gaussian)GetKernelGaussian(rr2,drx,dry,drz,frx,fry,frz);
+              else if(tker==KERNEL_Cubic)GetKernelCubic(rr2,drx,dry,drz,frx,fry,frz);
+
+              //===== Get mass of particle p2 ===== 
+              float massp2=(boundp2? MassBound: MassFluid); //-Contiene masa de particula segun sea bound o fluid.
+              bool ftp2=false;    //-Indicate if it is floating | Indica si es floating.
+              bool compute=true;  //-Deactivate when using DEM and if it is of type float-float or float-bound | Se desactiva cuando se usa DEM y es float-float o float-bound.
+              if(USE_FLOATING){
+                ftp2=CODE_IsFloating(code[p2]);
+                if(ftp2)massp2=FtObjs[CODE_GetTypeValue(code[p2])].massp;
+                #ifdef DELTA_HEAVYFLOATING
+                  if(ftp2 && massp2<=(MassFluid*1.2f) && (tdelta==DELTA_Dynamic || tdelta==DELTA_DynamicExt))deltap1=FLT_MAX;
+                #else
+                  if(ftp2 && (tdelta==DELTA_Dynamic || tdelta==DELTA_DynamicExt))deltap1=FLT_MAX;
+                #endif
+                if(ftp2 && shift && tshifting==SHIFT_NoBound)shiftposp1.x=FLT_MAX; //-With floating objects do not use shifting. | Con floatings anula shifting.
+                compute=!(USE_DEM && ftp1 && (boundp2 || ftp2)); //-Deactivate when using DEM and if it is of type float-float or float-bound. | Se desactiva cuando se usa DEM y es float-float o float-bound.
+              }
 
-            //-Density derivative.
-            const float dvx=velp1.x-velrhop[p2].x, dvy=velp1.y-velrhop[p2].y, dvz=velp1.z-velrhop[p2].z;
-            if(compute)arp1+=massp2*(dvx*frx+dvy*fry+dvz*frz);
-
-            const float cbar=(float)Cs0;
-            //-Density derivative (DeltaSPH Molteni).
-            if((tdelta==DELTA_Dynamic || tdelta==DELTA_DynamicExt) && deltap1!=FLT_MAX){
-              const float rhop1over2=rhopp1/velrhop[p2].w;
-              const float visc_densi=Delta2H*cbar*(rhop1over2-1.f)/(rr2+Eta2);
-              const float dot3=(drx*frx+dry*fry+drz*frz);
-              const float delta=visc_densi*dot3*massp2;
-              deltap1=(boundp2? FLT_MAX: deltap1+delta);
-            }
+              //===== Acceleration ===== 
+              if(compute){
+                const float prs=(pressp1+press[p2])/(rhopp1*velrhop[p2].w) + (tker==KERNEL_Cubic? GetKernelCubicTensil(rr2,rhopp1,pressp1,velrhop[p2].w,press[p2]): (tker==KERNEL_Table && KerTableTensil? GetKernelTableTensil(rr2,rhopp1,pressp1,velrhop[p2].w,press[p2]): 0));
+                const float p_vpm=-prs*massp2*ftmassp1;
+                acep1.x+=p_vpm*frx; acep1.y+=p_vpm*fry; acep1.z+=p_vpm*frz;
+              }
+
+              //-Density derivative.
+              const float dvx=velp1.x-velrhop[p2].x, dvy=velp1.y-velrhop[p2].y, dvz=velp1.z-velrhop[p2].z;
+              if(compute)arp1+=massp2*(dvx*frx+dvy*fry+dvz*frz);
+
+              const float cbar=(float)Cs0;
+              //-Density derivative (DeltaSPH Molteni).
+              if((tdelta==DELTA_Dynamic || tdelta==DELTA_DynamicExt) && deltap1!=FLT_MAX){
+                const float rhop1over2=rhopp1/velrhop[p2].w;
+                const float visc_densi=Delta2H*cbar*(rhop1over2-1.f)/(rr2+Eta2);
+                const float dot3=(drx*frx+dry*fry+drz*frz);
+                const float delta=visc_densi*dot3*massp2;
+                deltap1=(boundp2? FLT_MAX: deltap1+delta);
+              }
 
-            //-Shifting correction.
-            if(shift && shiftposp1.x!=FLT_MAX){
-              const float massrhop=massp2/velrhop[p2].w;
-              const bool noshift=(boundp2 && (tshifting==SHIFT_NoBound || (tshifting==SHIFT_NoFixed && CODE_IsFixed(code[p2]))));
-              shiftposp1.x=(noshift? FLT_MAX: shiftposp1.x+massrhop*frx); //-For boundary do not use shifting. | Con boundary anula shifting.
-              shiftposp1.y+=massrhop*fry;
-              shiftposp1.z+=massrhop*frz;
-              shiftdetectp1-=massrhop*(drx*frx+dry*fry+drz*frz);
+              //-Shifting correction.
+              if(shift && shiftposp1.x!=FLT_MAX){
+                const float massrhop=massp2/velrhop[p2].w;
+                const bool noshift=(boundp2 && (tshifting==SHIFT_NoBound || (tshifting==SHIFT_NoFixed && CODE_IsFixed(code[p2]))));
+                shiftposp1.x=(noshift? FLT_MAX: shiftposp1.x+massrhop*frx); //-For boundary do not use shifting. | Con boundary anula shifting.
+                shiftposp1.y+=massrhop*fry;
+                shiftposp1.z+=massrhop*frz;
+                shiftdetectp1-=massrhop*(drx*frx+dry*fry+drz*frz);
+              }
+
+              //===== Viscosity ===== 
+              if(compute){
+                const float dot=drx*dvx + dry*dvy + drz*dvz;
+                const float dot_rr2=dot/(rr2+Eta2);
+                visc=max(dot_rr2,visc);
+                if(!lamsps){//-Artificial viscosity.
+                  if(dot<0){
+                    const float amubar=H*dot_rr2;  //amubar=CTE.h*dot/(rr2+CTE.eta2);
+                    const float robar=(rhopp1+velrhop[p2].w)*0.5f;
+                    const float pi_visc=(-visco*cbar*amubar/robar)*massp2*ftmassp1;
+                    acep1.x-=pi_visc*frx; acep1.y-=pi_visc*fry; acep1.z-=pi_visc*frz;
+                  }
+                }
+                else{//-Laminar+SPS viscosity. 
+                  {//-Laminar contribution.
+                    const float robar2=(rhopp1+velrhop[p2].w);
+                    const float temp=4.f*visco/((rr2+Eta2)*robar2);  //-Simplification of: temp=2.0f*visco/((rr2+CTE.eta2)*robar); robar=(rhopp1+velrhop2.w)*0.5f;
+                    const float vtemp=massp2*temp*(drx*frx+dry*fry+drz*frz);  
+                    acep1.x+=vtemp*dvx; acep1.y+=vtemp*dvy; acep1.z+=vtemp*dvz;
+                  }
+                  //-SPS turbulence model.
+                  float tau_xx=taup1.xx,tau_xy=taup1.xy,tau_xz=taup1.xz; //-taup1 is always zero when p1 is not a fluid particle. | taup1 siempre es cero cuando p1 no es fluid.
+                  float tau_yy=taup1.yy,tau_yz=taup1.yz,tau_zz=taup1.zz;
+                  if(!boundp2 && !ftp2){//-When p2 is a fluid particle. 
+                    tau_xx+=tau[p2].xx; tau_xy+=tau[p2].xy; tau_xz+=tau[p2].xz;
+                    tau_yy+=tau[p2].yy; tau_yz+=tau[p2].yz; tau_zz+=tau[p2].zz;
+                  }
+                  acep1.x+=massp2*ftmassp1*(tau_xx*frx+tau_xy*fry+tau_xz*frz);
+                  acep1.y+=massp2*ftmassp1*(tau_xy*frx+tau_yy*fry+tau_yz*frz);
+                  acep1.z+=massp2*ftmassp1*(tau_xz*frx+tau_yz*fry+tau_zz*frz);
+                  //-Velocity gradients.
+                  if(!ftp1){//-When p1 is a fluid particle. 
+                    const float volp2=-massp2/velrhop[p2].w;
+                    float dv=dvx*volp2; gradvelp1.xx+=dv*frx; gradvelp1.xy+=dv*fry; gradvelp1.xz+=dv*frz;
+                          dv=dvy*volp2; gradvelp1.xy+=dv*frx; gradvelp1.yy+=dv*fry; gradvelp1.yz+=dv*frz;
+                          dv=dvz*volp2; gradvelp1.xz+=dv*frx; gradvelp1.yz+=dv*fry; gradvelp1.zz+=dv*frz;
+                    //-To compute tau terms we assume that gradvel.xy=gradvel.dudy+gradvel.dvdx, gradvel.xz=gradvel.dudz+gradvel.dwdx, gradvel.yz=gradvel.dvdz+gradvel.dwdy
+                    //-so only 6 elements are needed instead of 3x3.
+                  }
+                }
+              }
             }
+          }
+        }
+      }
+    }
+    //-Sum results together. | Almacena resultados.
+    if(shift||arp1||acep1.x||acep1.y||acep1.z||visc){
+      if(tdelta==DELTA_Dynamic&&deltap1!=FLT_MAX)arp1+=deltap1;
+      if(tdelta==DELTA_DynamicExt)delta[p1]=(delta[p1]==FLT_MAX || deltap1==FLT_MAX? FLT_MAX: delta[p1]+deltap1);
+      ar[p1]+=arp1;
+      ace[p1]=ace[p1]+acep1;
+      const int th=omp_get_thread_num();
+      if(visc>viscth[th*OMP_STRIDE])viscth[th*OMP_STRIDE]=visc;
+      if(lamsps){
+        gradvel[p1].xx+=gradvelp1.xx;
+        gradvel[p1].xy+=gradvelp1.xy;
+        gradvel[p1].xz+=gradvelp1.xz;
+        gradvel[p1].yy+=gradvelp1.yy;
+        gradvel[p1].yz+=gradvelp1.yz;
+        gradvel[p1].zz+=gradvelp1.zz;
+      }
+      if(shift && shiftpos[p1].x!=FLT_MAX){
+        shiftpos[p1]=(shiftposp1.x==FLT_MAX? TFloat3(FLT_MAX,0,0): shiftpos[p1]+shiftposp1);
+        if(shiftdetect)shiftdetect[p1]+=shiftdetectp1;
+      }
+    }
+  }
+  //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
+  for(int th=0;th<OmpThreads;th++)if(viscdt<viscth[th*OMP_STRIDE])viscdt=viscth[th*OMP_STRIDE];
+}
+
+//==============================================================================
+/// Perform interaction Bound-Fluid/Float using chunks of balanced cost that are
+/// distributed among threads by CellBalance or using the static range of each
+/// thread of the NUMA placement.
+/// Realiza interaccion Bound-Fluid/Float usando trozos de coste equilibrado que
+/// CellBalance reparte entre los hilos o usando el rango estatico de cada hilo
+/// de la ubicacion NUMA.
+//==============================================================================
+template<bool psingle,TpKernel tker,TpFtMode ftmode> void JSphCpu::InteractionForcesBoundBal
+  (unsigned n,unsigned pini,tint4 nc,int hdiv,unsigned cellinitial
+  ,const unsigned *beginendcell,tint3 cellzero,const unsigned *dcell
+  ,const unsigned *nlbegin,const unsigned *nlist,const unsigned *nlcur
+  ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
+  ,float &viscdt,float *ar)const
+{
+  float viscth[OMP_MAXTHREADS*OMP_STRIDE];
+  for(int th=0;th<OmpThreads;th++)viscth[th*OMP_STRIDE]=0;
+  if(CellBalance)CellBalance->RunStart(JCellBalanceCpu::PASS_BoundFluid);
+  #ifdef OMP_USE
+    #pragma omp parallel
+  #endif
+  {
+    const int th=omp_get_thread_num();
+    float viscdtth=0;
+    unsigned ini,fin;
+    if(CellBalance){
+      while(CellBalance->NextChunk(th,ini,fin))if(ini<fin){
+        InteractionForcesBound<psingle,tker,ftmode>(fin-ini,ini,nc,hdiv,cellinitial,beginendcell,cellzero,dcell,nlbegin,nlist,nlcur,pos,pspos,velrhop,code,idp,viscdtth,ar);
+      }
+    }
+    else{
+      JNumaCpu::GetThreadRange(pini,pini+n,th,omp_get_num_threads(),ini,fin);
+      if(ini<fin)InteractionForcesBound<psingle,tker,ftmode>(fin-ini,ini,nc,hdiv,cellinitial,beginendcell,cellzero,dcell,nlbegin,nlist,nlcur,pos,pspos,velrhop,code,idp,viscdtth,ar);
+    }
+    viscth[th*OMP_STRIDE]=viscdtth;
+  }
+  if(CellBalance)CellBalance->RunEnd();
+  //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
+  for(int th=0;th<OmpThreads;th++)if(viscdt<viscth[th*OMP_STRIDE])viscdt=viscth[th*OMP_STRIDE];
+}
+
+//==============================================================================
+/// Perform interaction between fluid particles and neighbours of type Fluid 
+/// (cellinitial=cellfluid) or Bound (cellinitial=0) using chunks of balanced 
+/// cost that are distributed among threads by CellBalance or using the static
+/// range of each thread of the NUMA placement.
+///
+/// Realiza interaccion entre particulas fluidas y vecinas de tipo Fluid 
+/// (cellinitial=cellfluid) o Bound (cellinitial=0) usando trozos de coste 
+/// equilibrado que CellBalance reparte entre los hilos o usando el rango 
+/// estatico de cada hilo de la ubicacion NUMA.
+//==============================================================================
+template<bool psingle,TpKernel tker,TpFtMode ftmode,bool lamsps,TpDeltaSph tdelta,bool shift> void JSphCpu::InteractionForcesFluidBal
+  (unsigned n,unsigned pini,tint4 nc,int hdiv,unsigned cellinitial,float visco
+  ,const unsigned *beginendcell,tint3 cellzero,const unsigned *dcell
+  ,const unsigned *nlbegin,const unsigned *nlist,const unsigned *nlcur
+  ,const tsymatrix3f* tau,tsymatrix3f* gradvel
+  ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
+  ,const float *press
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta
+  ,TpShifting tshifting,tfloat3 *shiftpos,float *shiftdetect)const
+{
+  float viscth[OMP_MAXTHREADS*OMP_STRIDE];
+  for(int th=0;th<OmpThreads;th++)viscth[th*OMP_STRIDE]=0;
+  if(CellBalance)CellBalance->RunStart(cellinitial? JCellBalanceCpu::PASS_FluidFluid: JCellBalanceCpu::PASS_FluidBound);
+  #ifdef OMP_USE
+    #pragma omp parallel
+  #endif
+  {
+    const int th=omp_get_thread_num();
+    float viscdtth=0;
+    unsigned ini,fin;
+    if(CellBalance){
+      while(CellBalance->NextChunk(th,ini,fin))if(ini<fin){
+        InteractionForcesFluid<psingle,tker,ftmode,lamsps,tdelta,shift>(fin-ini,ini,nc,hdiv,cellinitial,visco,beginendcell,cellzero,dcell,nlbegin,nlist,nlcur,tau,gradvel,pos,pspos,velrhop,code,idp,press,viscdtth,ar,ace,delta,tshifting,shiftpos,shiftdetect);
+      }
+    }
+    else{
+      JNumaCpu::GetThreadRange(pini,pini+n,th,omp_get_num_threads(),ini,fin);
+      if(ini<fin)InteractionForcesFluid<psingle,tker,ftmode,lamsps,tdelta,shift>(fin-ini,ini,nc,hdiv,cellinitial,visco,beginendcell,cellzero,dcell,nlbegin,nlist,nlcur,tau,gradvel,pos,pspos,velrhop,code,idp,press,viscdtth,ar,ace,delta,tshifting,shiftpos,shiftdetect);
+    }
+    viscth[th*OMP_STRIDE]=viscdtth;
+  }
+  if(CellBalance)CellBalance->RunEnd();
+  //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
+  for(int th=0;th<OmpThreads;th++)if(viscdt<viscth[th*OMP_STRIDE])viscdt=viscth[th*OMP_STRIDE];
+}
+
+//==============================================================================
+/// Perform interaction between fluid particles and neighbours of type Fluid 
+/// (cellinitial=cellfluid) or Bound (cellinitial=0) cell by cell. The data of 
+/// neighbour cells is copied to a thread-local buffer that is reused by all 
+/// the particles of the cell, so the neighbours are read from contiguous memory.
+/// The order of the neighbours is the same one used by InteractionForcesFluid().
+/// Floating bodies are not supported.
+///
+/// Realiza la interaccion entre particulas fluidas y vecinas de tipo Fluid 
+/// (cellinitial=cellfluid) o Bound (cellinitial=0) celda a celda. Los datos de
+/// las celdas vecinas se copian en un buffer local del hilo que reutilizan 
+/// todas las particulas de la celda, de forma que las vecinas se leen de 
+/// memoria contigua. El orden de las vecinas es el usado en 
+/// InteractionForcesFluid(). No admite floatings.
+//==============================================================================
+template<bool psingle,TpKernel tker,bool lamsps,TpDeltaSph tdelta,bool shift> void JSphCpu::InteractionForcesFluidTile
+  (tint4 nc,int hdiv,unsigned cellfluid,unsigned cellinitial,float visco
+  ,const unsigned *beginendcell
+  ,const tsymatrix3f* tau,tsymatrix3f* gradvel
+  ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhop,const typecode *code
+  ,const float *press
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta
+  ,TpShifting tshifting,tfloat3 *shiftpos,float *shiftdetect)const
+{
+  const char met[]="InteractionForcesFluidTile";
+  const bool boundp2=(!cellinitial); //-Interaction with type boundary (Bound). | Interaccion con Bound.
+  const float massp2=(boundp2? MassBound: MassFluid);
+  const float cbar=(float)Cs0;
+  const int ncells=int(CellRow[nc.y*nc.z]);
+  //-Initialize viscth to calculate viscdt maximo con OpenMP. | Inicializa viscth para calcular visdt maximo con OpenMP.
+  float viscth[OMP_MAXTHREADS*OMP_STRIDE];
+  for(int th=0;th<OmpThreads;th++)viscth[th*OMP_STRIDE]=0;
+  bool errmem=false;
+  #ifdef OMP_USE
+    #pragma omp parallel
+  #endif
+  {
+    //-Thread-local buffer with data of neighbour cells. | Buffer local del hilo con datos de las celdas vecinas.
+    unsigned bsize=0;
+    tdouble3    *bpos=NULL;
+    tfloat3     *bpspos=NULL;
+    tfloat4     *bvelrhop=NULL;
+    float       *bpress=NULL;
+    typecode    *bcode=NULL;
+    tsymatrix3f *btau=NULL;
+    float visc=0;
+    #ifdef OMP_USE
+      #pragma omp for schedule (dynamic)
+    #endif
+    for(int c=0;c<ncells;c++){
+      const unsigned pcini=beginendcell[cellfluid+c];
+      const unsigned pcfin=beginendcell[cellfluid+c+1];
+      if(pcini<pcfin && !errmem){
+        //-Obtain interaction limits of the cell. | Obtiene limites de interaccion de la celda.
+        const int cx=c%nc.x;
+        const int cy=int(CellRowInv[c/nc.x])%nc.y;
+        const int cz=int(CellRowInv[c/nc.x])/nc.y;
+        const int cxini=cx-min(cx,hdiv);
+        const int cxfin=cx+min(nc.x-cx-1,hdiv)+1;
+        const int yini=cy-min(cy,hdiv);
+        const int yfin=cy+min(nc.y-cy-1,hdiv)+1;
+        const int zini=cz-min(cz,hdiv);
+        const int zfin=cz+min(nc.z-cz-1,hdiv)+1;
+        //-Counts neighbours and resizes buffer. | Cuenta vecinas y redimensiona el buffer.
+        unsigned nb=0;
+        for(int z=zini;z<zfin;z++)for(int y=yini;y<yfin;y++){
+          const int ymod=int(cellinitial+CellRow[y+nc.y*z]);
+          nb+=beginendcell[cxfin+ymod]-beginendcell[cxini+ymod];
+        }
+        if(!nb)continue;
+        if(nb>bsize){
+          delete[] bpos;     bpos=NULL;
+          delete[] bpspos;   bpspos=NULL;
+          delete[] bvelrhop; bvelrhop=NULL;
+          delete[] bpress;   bpress=NULL;
+          delete[] bcode;    bcode=NULL;
+          delete[] btau;     btau=NULL;
+          bsize=nb+nb/4+64;
+          try{
+            if(psingle)bpspos=new tfloat3[bsize];
+            else bpos=new tdouble3[bsize];
+            bvelrhop=new tfloat4[bsize];
+            bpress=new float[bsize];
+            if(boundp2 && shift)bcode=new typecode[bsize];
+            if(lamsps && !boundp2)btau=new tsymatrix3f[bsize];
+          }
+          catch(const std::bad_alloc){
+            errmem=true; bsize=0;
+            continue;
+          }
+        }
+        //-Copies data of neighbours to buffer. | Copia datos de vecinas al buffer.
+        nb=0;
+        for(int z=zini;z<zfin;z++)for(int y=yini;y<yfin;y++){
+          const int ymod=int(cellinitial+CellRow[y+nc.y*z]);
+          const unsigned pini=beginendcell[cxini+ymod];
+          const unsigned pfin=beginendcell[cxfin+ymod];
+          for(unsigned p2=pini;p2<pfin;p2++,nb++){
+            if(psingle)bpspos[nb]=pspos[p2];
+            else bpos[nb]=pos[p2];
+            bvelrhop[nb]=velrhop[p2];
+            bpress[nb]=press[p2];
+            if(boundp2 && shift)bcode[nb]=code[p2];
+            if(lamsps && !boundp2)btau[nb]=tau[p2];
+          }
+        }
+
+        //-Interaction of particles of the cell with neighbours in buffer.
+        //-Interaccion de las particulas de la celda con las vecinas del buffer.
+        for(unsigned p1=pcini;p1<pcfin;p1++){
+          float arp1=0,deltap1=0;
+          tfloat3 acep1=TFloat3(0);
+          tsymatrix3f gradvelp1={0,0,0,0,0,0};
+          tfloat3 shiftposp1=TFloat3(0);
+          float shiftdetectp1=0;
+          float viscp1=0;
+
+          //-Obtain data of particle p1.
+          const tfloat3 velp1=TFloat3(velrhop[p1].x,velrhop[p1].y,velrhop[p1].z);
+          const float rhopp1=velrhop[p1].w;
+          const tfloat3 psposp1=(psingle? pspos[p1]: TFloat3(0));
+          const tdouble3 posp1=(psingle? TDouble3(0): pos[p1]);
+          const float pressp1=press[p1];
+          const tsymatrix3f taup1=(lamsps? tau[p1]: gradvelp1);
+
+          for(unsigned b=0;b<nb;b++){
+            const float drx=(psingle? psposp1.x-bpspos[b].x: float(posp1.x-bpos[b].x));
+            const float dry=(psingle? psposp1.y-bpspos[b].y: float(posp1.y-bpos[b].y));
+            const float drz=(psingle? psposp1.z-bpspos[b].z: float(posp1.z-bpos[b].z));
+            const float rr2=drx*drx+dry*dry+drz*drz;
+            if(rr2<=Fourh2 && rr2>=ALMOSTZERO){
+              //-Cubic Spline, Wendland or Gaussian kernel.
+              float frx,fry,frz;
+              if(tker==KERNEL_Table)GetKernelTable(rr2,drx,dry,drz,frx,fry,frz);
+              else if(tker==KERNEL_Wendland)GetKernelWendland(rr2,drx,dry,drz,frx,fry,frz);
+              else if(tker==KERNEL_Gaussian)GetKernelGaussian(rr2,drx,dry,drz,frx,fry,frz);
+              else if(tker==KERNEL_Cubic)GetKernelCubic(rr2,drx,dry,drz,frx,fry,frz);
+              const float rhopp2=bvelrhop[b].w;
+              const float pressp2=bpress[b];
+
+              //===== Acceleration ===== 
+              {
+                const float prs=(pressp1+pressp2)/(rhopp1*rhopp2) + (tker==KERNEL_Cubic? GetKernelCubicTensil(rr2,rhopp1,pressp1,rhopp2,pressp2): (tker==KERNEL_Table && KerTableTensil? GetKernelTableTensil(rr2,rhopp1,pressp1,rhopp2,pressp2): 0));
+                const float p_vpm=-prs*massp2;
+                acep1.x+=p_vpm*frx; acep1.y+=p_vpm*fry; acep1.z+=p_vpm*frz;
+              }
+
+              //-Density derivative.
+              const float dvx=velp1.x-bvelrhop[b].x, dvy=velp1.y-bvelrhop[b].y, dvz=velp1.z-bvelrhop[b].z;
+              arp1+=massp2*(dvx*frx+dvy*fry+dvz*frz);
+
+              //-Density derivative (DeltaSPH Molteni).
+              if((tdelta==DELTA_Dynamic || tdelta==DELTA_DynamicExt) && deltap1!=FLT_MAX){
+                const float rhop1over2=rhopp1/rhopp2;
+                const float visc_densi=Delta2H*cbar*(rhop1over2-1.f)/(rr2+Eta2);
+                const float dot3=(drx*frx+dry*fry+drz*frz);
+                const float delta=visc_densi*dot3*massp2;
+                deltap1=(boundp2? FLT_MAX: deltap1+delta);
+              }
 
-            //===== Viscosity ===== 
-            if(compute){
+              //-Shifting correction.
+              if(shift && shiftposp1.x!=FLT_MAX){
+                const float massrhop=massp2/rhopp2;
+                const bool noshift=(boundp2 && (tshifting==SHIFT_NoBound || (tshifting==SHIFT_NoFixed && CODE_IsFixed(bcode[b]))));
+                shiftposp1.x=(noshift? FLT_MAX: shiftposp1.x+massrhop*frx); //-For boundary do not use shifting. | Con boundary anula shifting.
+                shiftposp1.y+=massrhop*fry;
+                shiftposp1.z+=massrhop*frz;
+                shiftdetectp1-=massrhop*(drx*frx+dry*fry+drz*frz);
+              }
+
+              //===== Viscosity ===== 
               const float dot=drx*dvx + dry*dvy + drz*dvz;
               const float dot_rr2=dot/(rr2+Eta2);
-              visc=max(dot_rr2,visc);
+              viscp1=max(dot_rr2,viscp1);
               if(!lamsps){//-Artificial viscosity.
                 if(dot<0){
                   const float amubar=H*dot_rr2;  //amubar=CTE.h*dot/(rr2+CTE.eta2);
-                  const float robar=(rhopp1+velrhop[p2].w)*0.5f;
-                  const float pi_visc=(-visco*cbar*amubar/robar)*massp2*ftmassp1;
+                  const float robar=(rhopp1+rhopp2)*0.5f;
+                  const float pi_visc=(-visco*cbar*amubar/robar)*massp2;
                   acep1.x-=pi_visc*frx; acep1.y-=pi_visc*fry; acep1.z-=pi_visc*frz;
                 }
               }
               else{//-Laminar+SPS viscosity. 
                 {//-Laminar contribution.
-                  const float robar2=(rhopp1+velrhop[p2].w);
-                  const float temp=4.f*visco/((rr2+Eta2)*robar2);  //-Simplification of: temp=2.0f*visco/((rr2+CTE.eta2)*robar); robar=(rhopp1+velrhop2.w)*0.5f;
+                  const float robar2=(rhopp1+rhopp2);
+                  const float temp=4.f*visco/((rr2+Eta2)*robar2);
                   const float vtemp=massp2*temp*(drx*frx+dry*fry+drz*frz);  
                   acep1.x+=vtemp*dvx; acep1.y+=vtemp*dvy; acep1.z+=vtemp*dvz;
                 }
                 //-SPS turbulence model.
-                float tau_xx=taup1.xx,tau_xy=taup1.xy,tau_xz=taup1.xz; //-taup1 is always zero when p1 is not a fluid particle. | taup1 siempre es cero cuando p1 no es fluid.
+                float tau_xx=taup1.xx,tau_xy=taup1.xy,tau_xz=taup1.xz;
                 float tau_yy=taup1.yy,tau_yz=taup1.yz,tau_zz=taup1.zz;
-                if(!boundp2 && !ftp2){//-When p2 is a fluid particle. 
-                  tau_xx+=tau[p2].xx; tau_xy+=tau[p2].xy; tau_xz+=tau[p2].xz;
-                  tau_yy+=tau[p2].yy; tau_yz+=tau[p2].yz; tau_zz+=tau[p2].zz;
+                if(!boundp2){//-When p2 is a fluid particle. 
+                  tau_xx+=btau[b].xx; tau_xy+=btau[b].xy; tau_xz+=btau[b].xz;
+                  tau_yy+=btau[b].yy; tau_yz+=btau[b].yz; tau_zz+=btau[b].zz;
                 }
-                acep1.x+=massp2*ftmassp1*(tau_xx*frx+tau_xy*fry+tau_xz*frz);
-                acep1.y+=massp2*ftmassp1*(tau_xy*frx+tau_yy*fry+tau_yz*frz);
-                acep1.z+=massp2*ftmassp1*(tau_xz*frx+tau_yz*fry+tau_zz*frz);
+                acep1.x+=massp2*(tau_xx*frx+tau_xy*fry+tau_xz*frz);
+                acep1.y+=massp2*(tau_xy*frx+tau_yy*fry+tau_yz*frz);
+                acep1.z+=massp2*(tau_xz*frx+tau_yz*fry+tau_zz*frz);
                 //-Velocity gradients.
-                if(!ftp1){//-When p1 is a fluid particle. 
-                  const float volp2=-massp2/velrhop[p2].w;
+                {
+                  const float volp2=-massp2/rhopp2;
                   float dv=dvx*volp2; gradvelp1.xx+=dv*frx; gradvelp1.xy+=dv*fry; gradvelp1.xz+=dv*frz;
                         dv=dvy*volp2; gradvelp1.xy+=dv*frx; gradvelp1.yy+=dv*fry; gradvelp1.yz+=dv*frz;
                         dv=dvz*volp2; gradvelp1.xz+=dv*frx; gradvelp1.yz+=dv*fry; gradvelp1.zz+=dv*frz;
-                  //-To compute tau terms we assume that gradvel.xy=gradvel.dudy+gradvel.dvdx, gradvel.xz=gradvel.dudz+gradvel.dwdx, gradvel.yz=gradvel.dvdz+gradvel.dwdy
-                  //-so only 6 elements are needed instead of 3x3.
                 }
               }
             }
           }
+          //-Sum results together. | Almacena resultados.
+          if(shift||arp1||acep1.x||acep1.y||acep1.z||viscp1){
+            if(tdelta==DELTA_Dynamic&&deltap1!=FLT_MAX)arp1+=deltap1;
+            if(tdelta==DELTA_DynamicExt)delta[p1]=(delta[p1]==FLT_MAX || deltap1==FLT_MAX? FLT_MAX: delta[p1]+deltap1);
+            ar[p1]+=arp1;
+            ace[p1]=ace[p1]+acep1;
+            visc=max(viscp1,visc);
+            if(lamsps){
+              gradvel[p1].xx+=gradvelp1.xx;
+              gradvel[p1].xy+=gradvelp1.xy;
+              gradvel[p1].xz+=gradvelp1.xz;
+              gradvel[p1].yy+=gradvelp1.yy;
+              gradvel[p1].yz+=gradvelp1.yz;
+              gradvel[p1].zz+=gradvelp1.zz;
+            }
+            if(shift && shiftpos[p1].x!=FLT_MAX){
+              shiftpos[p1]=(shiftposp1.x==FLT_MAX? TFloat3(FLT_MAX,0,0): shiftpos[p1]+shiftposp1);
+              if(shiftdetect)shiftdetect[p1]+=shiftdetectp1;
+            }
+          }
         }
       }
     }
-    //-Sum results together. | Almacena resultados.
-    if(shift||arp1||acep1.x||acep1.y||acep1.z||visc){
-      if(tdelta==DELTA_Dynamic&&deltap1!=FLT_MAX)arp1+=deltap1;
-      if(tdelta==DELTA_DynamicExt)delta[p1]=(delta[p1]==FLT_MAX || deltap1==FLT_MAX? FLT_MAX: delta[p1]+deltap1);
-      ar[p1]+=arp1;
-      ace[p1]=ace[p1]+acep1;
+    const int th=omp_get_thread_num();
+    if(visc>viscth[th*OMP_STRIDE])viscth[th*OMP_STRIDE]=visc;
+    delete[] bpos;
+    delete[] bpspos;
+    delete[] bvelrhop;
+    delete[] bpress;
+    delete[] bcode;
+    delete[] btau;
+  }
+  if(errmem)RunException(met,"Could not allocate the requested memory.");
+  //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
+  for(int th=0;th<OmpThreads;th++)if(viscdt<viscth[th*OMP_STRIDE])viscdt=viscth[th*OMP_STRIDE];
+}
+
+//==============================================================================
+/// Perform symmetric interaction Fluid-Fluid where each pair is computed only
+/// once and the result is applied to both particles (Newton's third law).
+/// The cells are grouped in slabs of hdiv cells along Z (or Y) and the slabs 
+/// are processed in two colours, so threads never update the same particles.
+/// Floating bodies are not supported.
+///
+/// Realiza interaccion simetrica Fluid-Fluid donde cada pareja se calcula solo
+/// una vez y el resultado se aplica a ambas particulas (tercera ley de Newton).
+/// Las celdas se agrupan en franjas de hdiv celdas segun Z (o Y) y las franjas
+/// se procesan en dos colores, de forma que los hilos nunca modifican las 
+/// mismas particulas. No admite floatings.
+//==============================================================================
+template<bool psingle,TpKernel tker,bool lamsps,TpDeltaSph tdelta,bool shift> void JSphCpu::InteractionForcesFluidSym
+  (tint4 nc,int hdiv,unsigned cellfluid,float visco
+  ,const unsigned *beginendcell
+  ,const tsymatrix3f* tau,tsymatrix3f* gradvel
+  ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhop
+  ,const float *press
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta
+  ,TpShifting tshifting,tfloat3 *shiftpos,float *shiftdetect)const
+{
+  //-Slab axis (Z or Y) and number of slabs. | Eje de las franjas (Z o Y) y numero de franjas.
+  const bool slabz=(nc.z>=nc.y);
+  const int na=(slabz? nc.z: nc.y);
+  const int nb=(slabz? nc.y: nc.z);
+  const int nslab=(na+hdiv-1)/hdiv;
+  //-Rows of cells ahead of the current cell (half stencil without the row of the cell).
+  //-Filas de celdas por delante de la celda actual (medio stencil sin la fila de la celda).
+  int rowdy[12],rowdz[12],nrows=0;
+  for(int da=0;da<=hdiv;da++)for(int db=(da? -hdiv: 1);db<=hdiv;db++){
+    rowdy[nrows]=(slabz? db: da);
+    rowdz[nrows]=(slabz? da: db);
+    nrows++;
+  }
+  const float cbar=(float)Cs0;
+  //-Initialize viscth to calculate viscdt maximo con OpenMP. | Inicializa viscth para calcular visdt maximo con OpenMP.
+  float viscth[OMP_MAXTHREADS*OMP_STRIDE];
+  for(int th=0;th<OmpThreads;th++)viscth[th*OMP_STRIDE]=0;
+  //-Even slabs first and then odd slabs. | Primero las franjas pares y despues las impares.
+  for(int colour=0;colour<2;colour++){
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (dynamic)
+    #endif
+    for(int cs=colour;cs<nslab;cs+=2){
+      float visc=0;
+      const int aini=cs*hdiv,afin=min(aini+hdiv,na);
+      for(int ca=aini;ca<afin;ca++)for(int cb=0;cb<nb;cb++){
+        const int cy=(slabz? cb: ca);
+        const int cz=(slabz? ca: cb);
+        const int rowcell=int(cellfluid+CellRow[cy+nc.y*cz]);
+        for(int cx=0;cx<nc.x;cx++){
+          const unsigned pcini=beginendcell[rowcell+cx];
+          const unsigned pcfin=beginendcell[rowcell+cx+1];
+          if(pcini<pcfin){
+            const int cxini=cx-min(cx,hdiv);
+            const int cxfin=cx+min(nc.x-cx-1,hdiv)+1;
+            const unsigned pownfin=beginendcell[rowcell+cxfin];
+            for(unsigned p1=pcini;p1<pcfin;p1++){
+              float arp1=0,deltap1=0;
+              tfloat3 acep1=TFloat3(0);
+              tsymatrix3f gradvelp1={0,0,0,0,0,0};
+              tfloat3 shiftposp1=TFloat3(0);
+              float shiftdetectp1=0;
+
+              //-Obtain data of particle p1.
+              const tfloat3 velp1=TFloat3(velrhop[p1].x,velrhop[p1].y,velrhop[p1].z);
+              const float rhopp1=velrhop[p1].w;
+              const tfloat3 psposp1=(psingle? pspos[p1]: TFloat3(0));
+              const tdouble3 posp1=(psingle? TDouble3(0): pos[p1]);
+              const float pressp1=press[p1];
+              const tsymatrix3f taup1=(lamsps? tau[p1]: gradvelp1);
+
+              //-Search for neighbours in the rest of the own row and in the rows ahead.
+              //-Busqueda de vecinos en el resto de la propia fila y en las filas por delante.
+              for(int r=-1;r<nrows;r++){
+                unsigned pini=p1+1,pfin=pownfin;
+                if(r>=0){
+                  const int y=cy+rowdy[r],z=cz+rowdz[r];
+                  if(y<0 || y>=nc.y || z<0 || z>=nc.z)continue;
+                  const int ymod=int(cellfluid+CellRow[y+nc.y*z]);
+                  pini=beginendcell[cxini+ymod];
+                  pfin=beginendcell[cxfin+ymod];
+                }
+
+                //-Interaction of Fluid with Fluid. | Interaccion de Fluid con Fluid.
+                //-------------------------------------------------------------------
+                for(unsigned p2=pini;p2<pfin;p2++){
+                  const float drx=(psingle? psposp1.x-pspos[p2].x: float(posp1.x-pos[p2].x));
+                  const float dry=(psingle? psposp1.y-pspos[p2].y: float(posp1.y-pos[p2].y));
+                  const float drz=(psingle? psposp1.z-pspos[p2].z: float(posp1.z-pos[p2].z));
+                  const float rr2=drx*drx+dry*dry+drz*drz;
+                  if(rr2<=Fourh2 && rr2>=ALMOSTZERO){
+                    //-Cubic Spline, Wendland or Gaussian kernel.
+                    float frx,fry,frz;
+                    if(tker==KERNEL_Table)GetKernelTable(rr2,drx,dry,drz,frx,fry,frz);
+                    else if(tker==KERNEL_Wendland)GetKernelWendland(rr2,drx,dry,drz,frx,fry,frz);
+                    else if(tker==KERNEL_Gaussian)GetKernelGaussian(rr2,drx,dry,drz,frx,fry,frz);
+                    else if(tker==KERNEL_Cubic)GetKernelCubic(rr2,drx,dry,drz,frx,fry,frz);
+                    const float rhopp2=velrhop[p2].w;
+                    const float pressp2=press[p2];
+
+                    //===== Acceleration (applied to p1 and with opposite sign to p2) ===== 
+                    const float prs=(pressp1+pressp2)/(rhopp1*rhopp2) + (tker==KERNEL_Cubic? GetKernelCubicTensil(rr2,rhopp1,pressp1,rhopp2,pressp2): (tker==KERNEL_Table && KerTableTensil? GetKernelTableTensil(rr2,rhopp1,pressp1,rhopp2,pressp2): 0));
+                    const float p_vpm=-prs*MassFluid;
+                    tfloat3 acep=TFloat3(p_vpm*frx,p_vpm*fry,p_vpm*frz);
+
+                    //-Density derivative.
+                    const float dvx=velp1.x-velrhop[p2].x, dvy=velp1.y-velrhop[p2].y, dvz=velp1.z-velrhop[p2].z;
+                    const float arp=MassFluid*(dvx*frx+dvy*fry+dvz*frz);
+                    arp1+=arp;
+                    float arp2=arp;
+
+                    //-Density derivative (DeltaSPH Molteni).
+                    if(tdelta==DELTA_Dynamic || tdelta==DELTA_DynamicExt){
+                      const float dot3=(drx*frx+dry*fry+drz*frz);
+                      const float visc_densi=Delta2H*cbar*dot3*MassFluid/(rr2+Eta2);
+                      deltap1+=visc_densi*(rhopp1/rhopp2-1.f);
+                      const float deltap2=visc_densi*(rhopp2/rhopp1-1.f);
+                      if(tdelta==DELTA_Dynamic)arp2+=deltap2;
+                      else delta[p2]+=deltap2;
+                    }
+
+                    //-Shifting correction.
+                    if(shift){
+                      const float massrhop1=MassFluid/rhopp1;
+                      const float massrhop2=MassFluid/rhopp2;
+                      const float dot3=(drx*frx+dry*fry+drz*frz);
+                      shiftposp1.x+=massrhop2*frx; shiftposp1.y+=massrhop2*fry; shiftposp1.z+=massrhop2*frz;
+                      shiftdetectp1-=massrhop2*dot3;
+                      shiftpos[p2].x-=massrhop1*frx; shiftpos[p2].y-=massrhop1*fry; shiftpos[p2].z-=massrhop1*frz;
+                      if(shiftdetect)shiftdetect[p2]-=massrhop1*dot3;
+                    }
+
+                    //===== Viscosity ===== 
+                    const float dot=drx*dvx + dry*dvy + drz*dvz;
+                    const float dot_rr2=dot/(rr2+Eta2);
+                    visc=max(dot_rr2,visc);
+                    if(!lamsps){//-Artificial viscosity.
+                      if(dot<0){
+                        const float amubar=H*dot_rr2;  //amubar=CTE.h*dot/(rr2+CTE.eta2);
+                        const float robar=(rhopp1+rhopp2)*0.5f;
+                        const float pi_visc=(-visco*cbar*amubar/robar)*MassFluid;
+                        acep.x-=pi_visc*frx; acep.y-=pi_visc*fry; acep.z-=pi_visc*frz;
+                      }
+                    }
+                    else{//-Laminar+SPS viscosity. 
+                      {//-Laminar contribution.
+                        const float robar2=(rhopp1+rhopp2);
+                        const float temp=4.f*visco/((rr2+Eta2)*robar2);
+                        const float vtemp=MassFluid*temp*(drx*frx+dry*fry+drz*frz);  
+                        acep.x+=vtemp*dvx; acep.y+=vtemp*dvy; acep.z+=vtemp*dvz;
+                      }
+                      //-SPS turbulence model.
+                      const float tau_xx=taup1.xx+tau[p2].xx,tau_xy=taup1.xy+tau[p2].xy,tau_xz=taup1.xz+tau[p2].xz;
+                      const float tau_yy=taup1.yy+tau[p2].yy,tau_yz=taup1.yz+tau[p2].yz,tau_zz=taup1.zz+tau[p2].zz;
+                      acep.x+=MassFluid*(tau_xx*frx+tau_xy*fry+tau_xz*frz);
+                      acep.y+=MassFluid*(tau_xy*frx+tau_yy*fry+tau_yz*frz);
+                      acep.z+=MassFluid*(tau_xz*frx+tau_yz*fry+tau_zz*frz);
+                      //-Velocity gradients (the sign of dv and fr changes for p2 so the product is the same).
+                      {
+                        const float volp2=-MassFluid/rhopp2;
+                        float dv=dvx*volp2; gradvelp1.xx+=dv*frx; gradvelp1.xy+=dv*fry; gradvelp1.xz+=dv*frz;
+                              dv=dvy*volp2; gradvelp1.xy+=dv*frx; gradvelp1.yy+=dv*fry; gradvelp1.yz+=dv*frz;
+                              dv=dvz*volp2; gradvelp1.xz+=dv*frx; gradvelp1.yz+=dv*fry; gradvelp1.zz+=dv*frz;
+                      }
+                      {
+                        const float volp1=-MassFluid/rhopp1;
+                        tsymatrix3f &gradvelp2=gradvel[p2];
+                        float dv=dvx*volp1; gradvelp2.xx+=dv*frx; gradvelp2.xy+=dv*fry; gradvelp2.xz+=dv*frz;
+                              dv=dvy*volp1; gradvelp2.xy+=dv*frx; gradvelp2.yy+=dv*fry; gradvelp2.yz+=dv*frz;
+                              dv=dvz*volp1; gradvelp2.xz+=dv*frx; gradvelp2.yz+=dv*fry; gradvelp2.zz+=dv*frz;
+                      }
+                    }
+                    //-Applies the contribution of the pair. | Aplica la contribucion de la pareja.
+                    acep1=acep1+acep;
+                    ace[p2]=ace[p2]-acep;
+                    ar[p2]+=arp2;
+                  }
+                }
+              }
+              //-Sum results together. | Almacena resultados.
+              if(tdelta==DELTA_Dynamic)arp1+=deltap1;
+              if(tdelta==DELTA_DynamicExt)delta[p1]+=deltap1;
+              ar[p1]+=arp1;
+              ace[p1]=ace[p1]+acep1;
+              if(lamsps){
+                gradvel[p1].xx+=gradvelp1.xx;
+                gradvel[p1].xy+=gradvelp1.xy;
+                gradvel[p1].xz+=gradvelp1.xz;
+                gradvel[p1].yy+=gradvelp1.yy;
+                gradvel[p1].yz+=gradvelp1.yz;
+                gradvel[p1].zz+=gradvelp1.zz;
+              }
+              if(shift){
+                shiftpos[p1]=shiftpos[p1]+shiftposp1;
+                if(shiftdetect)shiftdetect[p1]+=shiftdetectp1;
+              }
+            }
+          }
+        }
+      }
       const int th=omp_get_thread_num();
       if(visc>viscth[th*OMP_STRIDE])viscth[th*OMP_STRIDE]=visc;
-      if(lamsps){
-        gradvel[p1].xx+=gradvelp1.xx;
-        gradvel[p1].xy+=gradvelp1.xy;
-        gradvel[p1].xz+=gradvelp1.xz;
-        gradvel[p1].yy+=gradvelp1.yy;
-        gradvel[p1].yz+=gradvelp1.yz;
-        gradvel[p1].zz+=gradvelp1.zz;
-      }
-      if(shift && shiftpos[p1].x!=FLT_MAX){
-        shiftpos[p1]=(shiftposp1.x==FLT_MAX? TFloat3(FLT_MAX,0,0): shiftpos[p1]+shiftposp1);
-        if(shiftdetect)shiftdetect[p1]+=shiftdetectp1;
-      }
     }
   }
   //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
@@ -1082,9 +2039,9 @@ template<bool psingle> void JSphCpu::InteractionForcesDEM
       //-Search for neighbours in adjacent cells (first bound and then fluid+floating).
       for(unsigned cellinitial=0;cellinitial<=cellfluid;cellinitial+=cellfluid){
         for(int z=zini;z<zfin;z++){
-          const int zmod=(nc.w)*z+cellinitial; //-Sum from start of fluid or boundary cells. | Le suma donde empiezan las celdas de fluido o bound.
+          const unsigned *rowz=CellRow+nc.y*z; //-First cell of the rows of cells in z. | Primera celda de las filas de celdas en z.
           for(int y=yini;y<yfin;y++){
-            int ymod=zmod+nc.x*y;
+            int ymod=int(cellinitial+rowz[y]); //-Sum from start of fluid or boundary cells. | Le suma donde empiezan las celdas de fluido o bound.
             const unsigned pini=beginendcell[cxini+ymod];
             const unsigned pfin=beginendcell[cxfin+ymod];
 
@@ -1197,14 +2154,33 @@ template<bool psingle,TpKernel tker,TpFtMode ftmode,bool lamsps,TpDeltaSph tdelt
   const unsigned npf=np-npb;
   const tint4 nc=TInt4(int(ncells.x),int(ncells.y),int(ncells.z),int(ncells.x*ncells.y));
   const tint3 cellzero=TInt3(cellmin.x,cellmin.y,cellmin.z);
-  const unsigned cellfluid=nc.w*nc.z+1;
+  const unsigned cellfluid=CellRow[nc.y*nc.z]+1;
   const int hdiv=(CellMode==CELLMODE_H? 2: 1);
+  //-SIMD interaction (only Pos-Single, Wendland, artificial viscosity and without floatings or shifting).
+  const bool simd=(SimdMode!=SIMDMODE_None && psingle && tker==KERNEL_Wendland && ftmode==FTMODE_None && !lamsps && !shift);
+  //-Neighbour lists (NULL when interaction uses the cells). | Listas de vecinos (NULL cuando la interaccion usa las celdas).
+  const unsigned *nlbeginff=(NeighList? NeighList->GetBegin(JNeighbourListCpu::PASS_FluidFluid): NULL);
+  const unsigned *nlistff  =(NeighList? NeighList->GetList (JNeighbourListCpu::PASS_FluidFluid): NULL);
+  const unsigned *nlbeginfb=(NeighList? NeighList->GetBegin(JNeighbourListCpu::PASS_FluidBound): NULL);
+  const unsigned *nlistfb  =(NeighList? NeighList->GetList (JNeighbourListCpu::PASS_FluidBound): NULL);
+  const unsigned *nlbeginbf=(NeighList? NeighList->GetBegin(JNeighbourListCpu::PASS_BoundFluid): NULL);
+  const unsigned *nlistbf  =(NeighList? NeighList->GetList (JNeighbourListCpu::PASS_BoundFluid): NULL);
+  const unsigned *nlcur    =(NeighList? NeighList->GetCurPart(): NULL);
+  //-Chunks of balanced cost for the current cell division. | Trozos de coste equilibrado para la division en celdas actual.
+  if(CellBalance)CellBalance->Prepare(nc,hdiv,cellfluid,begincell,CellRow,CellRowInv,np,npb,npbok);
   
   if(npf){
     //-Interaction Fluid-Fluid.
-    InteractionForcesFluid<psingle,tker,ftmode,lamsps,tdelta,shift> (npf,npb,nc,hdiv,cellfluid,Visco                 ,begincell,cellzero,dcell,spstau,spsgradvel,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,tshifting,shiftpos,shiftdetect);
+    if(ftmode==FTMODE_None && Symmetry)InteractionForcesFluidSym<psingle,tker,lamsps,tdelta,shift> (nc,hdiv,cellfluid,Visco,begincell,spstau,spsgradvel,pos,pspos,velrhop,press,viscdt,ar,ace,delta,tshifting,shiftpos,shiftdetect);
+    else if(simd)cpusimd::InteractionForcesFluid(SimdMode,tdelta,SimdCte,SimdData,npf,npb,nc,hdiv,cellfluid,Visco,begincell,CellRow,cellzero,dcell,viscdt,ar,ace,delta);
+    else if(ftmode==FTMODE_None && CellTile)InteractionForcesFluidTile<psingle,tker,lamsps,tdelta,shift> (nc,hdiv,cellfluid,cellfluid,Visco,begincell,spstau,spsgradvel,pos,pspos,velrhop,code,press,viscdt,ar,ace,delta,tshifting,shiftpos,shiftdetect);
+    else if(CellBalance || NumaArrays)InteractionForcesFluidBal<psingle,tker,ftmode,lamsps,tdelta,shift> (npf,npb,nc,hdiv,cellfluid,Visco,begincell,cellzero,dcell,nlbeginff,nlistff,nlcur,spstau,spsgradvel,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,tshifting,shiftpos,shiftdetect);
+    else InteractionForcesFluid<psingle,tker,ftmode,lamsps,tdelta,shift> (npf,npb,nc,hdiv,cellfluid,Visco                 ,begincell,cellzero,dcell,nlbeginff,nlistff,nlcur,spstau,spsgradvel,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,tshifting,shiftpos,shiftdetect);
     //-Interaction Fluid-Bound.
-    InteractionForcesFluid<psingle,tker,ftmode,lamsps,tdelta,shift> (npf,npb,nc,hdiv,0        ,Visco*ViscoBoundFactor,begincell,cellzero,dcell,spstau,spsgradvel,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,tshifting,shiftpos,shiftdetect);
+    if(simd)cpusimd::InteractionForcesFluid(SimdMode,tdelta,SimdCte,SimdData,npf,npb,nc,hdiv,0,Visco*ViscoBoundFactor,begincell,CellRow,cellzero,dcell,viscdt,ar,ace,delta);
+    else if(ftmode==FTMODE_None && CellTile)InteractionForcesFluidTile<psingle,tker,lamsps,tdelta,shift> (nc,hdiv,cellfluid,0,Visco*ViscoBoundFactor,begincell,spstau,spsgradvel,pos,pspos,velrhop,code,press,viscdt,ar,ace,delta,tshifting,shiftpos,shiftdetect);
+    else if(CellBalance || NumaArrays)InteractionForcesFluidBal<psingle,tker,ftmode,lamsps,tdelta,shift> (npf,npb,nc,hdiv,0,Visco*ViscoBoundFactor,begincell,cellzero,dcell,nlbeginfb,nlistfb,nlcur,spstau,spsgradvel,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,tshifting,shiftpos,shiftdetect);
+    else InteractionForcesFluid<psingle,tker,ftmode,lamsps,tdelta,shift> (npf,npb,nc,hdiv,0        ,Visco*ViscoBoundFactor,begincell,cellzero,dcell,nlbeginfb,nlistfb,nlcur,spstau,spsgradvel,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,tshifting,shiftpos,shiftdetect);
 
     //-Interaction of DEM Floating-Bound & Floating-Floating. //(DEM)
     if(USE_DEM)InteractionForcesDEM<psingle> (CaseNfloat,nc,hdiv,cellfluid,begincell,cellzero,dcell,FtRidp,DemData,pos,pspos,velrhop,code,idp,viscdt,ace);
@@ -1214,7 +2190,9 @@ template<bool psingle,TpKernel tker,TpFtMode ftmode,bool lamsps,TpDeltaSph tdelt
   }
   if(npbok){
     //-Interaction Bound-Fluid.
-    InteractionForcesBound      <psingle,tker,ftmode> (npbok,0,nc,hdiv,cellfluid,begincell,cellzero,dcell,pos,pspos,velrhop,code,idp,viscdt,ar);
+    if(simd)cpusimd::InteractionForcesBound(SimdMode,SimdCte,SimdData,npbok,0,nc,hdiv,cellfluid,begincell,CellRow,cellzero,dcell,viscdt,ar);
+    else if(CellBalance || NumaArrays)InteractionForcesBoundBal<psingle,tker,ftmode> (npbok,0,nc,hdiv,cellfluid,begincell,cellzero,dcell,nlbeginbf,nlistbf,nlcur,pos,pspos,velrhop,code,idp,viscdt,ar);
+    else InteractionForcesBound <psingle,tker,ftmode> (npbok,0,nc,hdiv,cellfluid,begincell,cellzero,dcell,nlbeginbf,nlistbf,nlcur,pos,pspos,velrhop,code,idp,viscdt,ar);
   }
 }
 
@@ -1232,7 +2210,7 @@ void JSphCpu::Interaction_Forces(unsigned np,unsigned npb,unsigned npbok
 {
   tfloat3 *pspos=NULL;
   const bool psingle=false;
-  if(TKernel==KERNEL_Wendland){          const TpKernel tker=KERNEL_Wendland;
+  if(KerTableFac){                       const TpKernel tker=KERNEL_Table;
     if(!WithFloating){                   const TpFtMode ftmode=FTMODE_None;
       if(TShifting){                     const bool tshift=true;
         if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
@@ -1300,7 +2278,75 @@ void JSphCpu::Interaction_Forces(unsigned np,unsigned npb,unsigned npbok
         }
       }
     }
-  }else if(TKernel==KERNEL_Gaussian){    const TpKernel tker=KERNEL_Gaussian;
+  }else if(TKernel==KERNEL_Wendland){    const TpKernel tker=KERNEL_Wendland;
+    if(!WithFloating){                   const TpFtMode ftmode=FTMODE_None;
+      if(TShifting){                     const bool tshift=true;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }else{                             const bool tshift=false;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }
+    }else if(!UseDEM){                   const TpFtMode ftmode=FTMODE_Sph;
+      if(TShifting){                     const bool tshift=true;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }else{                             const bool tshift=false;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }
+    }else{                               const TpFtMode ftmode=FTMODE_Dem;
+      if(TShifting){                     const bool tshift=true;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }else{                             const bool tshift=false;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }
+    }
+  }else if(TKernel==KERNEL_Gaussian){    const TpKernel tker=KERNEL_Gaussian;
     if(!WithFloating){                   const TpFtMode ftmode=FTMODE_None;
       if(TShifting){                     const bool tshift=true;
         if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
@@ -1453,7 +2499,75 @@ void JSphCpu::InteractionSimple_Forces(unsigned np,unsigned npb,unsigned npbok
 {
   tdouble3 *pos=NULL;
   const bool psingle=true;
-  if(TKernel==KERNEL_Wendland){          const TpKernel tker=KERNEL_Wendland;
+  if(KerTableFac){                       const TpKernel tker=KERNEL_Table;
+    if(!WithFloating){                   const TpFtMode ftmode=FTMODE_None;
+      if(TShifting){                     const bool tshift=true;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }else{                             const bool tshift=false;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }
+    }else if(!UseDEM){                   const TpFtMode ftmode=FTMODE_Sph;
+      if(TShifting){                     const bool tshift=true;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }else{                             const bool tshift=false;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }
+    }else{                               const TpFtMode ftmode=FTMODE_Dem;
+      if(TShifting){                     const bool tshift=true;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }else{                             const bool tshift=false;
+        if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }else{                           const bool lamsps=false;
+          if(TDeltaSph==DELTA_None)      Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_None,tshift>       (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_Dynamic)   Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_Dynamic,tshift>    (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+          if(TDeltaSph==DELTA_DynamicExt)Interaction_ForcesT<psingle,tker,ftmode,lamsps,DELTA_DynamicExt,tshift> (np,npb,npbok,ncells,begincell,cellmin,dcell,pos,pspos,velrhop,code,idp,press,viscdt,ar,ace,delta,spstau,spsgradvel,TShifting,shiftpos,shiftdetect);
+        }
+      }
+    }
+  }else if(TKernel==KERNEL_Wendland){    const TpKernel tker=KERNEL_Wendland;
     if(!WithFloating){                   const TpFtMode ftmode=FTMODE_None;
       if(TShifting){                     const bool tshift=true;
         if(TVisco==VISCO_LaminarSPS){    const bool lamsps=true;
@@ -1786,6 +2900,81 @@ void JSphCpu::ComputeVelrhopBound(const tfloat4* velrhopold,double armul,tfloat4
   }
 }
 
+//==============================================================================
+/// Calculate new values of position, velocity & density for fluid (using Verlet)
+/// with CompactState. Previous values are obtained from velrhopm1 (when usem1) 
+/// and they are replaced by the current values, so the new values are stored 
+/// in velrhop.
+///
+/// Calcula nuevos valores de posicion, velocidad y densidad para el fluido 
+/// (usando Verlet) con CompactState. Los valores anteriores se obtienen de
+/// velrhopm1 (cuando usem1) y se sustituyen por los valores actuales, de modo
+/// que los nuevos valores se guardan en velrhop.
+//==============================================================================
+template<bool shift> void JSphCpu::ComputeVerletVarsFluidCompact(bool usem1,double dt,double dt2
+  ,tdouble3 *pos,unsigned *dcell,typecode *code,tfloat4 *velrhop,thalf4 *velrhopm1)const
+{
+  const double dt205=0.5*dt*dt;
+  const int pini=int(Npb),pfin=int(Np),npf=int(Np-Npb);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(npf>OMP_LIMIT_COMPUTESTEP)
+  #endif
+  for(int p=pini;p<pfin;p++){
+    const tfloat4 vr1=velrhop[p];
+    const tfloat4 vr2=(usem1? ExpandVelrhop(velrhopm1[p],vr1): vr1);
+    //-Calculate density. | Calcula densidad.
+    const float rhopnew=float(double(vr2.w)+dt2*Arc[p]);
+    tfloat4 vrnew;
+    if(!WithFloating || CODE_IsFluid(code[p])){//-Fluid Particles.
+      //-Calculate displacement and update position. | Calcula desplazamiento y actualiza posicion.
+      double dx=double(vr1.x)*dt + double(Acec[p].x)*dt205;
+      double dy=double(vr1.y)*dt + double(Acec[p].y)*dt205;
+      double dz=double(vr1.z)*dt + double(Acec[p].z)*dt205;
+      if(shift){
+        dx+=double(ShiftPosc[p].x);
+        dy+=double(ShiftPosc[p].y);
+        dz+=double(ShiftPosc[p].z);
+      }
+      bool outrhop=(rhopnew<RhopOutMin||rhopnew>RhopOutMax);
+      UpdatePos(pos[p],dx,dy,dz,outrhop,p,pos,dcell,code);
+      //-Update velocity & density. | Actualiza velocidad y densidad.
+      vrnew.x=float(double(vr2.x)+double(Acec[p].x)*dt2);
+      vrnew.y=float(double(vr2.y)+double(Acec[p].y)*dt2);
+      vrnew.z=float(double(vr2.z)+double(Acec[p].z)*dt2);
+      vrnew.w=rhopnew;
+    }
+    else{//-Floating Particles.
+      vrnew=vr1;
+      vrnew.w=(rhopnew<RhopZero? RhopZero: rhopnew); //-Avoid fluid particles being absorved by floating ones. | Evita q las floating absorvan a las fluidas.
+    }
+    //-Current values become previous values. | Los valores actuales pasan a ser los anteriores.
+    velrhopm1[p]=CompactVelrhop(vr1,vrnew);
+    velrhop[p]=vrnew;
+  }
+}
+
+//==============================================================================
+/// Calculate new values of density and set velocity=zero for boundary with 
+/// CompactState (see ComputeVerletVarsFluidCompact()).
+///
+/// Calcula nuevos valores de densidad y pone velocidad a cero para el contorno
+/// con CompactState (ver ComputeVerletVarsFluidCompact()).
+//==============================================================================
+void JSphCpu::ComputeVelrhopBoundCompact(bool usem1,double armul,tfloat4* velrhop,thalf4 *velrhopm1)const{
+  const int npb=int(Npb);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(npb>OMP_LIMIT_COMPUTESTEP)
+  #endif
+  for(int p=0;p<npb;p++){
+    const tfloat4 vr=velrhop[p];
+    const float rhopold=(usem1? ExpandVelrhop(velrhopm1[p],vr).w: vr.w);
+    const float rhopnew=float(double(rhopold)+armul*Arc[p]);
+    const tfloat4 vrnew=TFloat4(0,0,0,(rhopnew<RhopZero? RhopZero: rhopnew));//-Avoid fluid particles being absorved by boundary ones. | Evita q las boundary absorvan a las fluidas.
+    velrhopm1[p]=CompactVelrhop(vr,vrnew);
+    velrhop[p]=vrnew;
+  }
+}
+
 //==============================================================================
 /// Update of particles according to forces and dt using Verlet.
 /// Actualizacion de particulas segun fuerzas y dt usando Verlet.
@@ -1793,7 +2982,16 @@ void JSphCpu::ComputeVelrhopBound(const tfloat4* velrhopold,double armul,tfloat4
 void JSphCpu::ComputeVerlet(double dt){
   TmcStart(Timers,TMC_SuComputeStep);
   VerletStep++;
-  if(VerletStep<VerletSteps){
+  if(CompactState){
+    //-New values are calculated in Velrhopc and current ones are stored in VelrhopM1h. | Los nuevos valores se calculan en Velrhopc y los actuales se guardan en VelrhopM1h.
+    const bool usem1=(VerletStep<VerletSteps);
+    const double dt2=(usem1? dt+dt: dt);
+    if(TShifting)ComputeVerletVarsFluidCompact<true>  (usem1,dt,dt2,Posc,Dcellc,Codec,Velrhopc,VelrhopM1h);
+    else         ComputeVerletVarsFluidCompact<false> (usem1,dt,dt2,Posc,Dcellc,Codec,Velrhopc,VelrhopM1h);
+    ComputeVelrhopBoundCompact(usem1,dt2,Velrhopc,VelrhopM1h);
+    if(!usem1)VerletStep=0;
+  }
+  else if(VerletStep<VerletSteps){
     const double twodt=dt+dt;
     if(TShifting)ComputeVerletVarsFluid<true>  (Velrhopc,VelrhopM1c,dt,twodt,Posc,Dcellc,Codec,VelrhopM1c);
     else         ComputeVerletVarsFluid<false> (Velrhopc,VelrhopM1c,dt,twodt,Posc,Dcellc,Codec,VelrhopM1c);
@@ -1806,7 +3004,7 @@ void JSphCpu::ComputeVerlet(double dt){
     VerletStep=0;
   }
   //-New values are calculated en VelrhopM1c. | Los nuevos valores se calculan en VelrhopM1c.
-  swap(Velrhopc,VelrhopM1c);     //-Swap Velrhopc & VelrhopM1c. | Intercambia Velrhopc y VelrhopM1c.
+  if(!CompactState)swap(Velrhopc,VelrhopM1c); //-Swap Velrhopc & VelrhopM1c. | Intercambia Velrhopc y VelrhopM1c.
   TmcStop(Timers,TMC_SuComputeStep);
 }
 
@@ -1815,7 +3013,8 @@ void JSphCpu::ComputeVerlet(double dt){
 /// Actualizacion de particulas segun fuerzas y dt usando Symplectic-Predictor.
 //==============================================================================
 void JSphCpu::ComputeSymplecticPre(double dt){
-  if(TShifting)ComputeSymplecticPreT<false>(dt); //-We strongly recommend running the shifting correction only for the corrector. If you want to re-enable shifting in the predictor, change the value here to "true".
+  if(CompactState)ComputeSymplecticPreCompactT<false>(dt); //-Shifting is not applied in the predictor (see below).
+  else if(TShifting)ComputeSymplecticPreT<false>(dt); //-We strongly recommend running the shifting correction only for the corrector. If you want to re-enable shifting in the predictor, change the value here to "true".
   else         ComputeSymplecticPreT<false>(dt);
 }
 
@@ -1833,6 +3032,7 @@ template<bool shift> void JSphCpu::ComputeSymplecticPreT(double dt){
   swap(VelrhopPrec,Velrhopc); //Put value of Velrhop[] in VelrhopPre[]. | Es decir... VelrhopPre[] <= Velrhop[].
   //-Calculate new values of particles. | Calcula nuevos datos de particulas.
   const double dt05=dt*.5;
+  const double coeftfs=(Simulate2D? 2.0: 3.0)-ShiftTFS;
   
   //-Calculate new density for boundary and copy velocity. | Calcula nueva densidad para el contorno y copia velocidad.
   const int npb=int(Npb);
@@ -1854,14 +3054,16 @@ template<bool shift> void JSphCpu::ComputeSymplecticPreT(double dt){
     //-Calculate density.
     const float rhopnew=float(double(VelrhopPrec[p].w)+dt05*Arc[p]);
     if(!WithFloating || CODE_IsFluid(Codec[p])){//-Fluid Particles.
+      //-Shifting is computed here with FusedStep (instead of RunShifting()). | Shifting se calcula aqui con FusedStep (en lugar de RunShifting()).
+      const tfloat3 shiftpos=(!shift? TFloat3(0): (FusedStep? ComputeShiftPos(p,VelrhopPrec[p],dt05,coeftfs): ShiftPosc[p]));
       //-Calculate displacement & update position. | Calcula desplazamiento y actualiza posicion.
       double dx=double(VelrhopPrec[p].x)*dt05;
       double dy=double(VelrhopPrec[p].y)*dt05;
       double dz=double(VelrhopPrec[p].z)*dt05;
       if(shift){
-        dx+=double(ShiftPosc[p].x);
-        dy+=double(ShiftPosc[p].y);
-        dz+=double(ShiftPosc[p].z);
+        dx+=double(shiftpos.x);
+        dy+=double(shiftpos.y);
+        dz+=double(shiftpos.z);
       }
       bool outrhop=(rhopnew<RhopOutMin||rhopnew>RhopOutMax);
       UpdatePos(PosPrec[p],dx,dy,dz,outrhop,p,Posc,Dcellc,Codec);
@@ -1885,13 +3087,93 @@ template<bool shift> void JSphCpu::ComputeSymplecticPreT(double dt){
   TmcStop(Timers,TMC_SuComputeStep);
 }
 
+//==============================================================================
+/// Update of particles according to forces and dt using Symplectic-Predictor
+/// with CompactState. The new values are calculated in Posc and Velrhopc and
+/// the previous ones are stored as differences in PosPrecOff and VelrhopPrech.
+///
+/// Actualizacion de particulas segun fuerzas y dt usando Symplectic-Predictor
+/// con CompactState. Los nuevos valores se calculan en Posc y Velrhopc y los
+/// anteriores se guardan como diferencias en PosPrecOff y VelrhopPrech.
+//==============================================================================
+template<bool shift> void JSphCpu::ComputeSymplecticPreCompactT(double dt){
+  TmcStart(Timers,TMC_SuComputeStep);
+  //-Assign memory to variables Pre. | Asigna memoria a variables Pre.
+  PosPrecOff=ArraysCpu->ReserveFloat3();
+  VelrhopPrech=ArraysCpu->ReserveHalf4();
+  const double dt05=dt*.5;
+  const double coeftfs=(Simulate2D? 2.0: 3.0)-ShiftTFS;
+
+  //-Calculate new density for boundary and copy velocity. | Calcula nueva densidad para el contorno y copia velocidad.
+  const int npb=int(Npb);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(npb>OMP_LIMIT_COMPUTESTEP)
+  #endif
+  for(int p=0;p<npb;p++){
+    const tfloat4 vr=Velrhopc[p];
+    const float rhopnew=float(double(vr.w)+dt05*Arc[p]);
+    const tfloat4 vrnew=TFloat4(vr.x,vr.y,vr.z,(rhopnew<RhopZero? RhopZero: rhopnew));//-Avoid fluid particles being absorbed by boundary ones. | Evita q las boundary absorvan a las fluidas.
+    VelrhopPrech[p]=CompactVelrhop(vr,vrnew);
+    Velrhopc[p]=vrnew;
+    PosPrecOff[p]=TFloat3(0);
+  }
+
+  //-Calculate new values of fluid. | Calcula nuevos datos del fluido.
+  const int np=int(Np);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(np>OMP_LIMIT_COMPUTESTEP)
+  #endif
+  for(int p=npb;p<np;p++){
+    const tfloat4 vr=Velrhopc[p];
+    //-Calculate density.
+    const float rhopnew=float(double(vr.w)+dt05*Arc[p]);
+    tfloat4 vrnew;
+    if(!WithFloating || CODE_IsFluid(Codec[p])){//-Fluid Particles.
+      //-Shifting is computed here with FusedStep (instead of RunShifting()). | Shifting se calcula aqui con FusedStep (en lugar de RunShifting()).
+      const tfloat3 shiftpos=(!shift? TFloat3(0): (FusedStep? ComputeShiftPos(p,vr,dt05,coeftfs): ShiftPosc[p]));
+      //-Calculate displacement & update position. | Calcula desplazamiento y actualiza posicion.
+      double dx=double(vr.x)*dt05;
+      double dy=double(vr.y)*dt05;
+      double dz=double(vr.z)*dt05;
+      if(shift){
+        dx+=double(shiftpos.x);
+        dy+=double(shiftpos.y);
+        dz+=double(shiftpos.z);
+      }
+      bool outrhop=(rhopnew<RhopOutMin||rhopnew>RhopOutMax);
+      UpdatePos(Posc[p],dx,dy,dz,outrhop,p,Posc,Dcellc,Codec);
+      //-The displacement is stored instead of the difference of positions, which is wrong when periodic conditions move the particle. 
+      //-Se guarda el desplazamiento en lugar de la diferencia de posiciones, que es erronea cuando las condiciones periodicas mueven la particula.
+      PosPrecOff[p]=TFloat3(float(-dx),float(-dy),float(-dz));
+      //-Update velocity & density. | Actualiza velocidad y densidad.
+      vrnew.x=float(double(vr.x)+double(Acec[p].x)* dt05);
+      vrnew.y=float(double(vr.y)+double(Acec[p].y)* dt05);
+      vrnew.z=float(double(vr.z)+double(Acec[p].z)* dt05);
+      vrnew.w=rhopnew;
+    }
+    else{//-Floating Particles.
+      vrnew=vr;
+      vrnew.w=(rhopnew<RhopZero? RhopZero: rhopnew); //-Avoid fluid particles being absorbed by floating ones. | Evita q las floating absorvan a las fluidas.
+      //-Position is not changed here (see RunFloating()). | La posicion no cambia aqui (ver RunFloating()).
+      PosPrecOff[p]=TFloat3(0);
+    }
+    VelrhopPrech[p]=CompactVelrhop(vr,vrnew);
+    Velrhopc[p]=vrnew;
+  }
+  TmcStop(Timers,TMC_SuComputeStep);
+}
+
 //==============================================================================
 /// Update particles according to forces and dt using Symplectic-Corrector.
 /// Actualizacion de particulas segun fuerzas y dt usando Symplectic-Corrector.
 //==============================================================================
 void JSphCpu::ComputeSymplecticCorr(double dt){
-  if(TShifting)ComputeSymplecticCorrT<true> (dt);
-  else         ComputeSymplecticCorrT<false>(dt);
+  if(CompactState){
+    if(TShifting)ComputeSymplecticCorrCompactT<true> (dt);
+    else         ComputeSymplecticCorrCompactT<false>(dt);
+  }
+  else if(TShifting)ComputeSymplecticCorrT<true> (dt);
+  else              ComputeSymplecticCorrT<false>(dt);
 }
 
 //==============================================================================
@@ -1914,6 +3196,9 @@ template<bool shift> void JSphCpu::ComputeSymplecticCorrT(double dt){
 
   //-Calculate fluid values. | Calcula datos de fluido.
   const double dt05=dt*.5;
+  const double coeftfs=(Simulate2D? 2.0: 3.0)-ShiftTFS;
+  const bool damping=(FusedStep && Damping!=NULL);
+  const bool dampcode=(CaseNfloat || PeriActive); //-Floating and periodic particles are ignored by damping (see RunDamping()). | Las particulas floating y periodicas se descartan en damping (ver RunDamping()).
   const int np=int(Np);
   #ifdef OMP_USE
     #pragma omp parallel for schedule (static) if(np>OMP_LIMIT_COMPUTESTEP)
@@ -1922,6 +3207,8 @@ template<bool shift> void JSphCpu::ComputeSymplecticCorrT(double dt){
     const double epsilon_rdot=(-double(Arc[p])/double(Velrhopc[p].w))*dt;
     const float rhopnew=float(double(VelrhopPrec[p].w) * (2.-epsilon_rdot)/(2.+epsilon_rdot));
     if(!WithFloating || CODE_IsFluid(Codec[p])){//-Fluid Particles.
+      //-Shifting is computed here with FusedStep (instead of RunShifting()). | Shifting se calcula aqui con FusedStep (en lugar de RunShifting()).
+      const tfloat3 shiftpos=(!shift? TFloat3(0): (FusedStep? ComputeShiftPos(p,Velrhopc[p],dt,coeftfs): ShiftPosc[p]));
       //-Update velocity & density. | Actualiza velocidad y densidad.
       Velrhopc[p].x=float(double(VelrhopPrec[p].x) + double(Acec[p].x) * dt); 
       Velrhopc[p].y=float(double(VelrhopPrec[p].y) + double(Acec[p].y) * dt); 
@@ -1932,12 +3219,14 @@ template<bool shift> void JSphCpu::ComputeSymplecticCorrT(double dt){
       double dy=(double(VelrhopPrec[p].y)+double(Velrhopc[p].y)) * dt05; 
       double dz=(double(VelrhopPrec[p].z)+double(Velrhopc[p].z)) * dt05;
       if(shift){
-        dx+=double(ShiftPosc[p].x);
-        dy+=double(ShiftPosc[p].y);
-        dz+=double(ShiftPosc[p].z);
+        dx+=double(shiftpos.x);
+        dy+=double(shiftpos.y);
+        dz+=double(shiftpos.z);
       }
       bool outrhop=(rhopnew<RhopOutMin||rhopnew>RhopOutMax);
       UpdatePos(PosPrec[p],dx,dy,dz,outrhop,p,Posc,Dcellc,Codec);
+      //-Applies Damping with FusedStep (instead of RunDamping()). | Aplica Damping con FusedStep (en lugar de RunDamping()).
+      if(damping && (!dampcode || (CODE_IsNormal(Codec[p]) && CODE_IsFluid(Codec[p]))))Damping->ComputeDampingParticle(dt,Posc[p],Velrhopc[p]);
     }
     else{//-Floating Particles.
       Velrhopc[p]=VelrhopPrec[p];
@@ -1953,6 +3242,83 @@ template<bool shift> void JSphCpu::ComputeSymplecticCorrT(double dt){
   TmcStop(Timers,TMC_SuComputeStep);
 }
 
+//==============================================================================
+/// Update particles according to forces and dt using Symplectic-Corrector
+/// with CompactState. Values of predictor are obtained from the current ones
+/// plus PosPrecOff and VelrhopPrech.
+///
+/// Actualizacion de particulas segun fuerzas y dt usando Symplectic-Corrector
+/// con CompactState. Los valores del predictor se obtienen de los actuales mas
+/// PosPrecOff y VelrhopPrech.
+//==============================================================================
+template<bool shift> void JSphCpu::ComputeSymplecticCorrCompactT(double dt){
+  TmcStart(Timers,TMC_SuComputeStep);
+  
+  //-Calculate rhop of boudary and set velocity=0. | Calcula rhop de contorno y vel igual a cero.
+  const int npb=int(Npb);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(npb>OMP_LIMIT_COMPUTESTEP)
+  #endif
+  for(int p=0;p<npb;p++){
+    const tfloat4 vr=Velrhopc[p];
+    const double epsilon_rdot=(-double(Arc[p])/double(vr.w))*dt;
+    const float rhopnew=float(double(ExpandVelrhop(VelrhopPrech[p],vr).w) * (2.-epsilon_rdot)/(2.+epsilon_rdot));
+    Velrhopc[p]=TFloat4(0,0,0,(rhopnew<RhopZero? RhopZero: rhopnew));//-Avoid fluid particles being absorbed by boundary ones. | Evita q las boundary absorvan a las fluidas.
+  }
+
+  //-Calculate fluid values. | Calcula datos de fluido.
+  const double dt05=dt*.5;
+  const double coeftfs=(Simulate2D? 2.0: 3.0)-ShiftTFS;
+  const bool damping=(FusedStep && Damping!=NULL);
+  const bool dampcode=(CaseNfloat || PeriActive); //-Floating and periodic particles are ignored by damping (see RunDamping()). | Las particulas floating y periodicas se descartan en damping (ver RunDamping()).
+  const int np=int(Np);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(np>OMP_LIMIT_COMPUTESTEP)
+  #endif
+  for(int p=npb;p<np;p++){
+    const tfloat4 vr=Velrhopc[p];
+    const tfloat4 vrpre=ExpandVelrhop(VelrhopPrech[p],vr);
+    const tdouble3 pspre=Posc[p]+ToTDouble3(PosPrecOff[p]);
+    const double epsilon_rdot=(-double(Arc[p])/double(vr.w))*dt;
+    const float rhopnew=float(double(vrpre.w) * (2.-epsilon_rdot)/(2.+epsilon_rdot));
+    if(!WithFloating || CODE_IsFluid(Codec[p])){//-Fluid Particles.
+      //-Shifting is computed here with FusedStep (instead of RunShifting()). | Shifting se calcula aqui con FusedStep (en lugar de RunShifting()).
+      const tfloat3 shiftpos=(!shift? TFloat3(0): (FusedStep? ComputeShiftPos(p,vr,dt,coeftfs): ShiftPosc[p]));
+      //-Update velocity & density. | Actualiza velocidad y densidad.
+      tfloat4 vrnew;
+      vrnew.x=float(double(vrpre.x) + double(Acec[p].x) * dt); 
+      vrnew.y=float(double(vrpre.y) + double(Acec[p].y) * dt); 
+      vrnew.z=float(double(vrpre.z) + double(Acec[p].z) * dt); 
+      vrnew.w=rhopnew;
+      Velrhopc[p]=vrnew;
+      //-Calculate displacement and update position. | Calcula desplazamiento y actualiza posicion.
+      double dx=(double(vrpre.x)+double(vrnew.x)) * dt05; 
+      double dy=(double(vrpre.y)+double(vrnew.y)) * dt05; 
+      double dz=(double(vrpre.z)+double(vrnew.z)) * dt05;
+      if(shift){
+        dx+=double(shiftpos.x);
+        dy+=double(shiftpos.y);
+        dz+=double(shiftpos.z);
+      }
+      bool outrhop=(rhopnew<RhopOutMin||rhopnew>RhopOutMax);
+      UpdatePos(pspre,dx,dy,dz,outrhop,p,Posc,Dcellc,Codec);
+      //-Applies Damping with FusedStep (instead of RunDamping()). | Aplica Damping con FusedStep (en lugar de RunDamping()).
+      if(damping && (!dampcode || (CODE_IsNormal(Codec[p]) && CODE_IsFluid(Codec[p]))))Damping->ComputeDampingParticle(dt,Posc[p],Velrhopc[p]);
+    }
+    else{//-Floating Particles.
+      Velrhopc[p]=vrpre;
+      Velrhopc[p].w=(rhopnew<RhopZero? RhopZero: rhopnew); //-Avoid fluid particles being absorbed by floating ones. | Evita q las floating absorvan a las fluidas.
+      //-Copy position. | Copia posicion.
+      Posc[p]=pspre;
+    }
+  }
+
+  //-Free memory assigned to variables Pre and ComputeSymplecticPre(). | Libera memoria asignada a variables Pre en ComputeSymplecticPre().
+  ArraysCpu->Free(PosPrecOff);    PosPrecOff=NULL;
+  ArraysCpu->Free(VelrhopPrech);  VelrhopPrech=NULL;
+  TmcStop(Timers,TMC_SuComputeStep);
+}
+
 //==============================================================================
 /// Calculate variable Dt.
 /// Calcula un Dt variable.
@@ -1970,6 +3336,32 @@ double JSphCpu::DtVariable(bool final){
   return(dt);
 }
 
+//==============================================================================
+/// Returns final Shifting displacement of particle p according to its velocity
+/// before the update. It is used by RunShifting() and by the fused update.
+///
+/// Devuelve el desplazamiento final de Shifting de la particula p segun su
+/// velocidad antes de la actualizacion. Se usa en RunShifting() y en la 
+/// actualizacion fusionada.
+//==============================================================================
+tfloat3 JSphCpu::ComputeShiftPos(unsigned p,const tfloat4 &velrhop,double dt,double coeftfs)const{
+  double vx=double(velrhop.x);
+  double vy=double(velrhop.y);
+  double vz=double(velrhop.z);
+  double umagn=double(ShiftCoef)*double(H)*sqrt(vx*vx+vy*vy+vz*vz)*dt;
+  if(ShiftDetectc){
+    if(ShiftDetectc[p]<ShiftTFS)umagn=0;
+    else umagn*=(double(ShiftDetectc[p])-ShiftTFS)/coeftfs;
+  }
+  const tfloat3 shiftpos=ShiftPosc[p];
+  if(shiftpos.x==FLT_MAX)umagn=0; //-Zero shifting near boundary. | Anula shifting por proximidad del contorno.
+  const float maxdist=0.1f*float(Dp); //-Max shifting distance permitted (recommended).
+  const float shiftdistx=float(double(shiftpos.x)*umagn);
+  const float shiftdisty=float(double(shiftpos.y)*umagn);
+  const float shiftdistz=float(double(shiftpos.z)*umagn);
+  return(TFloat3((shiftdistx<maxdist? shiftdistx: maxdist),(shiftdisty<maxdist? shiftdisty: maxdist),(shiftdistz<maxdist? shiftdistz: maxdist)));
+}
+
 //==============================================================================
 /// Calculate final Shifting for particles' position.
 /// Calcula Shifting final para posicion de particulas.
@@ -1982,22 +3374,7 @@ void JSphCpu::RunShifting(double dt){
     #pragma omp parallel for schedule (static) if(npf>OMP_LIMIT_COMPUTELIGHT)
   #endif
   for(int p=pini;p<pfin;p++){
-    double vx=double(Velrhopc[p].x);
-    double vy=double(Velrhopc[p].y);
-    double vz=double(Velrhopc[p].z);
-    double umagn=double(ShiftCoef)*double(H)*sqrt(vx*vx+vy*vy+vz*vz)*dt;
-    if(ShiftDetectc){
-      if(ShiftDetectc[p]<ShiftTFS)umagn=0;
-      else umagn*=(double(ShiftDetectc[p])-ShiftTFS)/coeftfs;
-    }
-    if(ShiftPosc[p].x==FLT_MAX)umagn=0; //-Zero shifting near boundary. | Anula shifting por proximidad del contorno.
-    const float maxdist=0.1f*float(Dp); //-Max shifting distance permitted (recommended).
-    const float shiftdistx=float(double(ShiftPosc[p].x)*umagn);
-    const float shiftdisty=float(double(ShiftPosc[p].y)*umagn);
-    const float shiftdistz=float(double(ShiftPosc[p].z)*umagn);
-    ShiftPosc[p].x=(shiftdistx<maxdist? shiftdistx: maxdist);
-    ShiftPosc[p].y=(shiftdisty<maxdist? shiftdisty: maxdist);
-    ShiftPosc[p].z=(shiftdistz<maxdist? shiftdistz: maxdist);
+    ShiftPosc[p]=ComputeShiftPos(p,Velrhopc[p],dt,coeftfs);
   }
   TmcStop(Timers,TMC_SuShifting);
 }
@@ -2176,6 +3553,19 @@ void JSphCpu::ShowTimers(bool onlyfile){
   Log->Print("\n[CPU Timers]",mode);
   if(!SvTimers)Log->Print("none",mode);
   else for(unsigned c=0;c<TimerGetCount();c++)if(TimerIsActive(c))Log->Print(TimerToText(c),mode);
+  if(SvTimers && CellBalance)for(int th=0;th<CellBalance->GetOmpThreads();th++){
+    Log->Print(JSph::TimerToText(fun::PrintStr("CF-Thread%02d-Busy",th),float(CellBalance->GetBusyTime(th)*1000)),mode);
+    Log->Print(JSph::TimerToText(fun::PrintStr("CF-Thread%02d-Idle",th),float(CellBalance->GetIdleTime(th)*1000)),mode);
+  }
+  if(SvTimers && IncDivide){
+    const char* names[3]={"NL-DivideFull","NL-DivideInc","NL-DivideIncFallback"};
+    const unsigned ndiv[3]={CellDiv->GetNdivFull(),CellDiv->GetNdivInc(),CellDiv->GetNdivIncFail()};
+    for(unsigned c=0;c<3;c++){
+      string tx=names[c];
+      while(tx.length()<33)tx+=".";
+      Log->Print(tx+": "+fun::UintStr(ndiv[c])+" divides.",mode);
+    }
+  }
 }
 
 //==============================================================================
@@ -2187,6 +3577,14 @@ void JSphCpu::GetTimersInfo(std::string &hinfo,std::string &dinfo)const{
     hinfo=hinfo+";"+TimerGetName(c);
     dinfo=dinfo+";"+fun::FloatStr(TimerGetValue(c)/1000.f);
   }
+  if(SvTimers && CellBalance)for(int th=0;th<CellBalance->GetOmpThreads();th++){
+    hinfo=hinfo+";"+fun::PrintStr("CF-Thread%02d-Busy",th)+";"+fun::PrintStr("CF-Thread%02d-Idle",th);
+    dinfo=dinfo+";"+fun::FloatStr(float(CellBalance->GetBusyTime(th)))+";"+fun::FloatStr(float(CellBalance->GetIdleTime(th)));
+  }
+  if(SvTimers && IncDivide){
+    hinfo=hinfo+";NL-DivideFull;NL-DivideInc;NL-DivideIncFallback";
+    dinfo=dinfo+";"+fun::UintStr(CellDiv->GetNdivFull())+";"+fun::UintStr(CellDiv->GetNdivInc())+";"+fun::UintStr(CellDiv->GetNdivIncFail());
+  }
 }
 
 
@@ -24,11 +24,20 @@
 #include "Types.h"
 #include "JSphTimersCpu.h"
 #include "JSph.h"
+#include "JSphCpuSimd_ker.h"
+#include "FunctionsMath.h"
+#include "JMemoryTracker.h"
 #include <string>
 
+#define FUSED_BLOCKSIZE 1024 ///<Number of particles of each block in fused preparation of interaction. | Numero de particulas de cada bloque en la preparacion fusionada de la interaccion.
+#define FT_BLOCKSIZE 2048    ///<Number of floating particles of each block in the computation of floating forces. | Numero de particulas floating de cada bloque en el calculo de fuerzas de floatings.
+
 class JPartsOut;
 class JArraysCpu;
 class JCellDivCpu;
+class JNeighbourListCpu;
+class JCellBalanceCpu;
+class JNumaCpu;
 
 //##############################################################################
 //# JSphCpu
@@ -43,6 +52,26 @@ private:
 protected:
   int OmpThreads;        ///<Max number of OpenMP threads in execution on CPU host (minimum 1). | Numero maximo de hilos OpenMP en ejecucion por host en CPU (minimo 1).
   std::string RunMode;   ///<Overall mode of execution (symmetry, openmp, load balancing). |  Almacena modo de ejecucion (simetria,openmp,balanceo,...).
+  bool Symmetry;         ///<Fluid-Fluid interaction computes each pair only once (not with floating bodies). | La interaccion Fluid-Fluid calcula cada pareja una sola vez (no con floatings).
+  bool FusedInter;       ///<Preparation and reductions of interaction are computed in one sweep before and one after interaction. | La preparacion y reducciones de la interaccion se calculan en un barrido antes y otro despues de la interaccion.
+  bool CellTile;         ///<Fluid interaction is computed cell by cell with a local copy of neighbour cells (not with floating bodies). | La interaccion del fluido se calcula celda a celda con una copia local de las celdas vecinas (no con floatings).
+  TpSimdMode SimdMode;   ///<SIMD instructions used in particle interaction (SIMDMODE_None: scalar code). | Instrucciones SIMD usadas en la interaccion (SIMDMODE_None: codigo escalar).
+  JNeighbourListCpu *NeighList; ///<Neighbour list reused in several interactions (NULL when it is not used). | Lista de vecinos reutilizada en varias interacciones (NULL cuando no se usa).
+  JNumaCpu *Numa;        ///<NUMA topology and placement of threads and particle arrays (NULL when it is not used). | Topologia NUMA y ubicacion de hilos y arrays de particulas (NULL cuando no se usa).
+  bool HugePages;        ///<Large particle arrays use transparent huge pages (only Linux). | Los arrays de particulas grandes usan huge pages transparentes (solo Linux).
+  bool ArraysStats;      ///<Shows statistics of particle arrays at the end of execution. | Muestra estadisticas de los arrays de particulas al final de la ejecucion.
+  bool CompactState;     ///<Previous-step state of Verlet and Symplectic is stored as differences in reduced precision. | El estado del paso anterior de Verlet y Symplectic se guarda como diferencias en precision reducida.
+  bool FusedStep;        ///<Symplectic applies shifting, update of particles and damping in one sweep (instead of RunShifting() and RunDamping()). | Symplectic aplica shifting, actualizacion de particulas y damping en un solo recorrido (en lugar de RunShifting() y RunDamping()).
+  bool NumaArrays;       ///<Particle arrays are placed in the NUMA nodes of the threads that process them. | Los arrays de particulas se ubican en los nodos NUMA de los hilos que los procesan.
+  float IncDivide;       ///<Maximum fraction of fluid particles that changed cell to update the cell division incrementally (0:disabled). | Fraccion maxima de particulas fluid que cambiaron de celda para actualizar la division en celdas de forma incremental (0:desactivado).
+  TpCellSfc CellSfc;     ///<Space-filling curve used to order the rows of cells. | Curva de llenado del espacio usada para ordenar las filas de celdas.
+  bool CellSparse;       ///<Only the rows of cells with particles are stored in the cell division. | Solo se almacenan las filas de celdas con particulas en la division en celdas.
+  unsigned CellModeAuto;      ///<Number of steps measured with each cell mode (2H and H) to select the fastest one (0:disabled). | Numero de pasos medidos con cada modo de celdas (2H y H) para seleccionar el mas rapido (0:desactivado).
+  unsigned CellModeAutoNum;   ///<Number of steps executed in the automatic selection of cell mode. | Numero de pasos ejecutados en la seleccion automatica del modo de celdas.
+  double CellModeAutoTime[2]; ///<Runtime (ms) of the steps measured with cell modes 2H and H. | Tiempo de ejecucion (ms) de los pasos medidos con los modos de celdas 2H y H.
+  const unsigned *CellRow;    ///<First cell of each row of cells (cy+cz*ncy) in the cell division, the last value is the number of cells stored [nc.y*nc.z+1]. | Primera celda de cada fila de celdas (cy+cz*ncy) en la division en celdas, el ultimo valor es el numero de celdas almacenadas [nc.y*nc.z+1].
+  const unsigned *CellRowInv; ///<Row of cells (cy+cz*ncy) stored in each position of rows [nc.y*nc.z+1]. | Fila de celdas (cy+cz*ncy) almacenada en cada posicion de filas [nc.y*nc.z+1].
+  JCellBalanceCpu *CellBalance; ///<Distributes interaction in chunks of balanced cost with work stealing (NULL when it is not used). | Reparte la interaccion en trozos de coste equilibrado con robo de trabajo (NULL cuando no se usa).
 
   //-Number of particles in domain | Numero de particulas del dominio.
   unsigned Np;        ///<Total number of particles (including periodic duplicates). | Numero total de particulas (incluidas las duplicadas periodicas).
@@ -54,6 +83,10 @@ protected:
   unsigned NpfPerM1;  ///<Number of periodic floating-fluid particles (previous values). | Numero de particulas fluidas-floating periodicas (valores anteriores).
   unsigned NpbPerM1;  ///<Number of periodic boundary particles (previous values). | Numero de particulas contorno periodicas (valores anteriores).
 
+  bool PeriImage;             ///<Periodic boundaries are applied searching neighbours around the periodic images of each particle (no periodic duplicates). | Las condiciones periodicas se aplican buscando vecinos alrededor de las imagenes periodicas de cada particula (sin duplicadas periodicas).
+  unsigned PeriImgCount;      ///<Number of displacements of periodic images. | Numero de desplazamientos de imagenes periodicas.
+  tdouble3 PeriImgInc[26];    ///<Displacements of periodic images (combinations of PeriXinc, PeriYinc and PeriZinc). | Desplazamientos de imagenes periodicas (combinaciones de PeriXinc, PeriYinc y PeriZinc).
+
   bool WithFloating;
   bool BoundChanged;  ///<Indicates if selected boundary has changed since last call of divide. | Indica si el contorno seleccionado a cambiado desde el ultimo divide.
 
@@ -76,17 +109,24 @@ protected:
     
   //-Variables for compute step: VERLET. | Vars. para compute step: VERLET.
   tfloat4 *VelrhopM1c;  ///<Verlet: in order to keep previous values. | Verlet: para guardar valores anteriores.
+  thalf4 *VelrhopM1h;   ///<Verlet with CompactState: previous values minus current values in half precision. | Verlet con CompactState: valores anteriores menos valores actuales en media precision.
   int VerletStep;
 
   //-Variables for compute step: SYMPLECTIC. | Vars. para compute step: SYMPLECTIC.
   tdouble3 *PosPrec;    ///<Sympletic: in order to keep previous values. | Sympletic: para guardar valores en predictor.
   tfloat4 *VelrhopPrec;
+  tfloat3 *PosPrecOff;  ///<Sympletic with CompactState: values of predictor minus current positions. | Sympletic con CompactState: valores del predictor menos posiciones actuales.
+  thalf4 *VelrhopPrech; ///<Sympletic with CompactState: values of predictor minus current values in half precision. | Sympletic con CompactState: valores del predictor menos valores actuales en media precision.
   double DtPre;   
 
   //-Variables for floating bodies.
   unsigned *FtRidp;             ///<Identifier to access to the particles of the floating object [CaseNfloat].
   StFtoForces *FtoForces;       ///<Stores forces of floatings [FtCount].
   StFtoForcesRes *FtoForcesRes; ///<Stores data to update floatings [FtCount].
+  unsigned FtBlockCount;        ///<Number of blocks of floating particles (FT_BLOCKSIZE). | Numero de bloques de particulas floating (FT_BLOCKSIZE).
+  unsigned *FtBlockIni;         ///<First block of each floating object [FtCount+1]. | Primer bloque de cada floating [FtCount+1].
+  unsigned *FtBlockFt;          ///<Floating object of each block [FtBlockCount]. | Floating de cada bloque [FtBlockCount].
+  StFtoForces *FtoBlockForces;  ///<Partial sums of face and fomegaace of each block [FtBlockCount]. | Sumas parciales de face y fomegaace de cada bloque [FtBlockCount].
 
   //-Variables for computation of forces | Vars. para computo de fuerzas.
   tfloat3 *PsPosc;       ///<Position and prrhop for Pos-Single interaction | Posicion y prrhop para interaccion Pos-Single.
@@ -98,6 +138,12 @@ protected:
   tfloat3 *ShiftPosc;    ///<Particle displacement using Shifting.
   float *ShiftDetectc;   ///<Used to detect free surface with Shifting.
 
+  //-Variables for interaction with SIMD instructions. | Vars. para interaccion con instrucciones SIMD.
+  StSimdCte SimdCte;         ///<Constants for SIMD interaction. | Constantes para interaccion SIMD.
+  StSimdParticles SimdData;  ///<Particle data in SoA format for SIMD interaction (pointers to SimdMem). | Datos de particulas en formato SoA para interaccion SIMD (punteros a SimdMem).
+  unsigned SimdSize;         ///<Number of particles with memory in SimdMem. | Numero de particulas con memoria en SimdMem.
+  float *SimdMem;            ///<Memory for SimdData. | Memoria para SimdData.
+
   double VelMax;        ///<Maximum value of Vel[] sqrt(vel.x^2 + vel.y^2 + vel.z^2) computed in PreInteraction_Forces().
   double AceMax;        ///<Maximum value of Ace[] sqrt(ace.x^2 + ace.y^2 + ace.z^2) computed in Interaction_Forces().
   float ViscDtMax;      ///<Max value of ViscDt calculated in Interaction_Forces() / Valor maximo de ViscDt calculado en Interaction_Forces().
@@ -111,6 +157,10 @@ protected:
 
   TimersCpu Timers;
 
+  //-Timers also mark the phases of MemTrack (TmcStart() and TmcStop() use these methods in JSphCpu and derived classes).
+  //-Los timers tambien marcan las fases de MemTrack (TmcStart() y TmcStop() usan estos metodos en JSphCpu y clases derivadas).
+  void _TmcStart(TimersCpu vtimer,CsTypeTimerCPU ct)const{ ::_TmcStart(vtimer,ct); if(MemTrack)MemTrack->StartPhase(unsigned(ct)); }
+  void _TmcStop(TimersCpu vtimer,CsTypeTimerCPU ct)const{ ::_TmcStop(vtimer,ct); if(MemTrack)MemTrack->StopPhase(unsigned(ct)); }
 
   void InitVars();
 
@@ -120,29 +170,13 @@ protected:
   void AllocCpuMemoryParticles(unsigned np,float over);
 
   void ResizeCpuMemoryParticles(unsigned np);
+  void FreeSimdMemory();
+  void PrepareSimdData(unsigned np);
   void ReserveBasicArraysCpu();
+  void NumaPlaceArrays();
 
   bool CheckCpuParticlesSize(unsigned requirednp){ return(requirednp+PARTICLES_OVERMEMORY_MIN<=CpuParticlesSize); }
 
-  template<class T> T* TSaveArrayCpu(unsigned np,const T *datasrc)const;
-  word*        SaveArrayCpu(unsigned np,const word        *datasrc)const{ return(TSaveArrayCpu<word>       (np,datasrc)); }
-  unsigned*    SaveArrayCpu(unsigned np,const unsigned    *datasrc)const{ return(TSaveArrayCpu<unsigned>   (np,datasrc)); }
-  int*         SaveArrayCpu(unsigned np,const int         *datasrc)const{ return(TSaveArrayCpu<int>        (np,datasrc)); }
-  float*       SaveArrayCpu(unsigned np,const float       *datasrc)const{ return(TSaveArrayCpu<float>      (np,datasrc)); }
-  tfloat4*     SaveArrayCpu(unsigned np,const tfloat4     *datasrc)const{ return(TSaveArrayCpu<tfloat4>    (np,datasrc)); }
-  double*      SaveArrayCpu(unsigned np,const double      *datasrc)const{ return(TSaveArrayCpu<double>     (np,datasrc)); }
-  tdouble3*    SaveArrayCpu(unsigned np,const tdouble3    *datasrc)const{ return(TSaveArrayCpu<tdouble3>   (np,datasrc)); }
-  tsymatrix3f* SaveArrayCpu(unsigned np,const tsymatrix3f *datasrc)const{ return(TSaveArrayCpu<tsymatrix3f>(np,datasrc)); }
-  template<class T> void TRestoreArrayCpu(unsigned np,T *data,T *datanew)const;
-  void RestoreArrayCpu(unsigned np,word        *data,word        *datanew)const{ TRestoreArrayCpu<word>       (np,data,datanew); }
-  void RestoreArrayCpu(unsigned np,unsigned    *data,unsigned    *datanew)const{ TRestoreArrayCpu<unsigned>   (np,data,datanew); }
-  void RestoreArrayCpu(unsigned np,int         *data,int         *datanew)const{ TRestoreArrayCpu<int>        (np,data,datanew); }
-  void RestoreArrayCpu(unsigned np,float       *data,float       *datanew)const{ TRestoreArrayCpu<float>      (np,data,datanew); }
-  void RestoreArrayCpu(unsigned np,tfloat4     *data,tfloat4     *datanew)const{ TRestoreArrayCpu<tfloat4>    (np,data,datanew); }
-  void RestoreArrayCpu(unsigned np,double      *data,double      *datanew)const{ TRestoreArrayCpu<double>     (np,data,datanew); }
-  void RestoreArrayCpu(unsigned np,tdouble3    *data,tdouble3    *datanew)const{ TRestoreArrayCpu<tdouble3>   (np,data,datanew); }
-  void RestoreArrayCpu(unsigned np,tsymatrix3f *data,tsymatrix3f *datanew)const{ TRestoreArrayCpu<tsymatrix3f>(np,data,datanew); }
-
   llong GetAllocMemoryCpu()const;
   void PrintAllocMemory(llong mcpu)const;
 
@@ -160,7 +194,9 @@ protected:
   float CalcVelMaxSeq(unsigned np,const tfloat4* velrhop)const;
   float CalcVelMaxOmp(unsigned np,const tfloat4* velrhop)const;
 
+  void UpdateNeighbourList();
   void PreInteractionVars_Forces(TpInter tinter,unsigned np,unsigned npb);
+  float PreInteractionFused_Forces(unsigned np,unsigned npb,unsigned pvini);
   void PreInteraction_Forces(TpInter tinter);
   void PosInteraction_Forces();
 
@@ -168,26 +204,66 @@ protected:
   inline void GetKernelGaussian(float rr2,float drx,float dry,float drz,float &frx,float &fry,float &frz)const;
   inline void GetKernelCubic(float rr2,float drx,float dry,float drz,float &frx,float &fry,float &frz)const;
   inline float GetKernelCubicTensil(float rr2,float rhopp1,float pressp1,float rhopp2,float pressp2)const;
+  inline void GetKernelTable(float rr2,float drx,float dry,float drz,float &frx,float &fry,float &frz)const;
+  inline float GetKernelTableTensil(float rr2,float rhopp1,float pressp1,float rhopp2,float pressp2)const;
 
   inline void GetInteractionCells(unsigned rcell
     ,int hdiv,const tint4 &nc,const tint3 &cellzero
     ,int &cxini,int &cxfin,int &yini,int &yfin,int &zini,int &zfin)const;
+  inline bool GetPeriImage(unsigned cimg,const tdouble3 &pos,tdouble3 &posimg,unsigned &dcellimg)const;
 
   template<bool psingle,TpKernel tker,TpFtMode ftmode> void InteractionForcesBound
     (unsigned n,unsigned pini,tint4 nc,int hdiv,unsigned cellinitial
     ,const unsigned *beginendcell,tint3 cellzero,const unsigned *dcell
+    ,const unsigned *nlbegin,const unsigned *nlist,const unsigned *nlcur
     ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhopp,const typecode *code,const unsigned *id
     ,float &viscdt,float *ar)const;
 
   template<bool psingle,TpKernel tker,TpFtMode ftmode,bool lamsps,TpDeltaSph tdelta,bool shift> void InteractionForcesFluid
     (unsigned n,unsigned pini,tint4 nc,int hdiv,unsigned cellfluid,float visco
     ,const unsigned *beginendcell,tint3 cellzero,const unsigned *dcell
+    ,const unsigned *nlbegin,const unsigned *nlist,const unsigned *nlcur
+    ,const tsymatrix3f* tau,tsymatrix3f* gradvel
+    ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
+    ,const float *press
+    ,float &viscdt,float *ar,tfloat3 *ace,float *delta
+    ,TpShifting tshifting,tfloat3 *shiftpos,float *shiftdetect)const;
+
+  template<bool psingle,TpKernel tker,TpFtMode ftmode> void InteractionForcesBoundBal
+    (unsigned n,unsigned pini,tint4 nc,int hdiv,unsigned cellinitial
+    ,const unsigned *beginendcell,tint3 cellzero,const unsigned *dcell
+    ,const unsigned *nlbegin,const unsigned *nlist,const unsigned *nlcur
+    ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhopp,const typecode *code,const unsigned *id
+    ,float &viscdt,float *ar)const;
+
+  template<bool psingle,TpKernel tker,TpFtMode ftmode,bool lamsps,TpDeltaSph tdelta,bool shift> void InteractionForcesFluidBal
+    (unsigned n,unsigned pini,tint4 nc,int hdiv,unsigned cellinitial,float visco
+    ,const unsigned *beginendcell,tint3 cellzero,const unsigned *dcell
+    ,const unsigned *nlbegin,const unsigned *nlist,const unsigned *nlcur
     ,const tsymatrix3f* tau,tsymatrix3f* gradvel
     ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
     ,const float *press
     ,float &viscdt,float *ar,tfloat3 *ace,float *delta
     ,TpShifting tshifting,tfloat3 *shiftpos,float *shiftdetect)const;
 
+  template<bool psingle,TpKernel tker,bool lamsps,TpDeltaSph tdelta,bool shift> void InteractionForcesFluidTile
+    (tint4 nc,int hdiv,unsigned cellfluid,unsigned cellinitial,float visco
+    ,const unsigned *beginendcell
+    ,const tsymatrix3f* tau,tsymatrix3f* gradvel
+    ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhop,const typecode *code
+    ,const float *press
+    ,float &viscdt,float *ar,tfloat3 *ace,float *delta
+    ,TpShifting tshifting,tfloat3 *shiftpos,float *shiftdetect)const;
+
+  template<bool psingle,TpKernel tker,bool lamsps,TpDeltaSph tdelta,bool shift> void InteractionForcesFluidSym
+    (tint4 nc,int hdiv,unsigned cellfluid,float visco
+    ,const unsigned *beginendcell
+    ,const tsymatrix3f* tau,tsymatrix3f* gradvel
+    ,const tdouble3 *pos,const tfloat3 *pspos,const tfloat4 *velrhop
+    ,const float *press
+    ,float &viscdt,float *ar,tfloat3 *ace,float *delta
+    ,TpShifting tshifting,tfloat3 *shiftpos,float *shiftdetect)const;
+
   template<bool psingle> void InteractionForcesDEM
     (unsigned nfloat,tint4 nc,int hdiv,unsigned cellfluid
     ,const unsigned *beginendcell,tint3 cellzero,const unsigned *dcell
@@ -225,14 +301,29 @@ protected:
 
   template<bool shift> void ComputeVerletVarsFluid(const tfloat4 *velrhop1,const tfloat4 *velrhop2,double dt,double dt2,tdouble3 *pos,unsigned *cell,typecode *code,tfloat4 *velrhopnew)const;
   void ComputeVelrhopBound(const tfloat4* velrhopold,double armul,tfloat4* velrhopnew)const;
+  template<bool shift> void ComputeVerletVarsFluidCompact(bool usem1,double dt,double dt2,tdouble3 *pos,unsigned *cell,typecode *code,tfloat4 *velrhop,thalf4 *velrhopm1)const;
+  void ComputeVelrhopBoundCompact(bool usem1,double armul,tfloat4* velrhop,thalf4 *velrhopm1)const;
+
+  /// Returns the difference v-vref in half precision. | Devuelve la diferencia v-vref en media precision.
+  static thalf4 CompactVelrhop(const tfloat4 &v,const tfloat4 &vref){
+    thalf4 h={fmath::Float2Half(v.x-vref.x),fmath::Float2Half(v.y-vref.y),fmath::Float2Half(v.z-vref.z),fmath::Float2Half(v.w-vref.w)};
+    return(h);
+  }
+  /// Returns the value stored with CompactVelrhop() from the same vref. | Devuelve el valor guardado con CompactVelrhop() a partir del mismo vref.
+  static tfloat4 ExpandVelrhop(const thalf4 &h,const tfloat4 &vref){
+    return(TFloat4(vref.x+fmath::Half2Float(h.x),vref.y+fmath::Half2Float(h.y),vref.z+fmath::Half2Float(h.z),vref.w+fmath::Half2Float(h.w)));
+  }
 
   void ComputeVerlet(double dt);
   template<bool shift> void ComputeSymplecticPreT(double dt);
   void ComputeSymplecticPre(double dt);
   template<bool shift> void ComputeSymplecticCorrT(double dt);
+  template<bool shift> void ComputeSymplecticPreCompactT(double dt);
+  template<bool shift> void ComputeSymplecticCorrCompactT(double dt);
   void ComputeSymplecticCorr(double dt);
   double DtVariable(bool final);
 
+  inline tfloat3 ComputeShiftPos(unsigned p,const tfloat4 &velrhop,double dt,double coeftfs)const;
   void RunShifting(double dt);
 
   void CalcRidp(bool periactive,unsigned np,unsigned pini,unsigned idini,unsigned idfin,const typecode *code,const unsigned *idp,unsigned *ridp)const;
@@ -0,0 +1,98 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+/// \file JSphCpuSimd_avx2.cpp \brief Implements the particle interaction on CPU with AVX2 instructions.
+/// This file is compiled for the AVX2 instruction set, which is only used when the CPU supports it.
+
+#include "JSphCpuSimd_ker.h"
+
+#ifdef CPUSIMD_AVX2
+#if defined(__clang__)
+  #pragma clang attribute push(__attribute__((target("avx2,fma"))),apply_to=function)
+#elif defined(__GNUC__)
+  #pragma GCC target("avx2,fma")
+#endif
+
+#include <immintrin.h>
+#include "JSphCpuSimd_kerT.h"
+
+namespace cpusimd{
+
+/// SIMD operations with AVX2 (8 floats).
+struct StSimdAvx2{
+  typedef __m256 vf;  ///<Vector of floats.
+  typedef __m256 vm;  ///<Mask of lanes.
+  static const unsigned W=8;
+  static inline vf zero(){ return(_mm256_setzero_ps()); }
+  static inline vf set1(float v){ return(_mm256_set1_ps(v)); }
+  static inline vf load(const float *p){ return(_mm256_loadu_ps(p)); }
+  static inline vf add(vf a,vf b){ return(_mm256_add_ps(a,b)); }
+  static inline vf sub(vf a,vf b){ return(_mm256_sub_ps(a,b)); }
+  static inline vf mul(vf a,vf b){ return(_mm256_mul_ps(a,b)); }
+  static inline vf div(vf a,vf b){ return(_mm256_div_ps(a,b)); }
+  static inline vf sqrt(vf a){ return(_mm256_sqrt_ps(a)); }
+  static inline vf max(vf a,vf b){ return(_mm256_max_ps(a,b)); }
+  static inline vm cmple(vf a,vf b){ return(_mm256_cmp_ps(a,b,_CMP_LE_OQ)); }
+  static inline vm cmpge(vf a,vf b){ return(_mm256_cmp_ps(a,b,_CMP_GE_OQ)); }
+  static inline vm cmplt(vf a,vf b){ return(_mm256_cmp_ps(a,b,_CMP_LT_OQ)); }
+  static inline vm mand(vm a,vm b){ return(_mm256_and_ps(a,b)); }
+  static inline bool any(vm m){ return(_mm256_movemask_ps(m)!=0); }
+  ///Returns v in the active lanes and 0 in the others.
+  static inline vf maskz(vm m,vf v){ return(_mm256_and_ps(m,v)); }
+  ///Returns b in the active lanes and a in the others.
+  static inline vf blend(vm m,vf a,vf b){ return(_mm256_blendv_ps(a,b,m)); }
+  ///Returns mask with the first nv lanes active.
+  static inline vm lanes(unsigned nv){ 
+    const __m256i v=_mm256_set1_epi32(int(nv<W? nv: W));
+    return(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v,_mm256_setr_epi32(0,1,2,3,4,5,6,7))));
+  }
+  static inline float hsum(vf a){ float v[W]; _mm256_storeu_ps(v,a); return(((v[0]+v[1])+(v[2]+v[3]))+((v[4]+v[5])+(v[6]+v[7]))); }
+  static inline float hmax(vf a){ float v[W]; _mm256_storeu_ps(v,a); float r=v[0]; for(unsigned c=1;c<W;c++)if(r<v[c])r=v[c]; return(r); }
+};
+
+//==============================================================================
+/// Interaction Fluid-Fluid or Fluid-Bound with AVX2 instructions.
+/// Interaccion Fluid-Fluid o Fluid-Bound con instrucciones AVX2.
+//==============================================================================
+void InteractionForcesFluid_Avx2(TpDeltaSph tdelta,const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial,float visco
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta)
+{
+  InteractionForcesFluidS<StSimdAvx2>(tdelta,cte,pdata,n,pinit,nc,hdiv,cellinitial,visco,beginendcell,cellrow,cellzero,dcell,viscdt,ar,ace,delta);
+}
+
+//==============================================================================
+/// Interaction Bound-Fluid with AVX2 instructions.
+/// Interaccion Bound-Fluid con instrucciones AVX2.
+//==============================================================================
+void InteractionForcesBound_Avx2(const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar)
+{
+  InteractionForcesBoundT<StSimdAvx2>(cte,pdata,n,pinit,nc,hdiv,cellinitial,beginendcell,cellrow,cellzero,dcell,viscdt,ar);
+}
+
+}
+
+#if defined(__clang__)
+  #pragma clang attribute pop
+#endif
+#endif
+
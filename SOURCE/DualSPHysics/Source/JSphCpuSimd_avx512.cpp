@@ -0,0 +1,96 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+/// \file JSphCpuSimd_avx512.cpp \brief Implements the particle interaction on CPU with AVX-512 instructions.
+/// This file is compiled for the AVX-512 instruction set, which is only used when the CPU supports it.
+
+#include "JSphCpuSimd_ker.h"
+
+#ifdef CPUSIMD_AVX512
+#if defined(__clang__)
+  #pragma clang attribute push(__attribute__((target("avx512f"))),apply_to=function)
+#elif defined(__GNUC__)
+  #pragma GCC target("avx512f")
+#endif
+
+#include <immintrin.h>
+#include "JSphCpuSimd_kerT.h"
+
+namespace cpusimd{
+
+/// SIMD operations with AVX-512 (16 floats).
+struct StSimdAvx512{
+  typedef __m512 vf;     ///<Vector of floats.
+  typedef __mmask16 vm;  ///<Mask of lanes.
+  static const unsigned W=16;
+  static inline vf zero(){ return(_mm512_setzero_ps()); }
+  static inline vf set1(float v){ return(_mm512_set1_ps(v)); }
+  static inline vf load(const float *p){ return(_mm512_loadu_ps(p)); }
+  static inline vf add(vf a,vf b){ return(_mm512_add_ps(a,b)); }
+  static inline vf sub(vf a,vf b){ return(_mm512_sub_ps(a,b)); }
+  static inline vf mul(vf a,vf b){ return(_mm512_mul_ps(a,b)); }
+  static inline vf div(vf a,vf b){ return(_mm512_div_ps(a,b)); }
+  //-Masked forms with a zero source since the unmasked ones use an undefined source (-Wmaybe-uninitialized with GCC).
+  static inline vf sqrt(vf a){ return(_mm512_mask_sqrt_ps(_mm512_setzero_ps(),0xFFFF,a)); }
+  static inline vf max(vf a,vf b){ return(_mm512_mask_max_ps(_mm512_setzero_ps(),0xFFFF,a,b)); }
+  static inline vm cmple(vf a,vf b){ return(_mm512_cmp_ps_mask(a,b,_CMP_LE_OQ)); }
+  static inline vm cmpge(vf a,vf b){ return(_mm512_cmp_ps_mask(a,b,_CMP_GE_OQ)); }
+  static inline vm cmplt(vf a,vf b){ return(_mm512_cmp_ps_mask(a,b,_CMP_LT_OQ)); }
+  static inline vm mand(vm a,vm b){ return(vm(a&b)); }
+  static inline bool any(vm m){ return(m!=0); }
+  ///Returns v in the active lanes and 0 in the others.
+  static inline vf maskz(vm m,vf v){ return(_mm512_maskz_mov_ps(m,v)); }
+  ///Returns b in the active lanes and a in the others.
+  static inline vf blend(vm m,vf a,vf b){ return(_mm512_mask_blend_ps(m,a,b)); }
+  ///Returns mask with the first nv lanes active.
+  static inline vm lanes(unsigned nv){ return(vm(nv<W? (1u<<nv)-1: 0xFFFFu)); }
+  static inline float hsum(vf a){ float v[W]; _mm512_storeu_ps(v,a); float r=0; for(unsigned c=0;c<W;c+=4)r+=((v[c]+v[c+1])+(v[c+2]+v[c+3])); return(r); }
+  static inline float hmax(vf a){ float v[W]; _mm512_storeu_ps(v,a); float r=v[0]; for(unsigned c=1;c<W;c++)if(r<v[c])r=v[c]; return(r); }
+};
+
+//==============================================================================
+/// Interaction Fluid-Fluid or Fluid-Bound with AVX-512 instructions.
+/// Interaccion Fluid-Fluid o Fluid-Bound con instrucciones AVX-512.
+//==============================================================================
+void InteractionForcesFluid_Avx512(TpDeltaSph tdelta,const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial,float visco
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta)
+{
+  InteractionForcesFluidS<StSimdAvx512>(tdelta,cte,pdata,n,pinit,nc,hdiv,cellinitial,visco,beginendcell,cellrow,cellzero,dcell,viscdt,ar,ace,delta);
+}
+
+//==============================================================================
+/// Interaction Bound-Fluid with AVX-512 instructions.
+/// Interaccion Bound-Fluid con instrucciones AVX-512.
+//==============================================================================
+void InteractionForcesBound_Avx512(const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar)
+{
+  InteractionForcesBoundT<StSimdAvx512>(cte,pdata,n,pinit,nc,hdiv,cellinitial,beginendcell,cellrow,cellzero,dcell,viscdt,ar);
+}
+
+}
+
+#if defined(__clang__)
+  #pragma clang attribute pop
+#endif
+#endif
+
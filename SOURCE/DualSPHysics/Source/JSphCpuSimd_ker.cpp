@@ -0,0 +1,99 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+/// \file JSphCpuSimd_ker.cpp \brief Implements the detection of SIMD instructions and the selection of SIMD functions for the particle interaction on CPU.
+
+#include "JSphCpuSimd_ker.h"
+#if defined(_MSC_VER) && defined(CPUSIMD_AVX2)
+  #include <intrin.h>
+#endif
+
+namespace cpusimd{
+
+//==============================================================================
+/// Returns the best SIMD instruction set supported by the CPU and the OS.
+/// Devuelve el mejor juego de instrucciones SIMD soportado por la CPU y el SO.
+//==============================================================================
+TpSimdMode GetSimdModeCpu(){
+  TpSimdMode simd=SIMDMODE_None;
+#ifdef CPUSIMD_AVX2
+  #ifdef _MSC_VER
+    int info[4];
+    __cpuid(info,0);
+    const int nids=info[0];
+    __cpuid(info,1);
+    const bool osxsave=((info[2]&(1<<27))!=0);
+    const bool fma=((info[2]&(1<<12))!=0);
+    if(osxsave && nids>=7){
+      const unsigned long long xcr0=_xgetbv(0);
+      __cpuidex(info,7,0);
+      const bool avx2=((info[1]&(1<<5))!=0);
+      const bool avx512f=((info[1]&(1<<16))!=0);
+      if(avx2 && fma && (xcr0&6)==6)simd=SIMDMODE_Avx2;
+      #ifdef CPUSIMD_AVX512
+        if(simd==SIMDMODE_Avx2 && avx512f && (xcr0&0xe6)==0xe6)simd=SIMDMODE_Avx512;
+      #endif
+    }
+  #else
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))simd=SIMDMODE_Avx2;
+    #ifdef CPUSIMD_AVX512
+      if(simd==SIMDMODE_Avx2 && __builtin_cpu_supports("avx512f"))simd=SIMDMODE_Avx512;
+    #endif
+  #endif
+#endif
+  return(simd);
+}
+
+//==============================================================================
+/// Interaction Fluid-Fluid or Fluid-Bound using the selected SIMD instructions.
+/// Interaccion Fluid-Fluid o Fluid-Bound usando las instrucciones SIMD seleccionadas.
+//==============================================================================
+void InteractionForcesFluid(TpSimdMode simd,TpDeltaSph tdelta,const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial,float visco
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta)
+{
+#ifdef CPUSIMD_AVX512
+  if(simd==SIMDMODE_Avx512)InteractionForcesFluid_Avx512(tdelta,cte,pdata,n,pinit,nc,hdiv,cellinitial,visco,beginendcell,cellrow,cellzero,dcell,viscdt,ar,ace,delta);
+#endif
+#ifdef CPUSIMD_AVX2
+  if(simd==SIMDMODE_Avx2)InteractionForcesFluid_Avx2(tdelta,cte,pdata,n,pinit,nc,hdiv,cellinitial,visco,beginendcell,cellrow,cellzero,dcell,viscdt,ar,ace,delta);
+#endif
+}
+
+//==============================================================================
+/// Interaction Bound-Fluid using the selected SIMD instructions.
+/// Interaccion Bound-Fluid usando las instrucciones SIMD seleccionadas.
+//==============================================================================
+void InteractionForcesBound(TpSimdMode simd,const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar)
+{
+#ifdef CPUSIMD_AVX512
+  if(simd==SIMDMODE_Avx512)InteractionForcesBound_Avx512(cte,pdata,n,pinit,nc,hdiv,cellinitial,beginendcell,cellrow,cellzero,dcell,viscdt,ar);
+#endif
+#ifdef CPUSIMD_AVX2
+  if(simd==SIMDMODE_Avx2)InteractionForcesBound_Avx2(cte,pdata,n,pinit,nc,hdiv,cellinitial,beginendcell,cellrow,cellzero,dcell,viscdt,ar);
+#endif
+}
+
+}
+
+
@@ -0,0 +1,99 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+/// \file JSphCpuSimd_ker.h \brief Declares functions for the particle interaction on CPU using SIMD instructions (AVX2 and AVX-512).
+
+#ifndef _JSphCpuSimd_ker_
+#define _JSphCpuSimd_ker_
+
+#include "Types.h"
+
+//-Instruction sets that can be compiled. | Juegos de instrucciones que se pueden compilar.
+#if defined(__x86_64__) || defined(_M_X64)
+  #define CPUSIMD_AVX2    ///<Enables/disables the AVX2 code.
+  #if !defined(_MSC_VER) || _MSC_VER>=1910
+    #define CPUSIMD_AVX512  ///<Enables/disables the AVX-512 code (not available with Visual Studio 2013).
+  #endif
+#endif
+
+#define CPUSIMD_PAD 16    ///<Padding of SoA arrays (maximum SIMD width in floats). | Relleno de los arrays SoA (maximo ancho SIMD en floats).
+
+/// Structure with constants for the particle interaction with SIMD instructions.
+typedef struct{
+  float h;          ///<Smoothing length.
+  float fourh2;     ///<fourh2=h*h*4
+  float eta2;       ///<eta2=(h*0.1)*(h*0.1)
+  float bwen;       ///<Cte. of Wendland kernel to compute fac (kernel derivative).
+  float cs0;        ///<Speed of sound of reference.
+  float delta2h;    ///<delta2h=DeltaSph*H*2
+  float massb;      ///<Mass of a boundary particle.
+  float massf;      ///<Mass of a fluid particle.
+  unsigned cellcode;///<Key for encoding cell position within the Domain.
+  int ompthreads;   ///<Number of OpenMP threads.
+}StSimdCte;
+
+/// Structure with pointers to particle data in SoA format (streams of size np+CPUSIMD_PAD).
+typedef struct{
+  const float *posx,*posy,*posz;
+  const float *velx,*vely,*velz;
+  const float *rhop;
+  const float *press;
+}StSimdParticles;
+
+/// Implements a set of functions for the particle interaction on CPU with SIMD instructions.
+namespace cpusimd{
+
+TpSimdMode GetSimdModeCpu();
+
+void InteractionForcesFluid(TpSimdMode simd,TpDeltaSph tdelta,const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial,float visco
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta);
+
+void InteractionForcesBound(TpSimdMode simd,const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar);
+
+#ifdef CPUSIMD_AVX2
+void InteractionForcesFluid_Avx2(TpDeltaSph tdelta,const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial,float visco
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta);
+void InteractionForcesBound_Avx2(const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar);
+#endif
+
+#ifdef CPUSIMD_AVX512
+void InteractionForcesFluid_Avx512(TpDeltaSph tdelta,const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial,float visco
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta);
+void InteractionForcesBound_Avx512(const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar);
+#endif
+
+}
+
+#endif
+
+
@@ -0,0 +1,316 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2017 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/). 
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics. 
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License 
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+ 
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details. 
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>. 
+*/
+
+/// \file JSphCpuSimd_kerT.h \brief Implements the templates of particle interaction with SIMD instructions.
+/// This file is only included by the source files of each instruction set (JSphCpuSimd_avx2.cpp and 
+/// JSphCpuSimd_avx512.cpp), which are compiled for that instruction set. The class S defines the 
+/// SIMD operations (S::W values per operation). Inline functions of other headers must not be used
+/// here because they would be compiled with the extended instruction set.
+
+#ifndef _JSphCpuSimd_kerT_
+#define _JSphCpuSimd_kerT_
+
+#include "JSphCpuSimd_ker.h"
+#include "OmpDefs.h"
+#include <cfloat>
+
+namespace cpusimd{
+
+//==============================================================================
+/// Returns the minimum of two integers.
+//==============================================================================
+static inline int SimdMin(int a,int b){ return(a<b? a: b); }
+
+//==============================================================================
+/// Return cell limits for interaction starting from cell coordinates.
+/// Devuelve limites de celdas para interaccion a partir de coordenadas de celda.
+//==============================================================================
+static inline void SimdInteractionCells(unsigned rcell,unsigned cellcode
+  ,int hdiv,const tint4 &nc,const tint3 &cellzero
+  ,int &cxini,int &cxfin,int &yini,int &yfin,int &zini,int &zfin)
+{
+  const int cx=PC__Cellx(cellcode,rcell)-cellzero.x;
+  const int cy=PC__Celly(cellcode,rcell)-cellzero.y;
+  const int cz=PC__Cellz(cellcode,rcell)-cellzero.z;
+  cxini=cx-SimdMin(cx,hdiv);
+  cxfin=cx+SimdMin(nc.x-cx-1,hdiv)+1;
+  yini=cy-SimdMin(cy,hdiv);
+  yfin=cy+SimdMin(nc.y-cy-1,hdiv)+1;
+  zini=cz-SimdMin(cz,hdiv);
+  zfin=cz+SimdMin(nc.z-cz-1,hdiv)+1;
+}
+
+//==============================================================================
+/// Perform interaction between particles: Fluid-Fluid or Fluid-Bound (only 
+/// Wendland kernel, artificial viscosity and without floatings or shifting).
+/// Each iteration computes S::W neighbours and the lanes out of the range or 
+/// out of the kernel support are excluded using masks.
+///
+/// Realiza interaccion entre particulas: Fluid-Fluid o Fluid-Bound (solo
+/// kernel Wendland, viscosidad artificial y sin floatings ni shifting).
+/// Cada iteracion calcula S::W vecinos y los que estan fuera del rango o fuera
+/// del soporte del kernel se excluyen usando mascaras.
+//==============================================================================
+template<class S,bool boundp2,TpDeltaSph tdelta> void InteractionForcesFluidT
+  (const StSimdCte &cte,const StSimdParticles &pd
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial,float visco
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta)
+{
+  typedef typename S::vf vf;
+  typedef typename S::vm vm;
+  const float massp2=(boundp2? cte.massb: cte.massf);
+  const vf v_zero=S::zero();
+  const vf v_one=S::set1(1.f);
+  const vf v_half=S::set1(0.5f);
+  const vf v_fourh2=S::set1(cte.fourh2);
+  const vf v_almostzero=S::set1(ALMOSTZERO);
+  const vf v_eta2=S::set1(cte.eta2);
+  const vf v_h=S::set1(cte.h);
+  const vf v_bwen=S::set1(cte.bwen);
+  const vf v_massp2=S::set1(massp2);
+  const vf v_nmassp2=S::set1(-massp2);
+  const vf v_kvisc=S::set1(-visco*cte.cs0*massp2);
+  const vf v_kdelta=S::set1(cte.delta2h*cte.cs0*massp2);
+  //-Initialize viscth to calculate viscdt maximo con OpenMP. | Inicializa viscth para calcular visdt maximo con OpenMP.
+  float viscth[OMP_MAXTHREADS*OMP_STRIDE];
+  for(int th=0;th<cte.ompthreads;th++)viscth[th*OMP_STRIDE]=0;
+  //-Initialise execution with OpenMP. | Inicia ejecucion con OpenMP.
+  const int pfin=int(pinit+n);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (guided)
+  #endif
+  for(int p1=int(pinit);p1<pfin;p1++){
+    vf acex=v_zero,acey=v_zero,acez=v_zero;
+    vf arv=v_zero,deltav=v_zero,viscv=v_zero;
+    bool deltamax=false;
+
+    //-Obtain data of particle p1.
+    const vf x1=S::set1(pd.posx[p1]),y1=S::set1(pd.posy[p1]),z1=S::set1(pd.posz[p1]);
+    const vf vx1=S::set1(pd.velx[p1]),vy1=S::set1(pd.vely[p1]),vz1=S::set1(pd.velz[p1]);
+    const vf rhopp1=S::set1(pd.rhop[p1]);
+    const vf pressp1=S::set1(pd.press[p1]);
+
+    //-Obtain interaction limits.
+    int cxini,cxfin,yini,yfin,zini,zfin;
+    SimdInteractionCells(dcell[p1],cte.cellcode,hdiv,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
+
+    //-Search for neighbours in adjacent cells.
+    for(int z=zini;z<zfin;z++){
+      const unsigned *rowz=cellrow+nc.y*z; //-First cell of the rows of cells in z. | Primera celda de las filas de celdas en z.
+      for(int y=yini;y<yfin;y++){
+        int ymod=int(cellinitial+rowz[y]); //-Sum from start of fluid or boundary cells. | Le suma donde empiezan las celdas de fluido o bound.
+        const unsigned pini=beginendcell[cxini+ymod];
+        const unsigned pfin=beginendcell[cxfin+ymod];
+
+        //-Interaction of Fluid with type Fluid or Bound (S::W neighbours per iteration).
+        //-Interaccion de Fluid con varias Fluid o Bound (S::W vecinos por iteracion).
+        //---------------------------------------------------------------------------------
+        for(unsigned p2=pini;p2<pfin;p2+=S::W){
+          const vf drx=S::sub(x1,S::load(pd.posx+p2));
+          const vf dry=S::sub(y1,S::load(pd.posy+p2));
+          const vf drz=S::sub(z1,S::load(pd.posz+p2));
+          const vf rr2=S::add(S::add(S::mul(drx,drx),S::mul(dry,dry)),S::mul(drz,drz));
+          const vm m=S::mand(S::lanes(pfin-p2),S::mand(S::cmple(rr2,v_fourh2),S::cmpge(rr2,v_almostzero)));
+          if(S::any(m)){
+            //-Wendland kernel.
+            const vf rr2m=S::blend(m,v_one,rr2);
+            const vf rad=S::sqrt(rr2m);
+            const vf qq=S::div(rad,v_h);
+            const vf wqq1=S::sub(v_one,S::mul(v_half,qq));
+            const vf fac=S::div(S::mul(S::mul(v_bwen,qq),S::mul(S::mul(wqq1,wqq1),wqq1)),rad);
+            const vf frx=S::mul(fac,drx),fry=S::mul(fac,dry),frz=S::mul(fac,drz);
+            const vf rhopp2=S::load(pd.rhop+p2);
+
+            //===== Acceleration ===== 
+            const vf prs=S::div(S::add(pressp1,S::load(pd.press+p2)),S::mul(rhopp1,rhopp2));
+            const vf p_vpm=S::mul(prs,v_nmassp2);
+            vf ax=S::mul(p_vpm,frx),ay=S::mul(p_vpm,fry),az=S::mul(p_vpm,frz);
+
+            //-Density derivative.
+            const vf dvx=S::sub(vx1,S::load(pd.velx+p2));
+            const vf dvy=S::sub(vy1,S::load(pd.vely+p2));
+            const vf dvz=S::sub(vz1,S::load(pd.velz+p2));
+            const vf dvfr=S::add(S::add(S::mul(dvx,frx),S::mul(dvy,fry)),S::mul(dvz,frz));
+            arv=S::add(arv,S::maskz(m,S::mul(v_massp2,dvfr)));
+
+            //-Density derivative (DeltaSPH Molteni).
+            if(tdelta==DELTA_Dynamic || tdelta==DELTA_DynamicExt){
+              if(boundp2)deltamax=true;
+              else{
+                const vf visc_densi=S::div(S::mul(v_kdelta,S::sub(S::div(rhopp1,rhopp2),v_one)),S::add(rr2m,v_eta2));
+                const vf dot3=S::add(S::add(S::mul(drx,frx),S::mul(dry,fry)),S::mul(drz,frz));
+                deltav=S::add(deltav,S::maskz(m,S::mul(visc_densi,dot3)));
+              }
+            }
+
+            //===== Viscosity ===== 
+            const vf dot=S::add(S::add(S::mul(drx,dvx),S::mul(dry,dvy)),S::mul(drz,dvz));
+            const vf dot_rr2=S::div(dot,S::add(rr2m,v_eta2));
+            viscv=S::max(viscv,S::maskz(m,dot_rr2));
+            const vm mneg=S::mand(m,S::cmplt(dot,v_zero));
+            if(S::any(mneg)){//-Artificial viscosity.
+              const vf amubar=S::mul(v_h,dot_rr2);
+              const vf robar=S::mul(S::add(rhopp1,rhopp2),v_half);
+              const vf pi_visc=S::div(S::mul(v_kvisc,amubar),robar);
+              ax=S::sub(ax,S::maskz(mneg,S::mul(pi_visc,frx)));
+              ay=S::sub(ay,S::maskz(mneg,S::mul(pi_visc,fry)));
+              az=S::sub(az,S::maskz(mneg,S::mul(pi_visc,frz)));
+            }
+            acex=S::add(acex,S::maskz(m,ax));
+            acey=S::add(acey,S::maskz(m,ay));
+            acez=S::add(acez,S::maskz(m,az));
+          }
+        }
+      }
+    }
+    //-Sum results together. | Almacena resultados.
+    float arp1=S::hsum(arv);
+    const float acep1x=S::hsum(acex),acep1y=S::hsum(acey),acep1z=S::hsum(acez);
+    const float visc=S::hmax(viscv);
+    const float deltap1=(boundp2? (deltamax? FLT_MAX: 0): S::hsum(deltav));
+    if(arp1||acep1x||acep1y||acep1z||visc){
+      if(tdelta==DELTA_Dynamic&&deltap1!=FLT_MAX)arp1+=deltap1;
+      if(tdelta==DELTA_DynamicExt)delta[p1]=(delta[p1]==FLT_MAX || deltap1==FLT_MAX? FLT_MAX: delta[p1]+deltap1);
+      ar[p1]+=arp1;
+      ace[p1].x+=acep1x; ace[p1].y+=acep1y; ace[p1].z+=acep1z;
+      const int th=omp_get_thread_num();
+      if(visc>viscth[th*OMP_STRIDE])viscth[th*OMP_STRIDE]=visc;
+    }
+  }
+  //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
+  for(int th=0;th<cte.ompthreads;th++)if(viscdt<viscth[th*OMP_STRIDE])viscdt=viscth[th*OMP_STRIDE];
+}
+
+//==============================================================================
+/// Perform interaction between particles: Bound-Fluid (only Wendland kernel
+/// and without floatings).
+/// Realiza interaccion entre particulas: Bound-Fluid (solo kernel Wendland y
+/// sin floatings).
+//==============================================================================
+template<class S> void InteractionForcesBoundT
+  (const StSimdCte &cte,const StSimdParticles &pd
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar)
+{
+  typedef typename S::vf vf;
+  typedef typename S::vm vm;
+  const vf v_zero=S::zero();
+  const vf v_one=S::set1(1.f);
+  const vf v_half=S::set1(0.5f);
+  const vf v_fourh2=S::set1(cte.fourh2);
+  const vf v_almostzero=S::set1(ALMOSTZERO);
+  const vf v_eta2=S::set1(cte.eta2);
+  const vf v_h=S::set1(cte.h);
+  const vf v_bwen=S::set1(cte.bwen);
+  const vf v_massp2=S::set1(cte.massf);
+  //-Initialize viscth to calculate max viscdt with OpenMP. | Inicializa viscth para calcular visdt maximo con OpenMP.
+  float viscth[OMP_MAXTHREADS*OMP_STRIDE];
+  for(int th=0;th<cte.ompthreads;th++)viscth[th*OMP_STRIDE]=0;
+  //-Starts execution using OpenMP.
+  const int pfin=int(pinit+n);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (guided)
+  #endif
+  for(int p1=int(pinit);p1<pfin;p1++){
+    vf arv=v_zero,viscv=v_zero;
+
+    //-Load data of particle p1. | Carga datos de particula p1.
+    const vf x1=S::set1(pd.posx[p1]),y1=S::set1(pd.posy[p1]),z1=S::set1(pd.posz[p1]);
+    const vf vx1=S::set1(pd.velx[p1]),vy1=S::set1(pd.vely[p1]),vz1=S::set1(pd.velz[p1]);
+
+    //-Obtain limits of interaction. | Obtiene limites de interaccion.
+    int cxini,cxfin,yini,yfin,zini,zfin;
+    SimdInteractionCells(dcell[p1],cte.cellcode,hdiv,nc,cellzero,cxini,cxfin,yini,yfin,zini,zfin);
+
+    //-Search for neighbours in adjacent cells. | Busqueda de vecinos en celdas adyacentes.
+    for(int z=zini;z<zfin;z++){
+      const unsigned *rowz=cellrow+nc.y*z; //-First cell of the rows of cells in z. | Primera celda de las filas de celdas en z.
+      for(int y=yini;y<yfin;y++){
+        int ymod=int(cellinitial+rowz[y]); //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
+        const unsigned pini=beginendcell[cxini+ymod];
+        const unsigned pfin=beginendcell[cxfin+ymod];
+
+        //-Interaction of boundary with type Fluid (S::W neighbours per iteration).
+        //-Interaccion de Bound con varias Fluid (S::W vecinos por iteracion).
+        //--------------------------------------------------------------------------
+        for(unsigned p2=pini;p2<pfin;p2+=S::W){
+          const vf drx=S::sub(x1,S::load(pd.posx+p2));
+          const vf dry=S::sub(y1,S::load(pd.posy+p2));
+          const vf drz=S::sub(z1,S::load(pd.posz+p2));
+          const vf rr2=S::add(S::add(S::mul(drx,drx),S::mul(dry,dry)),S::mul(drz,drz));
+          const vm m=S::mand(S::lanes(pfin-p2),S::mand(S::cmple(rr2,v_fourh2),S::cmpge(rr2,v_almostzero)));
+          if(S::any(m)){
+            //-Wendland kernel.
+            const vf rr2m=S::blend(m,v_one,rr2);
+            const vf rad=S::sqrt(rr2m);
+            const vf qq=S::div(rad,v_h);
+            const vf wqq1=S::sub(v_one,S::mul(v_half,qq));
+            const vf fac=S::div(S::mul(S::mul(v_bwen,qq),S::mul(S::mul(wqq1,wqq1),wqq1)),rad);
+            //-Density derivative.
+            const vf dvx=S::sub(vx1,S::load(pd.velx+p2));
+            const vf dvy=S::sub(vy1,S::load(pd.vely+p2));
+            const vf dvz=S::sub(vz1,S::load(pd.velz+p2));
+            const vf dot=S::add(S::add(S::mul(drx,dvx),S::mul(dry,dvy)),S::mul(drz,dvz));
+            arv=S::add(arv,S::maskz(m,S::mul(v_massp2,S::mul(fac,dot))));
+            //-Viscosity.
+            viscv=S::max(viscv,S::maskz(m,S::div(dot,S::add(rr2m,v_eta2))));
+          }
+        }
+      }
+    }
+    //-Sum results together. | Almacena resultados.
+    const float arp1=S::hsum(arv);
+    const float visc=S::hmax(viscv);
+    if(arp1||visc){
+      ar[p1]+=arp1;
+      const int th=omp_get_thread_num();
+      if(visc>viscth[th*OMP_STRIDE])viscth[th*OMP_STRIDE]=visc;
+    }
+  }
+  //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
+  for(int th=0;th<cte.ompthreads;th++)if(viscdt<viscth[th*OMP_STRIDE])viscdt=viscth[th*OMP_STRIDE];
+}
+
+//==============================================================================
+/// Selection of template parameters for InteractionForcesFluidT.
+/// Seleccion de parametros template para InteractionForcesFluidT.
+//==============================================================================
+template<class S> void InteractionForcesFluidS(TpDeltaSph tdelta,const StSimdCte &cte,const StSimdParticles &pdata
+  ,unsigned n,unsigned pinit,tint4 nc,int hdiv,unsigned cellinitial,float visco
+  ,const unsigned *beginendcell,const unsigned *cellrow,tint3 cellzero,const unsigned *dcell
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta)
+{
+  if(cellinitial){ const bool boundp2=false;
+    if(tdelta==DELTA_None)      InteractionForcesFluidT<S,boundp2,DELTA_None>      (cte,pdata,n,pinit,nc,hdiv,cellinitial,visco,beginendcell,cellrow,cellzero,dcell,viscdt,ar,ace,delta);
+    if(tdelta==DELTA_Dynamic)   InteractionForcesFluidT<S,boundp2,DELTA_Dynamic>   (cte,pdata,n,pinit,nc,hdiv,cellinitial,visco,beginendcell,cellrow,cellzero,dcell,viscdt,ar,ace,delta);
+    if(tdelta==DELTA_DynamicExt)InteractionForcesFluidT<S,boundp2,DELTA_DynamicExt>(cte,pdata,n,pinit,nc,hdiv,cellinitial,visco,beginendcell,cellrow,cellzero,dcell,viscdt,ar,ace,delta);
+  }
+  else{ const bool boundp2=true;
+    if(tdelta==DELTA_None)      InteractionForcesFluidT<S,boundp2,DELTA_None>      (cte,pdata,n,pinit,nc,hdiv,cellinitial,visco,beginendcell,cellrow,cellzero,dcell,viscdt,ar,ace,delta);
+    if(tdelta==DELTA_Dynamic)   InteractionForcesFluidT<S,boundp2,DELTA_Dynamic>   (cte,pdata,n,pinit,nc,hdiv,cellinitial,visco,beginendcell,cellrow,cellzero,dcell,viscdt,ar,ace,delta);
+    if(tdelta==DELTA_DynamicExt)InteractionForcesFluidT<S,boundp2,DELTA_DynamicExt>(cte,pdata,n,pinit,nc,hdiv,cellinitial,visco,beginendcell,cellrow,cellzero,dcell,viscdt,ar,ace,delta);
+  }
+}
+
+}
+
+#endif
+
+
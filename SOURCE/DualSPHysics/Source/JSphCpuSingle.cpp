@@ -33,6 +33,9 @@
 #include "JTimeOut.h"
 #include "JTimeControl.h"
 #include "JGaugeSystem.h"
+#include "JNeighbourListCpu.h"
+#include "JCellBalanceCpu.h"
+#include "JNumaCpu.h"
 #include <climits>
 
 using namespace std;
@@ -84,8 +87,32 @@ void JSphCpuSingle::LoadConfig(JCfgRun *cfg){
   const char met[]="LoadConfig";
   //-Load OpenMP configuraction. | Carga configuracion de OpenMP.
   ConfigOmp(cfg);
+  //-Load order and storage of rows of cells (used in the first divide). | Carga orden y almacenamiento de filas de celdas (usado en el primer divide).
+  CellSfc=cfg->CellSfc;
+  CellSparse=cfg->CellSparse;
+  //-Load configuration of particle arrays (used in the first allocation). | Carga configuracion de arrays de particulas (usada en la primera reserva).
+  #ifndef WIN32
+    HugePages=cfg->HugePages;
+  #endif
+  ArraysStats=cfg->ArraysStats;
+  CompactState=cfg->CompactState;
+  ArraysCpu->SetHugePages(HugePages);
+  //-Creates memory profile with the timers as phases. | Crea perfil de memoria con los timers como fases.
+  if(cfg->MemProfile){
+    MemTrack=new JMemoryTracker;
+    MemTrack->ConfigPhases(TmcGetCount());
+    for(unsigned ct=0;ct<TmcGetCount();ct++)MemTrack->SetPhaseName(ct,TmcGetName(CsTypeTimerCPU(ct)));
+    MemTrack->StartPhase(TMC_Init); //-Timer TMC_Init was started before LoadConfig(). | El timer TMC_Init se inicio antes de LoadConfig().
+    ArraysCpu->SetMemTrack(MemTrack);
+  }
   //-Load basic general configuraction. | Carga configuracion basica general.
   JSph::LoadConfig(cfg);
+  //-Load configuration of periodic images (used in the creation of the cell division), also used by the neighbour list. | Carga configuracion de imagenes periodicas (usada en la creacion de la division en celdas), tambien usada por la lista de vecinos.
+  PeriImage=((cfg->PeriImage || cfg->NeighListSkin>0) && PeriActive!=0);
+  if(PeriImage && (UseDEM || cfg->Symmetry || cfg->CellTile || cfg->SimdMode!=SIMDMODE_None)){
+    if(cfg->PeriImage)Log->Print("\n*** Attention: PeriImage is disabled because it is not supported with DEM, Symmetry, CellTile or SIMD.\n");
+    PeriImage=false;
+  }
   //-Checks compatibility of selected options.
   Log->Print("**Special case configuration is loaded");
 }
@@ -180,9 +207,7 @@ void JSphCpuSingle::ConfigDomain(){
   LoadDcellParticles(Np,Codec,Posc,Dcellc);
 
   //-Create object for divide in CPU & select a valid cellmode. | Crea objeto para divide en Gpu y selecciona un cellmode valido.
-  CellDivSingle=new JCellDivCpuSingle(Stable,FtCount!=0,PeriActive,CellOrder,CellMode,Scell,Map_PosMin,Map_PosMax,Map_Cells,CaseNbound,CaseNfixed,CaseNpb,Log,DirOut);
-  CellDivSingle->DefineDomain(DomCellCode,DomCelIni,DomCelFin,DomPosMin,DomPosMax);
-  ConfigCellDiv((JCellDivCpu*)CellDivSingle);
+  CreateCellDiv();
 
   ConfigSaveData(0,1,"");
 
@@ -191,6 +216,70 @@ void JSphCpuSingle::ConfigDomain(){
   RunCellDivide(true);
 }
 
+//==============================================================================
+/// Creates object for divide in CPU with the current cell mode and domain.
+/// Crea objeto para divide en CPU con el modo de celdas y dominio actuales.
+//==============================================================================
+void JSphCpuSingle::CreateCellDiv(){
+  //-With PeriImage there are no periodic boundary particles so boundary cells do not change in each divide. | Con PeriImage no hay particulas contorno periodicas asi que las celdas de contorno no cambian en cada divide.
+  CellDivSingle=new JCellDivCpuSingle(Stable,FtCount!=0,(PeriImage? 0: PeriActive),CellOrder,CellMode,Scell,Map_PosMin,Map_PosMax,Map_Cells,CaseNbound,CaseNfixed,CaseNpb,Log,DirOut);
+  CellDivSingle->DefineDomain(DomCellCode,DomCelIni,DomCelFin,DomPosMin,DomPosMax);
+  CellDivSingle->SetCellSfc(CellSfc);
+  CellDivSingle->SetCellSparse(CellSparse);
+  ConfigCellDiv((JCellDivCpu*)CellDivSingle);
+}
+
+//==============================================================================
+/// Changes the cell mode during the simulation. The cells of the particles are
+/// computed again and a new cell division is created and executed.
+///
+/// Cambia el modo de celdas durante la simulacion. Se calculan de nuevo las 
+/// celdas de las particulas y se crea y ejecuta una nueva division en celdas.
+//==============================================================================
+void JSphCpuSingle::ChangeCellMode(TpCellMode cellmode){
+  SetCellMode(cellmode);
+  SelecDomain(TUint3(0,0,0),Map_Cells);
+  //-Present periodic particles are ignored since they are created again in the divide. | Las periodicas actuales se ignoran porque se crean de nuevo en el divide.
+  if(PeriActive)for(unsigned p=0;p<Np;p++){
+    const typecode rcode=Codec[p];
+    if(CODE_IsPeriodic(rcode))Codec[p]=CODE_SetOutIgnore(rcode);
+  }
+  LoadDcellParticles(Np,Codec,Posc,Dcellc);
+  //-Replaces cell division and updates objects that depend on the cell size. | Sustituye la division en celdas y actualiza objetos que dependen del tamano de celda.
+  delete CellDivSingle; CellDivSingle=NULL;
+  CreateCellDiv();
+  CellDivSingle->SetIncDivide(IncDivide);
+  if(SimdMode!=SIMDMODE_None)SimdCte.cellcode=DomCellCode;
+  if(NeighList)NeighList->ConfigCells(Scell);
+  GaugeSystem->ConfigCells(DomPosMin,DomPosMax,Scell,Hdiv);
+  BoundChanged=true;
+  RunCellDivide(true);
+}
+
+//==============================================================================
+/// Measures the runtime of the first steps with cell modes 2H and H and then 
+/// continues the simulation with the fastest one. The first step with each 
+/// cell mode is not measured.
+///
+/// Mide el tiempo de ejecucion de los primeros pasos con los modos de celdas 
+/// 2H y H y despues continua la simulacion con el mas rapido. El primer paso 
+/// con cada modo de celdas no se mide.
+//==============================================================================
+void JSphCpuSingle::RunCellModeAuto(double steptime){
+  const unsigned nsteps=CellModeAuto;
+  if(CellModeAutoNum%nsteps)CellModeAutoTime[CellMode==CELLMODE_H? 1: 0]+=steptime;
+  CellModeAutoNum++;
+  if(CellModeAutoNum==nsteps)ChangeCellMode(CellMode==CELLMODE_H? CELLMODE_2H: CELLMODE_H);
+  else if(CellModeAutoNum==nsteps*2){
+    const double t2h=CellModeAutoTime[0]/(nsteps-1);
+    const double th=CellModeAutoTime[1]/(nsteps-1);
+    const TpCellMode cellmode=(th<t2h? CELLMODE_H: CELLMODE_2H);
+    Log->Printf("  CellMode auto: %.3f ms/step with 2H and %.3f ms/step with H, %s is selected.",t2h,th,GetNameCellMode(cellmode));
+    if(cellmode!=CellMode)ChangeCellMode(cellmode);
+    CellModeAuto=0;
+  }
+}
+
 //==============================================================================
 /// Redimension space reserved for particles in CPU, measure 
 /// time consumed using TMC_SuResizeNp. On finishing, update divide.
@@ -207,37 +296,177 @@ void JSphCpuSingle::ResizeParticlesSize(unsigned newsize,float oversize,bool upd
 }
 
 //==============================================================================
-/// Create list of new periodic particles to duplicate.
-/// With stable activated reordered list of periodic particles.
+/// Returns the exact number of periodic particles that RunPeriodic() creates 
+/// from a particle at position ps with several periodic axes. The particle is
+/// duplicated in each periodic axis together with its duplicates of previous
+/// axes (as RunPeriodic() does).
 ///
-/// Crea lista de nuevas particulas periodicas a duplicar.
-/// Con stable activado reordena lista de periodicas.
+/// Devuelve el numero exacto de particulas periodicas que crea RunPeriodic() a
+/// partir de una particula en la posicion ps con varios ejes periodicos. La 
+/// particula se duplica en cada eje periodico junto con sus duplicadas de ejes
+/// anteriores (como hace RunPeriodic()).
 //==============================================================================
-unsigned JSphCpuSingle::PeriodicMakeList(unsigned n,unsigned pini,bool stable,unsigned nmax,tdouble3 perinc,const tdouble3 *pos,const typecode *code,unsigned *listp)const{
-  unsigned count=0;
-  if(n){
-    //-Initialize size of list lsph to zero. | Inicializa tamao de lista lspg a cero.
-    listp[nmax]=0;
-    for(unsigned p=0;p<n;p++){
-      const unsigned p2=p+pini;
-      //-Keep normal or periodic particles. | Se queda con particulas normales o periodicas.
-      if(CODE_GetSpecialValue(code[p2])<=CODE_PERIODIC){
-        //-Get particle position. | Obtiene posicion de particula.
-        const tdouble3 ps=pos[p2];
-        tdouble3 ps2=ps+perinc;
-        if(Map_PosMin<=ps2 && ps2<Map_PosMax){
-          unsigned cp=listp[nmax]; listp[nmax]++; if(cp<nmax)listp[cp]=p2;
+unsigned JSphCpuSingle::PeriodicCount(const tdouble3 &ps)const{
+  tdouble3 vps[27];
+  unsigned nps=1;
+  vps[0]=ps;
+  for(unsigned cper=0;cper<3;cper++)if(PeriActive&(1<<cper)){
+    const tdouble3 perinc=(cper==0? PeriXinc: (cper==1? PeriYinc: PeriZinc));
+    const unsigned nps0=nps;
+    for(unsigned c=0;c<nps0;c++){
+      tdouble3 ps2=vps[c]+perinc;
+      if(Map_PosMin<=ps2 && ps2<Map_PosMax)vps[nps++]=ps2;
+      ps2=vps[c]-perinc;
+      if(Map_PosMin<=ps2 && ps2<Map_PosMax)vps[nps++]=ps2;
+    }
+  }
+  return(nps-1);
+}
+
+//==============================================================================
+/// Marks present periodic particles to ignore and creates the list of normal
+/// particles with periodic copies (the periodic band) in only one pass. Returns
+/// the number of particles in the band and the exact number of new periodic 
+/// particles in npernew. Each thread writes its band particles from the first
+/// position of its range, so the list is compacted at the end keeping the
+/// order of the particles.
+///
+/// Marca las periodicas actuales para ignorarlas y crea la lista de particulas
+/// normales con copias periodicas (la banda periodica) en una sola pasada. 
+/// Devuelve el numero de particulas de la banda y el numero exacto de nuevas 
+/// periodicas en npernew. Cada hilo graba sus particulas de la banda desde la 
+/// primera posicion de su rango, por lo que la lista se compacta al final 
+/// manteniendo el orden de las particulas.
+//==============================================================================
+unsigned JSphCpuSingle::PeriodicMarkBand(unsigned np,unsigned *listband,unsigned &npernew){
+  const int nth=(np>OMP_LIMIT_COMPUTELIGHT? OmpThreads: 1);
+  const bool perimulti=(PeriActive!=1 && PeriActive!=2 && PeriActive!=4);
+  const tdouble3 mapmin=Map_PosMin,mapmax=Map_PosMax;
+  const tdouble3 perinc[3]={PeriXinc,PeriYinc,PeriZinc};
+  const bool peri[3]={PeriX,PeriY,PeriZ};
+  const tdouble3 perinc1=(PeriX? PeriXinc: (PeriY? PeriYinc: PeriZinc)); //-Displacement with only one periodic axis. | Desplazamiento con un solo eje periodico.
+  unsigned countth[OMP_MAXTHREADS*OMP_STRIDE];
+  unsigned npernewth[OMP_MAXTHREADS*OMP_STRIDE];
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static,1) if(nth>1)
+  #endif
+  for(int th=0;th<nth;th++){
+    const unsigned p0=unsigned(ullong(np)*th/nth);
+    const unsigned p1=unsigned(ullong(np)*(th+1)/nth);
+    unsigned cp=p0,nper=0;
+    for(unsigned p=p0;p<p1;p++){
+      const typecode rcode=Codec[p];
+      if(CODE_IsPeriodic(rcode))Codec[p]=CODE_SetOutIgnore(rcode);
+      else if(CODE_IsNormal(rcode)){
+        //-Counts the copies in each axis. | Cuenta las copias en cada eje.
+        const tdouble3 ps=Posc[p];
+        unsigned ncopy=0;
+        if(!perimulti){
+          tdouble3 ps2=ps+perinc1;
+          if(mapmin<=ps2 && ps2<mapmax)ncopy++;
+          ps2=ps-perinc1;
+          if(mapmin<=ps2 && ps2<mapmax)ncopy++;
         }
-        ps2=ps-perinc;
-        if(Map_PosMin<=ps2 && ps2<Map_PosMax){
-          unsigned cp=listp[nmax]; listp[nmax]++; if(cp<nmax)listp[cp]=(p2|0x80000000);
+        else for(unsigned cper=0;cper<3;cper++)if(peri[cper]){
+          const tdouble3 ps1=ps+perinc[cper],ps2=ps-perinc[cper];
+          ncopy+=unsigned(mapmin<=ps1 && ps1<mapmax)+unsigned(mapmin<=ps2 && ps2<mapmax);
+        }
+        if(ncopy){
+          //-Copies of copies only exist when the particle has copies in some axis. | Copias de copias solo existen cuando la particula tiene copias en algun eje.
+          listband[cp++]=p;
+          nper+=(perimulti? PeriodicCount(ps): ncopy);
         }
       }
     }
-    count=listp[nmax];
-    //-Reorder list if it is valid and stability is activated. | Reordena lista si es valida y stable esta activado.
-    if(stable && count && count<=nmax){
-      //-Don't make mistake because at the moment the list is not created using OpenMP. | No hace falta porque de momento no se crea la lista usando OpenMP.
+    countth[th*OMP_STRIDE]=cp-p0;
+    npernewth[th*OMP_STRIDE]=nper;
+  }
+  //-Compacts the list of band particles. | Compacta la lista de particulas de la banda.
+  unsigned nband=countth[0];
+  npernew=npernewth[0];
+  for(int th=1;th<nth;th++){
+    const unsigned p0=unsigned(ullong(np)*th/nth);
+    const unsigned c=countth[th*OMP_STRIDE];
+    for(unsigned cp=0;cp<c;cp++)listband[nband+cp]=listband[p0+cp];
+    nband+=c;
+    npernew+=npernewth[th*OMP_STRIDE];
+  }
+  return(nband);
+}
+
+//==============================================================================
+/// Adds to listp from position cp the new periodic particles to duplicate from
+/// particles p0-p1 of the range (see PeriodicMakeList()) and returns the next
+/// position. When listp is NULL the particles are only counted.
+///
+/// Anade a listp desde la posicion cp las nuevas periodicas a duplicar a partir
+/// de las particulas p0-p1 del rango (ver PeriodicMakeList()) y devuelve la 
+/// siguiente posicion. Cuando listp es NULL las particulas solo se cuentan.
+//==============================================================================
+unsigned JSphCpuSingle::PeriodicMakeListRange(unsigned p0,unsigned p1,unsigned pini,const unsigned *listband,tdouble3 perinc,const tdouble3 *pos,const typecode *code,unsigned cp,unsigned *listp)const{
+  for(unsigned p=p0;p<p1;p++){
+    const unsigned p2=(listband? listband[p]: p+pini);
+    //-Keep normal or periodic particles. | Se queda con particulas normales o periodicas.
+    if(CODE_GetSpecialValue(code[p2])<=CODE_PERIODIC){
+      //-Get particle position. | Obtiene posicion de particula.
+      const tdouble3 ps=pos[p2];
+      tdouble3 ps2=ps+perinc;
+      if(Map_PosMin<=ps2 && ps2<Map_PosMax){
+        if(listp)listp[cp]=p2;
+        cp++;
+      }
+      ps2=ps-perinc;
+      if(Map_PosMin<=ps2 && ps2<Map_PosMax){
+        if(listp)listp[cp]=(p2|0x80000000);
+        cp++;
+      }
+    }
+  }
+  return(cp);
+}
+
+//==============================================================================
+/// Create list of new periodic particles to duplicate from the n particles 
+/// starting at pini or, when listband is not NULL, from the n particles of 
+/// listband.
+/// With several threads the list is created in parallel counting the particles
+/// of each thread first so the order is always the same (the one of the 
+/// particles).
+///
+/// Crea lista de nuevas particulas periodicas a duplicar a partir de las n 
+/// particulas desde pini o, cuando listband no es NULL, de las n particulas de
+/// listband.
+/// Con varios hilos la lista se crea en paralelo contando primero las 
+/// particulas de cada hilo de forma que el orden es siempre el mismo (el de las
+/// particulas).
+//==============================================================================
+unsigned JSphCpuSingle::PeriodicMakeList(unsigned n,unsigned pini,const unsigned *listband,tdouble3 perinc,const tdouble3 *pos,const typecode *code,unsigned *listp)const{
+  const int nth=(n>OMP_LIMIT_COMPUTELIGHT? OmpThreads: 1);
+  if(nth<2)return(PeriodicMakeListRange(0,n,pini,listband,perinc,pos,code,0,listp));
+  unsigned countth[OMP_MAXTHREADS*OMP_STRIDE];
+  //-Counts new periodic particles of each thread. | Cuenta las nuevas periodicas de cada hilo.
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static,1)
+  #endif
+  for(int th=0;th<nth;th++){
+    const unsigned p0=unsigned(ullong(n)*th/nth),p1=unsigned(ullong(n)*(th+1)/nth);
+    countth[th*OMP_STRIDE]=PeriodicMakeListRange(p0,p1,pini,listband,perinc,pos,code,0,NULL);
+  }
+  //-Converts counts of threads into their first position in the list. | Convierte los contadores de hilos en su primera posicion en la lista.
+  unsigned count=0;
+  for(int th=0;th<nth;th++){
+    const unsigned c=countth[th*OMP_STRIDE];
+    countth[th*OMP_STRIDE]=count;
+    count+=c;
+  }
+  //-Creates the list. | Crea la lista.
+  if(count){
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static,1)
+    #endif
+    for(int th=0;th<nth;th++){
+      const unsigned p0=unsigned(ullong(n)*th/nth),p1=unsigned(ullong(n)*(th+1)/nth);
+      PeriodicMakeListRange(p0,p1,pini,listband,perinc,pos,code,countth[th*OMP_STRIDE],listp);
     }
   }
   return(count);
@@ -288,7 +517,7 @@ void JSphCpuSingle::PeriodicDuplicatePos(unsigned pnew,unsigned pcopy,bool inver
 /// Este kernel vale para single-cpu y multi-cpu porque usa domposmin. 
 //==============================================================================
 void JSphCpuSingle::PeriodicDuplicateVerlet(unsigned np,unsigned pini,tuint3 cellmax,tdouble3 perinc,const unsigned *listp
-  ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tfloat4 *velrhopm1)const
+  ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tfloat4 *velrhopm1,thalf4 *velrhopm1h)const
 {
   const int n=int(np);
   #ifdef OMP_USE
@@ -304,7 +533,8 @@ void JSphCpuSingle::PeriodicDuplicateVerlet(unsigned np,unsigned pini,tuint3 cel
     idp[pnew]=idp[pcopy];
     code[pnew]=CODE_SetPeriodic(code[pcopy]);
     velrhop[pnew]=velrhop[pcopy];
-    velrhopm1[pnew]=velrhopm1[pcopy];
+    if(velrhopm1)velrhopm1[pnew]=velrhopm1[pcopy];
+    if(velrhopm1h)velrhopm1h[pnew]=velrhopm1h[pcopy];
     if(spstau)spstau[pnew]=spstau[pcopy];
   }
 }
@@ -319,7 +549,8 @@ void JSphCpuSingle::PeriodicDuplicateVerlet(unsigned np,unsigned pini,tuint3 cel
 /// Este kernel vale para single-cpu y multi-cpu porque usa domposmin. 
 //==============================================================================
 void JSphCpuSingle::PeriodicDuplicateSymplectic(unsigned np,unsigned pini,tuint3 cellmax,tdouble3 perinc,const unsigned *listp
-  ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tdouble3 *pospre,tfloat4 *velrhoppre)const
+  ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tdouble3 *pospre,tfloat4 *velrhoppre
+  ,tfloat3 *posprecoff,thalf4 *velrhopprech)const
 {
   const int n=int(np);
   #ifdef OMP_USE
@@ -337,6 +568,8 @@ void JSphCpuSingle::PeriodicDuplicateSymplectic(unsigned np,unsigned pini,tuint3
     velrhop[pnew]=velrhop[pcopy];
     if(pospre)pospre[pnew]=pospre[pcopy];
     if(velrhoppre)velrhoppre[pnew]=velrhoppre[pcopy];
+    if(posprecoff)posprecoff[pnew]=posprecoff[pcopy];
+    if(velrhopprech)velrhopprech[pnew]=velrhopprech[pcopy];
     if(spstau)spstau[pnew]=spstau[pcopy];
   }
 }
@@ -346,13 +579,21 @@ void JSphCpuSingle::PeriodicDuplicateSymplectic(unsigned np,unsigned pini,tuint3
 /// Create new periodic particles and mark the old ones to be ignored.
 /// New periodic particles are created from Np of the beginning, first the NpbPer
 /// of the boundry and then the NpfPer fluid ones. The Np of the those leaving contains also the
-/// new periodic ones.
+/// new periodic ones. Memory is resized only once with the exact number of new 
+/// periodic particles, which is counted in the same loop that marks the present
+/// periodic particles (PeriodicMarkBand()). This loop also creates the list of
+/// particles with periodic copies, so the lists of each axis are created only
+/// from these particles.
 ///
 /// Crea particulas duplicadas de condiciones periodicas.
 /// Crea nuevas particulas periodicas y marca las viejas para ignorarlas.
 /// Las nuevas periodicas se situan a partir del Np de entrada, primero las NpbPer
 /// de contorno y despues las NpfPer fluidas. El Np de salida contiene tambien las
-/// nuevas periodicas.
+/// nuevas periodicas. La memoria se redimensiona una sola vez con el numero exacto
+/// de nuevas periodicas, que se cuenta en el mismo bucle que marca las periodicas
+/// actuales (PeriodicMarkBand()). Este bucle tambien crea la lista de particulas
+/// con copias periodicas, de forma que las listas de cada eje se crean solo a 
+/// partir de estas particulas.
 //==============================================================================
 void JSphCpuSingle::RunPeriodic(){
   const char met[]="RunPeriodic";
@@ -360,21 +601,31 @@ void JSphCpuSingle::RunPeriodic(){
   //-Keep number of present periodic. | Guarda numero de periodicas actuales.
   NpfPerM1=NpfPer;
   NpbPerM1=NpbPer;
-  //-Mark present periodic particles to ignore. | Marca periodicas actuales para ignorar.
-  for(unsigned p=0;p<Np;p++){
-    const typecode rcode=Codec[p];
-    if(CODE_IsPeriodic(rcode))Codec[p]=CODE_SetOutIgnore(rcode);
+  //-Mark present periodic particles to ignore and count the new periodic particles. | Marca periodicas actuales para ignorar y cuenta las nuevas periodicas.
+  if(Np>=0x80000000)RunException(met,"The number of particles is too big.");//-Because the last bit is used to mark the direction in which a new periodic particle is created. | Porque el ultimo bit se usa para marcar el sentido en que se crea la nueva periodica.
+  unsigned* listband=ArraysCpu->ReserveUint();
+  unsigned npernew=0;
+  const unsigned nband=PeriodicMarkBand(Np,listband,npernew);
+  unsigned nbandb=0;
+  while(nbandb<nband && listband[nbandb]<Npb)nbandb++;
+  //-Redimension memory for particles only once when there is insufficient space for the new periodic particles.
+  //-Redimensiona memoria para particulas una sola vez cuando no hay espacio suficiente para las nuevas periodicas.
+  if(!CheckCpuParticlesSize(Np+npernew)){
+    TmcStop(Timers,TMC_SuPeriodic);
+    ResizeParticlesSize(Np+npernew,PERIODIC_OVERMEMORYNP,false);
+    listband=ArraysCpu->GetRenewed(listband);
+    TmcStart(Timers,TMC_SuPeriodic);
   }
   //-Create new periodic particles. | Crea las nuevas periodicas.
-  const unsigned npb0=Npb;
-  const unsigned npf0=Np-Npb;
   const unsigned np0=Np;
   NpbPer=NpfPer=0;
   BoundChanged=true;
+  //-Reserve memory to create lists of periodic particles. | Reserva memoria para crear listas de particulas periodicas.
+  unsigned* listp=ArraysCpu->ReserveUint();
   for(unsigned ctype=0;ctype<2;ctype++){//-0:bound, 1:fluid+floating.
-    //-Calculate range of particles to be examined (bound or fluid). | Calcula rango de particulas a examinar (bound o fluid).
-    const unsigned pini=(ctype? npb0: 0);
-    const unsigned num= (ctype? npf0: npb0);
+    //-Calculate range of band particles to be examined (bound or fluid). | Calcula rango de particulas de la banda a examinar (bound o fluid).
+    const unsigned *listbandt=listband+(ctype? nbandb: 0);
+    const unsigned nbandt=(ctype? nband-nbandb: nbandb);
     //-Search for periodic in each direction (X, Y, or Z). | Busca periodicas en cada eje (X, Y e Z).
     for(unsigned cper=0;cper<3;cper++)if((cper==0 && PeriActive&1) || (cper==1 && PeriActive&2) || (cper==2 && PeriActive&4)){
       tdouble3 perinc=(cper==0? PeriXinc: (cper==1? PeriYinc: PeriZinc));
@@ -382,50 +633,64 @@ void JSphCpuSingle::RunPeriodic(){
       //-Primero busca en la lista de periodicas nuevas y despues en la lista inicial de particulas (necesario para periodicas en mas de un eje).
       for(unsigned cblock=0;cblock<2;cblock++){//-0:new periodic, 1:original particles. | 0:periodicas nuevas, 1:particulas originales
         const unsigned nper=(ctype? NpfPer: NpbPer); //-Number of new periodic particles of type to be processed. | Numero de periodicas nuevas del tipo a procesar.
-        const unsigned pini2=(cblock? pini: Np-nper);
-        const unsigned num2= (cblock? num:  nper);
-        //-Repeat the search if the resulting memory available is insufficient and it had to be increased.
-        //-Repite la busqueda si la memoria disponible resulto insuficiente y hubo que aumentarla.
-        bool run=true;
-        while(run && num2){
-          //-Reserve memory to create list of periodic particles. | Reserva memoria para crear lista de particulas periodicas.
-          unsigned* listp=ArraysCpu->ReserveUint();
-          unsigned nmax=CpuParticlesSize-1; //-Maximmum number of particles that fit in the list. | Numero maximo de particulas que caben en la lista.
-          //-Generate list of new periodic particles. | Genera lista de nuevas periodicas.
-          if(Np>=0x80000000)RunException(met,"The number of particles is too big.");//-Because the last bit is used to mark the direction in which a new periodic particle is created. | Porque el ultimo bit se usa para marcar el sentido en que se crea la nueva periodica.
-          unsigned count=PeriodicMakeList(num2,pini2,Stable,nmax,perinc,Posc,Codec,listp);
-          //-Redimension memory for particles if there is insufficient space and repeat the search process.
-          //-Redimensiona memoria para particulas si no hay espacio suficiente y repite el proceso de busqueda.
-          if(count>nmax || !CheckCpuParticlesSize(count+Np)){
-            ArraysCpu->Free(listp); listp=NULL;
-            TmcStop(Timers,TMC_SuPeriodic);
-            ResizeParticlesSize(Np+count,PERIODIC_OVERMEMORYNP,false);
-            TmcStart(Timers,TMC_SuPeriodic);
-          }
-          else{
-            run=false;
-            //-Create new duplicate periodic particles in the list
-            //-Crea nuevas particulas periodicas duplicando las particulas de la lista.
-            if(TStep==STEP_Verlet)PeriodicDuplicateVerlet(count,Np,DomCells,perinc,listp,Idpc,Codec,Dcellc,Posc,Velrhopc,SpsTauc,VelrhopM1c);
-            if(TStep==STEP_Symplectic){
-              if((PosPrec || VelrhopPrec) && (!PosPrec || !VelrhopPrec))RunException(met,"Symplectic data is invalid.") ;
-              PeriodicDuplicateSymplectic(count,Np,DomCells,perinc,listp,Idpc,Codec,Dcellc,Posc,Velrhopc,SpsTauc,PosPrec,VelrhopPrec);
-            }
-
-            //-Free the list and update the number of particles. | Libera lista y actualiza numero de particulas.
-            ArraysCpu->Free(listp); listp=NULL;
-            Np+=count;
-            //-Update number of new periodic particles. | Actualiza numero de periodicas nuevas.
-            if(!ctype)NpbPer+=count;
-            else NpfPer+=count;
+        const unsigned num2=(cblock? nbandt: nper);
+        //-Generate list of new periodic particles. | Genera lista de nuevas periodicas.
+        const unsigned count=(num2? PeriodicMakeList(num2,Np-nper,(cblock? listbandt: NULL),perinc,Posc,Codec,listp): 0);
+        if(count){
+          if(Np+count>np0+npernew)RunException(met,"The number of new periodic particles is invalid.");
+          //-Create new duplicate periodic particles in the list
+          //-Crea nuevas particulas periodicas duplicando las particulas de la lista.
+          if(TStep==STEP_Verlet)PeriodicDuplicateVerlet(count,Np,DomCells,perinc,listp,Idpc,Codec,Dcellc,Posc,Velrhopc,SpsTauc,VelrhopM1c,VelrhopM1h);
+          if(TStep==STEP_Symplectic){
+            if((PosPrec || VelrhopPrec) && (!PosPrec || !VelrhopPrec))RunException(met,"Symplectic data is invalid.") ;
+            if((PosPrecOff || VelrhopPrech) && (!PosPrecOff || !VelrhopPrech))RunException(met,"Symplectic data is invalid.") ;
+            PeriodicDuplicateSymplectic(count,Np,DomCells,perinc,listp,Idpc,Codec,Dcellc,Posc,Velrhopc,SpsTauc,PosPrec,VelrhopPrec,PosPrecOff,VelrhopPrech);
           }
+          //-Update number of particles and of new periodic particles. | Actualiza numero de particulas y de periodicas nuevas.
+          Np+=count;
+          if(!ctype)NpbPer+=count;
+          else NpfPer+=count;
         }
       }
     }
   }
+  //-Free the lists. | Libera listas.
+  ArraysCpu->Free(listp); listp=NULL;
+  ArraysCpu->Free(listband); listband=NULL;
   TmcStop(Timers,TMC_SuPeriodic);
 }
 
+//==============================================================================
+/// Registers array to be reordered together with the others in a free array 
+/// of ArraysCpu. When there is no free array (or divide was incremental) it is
+/// reordered now and returns NULL.
+///
+/// Registra array para reordenarlo junto con los demas en un array libre de
+/// ArraysCpu. Cuando no hay ningun array libre (o el divide fue incremental)
+/// se reordena ahora y devuelve NULL.
+//==============================================================================
+template<class T> T* JSphCpuSingle::AddSortArray(T *vec){
+  const JArraysCpu::TpArraySize tsize=JArraysCpu::TpArraySize(sizeof(T));
+  T *sorted=NULL;
+  if(!CellDivSingle->GetDivideInc() && ArraysCpu->GetArrayCountUsed(tsize)<ArraysCpu->GetArrayCount(tsize)){
+    sorted=(T*)ArraysCpu->ReserveSize(tsize);
+    CellDivSingle->AddSortArray(vec,sorted);
+  }
+  else CellDivSingle->SortArray(vec);
+  return(sorted);
+}
+
+//==============================================================================
+/// Replaces array by its reordered copy and frees the previous one.
+/// Sustituye array por su copia reordenada y libera el anterior.
+//==============================================================================
+template<class T> void JSphCpuSingle::SetSortArray(T *&vec,T *sorted){
+  if(sorted){
+    ArraysCpu->Free(vec);
+    vec=sorted;
+  }
+}
+
 //==============================================================================
 /// Execute divide of particles in cells.
 /// Ejecuta divide de particulas en celdas.
@@ -433,27 +698,59 @@ void JSphCpuSingle::RunPeriodic(){
 void JSphCpuSingle::RunCellDivide(bool updateperiodic){
   const char met[]="RunCellDivide";
   //-Create new periodic particles & mark the old ones to be ignored. | Crea nuevas particulas periodicas y marca las viejas para ignorarlas.
-  if(updateperiodic && PeriActive)RunPeriodic();
+  if(updateperiodic && PeriActive && !PeriImage)RunPeriodic();
 
   //-Initialises Divide. | Inicia Divide.
   CellDivSingle->Divide(Npb,Np-Npb-NpbPer-NpfPer,NpbPer,NpfPer,BoundChanged,Dcellc,Codec,Idpc,Posc,Timers);
+  if(MemTrack){//-Memory of cell division is assigned to NL-MakeSort. | La memoria de la division en celdas se asigna a NL-MakeSort.
+    MemTrack->StartPhase(TMC_NlMakeSort);
+    MemTrack->SetBlock("CellDiv",CellDivSingle->GetAllocMemory());
+    MemTrack->StopPhase(TMC_NlMakeSort);
+  }
+  CellRow=CellDivSingle->GetCellRow();
+  CellRowInv=CellDivSingle->GetCellRowInv();
 
-  //-Order particle data. | Ordena datos de particulas
+  //-Order particle data in one pass over SortPart[] writing in free arrays. | Ordena datos de particulas en una pasada sobre SortPart[] escribiendo en arrays libres.
   TmcStart(Timers,TMC_NlSortData);
-  CellDivSingle->SortArray(Idpc);
-  CellDivSingle->SortArray(Codec);
-  CellDivSingle->SortArray(Dcellc);
-  CellDivSingle->SortArray(Posc);
-  CellDivSingle->SortArray(Velrhopc);
+  CellDivSingle->ClearSortArrays();
+  unsigned *idp=AddSortArray(Idpc);
+  typecode *code=AddSortArray(Codec);
+  unsigned *dcell=AddSortArray(Dcellc);
+  tdouble3 *pos=AddSortArray(Posc);
+  tfloat4 *velrhop=AddSortArray(Velrhopc);
+  tfloat4 *velrhopm1=NULL,*velrhoppre=NULL;
+  tdouble3 *pospre=NULL;
+  thalf4 *velrhopm1h=NULL,*velrhopprech=NULL;
+  tfloat3 *posprecoff=NULL;
+  tsymatrix3f *spstau=NULL;
   if(TStep==STEP_Verlet){
-    CellDivSingle->SortArray(VelrhopM1c);
+    if(VelrhopM1h)velrhopm1h=AddSortArray(VelrhopM1h);
+    else velrhopm1=AddSortArray(VelrhopM1c);
   }
   else if(TStep==STEP_Symplectic && (PosPrec || VelrhopPrec)){//-In reality, this is only necessary in divide for corrector, not in predictor??? | En realidad solo es necesario en el divide del corrector, no en el predictor???
     if(!PosPrec || !VelrhopPrec)RunException(met,"Symplectic data is invalid.") ;
-    CellDivSingle->SortArray(PosPrec);
-    CellDivSingle->SortArray(VelrhopPrec);
+    pospre=AddSortArray(PosPrec);
+    velrhoppre=AddSortArray(VelrhopPrec);
+  }
+  else if(TStep==STEP_Symplectic && (PosPrecOff || VelrhopPrech)){
+    if(!PosPrecOff || !VelrhopPrech)RunException(met,"Symplectic data is invalid.") ;
+    posprecoff=AddSortArray(PosPrecOff);
+    velrhopprech=AddSortArray(VelrhopPrech);
   }
-  if(TVisco==VISCO_LaminarSPS)CellDivSingle->SortArray(SpsTauc);
+  if(TVisco==VISCO_LaminarSPS)spstau=AddSortArray(SpsTauc);
+  CellDivSingle->SortArrays();
+  SetSortArray(Idpc,idp);
+  SetSortArray(Codec,code);
+  SetSortArray(Dcellc,dcell);
+  SetSortArray(Posc,pos);
+  SetSortArray(Velrhopc,velrhop);
+  SetSortArray(VelrhopM1c,velrhopm1);
+  SetSortArray(PosPrec,pospre);
+  SetSortArray(VelrhopPrec,velrhoppre);
+  SetSortArray(VelrhopM1h,velrhopm1h);
+  SetSortArray(PosPrecOff,posprecoff);
+  SetSortArray(VelrhopPrech,velrhopprech);
+  SetSortArray(SpsTauc,spstau);
 
   //-Collect divide data. | Recupera datos del divide.
   Np=CellDivSingle->GetNpFinal();
@@ -461,8 +758,18 @@ void JSphCpuSingle::RunCellDivide(bool updateperiodic){
   NpbOk=Npb-CellDivSingle->GetNpbIgnore();
   //-Collect position of floating particles. | Recupera posiciones de floatings.
   if(CaseNfloat)CalcRidp(PeriActive!=0,Np-Npb,Npb,CaseNpb,CaseNpb+CaseNfloat,Codec,Idpc,FtRidp);
+  //-Places particle arrays in the NUMA nodes of the threads that process them. | Ubica los arrays de particulas en los nodos NUMA de los hilos que los procesan.
+  if(NumaArrays && Numa->CheckPlacement(Npb,Np))NumaPlaceArrays();
   TmcStop(Timers,TMC_NlSortData);
 
+  //-Reorder data of neighbour list (excluded particles are removed from the list).
+  //-Reordena datos de la lista de vecinos (las particulas excluidas se eliminan de la lista).
+  if(NeighList){
+    TmcStart(Timers,TMC_NlNeighList);
+    NeighList->SortData(Np,Npb,NpbOk,(CellDivSingle->GetDivideFull()? 0: Npb),CellDivSingle->GetSortPart());
+    TmcStop(Timers,TMC_NlNeighList);
+  }
+
   //-Control of excluded particles (only fluid because if some bound is excluded ti generates an exception in Divide()).
   //-Gestion de particulas excluidas (solo fluid pq si alguna bound es excluida se genera excepcion en Divide()).
   TmcStart(Timers,TMC_NlOutCheck);
@@ -518,6 +825,22 @@ void JSphCpuSingle::Interaction_Forces(TpInter tinter){
   if(Psingle)JSphCpu::InteractionSimple_Forces(Np,Npb,NpbOk,CellDivSingle->GetNcells(),CellDivSingle->GetBeginCell(),CellDivSingle->GetCellDomainMin(),Dcellc,PsPosc,Velrhopc,Idpc,Codec,Pressc,viscdt,Arc,Acec,Deltac,SpsTauc,SpsGradvelc,ShiftPosc,ShiftDetectc);
   else JSphCpu::Interaction_Forces(Np,Npb,NpbOk,CellDivSingle->GetNcells(),CellDivSingle->GetBeginCell(),CellDivSingle->GetCellDomainMin(),Dcellc,Posc,Velrhopc,Idpc,Codec,Pressc,viscdt,Arc,Acec,Deltac,SpsTauc,SpsGradvelc,ShiftPosc,ShiftDetectc);
 
+  if(FusedInter){
+    //-Zero 2nd component of ace in 2-D, adds Delta-SPH to Arc[] and calculates AceMax in one sweep.
+    //-Anula 2 componente de ace en 2D, aade Delta-SPH a Arc[] y calcula AceMax en un barrido.
+    ViscDtMax=viscdt;
+    if(PeriActive!=0){
+      if(Simulate2D)AceMax=PosInteractionFused_Forces<true,true>  (Np,Npb,Acec,Arc,Deltac,Codec);
+      else          AceMax=PosInteractionFused_Forces<true,false> (Np,Npb,Acec,Arc,Deltac,Codec);
+    }
+    else{
+      if(Simulate2D)AceMax=PosInteractionFused_Forces<false,true> (Np,Npb,Acec,Arc,Deltac,Codec);
+      else          AceMax=PosInteractionFused_Forces<false,false>(Np,Npb,Acec,Arc,Deltac,Codec);
+    }
+    TmcStop(Timers,TMC_CfForces);
+    return;
+  }
+
   //-For 2-D simulations zero the 2nd component. | Para simulaciones 2D anula siempre la 2 componente.
   if(Simulate2D){
     const int ini=int(Npb),fin=int(Np),npf=int(Np-Npb);
@@ -545,6 +868,44 @@ void JSphCpuSingle::Interaction_Forces(TpInter tinter){
   TmcStop(Timers,TMC_CfForces);
 }
 
+//==============================================================================
+/// Applies the corrections of ace and ar after interaction in one sweep over 
+/// fluid particles and returns maximum value of ace (modulus).
+/// Aplica las correcciones de ace y ar tras la interaccion en un barrido de las
+/// particulas de fluido y devuelve el valor maximo de ace (modulo).
+//==============================================================================
+template<bool checkcodenormal,bool sim2d> double JSphCpuSingle::PosInteractionFused_Forces
+  (unsigned np,unsigned npb,tfloat3* ace,float *ar,const float *delta,const typecode *code)const
+{
+  float amaxth[OMP_MAXTHREADS*OMP_STRIDE];
+  for(int th=0;th<OmpThreads;th++)amaxth[th*OMP_STRIDE]=0;
+  const int ini=int(npb),fin=int(np),npf=int(np-npb);
+  #ifdef OMP_USE
+    #pragma omp parallel if(npf>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  {
+    const int th=omp_get_thread_num();
+    float amax2=0;
+    #ifdef OMP_USE
+      #pragma omp for schedule (static)
+    #endif
+    for(int p=ini;p<fin;p++){
+      tfloat3 a=ace[p];
+      if(sim2d){ a.y=0; ace[p].y=0; }
+      if(delta && delta[p]!=FLT_MAX)ar[p]+=delta[p];
+      //-With periodic conditions ignore periodic particles. | Con condiciones periodicas ignora las particulas periodicas.
+      if(!checkcodenormal || CODE_IsNormal(code[p])){
+        const float a2=a.x*a.x+a.y*a.y+a.z*a.z;
+        if(amax2<a2)amax2=a2;
+      }
+    }
+    amaxth[th*OMP_STRIDE]=amax2;
+  }
+  float amax=0;
+  for(int th=0;th<OmpThreads;th++)if(amax<amaxth[th*OMP_STRIDE])amax=amaxth[th*OMP_STRIDE];
+  return(sqrt(double(amax)));
+}
+
 //==============================================================================
 /// Returns maximum value of ace (modulus).
 /// Devuelve el valor maximo de ace (modulo).
@@ -645,7 +1006,7 @@ double JSphCpuSingle::ComputeStep_Sym(){
   DemDtForce=dt*0.5f;                     //(DEM)
   Interaction_Forces(INTER_Forces);       //-Interaction.
   const double ddt_p=DtVariable(false);   //-Calculate dt of predictor step.
-  if(TShifting)RunShifting(dt*.5);        //-Shifting.
+  if(TShifting && !FusedStep)RunShifting(dt*.5); //-Shifting (computed in ComputeSymplecticPre() with FusedStep).
   ComputeSymplecticPre(dt);               //-Apply Symplectic-Predictor to particles.
   if(CaseNfloat)RunFloating(dt*.5,true);  //-Control of floating bodies.
   PosInteraction_Forces();                //-Free memory used for interaction.
@@ -655,11 +1016,11 @@ double JSphCpuSingle::ComputeStep_Sym(){
   RunCellDivide(true);
   Interaction_Forces(INTER_ForcesCorr);   //Interaction.
   const double ddt_c=DtVariable(true);    //-Calculate dt of corrector step.
-  if(TShifting)RunShifting(dt);           //-Shifting.
+  if(TShifting && !FusedStep)RunShifting(dt); //-Shifting (computed in ComputeSymplecticCorr() with FusedStep).
   ComputeSymplecticCorr(dt);              //-Apply Symplectic-Corrector to particles.
   if(CaseNfloat)RunFloating(dt,false);    //-Control of floating bodies.
   PosInteraction_Forces();                //-Free memory used for interaction.
-  if(Damping)RunDamping(dt,Np,Npb,Posc,Codec,Velrhopc); //-Applies Damping.
+  if(Damping && !FusedStep)RunDamping(dt,Np,Npb,Posc,Codec,Velrhopc); //-Applies Damping (computed in ComputeSymplecticCorr() with FusedStep).
 
   DtPre=min(ddt_p,ddt_c);                 //-Calculate dt for next ComputeStep.
   return(dt);
@@ -687,13 +1048,22 @@ tfloat3 JSphCpuSingle::FtPeriodicDist(const tdouble3 &pos,const tdouble3 &center
 }
 
 //==============================================================================
-/// Calculate summation: face, fomegaace.
-/// Calcula suma de face y fomegaace a partir de particulas floating.
+/// Returns the range of floating particles (in FtRidp) of block b.
+/// Devuelve el intervalo de particulas floating (en FtRidp) del bloque b.
 //==============================================================================
-void JSphCpuSingle::FtCalcForcesSum(unsigned cf,tfloat3 &face,tfloat3 &fomegaace)const{
+void JSphCpuSingle::FtGetBlockRange(unsigned b,unsigned &fpini,unsigned &fpfin)const{
+  const unsigned cf=FtBlockFt[b];
+  const unsigned fpini0=FtObjs[cf].begin-CaseNpb;
+  fpini=fpini0+(b-FtBlockIni[cf])*FT_BLOCKSIZE;
+  fpfin=min(fpini+FT_BLOCKSIZE,fpini0+FtObjs[cf].count);
+}
+
+//==============================================================================
+/// Calculate summation: face, fomegaace of floating particles fpini-fpfin.
+/// Calcula suma de face y fomegaace a partir de particulas floating fpini-fpfin.
+//==============================================================================
+void JSphCpuSingle::FtCalcForcesSum(unsigned cf,unsigned fpini,unsigned fpfin,tfloat3 &face,tfloat3 &fomegaace)const{
   const StFloatingData fobj=FtObjs[cf];
-  const unsigned fpini=fobj.begin-CaseNpb;
-  const unsigned fpfin=fpini+fobj.count;
   const float fradius=fobj.radius;
   const tdouble3 fcenter=fobj.center;
   //-Computes traslational and rotational velocities.
@@ -714,9 +1084,26 @@ void JSphCpuSingle::FtCalcForcesSum(unsigned cf,tfloat3 &face,tfloat3 &fomegaace
 
 //==============================================================================
 /// Calculate forces around floating object particles.
+/// The summation is computed in parallel by blocks of FT_BLOCKSIZE particles
+/// so large floatings use all threads, then the partial sums of each floating
+/// are added in order of block (the result does not depend on the threads).
 /// Calcula fuerzas sobre floatings.
+/// El sumatorio se calcula en paralelo por bloques de FT_BLOCKSIZE particulas
+/// para que los floatings grandes usen todos los hilos, despues se suman las
+/// sumas parciales de cada floating en orden de bloque (el resultado no depende
+/// de los hilos).
 //==============================================================================
 void JSphCpuSingle::FtCalcForces(StFtoForces *ftoforces)const{
+  //-Calculate partial summation of each block. | Calcula sumatorio parcial de cada bloque.
+  const int nblock=int(FtBlockCount);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static)
+  #endif
+  for(int b=0;b<nblock;b++){
+    unsigned fpini,fpfin;
+    FtGetBlockRange(unsigned(b),fpini,fpfin);
+    FtCalcForcesSum(FtBlockFt[b],fpini,fpfin,FtoBlockForces[b].face,FtoBlockForces[b].fomegaace);
+  }
   const int ftcount=int(FtCount);
   #ifdef OMP_USE
     #pragma omp parallel for schedule (guided)
@@ -734,9 +1121,13 @@ void JSphCpuSingle::FtCalcForces(StFtoForces *ftoforces)const{
     //-Calculates the inverse of the intertia matrix to compute the I^-1 * L= W
     const tmatrix3f invinert=fmath::InverseMatrix3x3(inert);
 
-    //-Computes traslational and rotational velocities.
-    tfloat3 face,fomegaace;
-    FtCalcForcesSum(cf,face,fomegaace);
+    //-Computes traslational and rotational velocities. | Suma las sumas parciales de los bloques.
+    tfloat3 face=FtoBlockForces[FtBlockIni[cf]].face;
+    tfloat3 fomegaace=FtoBlockForces[FtBlockIni[cf]].fomegaace;
+    for(unsigned b=FtBlockIni[cf]+1;b<FtBlockIni[cf+1];b++){
+      face=face+FtoBlockForces[b].face;
+      fomegaace=fomegaace+FtoBlockForces[b].fomegaace;
+    }
 
     //-Calculate omega starting from fomegaace & invinert. | Calcula omega a partir de fomegaace y invinert.
     {
@@ -808,46 +1199,52 @@ void JSphCpuSingle::RunFloating(double dt,bool predictor){
     //-Calculate data to update floatings. | Calcula datos para actualizar floatings.
     FtCalcForcesRes(dt,FtoForces,FtoForcesRes);
 
-    //-Apply movement around floating objects. | Aplica movimiento sobre floatings.
-    const int ftcount=int(FtCount);
+    //-Apply movement around floating objects using the same blocks (and threads) of FtCalcForces(). | Aplica movimiento sobre floatings usando los mismos bloques (e hilos) de FtCalcForces().
+    const int nblock=int(FtBlockCount);
     #ifdef OMP_USE
-      #pragma omp parallel for schedule (guided)
+      #pragma omp parallel for schedule (static)
     #endif
-    for(int cf=0;cf<ftcount;cf++){
+    for(int b=0;b<nblock;b++){
       //-Get Floating object values.
-      const StFloatingData fobj=FtObjs[cf];
+      const unsigned cf=FtBlockFt[b];
       const tfloat3 fomega=FtoForcesRes[cf].fomegares;
       const tfloat3 fvel=FtoForcesRes[cf].fvelres;
       const tdouble3 fcenter=FtoForcesRes[cf].fcenterres;
       //-Updates floating particles.
-      const float fradius=fobj.radius;
-      const unsigned fpini=fobj.begin-CaseNpb;
-      const unsigned fpfin=fpini+fobj.count;
+      const float fradius=FtObjs[cf].radius;
+      unsigned fpini,fpfin;
+      FtGetBlockRange(unsigned(b),fpini,fpfin);
       for(unsigned fp=fpini;fp<fpfin;fp++){
         const int p=FtRidp[fp];
         if(p!=UINT_MAX){
           tfloat4 *velrhop=Velrhopc+p;
+          //-Values of predictor stored as differences with the current ones (CompactState). | Valores del predictor guardados como diferencias con los actuales (CompactState).
+          const tfloat4 vrpre=(VelrhopPrech? ExpandVelrhop(VelrhopPrech[p],*velrhop): TFloat4(0));
           //-Compute and record position displacement. | Calcula y graba desplazamiento de posicion.
           const double dx=dt*double(velrhop->x);
           const double dy=dt*double(velrhop->y);
           const double dz=dt*double(velrhop->z);
           UpdatePos(Posc[p],dx,dy,dz,false,p,Posc,Dcellc,Codec);
+          if(PosPrecOff)PosPrecOff[p]=PosPrecOff[p]-TFloat3(float(dx),float(dy),float(dz));
           //-Compute and record new velocity. | Calcula y graba nueva velocidad.
           tfloat3 dist=(PeriActive? FtPeriodicDist(Posc[p],fcenter,fradius): ToTFloat3(Posc[p]-fcenter)); 
           velrhop->x=fvel.x+(fomega.y*dist.z-fomega.z*dist.y);
           velrhop->y=fvel.y+(fomega.z*dist.x-fomega.x*dist.z);
           velrhop->z=fvel.z+(fomega.x*dist.y-fomega.y*dist.x);
+          if(VelrhopPrech)VelrhopPrech[p]=CompactVelrhop(vrpre,*velrhop);
         }
       }
+    }
 
-      //-Stores floating data.
-      if(!predictor){
-        //const tdouble3 centerold=FtObjs[cf].center;
-        FtObjs[cf].center=(PeriActive? UpdatePeriodicPos(fcenter): fcenter);
-        FtObjs[cf].angles=ToTFloat3(ToTDouble3(FtObjs[cf].angles)+ToTDouble3(fomega)*dt);
-        FtObjs[cf].fvel=fvel;
-        FtObjs[cf].fomega=fomega;
-      }
+    //-Stores floating data.
+    if(!predictor)for(unsigned cf=0;cf<FtCount;cf++){
+      const tfloat3 fomega=FtoForcesRes[cf].fomegares;
+      const tdouble3 fcenter=FtoForcesRes[cf].fcenterres;
+      //const tdouble3 centerold=FtObjs[cf].center;
+      FtObjs[cf].center=(PeriActive? UpdatePeriodicPos(fcenter): fcenter);
+      FtObjs[cf].angles=ToTFloat3(ToTDouble3(FtObjs[cf].angles)+ToTDouble3(fomega)*dt);
+      FtObjs[cf].fvel=FtoForcesRes[cf].fvelres;
+      FtObjs[cf].fomega=fomega;
     }
     TmcStop(Timers,TMC_SuFloating);
   }
@@ -859,7 +1256,8 @@ void JSphCpuSingle::RunFloating(double dt,bool predictor){
 //==============================================================================
 void JSphCpuSingle::RunGaugeSystem(double timestep){
   const bool svpart=(TimeStep>=TimePartNext);
-  GaugeSystem->CalculeCpu(timestep,svpart,CellDivSingle->GetNcells(),CellDivSingle->GetCellDomainMin(),CellDivSingle->GetBeginCell(),Posc,Codec,Velrhopc);
+  GaugeSystem->CalculeCpu(timestep,svpart,CellDivSingle->GetNcells(),CellDivSingle->GetCellDomainMin(),CellDivSingle->GetBeginCell(),CellDivSingle->GetCellRow(),Posc,Codec,Velrhopc);
+  if(MemTrack && GaugeSystem->GetCount())MemTrack->SetBlock("Gauges",GaugeSystem->GetAllocMemory());
 }
 
 //==============================================================================
@@ -883,6 +1281,7 @@ void JSphCpuSingle::Run(std::string appname,JCfgRun *cfg,JLog2 *log){
   ConfigConstants(Simulate2D);
   ConfigDomain();
   ConfigRunMode(cfg);
+  CellDivSingle->SetIncDivide(IncDivide);
   VisuParticleSummary();
 
   //-Initialisation of execution variables. | Inicializacion de variables de ejecucion.
@@ -893,6 +1292,7 @@ void JSphCpuSingle::Run(std::string appname,JCfgRun *cfg,JLog2 *log){
   PrintAllocMemory(GetAllocMemoryCpu());
   SaveData(); 
   TmcResetValues(Timers);
+  if(CellBalance)CellBalance->ResetTimes();
   TmcStop(Timers,TMC_Init);
   PartNstep=-1; Part++;
 
@@ -904,13 +1304,16 @@ void JSphCpuSingle::Run(std::string appname,JCfgRun *cfg,JLog2 *log){
   TimerPart.Start();
   Log->Print(string("\n[Initialising simulation (")+RunCode+")  "+fun::GetDateTime()+"]");
   PrintHeadPart();
+  JTimer timerstep;
   while(TimeStep<TimeMax){
+    if(CellModeAuto)timerstep.Start();
     if(ViscoTime)Visco=ViscoTime->GetVisco(float(TimeStep));
     double stepdt=ComputeStep();
     RunGaugeSystem(TimeStep+stepdt);
     if(PartDtMin>stepdt)PartDtMin=stepdt; if(PartDtMax<stepdt)PartDtMax=stepdt;
     if(CaseNmoving)RunMotion(stepdt);
     RunCellDivide(true);
+    if(CellModeAuto){ timerstep.Stop(); RunCellModeAuto(timerstep.GetElapsedTimeD()); }
     TimeStep+=stepdt;
     partoutstop=(Np<NpMinimum || !Np);
     if(TimeStep>=TimePartNext || partoutstop){
@@ -970,6 +1373,11 @@ void JSphCpuSingle::SaveData(){
     infoplus.npbper=NpbPer;
     infoplus.npfper=NpfPer;
     infoplus.memorycpualloc=this->GetAllocMemoryCpu();
+    if(MemTrack){
+      infoplus.memorycpupeak=MemTrack->GetPartAllocPeak();
+      infoplus.memorycpupeakused=MemTrack->GetPartUsedPeak();
+      infoplus.memorycpupeakphase=MemTrack->GetPartPhaseName();
+    }
     infoplus.gpudata=false;
     TimerSim.Stop();
     infoplus.timesim=TimerSim.GetElapsedTimeD()/1000.;
@@ -993,6 +1401,17 @@ void JSphCpuSingle::FinishRun(bool stop){
   float tsim=TimerSim.GetElapsedTimeF()/1000.f,ttot=TimerTot.GetElapsedTimeF()/1000.f;
   JSph::ShowResume(stop,tsim,ttot,true,"");
   string hinfo=";RunMode",dinfo=string(";")+RunMode;
+  if(NeighList)Log->Printf("Neighbour list: %u builds, %u reuses and %u periodic crossings.",NeighList->GetNumBuild(),NeighList->GetNumReuse(),NeighList->GetNumPeriodic());
+  if(NumaArrays)Log->Printf("NUMA placement: %u renewals of particle arrays.",Numa->GetNumPlace());
+  if(CellSparse)Log->Printf("Sparse cells: %u of %u rows of cells stored in the last divide.",CellDivSingle->GetRowsStored(),CellDivSingle->GetNcy()*CellDivSingle->GetNcz());
+  if(CellBalance)Log->Printf("Cell balance: %u chunks taken from other threads.",CellBalance->GetNumSteal());
+  if(ArraysStats)Log->Print(string("Particle arrays:\n")+ArraysCpu->GetStatsInfo(Nstep));
+  if(MemTrack){
+    vector<string> lines;
+    MemTrack->GetPhasesInfo(lines);
+    Log->Print("Peak of CPU memory by phase:");
+    Log->Print(lines);
+  }
   if(SvTimers){
     ShowTimers();
     GetTimersInfo(hinfo,dinfo);
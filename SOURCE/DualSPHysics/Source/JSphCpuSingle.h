@@ -44,16 +44,25 @@ protected:
   void LoadConfig(JCfgRun *cfg);
   void LoadCaseParticles();
   void ConfigDomain();
+  void CreateCellDiv();
+  void ChangeCellMode(TpCellMode cellmode);
+  void RunCellModeAuto(double steptime);
 
   void ResizeParticlesSize(unsigned newsize,float oversize,bool updatedivide);
-  unsigned PeriodicMakeList(unsigned np,unsigned pini,bool stable,unsigned nmax,tdouble3 perinc,const tdouble3 *pos,const typecode *code,unsigned *listp)const;
+  unsigned PeriodicCount(const tdouble3 &ps)const;
+  unsigned PeriodicMarkBand(unsigned np,unsigned *listband,unsigned &npernew);
+  unsigned PeriodicMakeListRange(unsigned p0,unsigned p1,unsigned pini,const unsigned *listband,tdouble3 perinc,const tdouble3 *pos,const typecode *code,unsigned cp,unsigned *listp)const;
+  unsigned PeriodicMakeList(unsigned n,unsigned pini,const unsigned *listband,tdouble3 perinc,const tdouble3 *pos,const typecode *code,unsigned *listp)const;
   void PeriodicDuplicatePos(unsigned pnew,unsigned pcopy,bool inverse,double dx,double dy,double dz,tuint3 cellmax,tdouble3 *pos,unsigned *dcell)const;
   void PeriodicDuplicateVerlet(unsigned np,unsigned pini,tuint3 cellmax,tdouble3 perinc,const unsigned *listp
-    ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tfloat4 *velrhopm1)const;
+    ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tfloat4 *velrhopm1,thalf4 *velrhopm1h)const;
   void PeriodicDuplicateSymplectic(unsigned np,unsigned pini,tuint3 cellmax,tdouble3 perinc,const unsigned *listp
-    ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tdouble3 *pospre,tfloat4 *velrhoppre)const;
+    ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tdouble3 *pospre,tfloat4 *velrhoppre
+    ,tfloat3 *posprecoff,thalf4 *velrhopprech)const;
   void RunPeriodic();
 
+  template<class T> T* AddSortArray(T *vec);
+  template<class T> void SetSortArray(T *&vec,T *sorted);
   void RunCellDivide(bool updateperiodic);
 
   inline void GetInteractionCells(unsigned rcell
@@ -64,13 +73,15 @@ protected:
   
   template<bool checkcodenormal> double ComputeAceMaxSeq(unsigned np,const tfloat3* ace,const typecode *code)const;
   template<bool checkcodenormal> double ComputeAceMaxOmp(unsigned np,const tfloat3* ace,const typecode *code)const;
+  template<bool checkcodenormal,bool sim2d> double PosInteractionFused_Forces(unsigned np,unsigned npb,tfloat3* ace,float *ar,const float *delta,const typecode *code)const;
   
   double ComputeStep(){ return(TStep==STEP_Verlet? ComputeStep_Ver(): ComputeStep_Sym()); }
   double ComputeStep_Ver();
   double ComputeStep_Sym();
 
   inline tfloat3 FtPeriodicDist(const tdouble3 &pos,const tdouble3 &center,float radius)const;
-  void FtCalcForcesSum(unsigned cf,tfloat3 &face,tfloat3 &fomegaace)const;
+  inline void FtGetBlockRange(unsigned b,unsigned &fpini,unsigned &fpfin)const;
+  void FtCalcForcesSum(unsigned cf,unsigned fpini,unsigned fpfin,tfloat3 &face,tfloat3 &fomegaace)const;
   void FtCalcForces(StFtoForces *ftoforces)const;
   void FtCalcForcesRes(double dt,const StFtoForces *ftoforces,StFtoForcesRes *ftoforcesres)const;
   void RunFloating(double dt,bool predictor);
@@ -53,8 +53,9 @@ typedef enum{
   ,TMC_SuPeriodic=11
   ,TMC_SuResizeNp=12
   ,TMC_SuSavePart=13
+  ,TMC_NlNeighList=14
 }CsTypeTimerCPU;
-#define TMC_COUNT 14
+#define TMC_COUNT 15
 
 typedef StSphTimerCpu TimersCpu[TMC_COUNT];
 
@@ -77,6 +78,7 @@ inline const char* TmcGetName(CsTypeTimerCPU ct){
     case TMC_SuPeriodic:        return("SU-Periodic");
     case TMC_SuResizeNp:        return("SU-ResizeNp");
     case TMC_SuSavePart:        return("SU-SavePart");
+    case TMC_NlNeighList:       return("NL-NeighList");
   }
   return("???");
 }
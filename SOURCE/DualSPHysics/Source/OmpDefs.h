@@ -25,7 +25,7 @@
 
 #define OMP_USE  ///<Enables/Disables OpenMP.
 #ifdef OMP_USE
-  //#define OMP_USE_RADIXSORT ///<Enables/disables OpenMP in JRadixSort.
+  #define OMP_USE_RADIXSORT ///<Enables/disables OpenMP in JRadixSort.
   #define OMP_USE_WAVEGEN ///<Enables/disables OpenMP in JWaveGen.
 #endif
 
@@ -149,6 +149,11 @@ typedef struct{ //(DEM)
   float restitu;      ///<Restitution Coefficient (units:-).
 }StDemData;
 
+///Structure with four values in half precision (IEEE 754 binary16) for compact storage of particle data.
+typedef struct{
+  word x,y,z,w;
+}thalf4;
+
 
 ///Controls the output of information on the screen and/or log.
 typedef enum{ 
@@ -176,6 +181,7 @@ typedef enum{
 
 ///Types of kernel function.
 typedef enum{ 
+  KERNEL_Table=4,     ///<Kernel of TKernel interpolated from tables (internal use on CPU).
   KERNEL_Gaussian=3,  ///<Gaussian kernel.
   KERNEL_Wendland=2,  ///<Wendland kernel.
   KERNEL_Cubic=1,     ///<Cubic Spline kernel.
@@ -406,6 +412,42 @@ inline const char* GetNameBlockSizeMode(TpBlockSizeMode bsizemode){
   return("???");
 }
 
+///Modes of SIMD instructions for particle interaction on CPU.
+typedef enum{ 
+   SIMDMODE_None=0     ///<Scalar code (by default).
+  ,SIMDMODE_Auto=1     ///<Best instruction set available on the CPU.
+  ,SIMDMODE_Avx2=2     ///<AVX2 instructions (8 values per operation).
+  ,SIMDMODE_Avx512=3   ///<AVX-512 instructions (16 values per operation).
+}TpSimdMode; 
+
+///Returns the name of the SIMD mode in text format.
+inline const char* GetNameSimdMode(TpSimdMode simdmode){
+  switch(simdmode){
+    case SIMDMODE_None:    return("None");
+    case SIMDMODE_Auto:    return("Auto");
+    case SIMDMODE_Avx2:    return("AVX2");
+    case SIMDMODE_Avx512:  return("AVX-512");
+  }
+  return("???");
+}
+
+///Space-filling curve to order the rows of cells along X (only CPU).
+typedef enum{ 
+   CELLSFC_None=0      ///<Rows of cells in row-major order (by default).
+  ,CELLSFC_Morton=1    ///<Rows of cells following a Morton curve in the Y-Z plane.
+  ,CELLSFC_Hilbert=2   ///<Rows of cells following a Hilbert curve in the Y-Z plane.
+}TpCellSfc; 
+
+///Returns the name of the space-filling curve in text format.
+inline const char* GetNameCellSfc(TpCellSfc cellsfc){
+  switch(cellsfc){
+    case CELLSFC_None:     return("None");
+    case CELLSFC_Morton:   return("Morton");
+    case CELLSFC_Hilbert:  return("Hilbert");
+  }
+  return("???");
+}
+
 ///Codificacion de celdas para posicion.
 ///Codification of cells for position.
 #define PC__CodeOut 0xffffffff
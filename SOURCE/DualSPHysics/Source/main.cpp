@@ -45,6 +45,7 @@ Please download source files and documentation from <a href="http://dual.sphysic
 #include "JCfgRun.h"
 #include "JException.h"
 #include "JSphCpuSingle.h"
+#include "JRadixSort.h"
 #ifdef _WITHGPU
   #include "JSphGpuSingle.h"
 #endif
@@ -133,7 +134,8 @@ int main(int argc, char** argv){
   try{
     cfg.LoadArgv(argc,argv);
     //cfg.VisuConfig();
-    if(!cfg.PrintInfo){
+    if(cfg.BenchRadix && !cfg.PrintInfo)printf("\n%s",JRadixSort::RunBenchmark(cfg.BenchRadix).c_str());
+    else if(!cfg.PrintInfo){
       log.Init(cfg.DirOut+"/Run.out",cfg.DirDataOut,cfg.CsvSepComa);
       log.Print(license,JLog2::Out_File);
       log.Print(appname,JLog2::Out_File);